@@ -0,0 +1,141 @@
+// battery_filter_test: replays raw ADC bursts through the battery filter
+// (battery_filter.c) and checks the median, trimmed mean, spread and
+// trimmed count against the values stored with each burst.
+//
+//   battery_filter_test host/traces/adc_bursts.txt
+//
+// Exit status 0 when every burst matches (run by ctest).
+
+#include "battery_filter.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_SAMPLES 512
+#define NAME_SIZE 48
+
+typedef struct {
+    char name[NAME_SIZE];
+    unsigned trim_percent;
+    unsigned long median;
+    unsigned long value;
+    unsigned long spread;
+    unsigned long trimmed;
+    uint16_t samples[MAX_SAMPLES];
+    size_t count;
+} burst_t;
+
+// Next logical line: comments skipped, "\" continuations joined
+static char* read_line(FILE* f, char* line, size_t size) {
+    size_t used = 0;
+    line[0] = '\0';
+    char buf[512];
+    while (fgets(buf, sizeof(buf), f) != NULL) {
+        size_t len = strcspn(buf, "\r\n");
+        buf[len] = '\0';
+        if (used == 0 && (buf[0] == '#' || buf[strspn(buf, " \t")] == '\0')) {
+            continue;
+        }
+        bool more = len > 0 && buf[len - 1] == '\\';
+        if (more) {
+            buf[--len] = '\0';
+        }
+        if (used + len + 2 > size) {
+            return NULL;
+        }
+        memcpy(line + used, buf, len);
+        used += len;
+        line[used++] = ' ';
+        line[used] = '\0';
+        if (!more) {
+            return line;
+        }
+    }
+    return used > 0 ? line : NULL;
+}
+
+static bool parse_burst(char* line, burst_t* burst) {
+    int consumed = 0;
+    if (sscanf(line, "%47s %u %lu %lu %lu %lu : %n", burst->name, &burst->trim_percent, &burst->median,
+               &burst->value, &burst->spread, &burst->trimmed, &consumed) != 6 || consumed == 0) {
+        return false;
+    }
+    burst->count = 0;
+    char* p = line + consumed;
+    char* end;
+    for (unsigned long sample = strtoul(p, &end, 10); end != p; sample = strtoul(p, &end, 10)) {
+        if (burst->count == MAX_SAMPLES || sample > 4095) {
+            return false;
+        }
+        burst->samples[burst->count++] = (uint16_t)sample;
+        p = end;
+    }
+    return burst->count > 0;
+}
+
+static bool check(const char* name, const char* what, unsigned long got, unsigned long want) {
+    if (got == want) {
+        return true;
+    }
+    printf("FAIL %s: %s %lu, expected %lu\n", name, what, got, want);
+    return false;
+}
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s TRACE_FILE\n", argv[0]);
+        return 2;
+    }
+    FILE* f = fopen(argv[1], "r");
+    if (f == NULL) {
+        perror(argv[1]);
+        return 2;
+    }
+
+    static char line[MAX_SAMPLES * 8];
+    static burst_t burst;
+    static uint16_t work[MAX_SAMPLES];
+    int bursts = 0;
+    int failures = 0;
+    while (read_line(f, line, sizeof(line)) != NULL) {
+        if (!parse_burst(line, &burst)) {
+            fprintf(stderr, "%s: malformed burst after %d: %.40s\n", argv[1], bursts, line);
+            fclose(f);
+            return 2;
+        }
+        bursts++;
+
+        // Both filters sort in place: each gets its own copy
+        memcpy(work, burst.samples, burst.count * sizeof(uint16_t));
+        bool ok = check(burst.name, "median", battery_filter_median(work, burst.count), burst.median);
+        for (size_t i = 1; i < burst.count; i++) {
+            if (work[i - 1] > work[i]) {
+                printf("FAIL %s: not sorted at %zu\n", burst.name, i);
+                ok = false;
+                break;
+            }
+        }
+
+        battery_filter_result_t result;
+        memcpy(work, burst.samples, burst.count * sizeof(uint16_t));
+        battery_filter_trimmed_mean(work, burst.count, (uint8_t)burst.trim_percent, &result);
+        ok &= check(burst.name, "value", result.value, burst.value);
+        ok &= check(burst.name, "median", result.median, burst.median);
+        ok &= check(burst.name, "spread", result.spread, burst.spread);
+        ok &= check(burst.name, "trimmed", result.trimmed, burst.trimmed);
+
+        printf("%-4s %-16s %3zu samples, trim %2u%%: value %4lu, median %4lu, spread %3lu, trimmed %zu\n",
+               ok ? "ok" : "FAIL", burst.name, burst.count, burst.trim_percent, (unsigned long)result.value,
+               (unsigned long)result.median, (unsigned long)result.spread, result.trimmed);
+        failures += ok ? 0 : 1;
+    }
+    fclose(f);
+
+    if (bursts == 0) {
+        fprintf(stderr, "%s: no bursts\n", argv[1]);
+        return 2;
+    }
+    printf("%d of %d bursts match\n", bursts - failures, bursts);
+    return failures == 0 ? 0 : 1;
+}
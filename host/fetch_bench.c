@@ -0,0 +1,253 @@
+// fetch_bench: drives the firmware quote fetch (wikiquote.c over the Linux
+// HTTP backend) against tools/mock_quote_server.py, one scenario at a time,
+// and reports latency, bytes, heap allocations, retries and connection
+// reuse per scenario. Each run is one wake: kept-alive connections are
+// closed between runs.
+
+#define _GNU_SOURCE  // nftw()
+
+#include "sim.h"
+#include "hal_http.h"
+#include "wikiquote.h"
+#include "esp_log.h"
+#include "cJSON.h"
+#include <curl/curl.h>
+#include <ftw.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_RUNS 20
+#define MAX_RUNS 1000
+#define FETCH_DEADLINE_MS 10000   // wikiquote.c HTTP_TIMEOUT_MS
+#define DEADLINE_SLACK_MS 250     // Allowed past the deadline (scheduling, teardown)
+
+typedef struct {
+    const char* label;
+    const char* name;
+    const char* params;
+    int max_runs;             // Caps --runs for scenarios that wait out the deadline (0: none)
+    bool check_deadline;      // Fail if a call takes longer than the fetch deadline
+} bench_scenario_t;
+
+static const bench_scenario_t scenarios[] = {
+    {"ok", "ok", "", 0, false},
+    {"latency_200ms", "latency", "delay_ms=200", 0, false},
+    {"chunked_16B", "chunked", "chunk=16&delay_ms=2", 0, false},
+    {"oversize", "oversize", "", 0, false},
+    {"oversize_body", "oversize_body", "size=8192", 0, false},
+    {"malformed", "malformed", "", 0, false},
+    {"missing_fields", "missing_fields", "", 0, false},
+    {"error_500", "error", "status=500", 0, false},
+    {"error_404", "error", "status=404", 0, false},
+    {"flaky_503", "flaky", "", 0, false},
+    {"repeat", "repeat", "", 0, false},
+    // The retry goes out on the kept-alive connection, which then stalls
+    // past the deadline: the call must still end at the deadline
+    {"slow_reuse", "slow_reuse", "delay_ms=12000", 3, true},
+};
+#define SCENARIO_COUNT (sizeof(scenarios) / sizeof(scenarios[0]))
+
+// Heap accounting for the fetch path: cJSON is the only allocator the
+// firmware code uses there (the HTTP client's own buffers are not comparable
+// between esp_http_client and libcurl)
+static struct {
+    uint32_t calls;
+    size_t current;
+    size_t peak;
+} heap;
+
+typedef union {
+    size_t size;
+    max_align_t align;
+} alloc_header_t;
+
+static void* counting_malloc(size_t size) {
+    alloc_header_t* block = malloc(sizeof(alloc_header_t) + size);
+    if (block == NULL) {
+        return NULL;
+    }
+    block->size = size;
+    heap.calls++;
+    heap.current += size;
+    if (heap.current > heap.peak) {
+        heap.peak = heap.current;
+    }
+    return block + 1;
+}
+
+static void counting_free(void* ptr) {
+    if (ptr == NULL) {
+        return;
+    }
+    alloc_header_t* block = (alloc_header_t*)ptr - 1;
+    heap.current -= block->size;
+    free(block);
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static size_t discard(char* data, size_t size, size_t nmemb, void* user_data) {
+    return size * nmemb;
+}
+
+// Switch the mock server scenario through its control endpoint, on the same
+// listener the firmware URL points at
+static int set_scenario(const bench_scenario_t* scenario) {
+    char url[512];
+    const char* api = QUOTABLE_API_URL;
+    const char* host_end = strchr(strstr(api, "://") + 3, '/');
+    int base_len = host_end ? (int)(host_end - api) : (int)strlen(api);
+    snprintf(url, sizeof(url), "%.*s/_scenario?name=%s%s%s", base_len, api, scenario->name,
+             scenario->params[0] ? "&" : "", scenario->params);
+
+    CURL* curl = curl_easy_init();
+    curl_easy_setopt(curl, CURLOPT_URL, url);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, discard);
+    const char* ca_file = getenv("QUOTE_SIM_CA");
+    if (ca_file != NULL) {
+        curl_easy_setopt(curl, CURLOPT_CAINFO, ca_file);
+    }
+    CURLcode res = curl_easy_perform(curl);
+    long status = 0;
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+    curl_easy_cleanup(curl);
+
+    if (res != CURLE_OK || status != 200) {
+        fprintf(stderr, "Cannot set scenario via %s: %s (status %ld)\n", url,
+                res != CURLE_OK ? curl_easy_strerror(res) : "rejected", status);
+        return -1;
+    }
+    return 0;
+}
+
+static int remove_entry(const char* path, const struct stat* st, int flag, struct FTW* ftw) {
+    return remove(path);
+}
+
+static int compare_double(const void* a, const void* b) {
+    double diff = *(const double*)a - *(const double*)b;
+    return (diff > 0) - (diff < 0);
+}
+
+static int run_scenario(const bench_scenario_t* scenario, int runs) {
+    if (set_scenario(scenario) != 0) {
+        return -1;
+    }
+    if (scenario->max_runs > 0 && runs > scenario->max_runs) {
+        runs = scenario->max_runs;
+    }
+
+    static double real_ms[MAX_RUNS];
+    double modeled_ms = 0;
+    int ok = 0;
+    uint32_t requests = sim_stat(SIM_STAT_HTTP_REQUESTS);
+    uint32_t bytes = sim_stat(SIM_STAT_HTTP_BYTES);
+    uint32_t alloc_calls = heap.calls;
+    heap.peak = heap.current;
+    hal_http_stats_t http_start, http_end;
+    hal_http_get_stats(&http_start);
+
+    for (int i = 0; i < runs; i++) {
+        char quote[512], author[128];
+        int64_t virtual_start = sim_uptime_us();
+        double start = now_ms();
+
+        if (wikiquote_get_random_quote_with_author(quote, sizeof(quote), author, sizeof(author)) == ESP_OK) {
+            ok++;
+        }
+
+        real_ms[i] = now_ms() - start;
+        modeled_ms += (sim_uptime_us() - virtual_start) / 1e3;
+        hal_http_close_idle();  // End of the wake
+    }
+    hal_http_get_stats(&http_end);
+
+    qsort(real_ms, runs, sizeof(real_ms[0]), compare_double);
+    requests = sim_stat(SIM_STAT_HTTP_REQUESTS) - requests;
+    bytes = sim_stat(SIM_STAT_HTTP_BYTES) - bytes;
+
+    printf("%-16s %3d/%-3d %8.1f %8.1f %10.1f %9.0f %8.2f %8.2f %7.2f %9.1f %9zu\n",
+           scenario->label, ok, runs, real_ms[runs / 2], real_ms[(runs * 95) / 100],
+           modeled_ms / runs, (double)bytes / runs, (double)requests / runs,
+           (double)(requests - runs) / runs, (double)(http_end.reused - http_start.reused) / runs,
+           (double)(heap.calls - alloc_calls) / runs, heap.peak);
+
+    if (scenario->check_deadline) {
+        double slowest = real_ms[runs - 1];
+        bool held = slowest <= FETCH_DEADLINE_MS + DEADLINE_SLACK_MS;
+        printf("%-16s slowest call %.1f ms, deadline %d ms %s\n", "", slowest, FETCH_DEADLINE_MS,
+               held ? "held" : "MISSED");
+        return held ? 0 : -1;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    int runs = DEFAULT_RUNS;
+    const char* only = NULL;
+
+    static const struct option long_options[] = {
+        {"runs", required_argument, NULL, 'n'},
+        {"scenario", required_argument, NULL, 's'},
+        {"verbose", no_argument, NULL, 'v'},
+        {NULL, 0, NULL, 0},
+    };
+
+    esp_log_level_set("*", ESP_LOG_NONE);
+    int c;
+    while ((c = getopt_long(argc, argv, "n:s:v", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'n': runs = atoi(optarg); break;
+            case 's': only = optarg; break;
+            case 'v': esp_log_level_set("*", ESP_LOG_INFO); break;
+            default:
+                fprintf(stderr, "Usage: %s [--runs N] [--scenario LABEL] [--verbose]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (runs < 1 || runs > MAX_RUNS) {
+        fprintf(stderr, "--runs must be 1..%d\n", MAX_RUNS);
+        return 2;
+    }
+
+    // Fresh state (NVS: seen-quote filter) per run, so quotes served in an
+    // earlier run are not rejected as repeats
+    char state_dir[] = "/tmp/fetch_bench.XXXXXX";
+    if (mkdtemp(state_dir) == NULL) {
+        perror("fetch_bench: cannot create state directory");
+        return 1;
+    }
+    sim_boot(state_dir, 1, 0);
+
+    cJSON_Hooks hooks = {.malloc_fn = counting_malloc, .free_fn = counting_free};
+    cJSON_InitHooks(&hooks);
+    sim_set_radio(true);  // Station connected for the whole run
+
+    printf("Fetch benchmark: %s, %d runs per scenario\n", QUOTABLE_API_URL, runs);
+    printf("%-16s %7s %8s %8s %10s %9s %8s %8s %7s %9s %9s\n", "scenario", "ok", "p50 ms", "p95 ms",
+           "model ms", "bytes", "requests", "retries", "reused", "allocs", "peak heap");
+
+    int failures = 0;
+    for (size_t i = 0; i < SCENARIO_COUNT; i++) {
+        if (only != NULL && strcmp(only, scenarios[i].label) != 0) {
+            continue;
+        }
+        if (run_scenario(&scenarios[i], runs) != 0) {
+            failures++;
+        }
+    }
+
+    // Leave the server in its default state for the simulator
+    static const bench_scenario_t reset = {"ok", "ok", "", 0, false};
+    set_scenario(&reset);
+    nftw(state_dir, remove_entry, 8, FTW_DEPTH | FTW_PHYS);
+    return failures == 0 ? 0 : 1;
+}
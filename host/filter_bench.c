@@ -0,0 +1,126 @@
+// filter_bench: insert and lookup throughput of the seen-quote filter
+// (quote_filter.c), its measured false-positive rate against the estimate
+// the firmware logs, and its memory footprint. No server or simulator state.
+
+#include "quote_filter.h"
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define DEFAULT_QUOTES 10000
+#define PROBES 100000           // Unseen quotes looked up per measurement
+#define QUOTE_TEXT_SIZE 160
+#define AUTHOR_SIZE 32
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Quote-sized synthetic text: unique per id, so every miss is a true miss
+static void make_quote(uint32_t id, char* text, size_t text_size, char* author, size_t author_size) {
+    snprintf(text, text_size, "Quote number %lu: the unexamined life is not worth living, "
+             "said someone at some point (%08lx).", (unsigned long)id, (unsigned long)(id * 2654435761u));
+    snprintf(author, author_size, "Author %lu", (unsigned long)(id % 997));
+}
+
+int main(int argc, char** argv) {
+    uint32_t quotes = DEFAULT_QUOTES;
+
+    static const struct option long_options[] = {
+        {"quotes", required_argument, NULL, 'n'},
+        {NULL, 0, NULL, 0},
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "n:", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'n': quotes = (uint32_t)strtoul(optarg, NULL, 10); break;
+            default:
+                fprintf(stderr, "Usage: %s [--quotes N]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (quotes < 1) {
+        fprintf(stderr, "--quotes must be at least 1\n");
+        return 2;
+    }
+
+    static quote_filter_t filter;
+    quote_filter_clear(&filter);
+    uint32_t total = quotes + PROBES;  // Inserted, then never-inserted probes
+    char (*texts)[QUOTE_TEXT_SIZE] = malloc(total * sizeof(*texts));
+    char (*authors)[AUTHOR_SIZE] = malloc(total * sizeof(*authors));
+    uint64_t* keys = malloc(total * sizeof(uint64_t));
+    bool* added = malloc(quotes * sizeof(bool));
+    if (texts == NULL || authors == NULL || keys == NULL || added == NULL) {
+        return 1;
+    }
+    for (uint32_t i = 0; i < total; i++) {
+        make_quote(i, texts[i], sizeof(texts[i]), authors[i], sizeof(authors[i]));
+    }
+
+    printf("Seen filter: %d bytes (2 generations x %d bytes), capacity %d-%d quotes, k = %d\n",
+           (int)sizeof(filter), QUOTE_FILTER_BYTES, QUOTE_FILTER_CAPACITY, 2 * QUOTE_FILTER_CAPACITY,
+           QUOTE_FILTER_HASHES);
+
+    double start = now_ns();
+    for (uint32_t i = 0; i < total; i++) {
+        keys[i] = quote_filter_key(texts[i], authors[i]);
+    }
+    double key_ns = (now_ns() - start) / total;
+
+    // Inserts, with generation rotation once past the capacity. A quote
+    // reported as seen is not added, as on the device (it is rejected)
+    uint32_t reported_seen = 0;
+    start = now_ns();
+    for (uint32_t i = 0; i < quotes; i++) {
+        added[i] = quote_filter_add(&filter, keys[i]);
+    }
+    double insert_ns = (now_ns() - start) / quotes;
+
+    // Lookups of the most recently added quotes (always remembered)
+    uint32_t first = quotes > QUOTE_FILTER_CAPACITY ? quotes - QUOTE_FILTER_CAPACITY : 0;
+    uint32_t recent = 0;
+    uint32_t hits = 0;
+    start = now_ns();
+    for (uint32_t i = first; i < quotes; i++) {
+        hits += quote_filter_contains(&filter, keys[i]) && added[i];
+    }
+    double hit_ns = (now_ns() - start) / (quotes - first);
+    for (uint32_t i = first; i < quotes; i++) {
+        recent += added[i];
+    }
+    for (uint32_t i = 0; i < quotes; i++) {
+        reported_seen += !added[i];
+    }
+
+    // Lookups of quotes never added
+    uint32_t false_positives = 0;
+    start = now_ns();
+    for (uint32_t i = quotes; i < total; i++) {
+        false_positives += quote_filter_contains(&filter, keys[i]);
+    }
+    double miss_ns = (now_ns() - start) / PROBES;
+
+    printf("%-28s %10s\n", "operation", "ns/op");
+    printf("%-28s %10.1f\n", "key (normalize + FNV-1a)", key_ns);
+    printf("%-28s %10.1f\n", "insert", insert_ns);
+    printf("%-28s %10.1f\n", "lookup (seen)", hit_ns);
+    printf("%-28s %10.1f\n", "lookup (unseen)", miss_ns);
+    printf("\n");
+    printf("Inserted:      %lu quotes, %lu remembered, %lu reported as seen on insert\n",
+           (unsigned long)quotes, (unsigned long)quote_filter_count(&filter), (unsigned long)reported_seen);
+    printf("Recent hits:   %lu/%lu (no false negatives expected)\n", (unsigned long)hits, (unsigned long)recent);
+    printf("FP rate:       %.3f%% measured (%lu/%d unseen), %.3f%% estimated from fill\n",
+           100.0 * false_positives / PROBES, (unsigned long)false_positives, PROBES,
+           100.0 * quote_filter_fp_rate(&filter));
+
+    free(texts);
+    free(authors);
+    free(added);
+    free(keys);
+    return hits == recent ? 0 : 1;
+}
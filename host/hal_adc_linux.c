@@ -0,0 +1,42 @@
+#include "hal_adc.h"
+#include "sim.h"
+
+#define DIVIDER_RATIO 2        // Board's battery divider
+#define NOISE_SPAN 9           // +/-4 LSB of conversion noise
+#define SPIKE_ONE_IN 32        // EPD rail switching spike probability
+#define SPIKE_LSB 180
+
+esp_err_t hal_adc_init(void) {
+    return ESP_OK;
+}
+
+esp_err_t hal_adc_read(int* raw) {
+    sim_spend(sim_model_us(sim_model.adc_sample_ms), SIM_LOAD_AWAKE, "adc");
+
+    // The divider is fed from the EPD rail; with the panel off the pin floats low
+    if (!sim_epd_on()) {
+        *raw = (int)(sim_random() % 16);
+        return ESP_OK;
+    }
+
+    float pin_mv = sim_battery_mv() / DIVIDER_RATIO;
+    int value = (int)(pin_mv * HAL_ADC_MAX_RAW / HAL_ADC_FULL_SCALE_MV + 0.5f);
+    value += (int)(sim_random() % NOISE_SPAN) - NOISE_SPAN / 2;
+    if (sim_random() % SPIKE_ONE_IN == 0) {
+        value += SPIKE_LSB;
+    }
+
+    if (value < 0) {
+        value = 0;
+    } else if (value > HAL_ADC_MAX_RAW) {
+        value = HAL_ADC_MAX_RAW;
+    }
+    *raw = value;
+    return ESP_OK;
+}
+
+esp_err_t hal_adc_to_mv(int raw, int* mv) {
+    // Ideal converter: the simulated calibration is exact
+    *mv = raw * HAL_ADC_FULL_SCALE_MV / HAL_ADC_MAX_RAW;
+    return ESP_OK;
+}
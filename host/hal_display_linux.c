@@ -0,0 +1,176 @@
+#include "hal_display.h"
+#include "screenshot.h"
+#include "sim.h"
+#include "esp_log.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "HAL_DISPLAY";
+
+#define WIDTH 960
+#define HEIGHT 540
+#define WHITE 0xFF
+#define BLACK 0x00
+#define MAX_TEXT_ITEMS 24
+
+// Fixed-pitch approximations of the firmware fonts, so word wrap and
+// centering produce similar layouts
+static const struct {
+    const char* name;
+    int advance;
+    int ascent;
+    int descent;
+} font_metrics[] = {
+    [HAL_FONT_LARGE] = {"FiraSans20", 17, 26, 7},
+    [HAL_FONT_MEDIUM] = {"FiraSans12", 11, 17, 4},
+    [HAL_FONT_SMALL] = {"OpenSans8", 7, 11, 3},
+};
+
+// 8-bit grayscale framebuffer; glyphs are drawn as filled boxes
+static uint8_t framebuffer[WIDTH * HEIGHT];
+
+// Text drawn since the last update, printed as the screen transcript
+static struct {
+    hal_font_t font;
+    int x;
+    int y;
+    char text[160];
+} text_items[MAX_TEXT_ITEMS];
+static int text_count = 0;
+
+static void fill_rect(int x, int y, int w, int h, uint8_t value) {
+    for (int row = y; row < y + h; row++) {
+        if (row < 0 || row >= HEIGHT) {
+            continue;
+        }
+        for (int col = x; col < x + w; col++) {
+            if (col >= 0 && col < WIDTH) {
+                framebuffer[row * WIDTH + col] = value;
+            }
+        }
+    }
+}
+
+// Code points in a UTF-8 string (continuation bytes do not advance)
+static int glyph_count(const char* text) {
+    int count = 0;
+    for (const unsigned char* p = (const unsigned char*)text; *p; p++) {
+        if ((*p & 0xC0) != 0x80) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void hal_display_init(void) {
+    memset(framebuffer, WHITE, sizeof(framebuffer));
+}
+
+int hal_display_width(void) {
+    return WIDTH;
+}
+
+int hal_display_height(void) {
+    return HEIGHT;
+}
+
+void hal_display_power_on(void) {
+    sim_set_epd(true);
+}
+
+void hal_display_power_off(void) {
+    sim_set_epd(false);
+}
+
+void hal_display_fill_white(void) {
+    memset(framebuffer, WHITE, sizeof(framebuffer));
+    text_count = 0;
+}
+
+void hal_display_clear_screen(void) {
+    if (sim_epd_on()) {
+        sim_spend(sim_model_us(sim_model.epd_clear_ms), SIM_LOAD_EPD_REFRESH, "epd_clear");
+    }
+    hal_display_fill_white();
+}
+
+void hal_display_draw_text(hal_font_t font, const char* text, int x, int y) {
+    int advance = font_metrics[font].advance;
+    int ascent = font_metrics[font].ascent;
+
+    for (const unsigned char* p = (const unsigned char*)text; *p; p++) {
+        if ((*p & 0xC0) == 0x80) {
+            continue;
+        }
+        if (*p != ' ') {
+            fill_rect(x + 1, y - ascent, advance - 2, ascent, BLACK);
+        }
+        x += advance;
+    }
+
+    if (text_count < MAX_TEXT_ITEMS) {
+        text_items[text_count].font = font;
+        text_items[text_count].x = x - glyph_count(text) * advance;
+        text_items[text_count].y = y;
+        snprintf(text_items[text_count].text, sizeof(text_items[0].text), "%s", text);
+        text_count++;
+    }
+}
+
+int hal_display_text_width(hal_font_t font, const char* text) {
+    return glyph_count(text) * font_metrics[font].advance;
+}
+
+void hal_display_draw_image(hal_image_t image, int x, int y) {
+    int size = image == HAL_IMAGE_LOGO_64 ? 64 : 256;
+    fill_rect(x, y, size, size, 0x80);
+}
+
+static esp_err_t write_file(const void* data, size_t length, void* ctx) {
+    return fwrite(data, 1, length, ctx) == length ? ESP_OK : ESP_FAIL;
+}
+
+// Golden image of a refresh, through the encoder the firmware serves /screen.png with
+static void save_screenshot(void) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/wake%04u_%u.png", sim_screenshot_dir(), (unsigned)sim_wake_number(),
+             (unsigned)sim_stat(SIM_STAT_REFRESHES));
+    FILE* f = fopen(path, "wb");
+    if (f == NULL) {
+        ESP_LOGW(TAG, "Cannot write %s", path);
+        return;
+    }
+    screenshot_encode(SCREENSHOT_PNG, write_file, f);
+    fclose(f);
+}
+
+esp_err_t hal_display_update(void) {
+    if (!sim_epd_on()) {
+        ESP_LOGE(TAG, "Display update failed with error: %d", -1);
+        return ESP_FAIL;
+    }
+
+    sim_spend(sim_model_us(sim_model.epd_refresh_ms), SIM_LOAD_EPD_REFRESH, "epd_refresh");
+    sim_count(SIM_STAT_REFRESHES, 1);
+
+    ESP_LOGI(TAG, "Screen refresh (%d text items):", text_count);
+    for (int i = 0; i < text_count; i++) {
+        ESP_LOGI(TAG, "  [%s @%d,%d] %s", font_metrics[text_items[i].font].name,
+                 text_items[i].x, text_items[i].y, text_items[i].text);
+    }
+    if (sim_screenshot_dir() != NULL) {
+        save_screenshot();
+    }
+    return ESP_OK;
+}
+
+esp_err_t hal_display_read_row(int y, uint8_t* gray) {
+    if (y < 0 || y >= HEIGHT) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int x = 0; x < WIDTH; x++) {
+        gray[x] = framebuffer[y * WIDTH + x] >> 4;
+    }
+    return ESP_OK;
+}
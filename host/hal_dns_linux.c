@@ -0,0 +1,81 @@
+#include "hal_dns.h"
+#include "sim.h"
+#include "esp_log.h"
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "HAL_DNS";
+
+// Answers to hal_dns_query(): resolved at once on the host and handed out by
+// hal_dns_collect(), as if they had arrived during the traffic in between
+static struct {
+    char host[HAL_DNS_HOST_SIZE];   // "" if the slot is free
+    hal_dns_answer_t answer;
+} pending[HAL_DNS_MAX_PENDING];
+
+// The simulator has no network beyond the mock server: names the host
+// cannot resolve get a stable address from 198.18.0.0/15 (benchmarking range)
+static uint32_t lookup(const char* host) {
+    struct addrinfo hints = {.ai_family = AF_INET, .ai_socktype = SOCK_STREAM};
+    struct addrinfo* result = NULL;
+    if (getaddrinfo(host, NULL, &hints, &result) == 0 && result != NULL) {
+        uint32_t addr = ((struct sockaddr_in*)result->ai_addr)->sin_addr.s_addr;
+        freeaddrinfo(result);
+        return addr;
+    }
+
+    uint32_t hash = 2166136261u;  // FNV-1a
+    for (const char* c = host; *c != '\0'; c++) {
+        hash = (hash ^ (uint8_t)*c) * 16777619u;
+    }
+    return htonl(0xC6120000u | (hash & 0x1FFFF));
+}
+
+static void fill_answer(const char* host, hal_dns_answer_t* answer) {
+    answer->addr = lookup(host);
+    answer->ttl_s = (uint32_t)sim_model.dns_ttl_s;
+    answer->elapsed_ms = (int)sim_model.dns_ms;
+}
+
+esp_err_t hal_dns_resolve(const char* host, uint32_t timeout_ms, hal_dns_answer_t* answer) {
+    if (!sim_radio_on()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (sim_model.dns_ms > timeout_ms) {
+        sim_spend((int64_t)timeout_ms * 1000, SIM_LOAD_RADIO_RX, "dns");
+        ESP_LOGW(TAG, "Resolving %s failed: %s", host, esp_err_to_name(ESP_ERR_TIMEOUT));
+        return ESP_ERR_TIMEOUT;
+    }
+    sim_spend(sim_model_us(sim_model.dns_ms), SIM_LOAD_RADIO_RX, "dns");
+    fill_answer(host, answer);
+    return ESP_OK;
+}
+
+esp_err_t hal_dns_query(const char* host) {
+    if (!sim_radio_on()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    for (int i = 0; i < HAL_DNS_MAX_PENDING; i++) {
+        if (pending[i].host[0] == '\0') {
+            snprintf(pending[i].host, sizeof(pending[i].host), "%s", host);
+            fill_answer(host, &pending[i].answer);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t hal_dns_collect(char* host, size_t host_size, hal_dns_answer_t* answer) {
+    for (int i = 0; i < HAL_DNS_MAX_PENDING; i++) {
+        if (pending[i].host[0] != '\0') {
+            snprintf(host, host_size, "%s", pending[i].host);
+            *answer = pending[i].answer;
+            pending[i].host[0] = '\0';
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
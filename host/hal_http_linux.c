@@ -0,0 +1,522 @@
+#include "hal_http.h"
+#include "sim.h"
+#include "esp_log.h"
+#include <curl/curl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+static const char *TAG = "HAL_HTTP";
+
+#define MOCK_DELAY_HEADER "X-Mock-Delay-Ms:"
+
+// One transfer: the curl handle plus what the model needs once it is done
+typedef struct {
+    CURL* curl;
+    struct curl_slist* headers;
+    struct curl_slist* resolve;  // request->addr as a CURLOPT_RESOLVE entry
+    hal_http_response_t* response;
+    long server_delay_ms;
+    bool close;              // Server closes the connection after this response
+    CURLcode res;
+} transfer_t;
+
+// Copy a header value if the line starts with name (case-insensitive)
+static bool header_value(const char* line, size_t len, const char* name, char* dest, size_t size) {
+    size_t prefix = strlen(name);
+    if (len <= prefix || strncasecmp(line, name, prefix) != 0) {
+        return false;
+    }
+    line += prefix;
+    len -= prefix;
+    while (len > 0 && *line == ' ') {
+        line++;
+        len--;
+    }
+    while (len > 0 && (line[len - 1] == '\r' || line[len - 1] == '\n')) {
+        len--;
+    }
+    if (dest != NULL) {
+        snprintf(dest, size, "%.*s", (int)len, line);
+    }
+    return true;
+}
+
+// Validators for conditional requests, and the server think time announced
+// by tools/mock_quote_server.py (charged as modeled time so latency
+// scenarios stay deterministic)
+static size_t header_callback(char* data, size_t size, size_t nitems, void* user_data) {
+    transfer_t* t = (transfer_t*)user_data;
+    size_t len = size * nitems;
+
+    char connection[16];
+    if (header_value(data, len, MOCK_DELAY_HEADER, NULL, 0)) {
+        t->server_delay_ms = strtol(data + strlen(MOCK_DELAY_HEADER), NULL, 10);
+    } else if (header_value(data, len, "Connection:", connection, sizeof(connection))) {
+        t->close = strcasecmp(connection, "close") == 0;
+    } else if (!header_value(data, len, "ETag:", t->response->etag, sizeof(t->response->etag))) {
+        header_value(data, len, "Last-Modified:", t->response->last_modified,
+                     sizeof(t->response->last_modified));
+    }
+    return len;
+}
+
+static size_t write_callback(char* data, size_t size, size_t nmemb, void* user_data) {
+    hal_http_response_t* response = (hal_http_response_t*)user_data;
+    size_t len = size * nmemb;
+
+    if (response->on_data != NULL) {
+        response->on_data(data, len, response->data_ctx);
+        response->length += len;
+        return len;
+    }
+
+    size_t room = response->buffer_size - 1 - response->length;
+    if (len > room) {
+        if (!response->truncated) {
+            ESP_LOGW(TAG, "Response buffer full, truncating data");
+        }
+        response->truncated = true;
+        memcpy(response->buffer + response->length, data, room);
+        response->length += room;
+    } else {
+        memcpy(response->buffer + response->length, data, len);
+        response->length += len;
+    }
+    return size * nmemb;  // Keep reading, as the ESP client does
+}
+
+static void reset_response(hal_http_response_t* response) {
+    response->length = 0;
+    response->status = 0;
+    response->truncated = false;
+    response->etag[0] = '\0';
+    response->last_modified[0] = '\0';
+    if (response->on_data == NULL) {
+        response->buffer[0] = '\0';
+    }
+}
+
+static void add_header(transfer_t* t, const char* name, const char* value) {
+    if (value != NULL && value[0] != '\0') {
+        char line[128];
+        snprintf(line, sizeof(line), "%s: %s", name, value);
+        t->headers = curl_slist_append(t->headers, line);
+    }
+}
+
+// Host of a URL and its port (explicit or the scheme's)
+static size_t url_host(const char* url, const char** host, int* port) {
+    const char* start = strstr(url, "://");
+    *host = start != NULL ? start + 3 : url;
+    size_t len = strcspn(*host, ":/?#");
+    *port = (*host)[len] == ':' ? atoi(*host + len + 1) : strncmp(url, "https://", 8) == 0 ? 443 : 80;
+    return len;
+}
+
+// The device resolves a host name itself unless given an address
+static bool needs_lookup(const hal_http_request_t* request) {
+    const char* host;
+    int port;
+    size_t len = url_host(request->url, &host, &port);
+    return request->addr == 0 && strspn(host, "0123456789.") < len;
+}
+
+static esp_err_t transfer_init(transfer_t* t, const char* url, uint32_t addr, int timeout_ms,
+                               hal_http_response_t* response,
+                               const char* if_none_match, const char* if_modified_since) {
+    static bool curl_ready = false;
+
+    if (!curl_ready) {
+        curl_global_init(CURL_GLOBAL_DEFAULT);
+        curl_ready = true;
+    }
+
+    t->server_delay_ms = 0;
+    t->close = false;
+    t->res = CURLE_OK;
+    t->response = response;
+    t->headers = NULL;
+    t->resolve = NULL;
+    t->curl = curl_easy_init();
+    if (t->curl == NULL) {
+        ESP_LOGE(TAG, "Failed to initialize HTTP client");
+        return ESP_FAIL;
+    }
+
+    curl_easy_setopt(t->curl, CURLOPT_URL, url);
+    curl_easy_setopt(t->curl, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_easy_setopt(t->curl, CURLOPT_WRITEDATA, response);
+    curl_easy_setopt(t->curl, CURLOPT_HEADERFUNCTION, header_callback);
+    curl_easy_setopt(t->curl, CURLOPT_HEADERDATA, t);
+    curl_easy_setopt(t->curl, CURLOPT_TIMEOUT_MS, (long)timeout_ms);
+    curl_easy_setopt(t->curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(t->curl, CURLOPT_ACCEPT_ENCODING, "identity");
+
+    // Connect to the given address without a lookup, keeping the name for
+    // TLS and the Host header, as the device does
+    if (addr != 0) {
+        const char* host;
+        int port;
+        size_t len = url_host(url, &host, &port);
+        const uint8_t* a = (const uint8_t*)&addr;
+        char entry[160];
+        snprintf(entry, sizeof(entry), "%.*s:%d:%u.%u.%u.%u", (int)len, host, port, a[0], a[1], a[2], a[3]);
+        t->resolve = curl_slist_append(NULL, entry);
+        curl_easy_setopt(t->curl, CURLOPT_RESOLVE, t->resolve);
+    }
+
+    add_header(t, "If-None-Match", if_none_match);
+    add_header(t, "If-Modified-Since", if_modified_since);
+    if (t->headers != NULL) {
+        curl_easy_setopt(t->curl, CURLOPT_HTTPHEADER, t->headers);
+    }
+
+    // Test CA for the mock server's HTTPS listener
+    const char* ca_file = getenv("QUOTE_SIM_CA");
+    if (ca_file != NULL) {
+        curl_easy_setopt(t->curl, CURLOPT_CAINFO, ca_file);
+    }
+    return ESP_OK;
+}
+
+static void transfer_cleanup(transfer_t* t) {
+    curl_easy_cleanup(t->curl);
+    curl_slist_free_all(t->headers);
+    curl_slist_free_all(t->resolve);
+    t->curl = NULL;
+    t->headers = NULL;
+    t->resolve = NULL;
+}
+
+// Modeled (not host) duration of a finished transfer: TLS handshake, request
+// airtime, then DNS lookup (new connection by name), TCP + request round
+// trips, server think time and the transfer while receiving. A kept-alive
+// connection skips the lookup, handshake and TCP round trip. Counts the
+// request in the run statistics.
+static int64_t transfer_modeled_us(transfer_t* t, const char* url, int timeout_ms, bool reused, bool lookup,
+                                   int64_t* tls_us, int64_t* tx_us) {
+    curl_off_t received = 0;
+    curl_easy_getinfo(t->curl, CURLINFO_SIZE_DOWNLOAD_T, &received);
+    sim_count(SIM_STAT_HTTP_REQUESTS, 1);
+    sim_count(SIM_STAT_HTTP_BYTES, (uint32_t)received);
+
+    *tls_us = !reused && strncmp(url, "https://", 8) == 0 ? sim_model_us(sim_model.tls_handshake_ms) : 0;
+    *tx_us = sim_model_us(sim_model.http_tx_ms);
+    int64_t rx_us = (lookup ? sim_model_us(sim_model.dns_ms) : 0) +
+                    (reused ? 1 : 2) * sim_model_us(sim_model.http_rtt_ms) + t->server_delay_ms * 1000 +
+                    (int64_t)(received * 1e6 / sim_model.http_bytes_per_s);
+    if (t->res == CURLE_OPERATION_TIMEDOUT) {
+        rx_us = (int64_t)timeout_ms * 1000;
+    }
+    return *tls_us + *tx_us + rx_us;
+}
+
+static esp_err_t transfer_finish(transfer_t* t, hal_http_response_t* response) {
+    esp_err_t err = ESP_OK;
+    if (t->res == CURLE_OK) {
+        long status = 0;
+        curl_easy_getinfo(t->curl, CURLINFO_RESPONSE_CODE, &status);
+        response->status = (int)status;
+    } else {
+        ESP_LOGE(TAG, "HTTP GET request failed: %s", curl_easy_strerror(t->res));
+        err = t->res == CURLE_OPERATION_TIMEDOUT ? ESP_ERR_TIMEOUT : ESP_FAIL;
+    }
+    if (response->on_data == NULL) {
+        response->buffer[response->length] = '\0';
+    }
+
+    transfer_cleanup(t);
+    return err;
+}
+
+#define HTTP_MAX_RACE 4  // Same limit as the device backend
+#define HTTP_ORIGIN_SIZE 96
+
+// Connections the device would keep open, by origin, with the same policy
+// as the device backend. Costs follow this model; libcurl keeps its own
+// connection cache in the shared multi handle.
+static struct {
+    char origin[HTTP_ORIGIN_SIZE];
+    bool open;
+    int64_t idle_since_us;
+} pool[HAL_HTTP_POOL_SIZE];
+
+static hal_http_stats_t stats;
+static CURLM* multi = NULL;
+
+static size_t origin_length(const char* url) {
+    const char* host = strstr(url, "://");
+    host = host != NULL ? host + 3 : url;
+    const char* path = strchr(host, '/');
+    return path != NULL ? (size_t)(path - url) : strlen(url);
+}
+
+static bool pool_take(const char* url) {
+    size_t len = origin_length(url);
+    for (int i = 0; i < HAL_HTTP_POOL_SIZE; i++) {
+        if (pool[i].open && strlen(pool[i].origin) == len && strncmp(pool[i].origin, url, len) == 0) {
+            pool[i].open = false;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void pool_put(const char* url, int64_t now_us) {
+    size_t len = origin_length(url);
+    if (len >= HTTP_ORIGIN_SIZE) {
+        return;
+    }
+
+    int slot = 0;
+    for (int i = 0; i < HAL_HTTP_POOL_SIZE; i++) {
+        if (!pool[i].open) {
+            slot = i;
+            break;
+        }
+        if (pool[i].idle_since_us < pool[slot].idle_since_us) {
+            slot = i;
+        }
+    }
+    snprintf(pool[slot].origin, sizeof(pool[slot].origin), "%.*s", (int)len, url);
+    pool[slot].open = true;
+    pool[slot].idle_since_us = now_us;
+}
+
+void hal_http_close_idle(void) {
+    for (int i = 0; i < HAL_HTTP_POOL_SIZE; i++) {
+        pool[i].open = false;
+    }
+    if (multi != NULL) {
+        curl_multi_cleanup(multi);  // Closes the cached connections
+        multi = NULL;
+    }
+}
+
+void hal_http_get_stats(hal_http_stats_t* out) {
+    *out = stats;
+}
+
+static void count_request(const hal_http_request_t* request) {
+    stats.requests++;
+    stats.reused += request->reused;
+    stats.total_ms += (uint32_t)request->elapsed_ms;
+    if ((uint32_t)request->elapsed_ms > stats.max_ms) {
+        stats.max_ms = (uint32_t)request->elapsed_ms;
+    }
+}
+
+// Length of the union of [start, end) intervals clipped to [0, limit)
+static int64_t union_us(int64_t* start, int64_t* end, int count, int64_t limit) {
+    // Insertion sort by start; count is at most HTTP_MAX_RACE
+    for (int i = 1; i < count; i++) {
+        for (int j = i; j > 0 && start[j] < start[j - 1]; j--) {
+            int64_t s = start[j], e = end[j];
+            start[j] = start[j - 1];
+            end[j] = end[j - 1];
+            start[j - 1] = s;
+            end[j - 1] = e;
+        }
+    }
+
+    int64_t covered = 0, reach = 0;
+    for (int i = 0; i < count; i++) {
+        int64_t s = start[i] > reach ? start[i] : reach;
+        int64_t e = end[i] < limit ? end[i] : limit;
+        if (e > s) {
+            covered += e - s;
+            reach = e;
+        }
+    }
+    return covered;
+}
+
+int hal_http_get_first(hal_http_request_t* requests, int count, int deadline_ms,
+                       hal_http_accept_cb_t accept, void* ctx) {
+    if (count > HTTP_MAX_RACE) {
+        ESP_LOGW(TAG, "Racing only the first %d of %d requests", HTTP_MAX_RACE, count);
+        count = HTTP_MAX_RACE;
+    }
+    for (int i = 0; i < count; i++) {
+        reset_response(&requests[i].response);
+        requests[i].result = ESP_ERR_NOT_FINISHED;
+        requests[i].elapsed_ms = 0;
+        requests[i].reused = false;
+    }
+
+    int64_t deadline_us = (int64_t)deadline_ms * 1000;
+    if (!sim_radio_on()) {
+        sim_spend(deadline_us, SIM_LOAD_AWAKE, "http");
+        ESP_LOGE(TAG, "HTTP GET request failed: %s", esp_err_to_name(ESP_ERR_TIMEOUT));
+        return -1;
+    }
+
+    // Run every transfer to completion on the host, all at once; the race is
+    // then replayed in modeled time so the outcome does not depend on host
+    // scheduling or the real latency of the mock server
+    transfer_t transfers[HTTP_MAX_RACE];
+    bool valid[HTTP_MAX_RACE] = {false};
+    if (multi == NULL) {
+        multi = curl_multi_init();
+    }
+    for (int i = 0; i < count; i++) {
+        if (transfer_init(&transfers[i], requests[i].url, requests[i].addr, deadline_ms, &requests[i].response,
+                          requests[i].if_none_match, requests[i].if_modified_since) == ESP_OK) {
+            valid[i] = true;
+            curl_multi_add_handle(multi, transfers[i].curl);
+        }
+    }
+
+    int still_running = 1;
+    while (still_running) {
+        curl_multi_perform(multi, &still_running);
+        if (still_running) {
+            curl_multi_poll(multi, NULL, 0, 100, NULL);
+        }
+    }
+    CURLMsg* msg;
+    int left;
+    while ((msg = curl_multi_info_read(multi, &left)) != NULL) {
+        for (int i = 0; i < count; i++) {
+            if (valid[i] && msg->msg == CURLMSG_DONE && msg->easy_handle == transfers[i].curl) {
+                transfers[i].res = msg->data.result;
+            }
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        if (valid[i]) {
+            curl_multi_remove_handle(multi, transfers[i].curl);
+        }
+    }
+
+    // Modeled timeline: start at the stagger delay, or as soon as nothing
+    // else is in flight; completions are offered to accept() in time order
+    int64_t start_us[HTTP_MAX_RACE], end_us[HTTP_MAX_RACE];
+    int64_t tls_start[HTTP_MAX_RACE], tls_end[HTTP_MAX_RACE];
+    int64_t duration_us[HTTP_MAX_RACE], tx_total_us = 0;
+    bool started[HTTP_MAX_RACE] = {false}, done[HTTP_MAX_RACE] = {false};
+    int64_t now_us = 0;
+    int winner = -1;
+
+    for (;;) {
+        // Start whatever is due now
+        bool in_flight = false;
+        for (int i = 0; i < count; i++) {
+            in_flight |= started[i] && !done[i];
+        }
+        for (int i = 0; i < count; i++) {
+            if (started[i] || (now_us < (int64_t)requests[i].start_delay_ms * 1000 && in_flight)) {
+                continue;
+            }
+            started[i] = true;
+            in_flight = true;
+            start_us[i] = now_us;
+            if (!valid[i]) {
+                duration_us[i] = 0;  // Client init failure, immediate
+                tls_start[i] = tls_end[i] = 0;
+            } else {
+                int64_t tls_us, tx_us;
+                requests[i].reused = pool_take(requests[i].url);
+                duration_us[i] = transfer_modeled_us(&transfers[i], requests[i].url, deadline_ms,
+                                                     requests[i].reused,
+                                                     !requests[i].reused && needs_lookup(&requests[i]),
+                                                     &tls_us, &tx_us);
+                tls_start[i] = now_us;
+                tls_end[i] = now_us + tls_us;
+                tx_total_us += tx_us;
+            }
+            end_us[i] = now_us + duration_us[i];
+        }
+
+        // Next event: earliest completion or the next staggered start
+        int next = -1;
+        int64_t next_us = deadline_us;
+        for (int i = 0; i < count; i++) {
+            if (started[i] && !done[i] && end_us[i] <= next_us) {
+                if (next < 0 || end_us[i] < end_us[next]) {
+                    next = i;
+                    next_us = end_us[i];
+                }
+            }
+        }
+        int64_t next_start_us = deadline_us;
+        for (int i = 0; i < count; i++) {
+            if (!started[i] && (int64_t)requests[i].start_delay_ms * 1000 < next_start_us) {
+                next_start_us = (int64_t)requests[i].start_delay_ms * 1000;
+            }
+        }
+        if (next_start_us < next_us || (next < 0 && next_start_us < deadline_us)) {
+            now_us = next_start_us;
+            continue;
+        }
+        if (next < 0) {
+            now_us = deadline_us;  // Everything still in flight is aborted
+            break;
+        }
+
+        now_us = next_us;
+        done[next] = true;
+        bool keep_alive = valid[next] && transfers[next].res == CURLE_OK && !transfers[next].close;
+        requests[next].result = valid[next] ? transfer_finish(&transfers[next], &requests[next].response)
+                                            : ESP_FAIL;
+        requests[next].elapsed_ms = (int)((now_us - start_us[next]) / 1000);
+        count_request(&requests[next]);
+        if (keep_alive) {
+            pool_put(requests[next].url, sim_uptime_us() + now_us);  // Body read: connection reusable
+        }
+        if (accept(next, &requests[next], ctx)) {
+            winner = next;
+            break;
+        }
+
+        bool all_done = true;
+        for (int i = 0; i < count; i++) {
+            all_done &= done[i];
+        }
+        if (all_done) {
+            break;
+        }
+    }
+
+    // Charge the race wall time once: handshakes (any in progress), request
+    // airtime, and receiving for the rest
+    int n_started = 0;
+    for (int i = 0; i < count; i++) {
+        if (started[i]) {
+            tls_start[n_started] = tls_start[i];
+            tls_end[n_started] = tls_end[i];
+            n_started++;
+        }
+    }
+    int64_t tls_us = union_us(tls_start, tls_end, n_started, now_us);
+    if (tx_total_us > now_us - tls_us) {
+        tx_total_us = now_us - tls_us;
+    }
+    if (tls_us > 0) {
+        sim_spend(tls_us, SIM_LOAD_RADIO_RX, "tls");
+    }
+    sim_spend(tx_total_us, SIM_LOAD_RADIO_TX, "http");
+    sim_spend(now_us - tls_us - tx_total_us, SIM_LOAD_RADIO_RX, "http");
+
+    // Aborted or never started: nothing was received as far as the device knows
+    for (int i = 0; i < count; i++) {
+        if (valid[i] && transfers[i].curl != NULL) {
+            transfer_cleanup(&transfers[i]);
+            reset_response(&requests[i].response);
+        }
+    }
+    return winner;
+}
+
+static bool accept_any(int index, hal_http_request_t* request, void* ctx) {
+    return true;
+}
+
+esp_err_t hal_http_get(const char* url, int timeout_ms, hal_http_response_t* response) {
+    hal_http_request_t request = {.url = url, .response = *response};
+    hal_http_get_first(&request, 1, timeout_ms, accept_any, NULL);
+    *response = request.response;
+    return request.result == ESP_ERR_NOT_FINISHED ? ESP_ERR_TIMEOUT : request.result;
+}
@@ -0,0 +1,11 @@
+#include "hal_mem.h"
+
+// The host's heap and threads say nothing about the device's: not measured
+
+esp_err_t hal_mem_heap(hal_mem_region_t region, hal_mem_heap_t* heap) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t hal_mem_task_stack(const char* name, uint32_t* free_min) {
+    return ESP_ERR_NOT_FOUND;
+}
@@ -0,0 +1,105 @@
+#include "hal_nvs.h"
+#include "sim.h"
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+// One file per key: <state_dir>/nvs/<namespace>/<key>
+
+static uint32_t commits = 0;  // Since boot (this wake's process)
+
+static void key_path(char* path, size_t size, const char* ns, const char* key) {
+    snprintf(path, size, "%s/nvs/%s/%s", sim_state_dir(), ns, key);
+}
+
+static esp_err_t read_key(const char* ns, const char* key, void* out, size_t* length) {
+    char path[PATH_MAX];
+    key_path(path, sizeof(path), ns, key);
+
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    fseek(f, 0, SEEK_END);
+    size_t stored = (size_t)ftell(f);
+    rewind(f);
+
+    esp_err_t err = ESP_OK;
+    if (out == NULL) {
+        *length = stored;  // Size query, as with nvs_get_blob(..., NULL, &len)
+    } else if (*length < stored) {
+        err = ESP_ERR_NVS_INVALID_LENGTH;
+    } else {
+        *length = fread(out, 1, stored, f);
+    }
+    fclose(f);
+    return err;
+}
+
+static esp_err_t write_key(const char* ns, const char* key, const void* data, size_t length) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/nvs", sim_state_dir());
+    mkdir(path, 0755);
+    snprintf(path, sizeof(path), "%s/nvs/%s", sim_state_dir(), ns);
+    mkdir(path, 0755);
+    key_path(path, sizeof(path), ns, key);
+
+    FILE* f = fopen(path, "wb");
+    if (f == NULL) {
+        return ESP_FAIL;
+    }
+    size_t written = fwrite(data, 1, length, f);
+    fclose(f);
+
+    sim_spend(sim_model_us(sim_model.nvs_commit_ms), SIM_LOAD_AWAKE, "nvs");
+    sim_count(SIM_STAT_NVS_COMMITS, 1);
+    if (written != length) {
+        return ESP_FAIL;
+    }
+    commits++;
+    return ESP_OK;
+}
+
+esp_err_t hal_nvs_get_blob(const char* ns, const char* key, void* out, size_t* length) {
+    return read_key(ns, key, out, length);
+}
+
+esp_err_t hal_nvs_set_blob(const char* ns, const char* key, const void* data, size_t length) {
+    return write_key(ns, key, data, length);
+}
+
+esp_err_t hal_nvs_get_str(const char* ns, const char* key, char* out, size_t* length) {
+    // Strings are stored with their terminator, so lengths match nvs_get_str()
+    return read_key(ns, key, out, length);
+}
+
+esp_err_t hal_nvs_set_str(const char* ns, const char* key, const char* value) {
+    return write_key(ns, key, value, strlen(value) + 1);
+}
+
+esp_err_t hal_nvs_get_u32(const char* ns, const char* key, uint32_t* out) {
+    size_t length = sizeof(*out);
+    esp_err_t err = read_key(ns, key, NULL, &length);
+    if (err == ESP_OK && length != sizeof(*out)) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    return err == ESP_OK ? read_key(ns, key, out, &length) : err;
+}
+
+esp_err_t hal_nvs_erase_key(const char* ns, const char* key) {
+    char path[PATH_MAX];
+    key_path(path, sizeof(path), ns, key);
+    if (remove(path) != 0) {
+        return errno == ENOENT ? ESP_ERR_NVS_NOT_FOUND : ESP_FAIL;
+    }
+    sim_spend(sim_model_us(sim_model.nvs_commit_ms), SIM_LOAD_AWAKE, "nvs");
+    sim_count(SIM_STAT_NVS_COMMITS, 1);
+    commits++;
+    return ESP_OK;
+}
+
+uint32_t hal_nvs_commits(void) {
+    return commits;
+}
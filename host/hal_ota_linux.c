@@ -0,0 +1,355 @@
+#include "hal_ota.h"
+#include "sim.h"
+#include "esp_log.h"
+#include "mbedtls/sha256.h"
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+static const char *TAG = "HAL_OTA";
+
+// Two app slots as files in <state_dir>/ota/, and the bootloader's
+// otadata as a text file next to them. Slot 0 holds the image the
+// simulator was built as (FIRMWARE_VERSION); its bytes, which patches are
+// applied to, come from QUOTE_SIM_IMAGE until an update wrote slot0.bin.
+// The bootloader's rollback decision is replayed by the first call of
+// each wake.
+
+#define SLOT_SIZE (3 * 1024 * 1024)   // partitions.csv: ota_0 and ota_1
+
+// Image layout (esp_image_header_t, first segment header, esp_app_desc_t)
+#define IMAGE_MAGIC 0xE9
+#define IMAGE_HASH_APPENDED_OFFSET 23
+#define APP_DESC_OFFSET 32
+#define APP_DESC_MAGIC 0xABCD5432
+#define APP_VERSION_OFFSET (APP_DESC_OFFSET + 16)
+#define APP_PROJECT_OFFSET (APP_DESC_OFFSET + 48)
+#define APP_HEADER_SIZE (APP_PROJECT_OFFSET + HAL_OTA_NAME_SIZE)
+
+typedef enum {
+    SLOT_VALID,              // Running image confirmed (or the original one)
+    SLOT_NEW,                // Activated, not booted yet
+    SLOT_PENDING,            // Booted once, not confirmed yet
+} slot_state_t;
+
+static struct {
+    int running;
+    int boot;
+    slot_state_t state;
+    hal_ota_app_t apps[2];
+    hal_ota_app_t rejected;  // version "" if none
+} otadata;
+
+static bool loaded = false;
+static FILE* image = NULL;    // Slot being written
+static size_t image_size = 0;
+static size_t written = 0;
+
+static void ota_path(char* path, size_t size, const char* name) {
+    snprintf(path, size, "%s/ota/%s", sim_state_dir(), name);
+}
+
+static void save(void) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/ota", sim_state_dir());
+    mkdir(path, 0755);
+    ota_path(path, sizeof(path), "otadata");
+    FILE* f = fopen(path, "w");
+    if (f == NULL) {
+        return;
+    }
+    fprintf(f, "running=%d\nboot=%d\nstate=%d\n", otadata.running, otadata.boot, (int)otadata.state);
+    for (int i = 0; i < 2; i++) {
+        fprintf(f, "version%d=%s\nproject%d=%s\n", i, otadata.apps[i].version, i, otadata.apps[i].project);
+    }
+    fprintf(f, "rejected=%s\n", otadata.rejected.version);
+    fclose(f);
+}
+
+static void read_value(const char* line, const char* key, char* dest, size_t size) {
+    size_t len = strlen(key);
+    if (strncmp(line, key, len) == 0 && line[len] == '=') {
+        snprintf(dest, size, "%.*s", (int)strcspn(line + len + 1, "\n"), line + len + 1);
+    }
+}
+
+// SHA-256 of everything before the digest the build appended
+static bool image_digest(FILE* f, size_t size, unsigned char digest[32]) {
+    if (size < 32) {
+        return false;
+    }
+    mbedtls_sha256_context sha;
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts(&sha, 0);
+    rewind(f);
+    unsigned char buffer[4096];
+    size_t left = size - 32;
+    while (left > 0) {
+        size_t n = fread(buffer, 1, left < sizeof(buffer) ? left : sizeof(buffer), f);
+        if (n == 0) {
+            break;
+        }
+        mbedtls_sha256_update(&sha, buffer, n);
+        left -= n;
+    }
+    mbedtls_sha256_finish(&sha, digest);
+    mbedtls_sha256_free(&sha);
+    return left == 0;
+}
+
+// What esp_ota_end() checks: header and app descriptor magics, and the
+// SHA-256 of the image when the build appended one
+static bool image_valid(FILE* f, size_t size, hal_ota_app_t* app) {
+    uint8_t header[APP_HEADER_SIZE];
+    rewind(f);
+    if (size < sizeof(header) + 32 || fread(header, 1, sizeof(header), f) != sizeof(header)) {
+        return false;
+    }
+    uint32_t magic = header[APP_DESC_OFFSET] | header[APP_DESC_OFFSET + 1] << 8 |
+                     header[APP_DESC_OFFSET + 2] << 16 | (uint32_t)header[APP_DESC_OFFSET + 3] << 24;
+    if (header[0] != IMAGE_MAGIC || magic != APP_DESC_MAGIC) {
+        return false;
+    }
+    snprintf(app->version, HAL_OTA_NAME_SIZE, "%.*s", HAL_OTA_NAME_SIZE - 1,
+             (const char*)header + APP_VERSION_OFFSET);
+    snprintf(app->project, HAL_OTA_NAME_SIZE, "%.*s", HAL_OTA_NAME_SIZE - 1,
+             (const char*)header + APP_PROJECT_OFFSET);
+    if (header[IMAGE_HASH_APPENDED_OFFSET] != 1) {
+        return true;
+    }
+
+    unsigned char digest[32];
+    unsigned char appended[32];
+    return image_digest(f, size, digest) && fread(appended, 1, sizeof(appended), f) == sizeof(appended) &&
+           memcmp(digest, appended, sizeof(digest)) == 0;
+}
+
+static size_t file_size(FILE* f) {
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    rewind(f);
+    return size > 0 ? (size_t)size : 0;
+}
+
+// Bytes of an app slot: its file, or QUOTE_SIM_IMAGE for the original slot 0
+static FILE* open_slot(int slot) {
+    char path[PATH_MAX];
+    char name[24];
+    snprintf(name, sizeof(name), "slot%d.bin", slot);
+    ota_path(path, sizeof(path), name);
+    FILE* f = fopen(path, "rb");
+    const char* base = getenv("QUOTE_SIM_IMAGE");
+    if (f == NULL && slot == 0 && base != NULL) {
+        f = fopen(base, "rb");
+    }
+    return f;
+}
+
+// Replay the bootloader: a new image boots once as pending; one that is
+// still pending at the next boot is rolled back
+static void load(void) {
+    if (loaded) {
+        return;
+    }
+    loaded = true;
+    memset(&otadata, 0, sizeof(otadata));
+    snprintf(otadata.apps[0].version, HAL_OTA_NAME_SIZE, "%s", FIRMWARE_VERSION);
+    snprintf(otadata.apps[0].project, HAL_OTA_NAME_SIZE, "%s", FIRMWARE_PROJECT);
+
+    FILE* base = open_slot(0);
+    if (base != NULL) {
+        hal_ota_app_t app;
+        if (image_valid(base, file_size(base), &app)) {
+            otadata.apps[0] = app;
+        }
+        fclose(base);
+    }
+
+    char path[PATH_MAX];
+    ota_path(path, sizeof(path), "otadata");
+    FILE* f = fopen(path, "r");
+    if (f == NULL) {
+        return;
+    }
+    char line[128];
+    char value[HAL_OTA_NAME_SIZE] = "";
+    while (fgets(line, sizeof(line), f) != NULL) {
+        sscanf(line, "running=%d", &otadata.running);
+        sscanf(line, "boot=%d", &otadata.boot);
+        int state;
+        if (sscanf(line, "state=%d", &state) == 1) {
+            otadata.state = (slot_state_t)state;
+        }
+        read_value(line, "version0", otadata.apps[0].version, HAL_OTA_NAME_SIZE);
+        read_value(line, "project0", otadata.apps[0].project, HAL_OTA_NAME_SIZE);
+        read_value(line, "version1", otadata.apps[1].version, HAL_OTA_NAME_SIZE);
+        read_value(line, "project1", otadata.apps[1].project, HAL_OTA_NAME_SIZE);
+        read_value(line, "rejected", value, sizeof(value));
+    }
+    fclose(f);
+    snprintf(otadata.rejected.version, HAL_OTA_NAME_SIZE, "%s", value);
+
+    if (otadata.state == SLOT_NEW) {
+        otadata.running = otadata.boot;
+        otadata.state = SLOT_PENDING;
+        ESP_LOGI(TAG, "Booting new image %s from slot %d", otadata.apps[otadata.running].version,
+                 otadata.running);
+        save();
+    } else if (otadata.state == SLOT_PENDING) {
+        otadata.rejected = otadata.apps[otadata.running];
+        otadata.running = otadata.boot = 1 - otadata.running;
+        otadata.state = SLOT_VALID;
+        ESP_LOGW(TAG, "Image %s was not confirmed, rolled back to %s", otadata.rejected.version,
+                 otadata.apps[otadata.running].version);
+        save();
+    }
+}
+
+esp_err_t hal_ota_begin(size_t size) {
+    load();
+    if (image != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (size > SLOT_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/ota", sim_state_dir());
+    mkdir(path, 0755);
+    char name[24];
+    snprintf(name, sizeof(name), "slot%d.bin", 1 - otadata.running);
+    ota_path(path, sizeof(path), name);
+    image = fopen(path, "w+b");
+    if (image == NULL) {
+        return ESP_FAIL;
+    }
+    image_size = size;
+    written = 0;
+    ESP_LOGI(TAG, "Writing %u bytes to slot %d", (unsigned)size, 1 - otadata.running);
+    return ESP_OK;
+}
+
+esp_err_t hal_ota_write(const void* data, size_t length) {
+    if (image == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (written + length > SLOT_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (fwrite(data, 1, length, image) != length) {
+        return ESP_FAIL;
+    }
+    written += length;
+    sim_spend((int64_t)(length * 1e6 / sim_model.flash_write_bytes_per_s), SIM_LOAD_AWAKE, "ota_write");
+    return ESP_OK;
+}
+
+esp_err_t hal_ota_end(bool activate) {
+    if (image == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    int slot = 1 - otadata.running;
+    hal_ota_app_t app;
+    bool valid = written == image_size && image_valid(image, written, &app);
+    fclose(image);
+    image = NULL;
+    if (!valid) {
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    otadata.apps[slot] = app;
+    if (activate) {
+        otadata.boot = slot;
+        otadata.state = SLOT_NEW;
+    }
+    save();
+    return ESP_OK;
+}
+
+void hal_ota_abort(void) {
+    if (image != NULL) {
+        fclose(image);
+        image = NULL;
+    }
+}
+
+size_t hal_ota_slot_size(void) {
+    return SLOT_SIZE;
+}
+
+void hal_ota_running(hal_ota_app_t* app) {
+    load();
+    *app = otadata.apps[otadata.running];
+}
+
+esp_err_t hal_ota_read_running(size_t offset, void* data, size_t length) {
+    load();
+    FILE* f = open_slot(otadata.running);
+    if (f == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    bool ok = fseek(f, (long)offset, SEEK_SET) == 0 && fread(data, 1, length, f) == length;
+    fclose(f);
+    return ok ? ESP_OK : ESP_ERR_INVALID_SIZE;
+}
+
+esp_err_t hal_ota_running_sha256(uint8_t digest[32]) {
+    load();
+    FILE* f = open_slot(otadata.running);
+    if (f == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    hal_ota_app_t app;
+    size_t size = file_size(f);
+    bool ok = image_valid(f, size, &app) && image_digest(f, size, digest);
+    fclose(f);
+    return ok ? ESP_OK : ESP_ERR_INVALID_CRC;
+}
+
+esp_err_t hal_ota_fall_back(void) {
+    load();
+    int previous = 1 - otadata.running;
+    if (otadata.apps[previous].version[0] == '\0') {
+        return ESP_ERR_NOT_FOUND;
+    }
+    // Like esp_ota_set_boot_partition(): the previous image boots as new
+    otadata.boot = previous;
+    otadata.state = SLOT_NEW;
+    save();
+    ESP_LOGI(TAG, "Slot %d (%s) boots next", previous, otadata.apps[previous].version);
+    return ESP_OK;
+}
+
+bool hal_ota_rejected(hal_ota_app_t* app) {
+    load();
+    if (otadata.rejected.version[0] == '\0') {
+        return false;
+    }
+    *app = otadata.rejected;
+    return true;
+}
+
+bool hal_ota_pending_verify(void) {
+    load();
+    return otadata.state == SLOT_PENDING;
+}
+
+esp_err_t hal_ota_confirm(bool valid) {
+    load();
+    if (otadata.state != SLOT_PENDING) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (valid) {
+        otadata.state = SLOT_VALID;
+        save();
+        return ESP_OK;
+    }
+    otadata.rejected = otadata.apps[otadata.running];
+    otadata.running = otadata.boot = 1 - otadata.running;
+    otadata.state = SLOT_VALID;
+    save();
+    sim_restart();
+}
@@ -0,0 +1,13 @@
+#include "hal_sleep.h"
+#include "sim.h"
+
+void hal_sleep_init(void) {
+}
+
+hal_wake_cause_t hal_sleep_wake_cause(void) {
+    return sim_wake_cause();
+}
+
+void hal_sleep_enter(uint32_t sleep_seconds) {
+    sim_sleep(sleep_seconds);
+}
@@ -0,0 +1,41 @@
+#include "hal_time.h"
+#include "sim.h"
+#include "esp_log.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "HAL_TIME";
+
+int64_t hal_time_us(void) {
+    return sim_uptime_us();
+}
+
+void hal_delay_ms(uint32_t ms) {
+    sim_spend((int64_t)ms * 1000, SIM_LOAD_AWAKE, "delay");
+}
+
+time_t hal_time_now(void) {
+    return sim_wall_time();
+}
+
+esp_err_t hal_time_sync(const char* server, const char* tz, uint32_t timeout_ms) {
+    setenv("TZ", tz, 1);
+    tzset();
+
+    // Same outcome as the SNTP poll loop running out: one request per second
+    // until the timeout, radio listening in between
+    if (!sim_radio_on() || sim_fault(sim_model.sntp_fail_rate)) {
+        sim_spend((int64_t)timeout_ms * 1000, sim_radio_on() ? SIM_LOAD_RADIO_RX : SIM_LOAD_AWAKE, "sntp");
+        ESP_LOGW(TAG, "Time sync timeout, using default time");
+        return ESP_ERR_TIMEOUT;
+    }
+
+    // A server name is resolved first (dns_cache passes an address)
+    if (strspn(server, "0123456789.") < strlen(server)) {
+        sim_spend(sim_model_us(sim_model.dns_ms), SIM_LOAD_RADIO_RX, "dns");
+    }
+    sim_spend(sim_model_us(sim_model.sntp_ms), SIM_LOAD_RADIO_RX, "sntp");
+    sim_clock_synced();
+    ESP_LOGI(TAG, "Time synchronized with %s", server);
+    return ESP_OK;
+}
@@ -0,0 +1,53 @@
+#include "hal_wifi.h"
+#include "sim.h"
+#include "esp_log.h"
+#include <stdio.h>
+
+static const char *TAG = "HAL_WIFI";
+
+#define SIM_RSSI -58
+
+esp_err_t hal_wifi_connect(const char* ssid, const char* password, uint32_t timeout_ms) {
+    (void)password;
+
+    // Station started: the radio draws idle current from here on, even if
+    // association fails
+    sim_set_radio(true);
+
+    if (ssid == NULL || ssid[0] == '\0') {
+        sim_spend((int64_t)timeout_ms * 1000, SIM_LOAD_RADIO_RX, "wifi_connect");
+        ESP_LOGW(TAG, "Connection to %s failed: %s", "(none)", esp_err_to_name(ESP_ERR_TIMEOUT));
+        return ESP_ERR_TIMEOUT;
+    }
+
+    sim_spend(sim_model_us(sim_model.wifi_tx_ms), SIM_LOAD_RADIO_TX, "wifi_connect");
+    sim_spend(sim_model_us(sim_model.wifi_connect_ms), SIM_LOAD_RADIO_RX, "wifi_connect");
+
+    if (sim_fault(sim_model.wifi_fail_rate)) {
+        ESP_LOGW(TAG, "Connection to %s failed: %s", ssid, esp_err_to_name(ESP_FAIL));
+        return ESP_FAIL;
+    }
+
+    sim_count(SIM_STAT_WIFI_CONNECTS, 1);
+    return ESP_OK;
+}
+
+esp_err_t hal_wifi_get_rssi(int8_t* rssi) {
+    if (!sim_radio_on()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    *rssi = SIM_RSSI;
+    return ESP_OK;
+}
+
+esp_err_t hal_wifi_get_ip(char* ip, size_t size) {
+    if (!sim_radio_on()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    snprintf(ip, size, "127.0.0.1");
+    return ESP_OK;
+}
+
+void hal_wifi_stop(void) {
+    sim_set_radio(false);
+}
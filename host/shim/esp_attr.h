@@ -0,0 +1,8 @@
+#pragma once
+
+// Host build: RTC memory is a linker section the simulator saves across
+// simulated deep sleeps (see sim.c)
+
+#define RTC_NOINIT_ATTR __attribute__((section("rtc_noinit")))
+#define RTC_DATA_ATTR __attribute__((section("rtc_noinit")))
+#define IRAM_ATTR
@@ -0,0 +1,15 @@
+#pragma once
+
+// Host build: seeded PRNG so simulated runs are reproducible
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint32_t esp_random(void);
+
+#ifdef __cplusplus
+}
+#endif
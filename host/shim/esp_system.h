@@ -0,0 +1,18 @@
+#pragma once
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*shutdown_handler_t)(void);
+
+// Host build: handlers run on esp_restart() only, like on the device
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handler);
+
+void esp_restart(void) __attribute__((noreturn));
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,15 @@
+#pragma once
+
+// Host build: esp_timer reads the simulator's virtual clock
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int64_t esp_timer_get_time(void);
+
+#ifdef __cplusplus
+}
+#endif
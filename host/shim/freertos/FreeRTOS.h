@@ -0,0 +1,9 @@
+#pragma once
+
+// Host build: the simulator is single-threaded, critical sections are no-ops
+
+typedef int portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
@@ -0,0 +1,60 @@
+// tinfl_decompress() for the host build, behind the ESP32 ROM's API. zlib
+// keeps its own window, so the caller's wrapping output buffer only
+// receives the bytes.
+
+#include "miniz.h"
+#include <string.h>
+
+enum { STATE_START, STATE_RUNNING, STATE_DONE, STATE_FAILED };
+
+tinfl_status tinfl_decompress(tinfl_decompressor* r, const uint8_t* pIn_buf_next, size_t* pIn_buf_size,
+                              uint8_t* pOut_buf_start, uint8_t* pOut_buf_next, size_t* pOut_buf_size,
+                              const uint32_t decomp_flags) {
+    z_stream* z = &r->stream;
+    size_t in_size = *pIn_buf_size;
+    size_t out_size = *pOut_buf_size;
+    *pIn_buf_size = 0;
+    *pOut_buf_size = 0;
+    if (r->m_state == STATE_DONE) {
+        return TINFL_STATUS_DONE;
+    }
+    if (r->m_state == STATE_FAILED) {
+        return TINFL_STATUS_FAILED;
+    }
+    if (r->m_state == STATE_START) {
+        memset(z, 0, sizeof(*z));
+        int window_bits = decomp_flags & TINFL_FLAG_PARSE_ZLIB_HEADER ? 15 : -15;
+        if (inflateInit2(z, window_bits) != Z_OK) {
+            return TINFL_STATUS_BAD_PARAM;
+        }
+        r->m_state = STATE_RUNNING;
+    }
+
+    z->next_in = (Bytef*)pIn_buf_next;
+    z->avail_in = (uInt)in_size;
+    z->next_out = pOut_buf_next;
+    z->avail_out = (uInt)out_size;
+    int ret = inflate(z, Z_NO_FLUSH);
+    *pIn_buf_size = in_size - z->avail_in;
+    *pOut_buf_size = out_size - z->avail_out;
+
+    if (ret == Z_STREAM_END) {
+        inflateEnd(z);
+        r->m_state = STATE_DONE;
+        return TINFL_STATUS_DONE;
+    }
+    if (ret != Z_OK && ret != Z_BUF_ERROR) {
+        inflateEnd(z);
+        r->m_state = STATE_FAILED;
+        return TINFL_STATUS_FAILED;
+    }
+    if (z->avail_out == 0) {
+        return TINFL_STATUS_HAS_MORE_OUTPUT;
+    }
+    if (!(decomp_flags & TINFL_FLAG_HAS_MORE_INPUT)) {
+        inflateEnd(z);
+        r->m_state = STATE_FAILED;
+        return TINFL_STATUS_FAILED;
+    }
+    return TINFL_STATUS_NEEDS_MORE_INPUT;
+}
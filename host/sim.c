@@ -0,0 +1,306 @@
+#include "sim.h"
+#include "sim_trace.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIM_MAGIC 0x53494D31  // "SIM1"
+#define SIM_STATE_FILE "sim_state.bin"
+#define SIM_TRACE_FILE "trace.csv"
+
+// RTC_NOINIT_ATTR variables (esp_attr.h shim) are collected here by the linker
+extern uint8_t __start_rtc_noinit[] __attribute__((weak));
+extern uint8_t __stop_rtc_noinit[] __attribute__((weak));
+
+/**
+ * Totals carried from wake to wake, followed by the RTC memory image
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t rtc_size;
+    uint32_t wakes;                      // Completed boots
+    uint32_t next_cause;                 // hal_wake_cause_t of the next boot
+    int64_t wall_us;                     // True wall clock when the next boot starts
+    uint32_t clock_synced;               // RTC clock holds an SNTP-synced time
+    uint32_t reserved;
+    double charge_mas[SIM_PHASE_COUNT];  // mA*s per rail (drives the cell voltage)
+    int64_t awake_us;
+    int64_t sleep_us;
+    uint32_t stats[SIM_STAT_COUNT];
+} sim_totals_t;
+
+static sim_totals_t totals;
+static double boot_charge_mas[SIM_PHASE_COUNT];
+static char state_dir[PATH_MAX];
+static const char* screenshot_dir = NULL;
+static int64_t uptime_us = 0;
+static hal_wake_cause_t wake_cause = HAL_WAKE_COLD;
+static bool radio_on = false;
+static bool epd_on = false;
+static uint32_t rng_state = 1;
+static uint32_t fault_state = 1;
+
+// Li-ion open-circuit curve (same points as battery_model.c), highest first
+static const struct {
+    float percent;
+    float voltage_mv;
+} cell_curve[] = {
+    {100, 4150}, {95, 4100}, {85, 4000}, {78, 3950}, {70, 3900}, {62, 3850},
+    {53, 3800}, {43, 3750}, {33, 3700}, {24, 3650}, {16, 3600}, {10, 3550},
+    {6, 3500}, {3, 3400}, {1, 3300}, {0, 3000},
+};
+#define CELL_CURVE_POINTS (sizeof(cell_curve) / sizeof(cell_curve[0]))
+
+static size_t rtc_size(void) {
+    if (__start_rtc_noinit == NULL || __stop_rtc_noinit == NULL) {
+        return 0;
+    }
+    return (size_t)(__stop_rtc_noinit - __start_rtc_noinit);
+}
+
+static void state_path(char* path, size_t size, const char* dir) {
+    snprintf(path, size, "%s/%s", dir, SIM_STATE_FILE);
+}
+
+const char* sim_trace_path(const char* dir) {
+    static char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", dir, SIM_TRACE_FILE);
+    return path;
+}
+
+static uint32_t xorshift32(uint32_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+static int load_totals(const char* dir, sim_totals_t* out, uint8_t* rtc, size_t rtc_len) {
+    char path[PATH_MAX];
+    state_path(path, sizeof(path), dir);
+
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) {
+        return -1;
+    }
+
+    int ok = fread(out, sizeof(*out), 1, f) == 1 && out->magic == SIM_MAGIC;
+    if (ok && rtc != NULL) {
+        ok = out->rtc_size == rtc_len && fread(rtc, 1, rtc_len, f) == rtc_len;
+    }
+    fclose(f);
+    return ok ? 0 : -1;
+}
+
+static void save_totals(void) {
+    char path[PATH_MAX], tmp[PATH_MAX + 8];
+    state_path(path, sizeof(path), state_dir);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+    FILE* f = fopen(tmp, "wb");
+    if (f == NULL) {
+        perror("sim: cannot write state");
+        exit(2);
+    }
+    totals.rtc_size = (uint32_t)rtc_size();
+    fwrite(&totals, sizeof(totals), 1, f);
+    if (totals.rtc_size > 0) {
+        fwrite(__start_rtc_noinit, 1, totals.rtc_size, f);
+    }
+    fclose(f);
+    rename(tmp, path);
+}
+
+static double total_charge_mas(void) {
+    double sum = 0;
+    for (int i = 0; i < SIM_PHASE_COUNT; i++) {
+        sum += totals.charge_mas[i];
+    }
+    return sum;
+}
+
+void sim_boot(const char* dir, uint32_t seed, time_t start_epoch) {
+    snprintf(state_dir, sizeof(state_dir), "%s", dir);
+
+    // Cold start of a new run: RTC memory starts zeroed (CRCs reject it)
+    if (load_totals(dir, &totals, __start_rtc_noinit, rtc_size()) != 0) {
+        memset(&totals, 0, sizeof(totals));
+        totals.magic = SIM_MAGIC;
+        totals.wall_us = (int64_t)start_epoch * 1000000;
+        totals.next_cause = HAL_WAKE_COLD;
+        if (rtc_size() > 0) {
+            memset(__start_rtc_noinit, 0, rtc_size());
+        }
+    }
+
+    wake_cause = (hal_wake_cause_t)totals.next_cause;
+    memcpy(boot_charge_mas, totals.charge_mas, sizeof(boot_charge_mas));
+
+    rng_state = seed ^ ((totals.wakes + 1) * 0x9E3779B9u);
+    fault_state = rng_state ^ 0x5bd1e995u;
+    if (rng_state == 0) {
+        rng_state = 1;
+    }
+    if (fault_state == 0) {
+        fault_state = 1;
+    }
+
+    if (sim_trace_open(sim_trace_path(dir), totals.wakes + 1) != 0) {
+        perror("sim: cannot open trace");
+    }
+
+    sim_spend(sim_model_us(sim_model.boot_ms), SIM_LOAD_AWAKE, "boot");
+}
+
+const char* sim_state_dir(void) {
+    return state_dir;
+}
+
+uint32_t sim_wake_number(void) {
+    return totals.wakes + 1;
+}
+
+void sim_set_screenshot_dir(const char* dir) {
+    screenshot_dir = dir;
+}
+
+const char* sim_screenshot_dir(void) {
+    return screenshot_dir;
+}
+
+void sim_spend(int64_t us, sim_load_t load, const char* label) {
+    sim_model_charge(&sim_model, load, radio_on, epd_on, us, totals.charge_mas);
+    sim_trace_span(label, load, radio_on, epd_on, us);
+    totals.awake_us += us;
+    uptime_us += us;
+}
+
+int64_t sim_uptime_us(void) {
+    return uptime_us;
+}
+
+time_t sim_wall_time(void) {
+    if (!totals.clock_synced) {
+        return (time_t)(uptime_us / 1000000);
+    }
+    return (time_t)((totals.wall_us + uptime_us) / 1000000);
+}
+
+void sim_clock_synced(void) {
+    totals.clock_synced = 1;
+}
+
+void sim_set_radio(bool on) {
+    radio_on = on;
+}
+
+bool sim_radio_on(void) {
+    return radio_on;
+}
+
+void sim_set_epd(bool on) {
+    epd_on = on;
+}
+
+bool sim_epd_on(void) {
+    return epd_on;
+}
+
+hal_wake_cause_t sim_wake_cause(void) {
+    return wake_cause;
+}
+
+uint32_t sim_random(void) {
+    return xorshift32(&rng_state);
+}
+
+bool sim_fault(float rate) {
+    return rate > 0 && (xorshift32(&fault_state) % 1000000) < (uint32_t)(rate * 1000000);
+}
+
+float sim_battery_mv(void) {
+    float used_mah = (float)(total_charge_mas() / 3600.0);
+    float percent = 100.0f * (1.0f - used_mah / sim_model.battery_mah);
+
+    if (percent >= cell_curve[0].percent) {
+        return cell_curve[0].voltage_mv;
+    }
+    for (size_t i = 1; i < CELL_CURVE_POINTS; i++) {
+        if (percent >= cell_curve[i].percent) {
+            float fraction = (percent - cell_curve[i].percent) /
+                             (cell_curve[i - 1].percent - cell_curve[i].percent);
+            return cell_curve[i].voltage_mv +
+                   fraction * (cell_curve[i - 1].voltage_mv - cell_curve[i].voltage_mv);
+        }
+    }
+    return cell_curve[CELL_CURVE_POINTS - 1].voltage_mv;
+}
+
+void sim_count(sim_stat_t stat, uint32_t amount) {
+    totals.stats[stat] += amount;
+}
+
+uint32_t sim_stat(sim_stat_t stat) {
+    return totals.stats[stat];
+}
+
+static void end_boot(int64_t sleep_us) {
+    double wake_mas = 0;
+    for (int i = 0; i < SIM_PHASE_SLEEP; i++) {
+        wake_mas += totals.charge_mas[i] - boot_charge_mas[i];
+    }
+    printf("SIM: boot %lu: awake %.2f s, %.3f mAh (cpu %.3f, radio %.3f, epd %.3f)\n",
+           (unsigned long)totals.wakes + 1, uptime_us / 1e6, wake_mas / 3600.0,
+           (totals.charge_mas[SIM_PHASE_CPU] - boot_charge_mas[SIM_PHASE_CPU]) / 3600.0,
+           (totals.charge_mas[SIM_PHASE_RADIO] - boot_charge_mas[SIM_PHASE_RADIO]) / 3600.0,
+           (totals.charge_mas[SIM_PHASE_EPD] - boot_charge_mas[SIM_PHASE_EPD]) / 3600.0);
+    fflush(stdout);
+
+    if (sleep_us > 0) {
+        sim_trace_span("sleep", SIM_LOAD_SLEEP, false, false, sleep_us);
+    }
+    sim_trace_close();
+
+    totals.wall_us += uptime_us + sleep_us;
+    totals.wakes++;
+    save_totals();
+}
+
+void sim_sleep(uint32_t seconds) {
+    int64_t sleep_us = (int64_t)seconds * 1000000;
+    sim_model_charge(&sim_model, SIM_LOAD_SLEEP, false, false, sleep_us, totals.charge_mas);
+    totals.sleep_us += sleep_us;
+    totals.next_cause = HAL_WAKE_TIMER;
+
+    end_boot(sleep_us);
+    exit(0);
+}
+
+void sim_restart(void) {
+    totals.next_cause = HAL_WAKE_COLD;
+    end_boot(0);
+    exit(0);
+}
+
+void sim_halt(int exit_code) {
+    end_boot(0);
+    exit(exit_code);
+}
+
+int sim_report(const char* dir) {
+    sim_totals_t t;
+    if (load_totals(dir, &t, NULL, 0) != 0) {
+        fprintf(stderr, "sim: no state in %s\n", dir);
+        return -1;
+    }
+
+    if (sim_trace_report(sim_trace_path(dir), &sim_model) != 0) {
+        return -1;
+    }
+    printf("Counts:      %lu refreshes, %lu NVS commits, %lu HTTP requests (%lu bytes), %lu WiFi connects\n",
+           (unsigned long)t.stats[SIM_STAT_REFRESHES], (unsigned long)t.stats[SIM_STAT_NVS_COMMITS],
+           (unsigned long)t.stats[SIM_STAT_HTTP_REQUESTS], (unsigned long)t.stats[SIM_STAT_HTTP_BYTES],
+           (unsigned long)t.stats[SIM_STAT_WIFI_CONNECTS]);
+    return 0;
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "hal_sleep.h"
+#include "sim_model.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Virtual-time board simulator behind the Linux HAL backends
+ *
+ * Every HAL call spends a modeled amount of virtual time under a load,
+ * which is charged to the CPU, radio and EPD rails with the active
+ * sim_model and appended to the state directory's trace. One simulated wake is
+ * one process: sim_boot() restores the RTC memory image, clock and energy
+ * totals from the state directory, sim_sleep() charges the deep sleep,
+ * saves everything and exits.
+ */
+
+/**
+ * Counters reported per run
+ */
+typedef enum {
+    SIM_STAT_REFRESHES,
+    SIM_STAT_NVS_COMMITS,
+    SIM_STAT_HTTP_REQUESTS,
+    SIM_STAT_HTTP_BYTES,
+    SIM_STAT_WIFI_CONNECTS,
+    SIM_STAT_COUNT
+} sim_stat_t;
+
+/**
+ * Restore state for the next simulated wake (child process)
+ *
+ * @param state_dir Directory holding sim_state.bin and the NVS files
+ * @param seed PRNG seed (mixed with the wake number)
+ * @param start_epoch Wall-clock time of the first cold boot
+ */
+void sim_boot(const char* state_dir, uint32_t seed, time_t start_epoch);
+
+/**
+ * @return State directory passed to sim_boot()
+ */
+const char* sim_state_dir(void);
+
+/**
+ * @return Number of the current wake, from 1
+ */
+uint32_t sim_wake_number(void);
+
+/**
+ * Save every screen refresh as a PNG (golden images), named
+ * wake<N>_<refresh>.png
+ *
+ * @param dir Existing directory, or NULL to save none
+ */
+void sim_set_screenshot_dir(const char* dir);
+
+/**
+ * @return Directory passed to sim_set_screenshot_dir(), or NULL
+ */
+const char* sim_screenshot_dir(void);
+
+/**
+ * Spend virtual time
+ *
+ * @param us Duration in microseconds
+ * @param load Activity during that time
+ * @param label Activity name in the trace and report (e.g. "http")
+ */
+void sim_spend(int64_t us, sim_load_t load, const char* label);
+
+/**
+ * @return Virtual microseconds since this boot
+ */
+int64_t sim_uptime_us(void);
+
+/**
+ * @return Wall-clock time as the firmware sees it (1970-based until synced)
+ */
+time_t sim_wall_time(void);
+
+/**
+ * Mark the wall clock as synchronized (SNTP succeeded)
+ */
+void sim_clock_synced(void);
+
+void sim_set_radio(bool on);
+bool sim_radio_on(void);
+void sim_set_epd(bool on);
+bool sim_epd_on(void);
+
+/**
+ * @return Cause of the current boot
+ */
+hal_wake_cause_t sim_wake_cause(void);
+
+/**
+ * @return Deterministic pseudo-random number (esp_random())
+ */
+uint32_t sim_random(void);
+
+/**
+ * Decide whether an injected fault happens, from a PRNG stream separate
+ * from sim_random() so fault rates do not change the quotes or sleep times
+ *
+ * @param rate Probability between 0 and 1
+ */
+bool sim_fault(float rate);
+
+/**
+ * @return Simulated cell voltage for the charge drawn so far
+ */
+float sim_battery_mv(void);
+
+void sim_count(sim_stat_t stat, uint32_t amount);
+
+/**
+ * @return Counter value accumulated in this process
+ */
+uint32_t sim_stat(sim_stat_t stat);
+
+/**
+ * Charge the deep sleep, persist RTC memory and totals, end the process
+ *
+ * @param seconds Timer wake delay
+ */
+void sim_sleep(uint32_t seconds) __attribute__((noreturn));
+
+/**
+ * Software reset: RTC memory kept, next boot is a cold boot
+ */
+void sim_restart(void) __attribute__((noreturn));
+
+/**
+ * End the simulation inside a wake (the device would stay awake, e.g. in
+ * provisioning mode): saves the trace and totals, exits with exit_code
+ */
+void sim_halt(int exit_code) __attribute__((noreturn));
+
+/**
+ * @return Trace file of a state directory (static buffer)
+ */
+const char* sim_trace_path(const char* state_dir);
+
+/**
+ * Print the energy report for all wakes in a state directory (parent process)
+ *
+ * @param state_dir Directory passed to sim_boot()
+ * @return 0 on success, -1 if no state was found
+ */
+int sim_report(const char* state_dir);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,46 @@
+#pragma once
+
+// Default current draw and timing model of the simulated board (Lilygo
+// T5-4.7, ESP32). Currents are per rail; radio and EPD figures are added on
+// top of the CPU while those parts are active. Every value can be
+// overridden at run time with quote_sim --model FILE (see sim_model.h).
+
+// CPU (CONFIG_ESP32_DEFAULT_CPU_FREQ_240): current = base + per_mhz * MHz
+#define SIM_CPU_MHZ 240.0f
+#define SIM_CPU_BASE_MA 20.0f
+#define SIM_CPU_MA_PER_MHZ 0.125f      // 30 mA at 80 MHz, 50 mA at 240 MHz
+
+// Radio and panel (mA on top of the CPU)
+#define SIM_RADIO_IDLE_MA 30.0f        // Started/associated, WIFI_PS_MIN_MODEM between beacons
+#define SIM_RADIO_RX_MA 70.0f          // Extra while listening/receiving
+#define SIM_RADIO_TX_MA 160.0f         // Extra while transmitting
+#define SIM_EPD_IDLE_MA 12.0f          // EPD rail on, panel idle (also feeds battery divider)
+#define SIM_EPD_REFRESH_MA 130.0f      // Extra while a waveform is driven
+#define SIM_SLEEP_MA 0.17f             // Whole board in deep sleep
+
+// Durations (ms)
+#define SIM_BOOT_MS 320.0f             // ROM + bootloader + app start before app_main()
+#define SIM_WIFI_CONNECT_MS 1800.0f    // Scan, auth, association, DHCP (mostly receiving)
+#define SIM_WIFI_TX_MS 25.0f           // Airtime of probe/auth/assoc/DHCP frames
+#define SIM_SNTP_MS 190.0f             // One NTP exchange (DNS is charged separately)
+#define SIM_DNS_MS 60.0f               // One lookup at the network's resolver
+#define SIM_DNS_TTL_S 300.0f           // TTL the simulated resolver answers with
+#define SIM_HTTP_RTT_MS 120.0f         // Per round trip to the quote API
+#define SIM_HTTP_TX_MS 5.0f            // Airtime of the request
+#define SIM_TLS_HANDSHAKE_MS 900.0f    // Full handshake incl. certificate verification
+#define SIM_HTTP_BYTES_PER_S 200000.0f // Effective download rate
+#define SIM_EPD_REFRESH_MS 1500.0f     // GC16 full-screen update
+#define SIM_EPD_CLEAR_MS 900.0f        // epd_clear() flashing cycles
+#define SIM_ADC_SAMPLE_MS 0.04f        // One oneshot conversion
+#define SIM_NVS_COMMIT_MS 12.0f        // Blob write + commit
+#define SIM_FLASH_WRITE_BYTES_PER_S 160000.0f // Erase + program of an app slot (esp_ota_write)
+
+// Fault injection (probability per attempt)
+#define SIM_WIFI_FAIL_RATE 0.0f        // Association attempt fails
+#define SIM_SNTP_FAIL_RATE 0.0f        // No NTP answer before the timeout
+
+// Battery
+#define SIM_BATTERY_MAH 2000.0f        // Matches BATTERY_CAPACITY_MAH in battery_model.c
+
+// Wall clock at the first cold boot (2025-03-01 08:00 UTC)
+#define SIM_DEFAULT_START_EPOCH 1740816000
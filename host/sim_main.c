@@ -0,0 +1,293 @@
+// quote_sim: runs the firmware wake cycle on a PC
+//
+// Each wake is a forked child that boots from the saved RTC image, runs the
+// same sequence as app_main() for a configured device and exits from deep
+// sleep; the parent prints the energy report when all wakes are done.
+// --replay costs an existing trace with a (different) current model instead.
+
+#include "sim.h"
+#include "sim_config.h"
+#include "sim_trace.h"
+#include "display_ui.h"
+#include "sleep_manager.h"
+#include "battery.h"
+#include "device_state.h"
+#include "binlog.h"
+#include "gerunds.h"
+#include "maintenance.h"
+#include "wake_cycle.h"
+#include "wake_budget.h"
+#include "hal_time.h"
+#include "hal_wifi.h"
+#include "wifi_manager.h"
+#include "wifi_networks.h"
+#include "esp_log.h"
+#include "cJSON.h"
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static const char *TAG = "MAIN";
+
+#define WIFI_CONNECT_TIMEOUT_MS 15000
+#define EXIT_PROVISIONING 3    // Wake ended in provisioning mode (stays awake)
+
+typedef struct {
+    int wakes;
+    const char* state_dir;
+    uint32_t seed;
+    time_t start_epoch;
+    const char* ssid;
+    const char* password;
+    const char* replay;
+    long budget_ms;            // -1: WAKE_BUDGET_MS on timer wakes, none on a cold boot
+    bool fresh;
+    esp_log_level_t log_level;
+} sim_options_t;
+
+// Same policy as wifi_event_handler(): the first attempt plus WIFI_MAX_RETRY
+// reconnects per cycle, WIFI_RETRY_DELAY_MS between cycles (station still
+// started), provisioning after WIFI_MAX_RETRY_CYCLES. Returns ESP_ERR_TIMEOUT
+// when the wake budget runs out first (the wake goes on offline)
+static esp_err_t connect_with_retries(const char* ssid, const char* password) {
+    for (int cycle = 0; cycle <= WIFI_MAX_RETRY_CYCLES; cycle++) {
+        for (int attempt = 0; attempt <= WIFI_MAX_RETRY; attempt++) {
+            if (!wake_budget_check()) {
+                return ESP_ERR_TIMEOUT;
+            }
+            if (hal_wifi_connect(ssid, password, wake_budget_clamp_ms(WIFI_CONNECT_TIMEOUT_MS)) == ESP_OK) {
+                return ESP_OK;
+            }
+        }
+        if (cycle < WIFI_MAX_RETRY_CYCLES && wake_budget_remaining_ms() < WIFI_RETRY_DELAY_MS) {
+            // The wait would outlast the wake budget
+            wake_budget_expire();
+            return ESP_ERR_TIMEOUT;
+        }
+        if (cycle < WIFI_MAX_RETRY_CYCLES) {
+            ESP_LOGW(TAG, "Failed to connect after %d attempts (cycle %d/%d), waiting before retry...",
+                     WIFI_MAX_RETRY, cycle + 1, WIFI_MAX_RETRY_CYCLES);
+            sim_spend((int64_t)WIFI_RETRY_DELAY_MS * 1000, SIM_LOAD_AWAKE, "wifi_retry_wait");
+        }
+    }
+    return ESP_FAIL;
+}
+
+// Mirrors app_main() plus the STA path of wifi_manager for saved credentials
+static void write_metrics(const char* state_dir) {
+    char* json = maintenance_metrics_json();
+    char path[512];
+    snprintf(path, sizeof(path), "%s/metrics.json", state_dir);
+    FILE* f = fopen(path, "w");
+    if (json != NULL && f != NULL) {
+        fputs(json, f);
+        ESP_LOGI(TAG, "Maintenance metrics written to %s", path);
+    }
+    if (f != NULL) {
+        fclose(f);
+    }
+    cJSON_free(json);
+}
+
+static void run_wake(const sim_options_t* opt) __attribute__((noreturn));
+static void run_wake(const sim_options_t* opt) {
+    esp_log_level_set("*", opt->log_level);
+    ESP_LOGI(TAG, "Starting Lilygo T5-4.7 Quote Display (host simulator)");
+
+    device_state_init();
+    binlog_init();
+    battery_print_last_reading();
+    sleep_manager_init();
+
+    bool is_wakeup = sleep_manager_is_wakeup_from_sleep();
+    if (is_wakeup) {
+        ESP_LOGI(TAG, "Woke from timer - time for periodic quote update");
+    } else {
+        ESP_LOGI(TAG, "Cold boot - first run");
+    }
+    if (opt->budget_ms >= 0) {
+        wake_budget_start((uint32_t)opt->budget_ms);
+    } else {
+        wake_budget_start(is_wakeup ? WAKE_BUDGET_MS : 0);
+    }
+
+    display_init();
+    if (battery_init() == ESP_OK) {
+        display_set_power_hook(battery_display_power_hook);
+    }
+
+    if (is_wakeup) {
+        display_loading(get_random_gerund());
+    } else {
+        display_connecting(opt->ssid);
+    }
+
+    // --ssid stands for a network saved through the portal; the simulated
+    // radio has no scan, so only the stats of the saved network are kept
+    int network = -1;
+    if (opt->ssid[0] != '\0') {
+        wifi_networks_init();
+        network = wifi_networks_find(opt->ssid);
+        if (network < 0 && wifi_networks_add(opt->ssid, opt->password, 0, NULL) == ESP_OK) {
+            network = 0;
+        }
+    }
+
+    wake_budget_enter(WAKE_STAGE_WIFI);
+    int64_t connect_started_us = hal_time_us();
+    esp_err_t err = connect_with_retries(opt->ssid, opt->password);
+    if (err == ESP_OK && network >= 0) {
+        static const uint8_t no_bssid[6];
+        int8_t rssi = 0;
+        hal_wifi_get_rssi(&rssi);
+        wifi_networks_connected(network, 0, no_bssid, rssi, (hal_time_us() - connect_started_us) / 1000);
+    }
+    if (err == ESP_FAIL) {
+        // The device would now sit in softAP provisioning until configured
+        ESP_LOGW(TAG, "Failed to connect after %d retry cycles, switching to provisioning mode",
+                 WIFI_MAX_RETRY_CYCLES);
+        sim_halt(EXIT_PROVISIONING);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Wake budget used up while connecting, continuing offline");
+        hal_wifi_stop();
+    }
+
+    uint32_t sleep_seconds = wake_cycle_run(err == ESP_OK);
+
+    // Maintenance window: what GET /metrics.json would answer goes to the
+    // state directory, and the station stays up listening
+    uint32_t window_ms = maintenance_window_ms();
+    if (window_ms > 0) {
+        write_metrics(opt->state_dir);
+        sim_spend((int64_t)window_ms * 1000, SIM_LOAD_RADIO_RX, "maintenance");
+    }
+    sleep_manager_enter_deep_sleep(sleep_seconds);
+    exit(1);  // Not reached: deep sleep ends the process
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -n, --wakes N      Wakes to simulate (default 10)\n"
+            "  -d, --state DIR    State directory: RTC image, NVS, totals (default sim_state)\n"
+            "  -f, --fresh        Discard saved state and start with a cold boot\n"
+            "  -s, --seed N       PRNG seed (default 1)\n"
+            "  -t, --start EPOCH  Wall clock of the first cold boot\n"
+            "  -w, --ssid NAME    Network to join (empty = no network)\n"
+            "  -b, --budget MS    Wake budget (default %d on timer wakes, none on a cold\n"
+            "                     boot; 0 = none)\n"
+            "  -q, --quiet        Warnings and the energy report only\n"
+            "  -m, --model FILE   Current/timing model overrides (key = value)\n"
+            "  -p, --print-model  Print the active model and exit\n"
+            "  -r, --replay FILE  Cost an existing trace with the model, no simulation\n"
+            "  -g, --screenshots DIR  Save each screen refresh as DIR/wake<N>_<k>.png\n",
+            prog, WAKE_BUDGET_MS);
+}
+
+static void remove_state(const char* dir) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/sim_state.bin", dir);
+    remove(path);
+    remove(sim_trace_path(dir));
+    snprintf(path, sizeof(path), "rm -rf '%s/nvs'", dir);
+    if (system(path) != 0) {
+        fprintf(stderr, "Could not remove %s/nvs\n", dir);
+    }
+}
+
+int main(int argc, char** argv) {
+    sim_options_t opt = {
+        .wakes = 10,
+        .state_dir = "sim_state",
+        .seed = 1,
+        .start_epoch = SIM_DEFAULT_START_EPOCH,
+        .ssid = "SimNet",
+        .password = "",
+        .replay = NULL,
+        .budget_ms = -1,
+        .fresh = false,
+        .log_level = ESP_LOG_INFO,
+    };
+
+    static const struct option long_options[] = {
+        {"wakes", required_argument, NULL, 'n'},
+        {"state", required_argument, NULL, 'd'},
+        {"fresh", no_argument, NULL, 'f'},
+        {"seed", required_argument, NULL, 's'},
+        {"start", required_argument, NULL, 't'},
+        {"ssid", required_argument, NULL, 'w'},
+        {"budget", required_argument, NULL, 'b'},
+        {"quiet", no_argument, NULL, 'q'},
+        {"model", required_argument, NULL, 'm'},
+        {"print-model", no_argument, NULL, 'p'},
+        {"replay", required_argument, NULL, 'r'},
+        {"screenshots", required_argument, NULL, 'g'},
+        {NULL, 0, NULL, 0},
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "n:d:fs:t:w:b:qm:pr:g:", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'n': opt.wakes = atoi(optarg); break;
+            case 'd': opt.state_dir = optarg; break;
+            case 'f': opt.fresh = true; break;
+            case 's': opt.seed = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 't': opt.start_epoch = (time_t)strtoll(optarg, NULL, 0); break;
+            case 'w': opt.ssid = optarg; break;
+            case 'b': opt.budget_ms = strtol(optarg, NULL, 10); break;
+            case 'q': opt.log_level = ESP_LOG_WARN; break;
+            case 'm':
+                if (sim_model_load(optarg) != 0) {
+                    return 2;
+                }
+                break;
+            case 'p': sim_model_print(stdout); return 0;
+            case 'r': opt.replay = optarg; break;
+            case 'g':
+                mkdir(optarg, 0755);
+                sim_set_screenshot_dir(optarg);
+                break;
+            default: usage(argv[0]); return 2;
+        }
+    }
+
+    if (opt.replay != NULL) {
+        return sim_trace_report(opt.replay, &sim_model) == 0 ? 0 : 1;
+    }
+
+    mkdir(opt.state_dir, 0755);
+    if (opt.fresh) {
+        remove_state(opt.state_dir);
+    }
+
+    for (int i = 0; i < opt.wakes; i++) {
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            return 1;
+        }
+        if (pid == 0) {
+            sim_boot(opt.state_dir, opt.seed, opt.start_epoch);
+            run_wake(&opt);
+        }
+
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (WIFEXITED(status) && WEXITSTATUS(status) == EXIT_PROVISIONING) {
+            printf("SIM: wake %d fell back to provisioning mode, stopping\n", i + 1);
+            break;
+        }
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            fprintf(stderr, "Wake %d did not reach deep sleep (status %d)\n", i + 1, status);
+            return 1;
+        }
+    }
+
+    return sim_report(opt.state_dir) == 0 ? 0 : 1;
+}
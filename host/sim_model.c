@@ -0,0 +1,160 @@
+#include "sim_model.h"
+#include "sim_config.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+sim_model_t sim_model = {
+    .cpu_mhz = SIM_CPU_MHZ,
+    .cpu_base_ma = SIM_CPU_BASE_MA,
+    .cpu_ma_per_mhz = SIM_CPU_MA_PER_MHZ,
+    .radio_idle_ma = SIM_RADIO_IDLE_MA,
+    .radio_rx_ma = SIM_RADIO_RX_MA,
+    .radio_tx_ma = SIM_RADIO_TX_MA,
+    .epd_idle_ma = SIM_EPD_IDLE_MA,
+    .epd_refresh_ma = SIM_EPD_REFRESH_MA,
+    .sleep_ma = SIM_SLEEP_MA,
+    .boot_ms = SIM_BOOT_MS,
+    .wifi_connect_ms = SIM_WIFI_CONNECT_MS,
+    .wifi_tx_ms = SIM_WIFI_TX_MS,
+    .sntp_ms = SIM_SNTP_MS,
+    .dns_ms = SIM_DNS_MS,
+    .dns_ttl_s = SIM_DNS_TTL_S,
+    .http_rtt_ms = SIM_HTTP_RTT_MS,
+    .http_tx_ms = SIM_HTTP_TX_MS,
+    .tls_handshake_ms = SIM_TLS_HANDSHAKE_MS,
+    .http_bytes_per_s = SIM_HTTP_BYTES_PER_S,
+    .epd_refresh_ms = SIM_EPD_REFRESH_MS,
+    .epd_clear_ms = SIM_EPD_CLEAR_MS,
+    .adc_sample_ms = SIM_ADC_SAMPLE_MS,
+    .nvs_commit_ms = SIM_NVS_COMMIT_MS,
+    .flash_write_bytes_per_s = SIM_FLASH_WRITE_BYTES_PER_S,
+    .wifi_fail_rate = SIM_WIFI_FAIL_RATE,
+    .sntp_fail_rate = SIM_SNTP_FAIL_RATE,
+    .battery_mah = SIM_BATTERY_MAH,
+};
+
+#define FIELD(name) {#name, offsetof(sim_model_t, name)}
+
+static const struct {
+    const char* key;
+    size_t offset;
+} model_fields[] = {
+    FIELD(cpu_mhz), FIELD(cpu_base_ma), FIELD(cpu_ma_per_mhz),
+    FIELD(radio_idle_ma), FIELD(radio_rx_ma), FIELD(radio_tx_ma),
+    FIELD(epd_idle_ma), FIELD(epd_refresh_ma), FIELD(sleep_ma),
+    FIELD(boot_ms), FIELD(wifi_connect_ms), FIELD(wifi_tx_ms), FIELD(sntp_ms),
+    FIELD(dns_ms), FIELD(dns_ttl_s),
+    FIELD(http_rtt_ms), FIELD(http_tx_ms), FIELD(tls_handshake_ms), FIELD(http_bytes_per_s),
+    FIELD(epd_refresh_ms), FIELD(epd_clear_ms), FIELD(adc_sample_ms), FIELD(nvs_commit_ms),
+    FIELD(flash_write_bytes_per_s),
+    FIELD(wifi_fail_rate), FIELD(sntp_fail_rate), FIELD(battery_mah),
+};
+#define MODEL_FIELD_COUNT (sizeof(model_fields) / sizeof(model_fields[0]))
+
+static const char* load_names[SIM_LOAD_COUNT] = {"awake", "rx", "tx", "refresh", "sleep"};
+static const char* phase_names[SIM_PHASE_COUNT] = {"cpu", "radio", "epd", "sleep"};
+
+static char* trim(char* s) {
+    while (*s == ' ' || *s == '\t') {
+        s++;
+    }
+    char* end = s + strlen(s);
+    while (end > s && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\n' || end[-1] == '\r')) {
+        *--end = '\0';
+    }
+    return s;
+}
+
+int sim_model_load(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (f == NULL) {
+        fprintf(stderr, "sim: cannot open model %s\n", path);
+        return -1;
+    }
+
+    char line[256];
+    int line_no = 0;
+    int result = 0;
+    while (fgets(line, sizeof(line), f) != NULL) {
+        line_no++;
+        char* comment = strchr(line, '#');
+        if (comment != NULL) {
+            *comment = '\0';
+        }
+        char* eq = strchr(line, '=');
+        if (eq == NULL) {
+            if (trim(line)[0] != '\0') {
+                fprintf(stderr, "sim: %s:%d: expected key = value\n", path, line_no);
+                result = -1;
+            }
+            continue;
+        }
+        *eq = '\0';
+        char* key = trim(line);
+        char* value = trim(eq + 1);
+
+        size_t i;
+        for (i = 0; i < MODEL_FIELD_COUNT; i++) {
+            if (strcmp(key, model_fields[i].key) == 0) {
+                *(float*)((char*)&sim_model + model_fields[i].offset) = strtof(value, NULL);
+                break;
+            }
+        }
+        if (i == MODEL_FIELD_COUNT) {
+            fprintf(stderr, "sim: %s:%d: unknown model key '%s'\n", path, line_no, key);
+            result = -1;
+        }
+    }
+    fclose(f);
+    return result;
+}
+
+void sim_model_print(FILE* out) {
+    for (size_t i = 0; i < MODEL_FIELD_COUNT; i++) {
+        fprintf(out, "%s = %g\n", model_fields[i].key,
+                *(const float*)((const char*)&sim_model + model_fields[i].offset));
+    }
+}
+
+int64_t sim_model_us(float ms) {
+    return (int64_t)(ms * 1000.0f + 0.5f);
+}
+
+void sim_model_charge(const sim_model_t* model, sim_load_t load, bool radio_on, bool epd_on,
+                      int64_t us, double mas[SIM_PHASE_COUNT]) {
+    double seconds = us / 1e6;
+
+    if (load == SIM_LOAD_SLEEP) {
+        mas[SIM_PHASE_SLEEP] += model->sleep_ma * seconds;
+        return;
+    }
+
+    double cpu_ma = model->cpu_base_ma + model->cpu_ma_per_mhz * model->cpu_mhz;
+    double radio_ma = (radio_on ? model->radio_idle_ma : 0) +
+                      (load == SIM_LOAD_RADIO_RX ? model->radio_rx_ma : 0) +
+                      (load == SIM_LOAD_RADIO_TX ? model->radio_tx_ma : 0);
+    double epd_ma = (epd_on ? model->epd_idle_ma : 0) +
+                    (load == SIM_LOAD_EPD_REFRESH ? model->epd_refresh_ma : 0);
+
+    mas[SIM_PHASE_CPU] += cpu_ma * seconds;
+    mas[SIM_PHASE_RADIO] += radio_ma * seconds;
+    mas[SIM_PHASE_EPD] += epd_ma * seconds;
+}
+
+const char* sim_load_name(sim_load_t load) {
+    return load < SIM_LOAD_COUNT ? load_names[load] : "?";
+}
+
+sim_load_t sim_load_from_name(const char* name) {
+    for (int i = 0; i < SIM_LOAD_COUNT; i++) {
+        if (strcmp(name, load_names[i]) == 0) {
+            return (sim_load_t)i;
+        }
+    }
+    return SIM_LOAD_COUNT;
+}
+
+const char* sim_phase_name(sim_phase_t phase) {
+    return phase < SIM_PHASE_COUNT ? phase_names[phase] : "?";
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Rails energy is charged to
+ */
+typedef enum {
+    SIM_PHASE_CPU,
+    SIM_PHASE_RADIO,
+    SIM_PHASE_EPD,
+    SIM_PHASE_SLEEP,
+    SIM_PHASE_COUNT
+} sim_phase_t;
+
+/**
+ * What the board is doing while virtual time passes
+ */
+typedef enum {
+    SIM_LOAD_AWAKE,          // CPU plus whatever rails are on
+    SIM_LOAD_RADIO_RX,       // Radio listening/receiving on top
+    SIM_LOAD_RADIO_TX,       // Radio transmitting on top
+    SIM_LOAD_EPD_REFRESH,    // Waveform being driven on top
+    SIM_LOAD_SLEEP,          // Deep sleep (nothing else counts)
+    SIM_LOAD_COUNT
+} sim_load_t;
+
+/**
+ * Current draw and timing model (defaults in sim_config.h)
+ */
+typedef struct {
+    float cpu_mhz;
+    float cpu_base_ma;
+    float cpu_ma_per_mhz;
+    float radio_idle_ma;
+    float radio_rx_ma;
+    float radio_tx_ma;
+    float epd_idle_ma;
+    float epd_refresh_ma;
+    float sleep_ma;
+    float boot_ms;
+    float wifi_connect_ms;
+    float wifi_tx_ms;
+    float sntp_ms;
+    float dns_ms;
+    float dns_ttl_s;
+    float http_rtt_ms;
+    float http_tx_ms;
+    float tls_handshake_ms;
+    float http_bytes_per_s;
+    float epd_refresh_ms;
+    float epd_clear_ms;
+    float adc_sample_ms;
+    float nvs_commit_ms;
+    float flash_write_bytes_per_s;
+    float wifi_fail_rate;
+    float sntp_fail_rate;
+    float battery_mah;
+} sim_model_t;
+
+// Active model; inherited by the per-wake child processes
+extern sim_model_t sim_model;
+
+/**
+ * Override model values from a "key = value" file ('#' starts a comment)
+ *
+ * @param path Model file
+ * @return 0 on success, -1 on unreadable file or unknown key
+ */
+int sim_model_load(const char* path);
+
+/**
+ * Write the active model in the format sim_model_load() reads
+ */
+void sim_model_print(FILE* out);
+
+/**
+ * Convert a model duration to microseconds
+ */
+int64_t sim_model_us(float ms);
+
+/**
+ * Charge drawn per rail for a span of time
+ *
+ * @param model Current model
+ * @param load Activity during the span
+ * @param radio_on Radio started (idle current applies)
+ * @param epd_on EPD rail on (idle current applies)
+ * @param us Span length
+ * @param mas Per-rail charge in mA*s, added to
+ */
+void sim_model_charge(const sim_model_t* model, sim_load_t load, bool radio_on, bool epd_on,
+                      int64_t us, double mas[SIM_PHASE_COUNT]);
+
+const char* sim_load_name(sim_load_t load);
+sim_load_t sim_load_from_name(const char* name);
+const char* sim_phase_name(sim_phase_t phase);
+
+#ifdef __cplusplus
+}
+#endif
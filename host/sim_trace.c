@@ -0,0 +1,182 @@
+#include "sim_trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRACE_HEADER "wake,label,load,radio,epd,us"
+#define MAX_LABELS 32
+#define LABEL_LEN 32
+
+static FILE* trace_file = NULL;
+static uint32_t trace_wake = 0;
+static struct {
+    bool valid;
+    char label[LABEL_LEN];
+    sim_load_t load;
+    bool radio_on;
+    bool epd_on;
+    int64_t us;
+} pending;
+
+static void flush_pending(void) {
+    if (pending.valid && trace_file != NULL) {
+        fprintf(trace_file, "%lu,%s,%s,%d,%d,%lld\n", (unsigned long)trace_wake, pending.label,
+                sim_load_name(pending.load), pending.radio_on, pending.epd_on, (long long)pending.us);
+    }
+    pending.valid = false;
+}
+
+int sim_trace_open(const char* path, uint32_t wake) {
+    trace_file = fopen(path, "a");
+    if (trace_file == NULL) {
+        return -1;
+    }
+    if (ftell(trace_file) == 0) {
+        fprintf(trace_file, TRACE_HEADER "\n");
+    }
+    trace_wake = wake;
+    pending.valid = false;
+    return 0;
+}
+
+void sim_trace_span(const char* label, sim_load_t load, bool radio_on, bool epd_on, int64_t us) {
+    if (pending.valid && pending.load == load && pending.radio_on == radio_on &&
+        pending.epd_on == epd_on && strcmp(pending.label, label) == 0) {
+        pending.us += us;
+        return;
+    }
+
+    flush_pending();
+    pending.valid = true;
+    snprintf(pending.label, sizeof(pending.label), "%s", label);
+    pending.load = load;
+    pending.radio_on = radio_on;
+    pending.epd_on = epd_on;
+    pending.us = us;
+}
+
+void sim_trace_close(void) {
+    flush_pending();
+    if (trace_file != NULL) {
+        fclose(trace_file);
+        trace_file = NULL;
+    }
+}
+
+typedef struct {
+    char label[LABEL_LEN];
+    int64_t us;
+    double mas;
+} label_total_t;
+
+static int compare_mas(const void* a, const void* b) {
+    double diff = ((const label_total_t*)b)->mas - ((const label_total_t*)a)->mas;
+    return (diff > 0) - (diff < 0);
+}
+
+int sim_trace_report(const char* path, const sim_model_t* model) {
+    FILE* f = fopen(path, "r");
+    if (f == NULL) {
+        fprintf(stderr, "sim: cannot open trace %s\n", path);
+        return -1;
+    }
+
+    double rail_mas[SIM_PHASE_COUNT] = {0};
+    label_total_t labels[MAX_LABELS];
+    int label_count = 0;
+    int64_t awake_us = 0, sleep_us = 0;
+    unsigned long wakes = 0, last_wake = (unsigned long)-1;
+    int line_no = 0;
+    char line[256];
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+        line_no++;
+        if (strncmp(line, "wake,", 5) == 0 || line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+
+        unsigned long wake;
+        char label[LABEL_LEN], load_name[16];
+        int radio_on, epd_on;
+        long long us;
+        if (sscanf(line, "%lu,%31[^,],%15[^,],%d,%d,%lld", &wake, label, load_name,
+                   &radio_on, &epd_on, &us) != 6) {
+            fprintf(stderr, "sim: %s:%d: malformed span\n", path, line_no);
+            continue;
+        }
+        sim_load_t load = sim_load_from_name(load_name);
+        if (load == SIM_LOAD_COUNT) {
+            fprintf(stderr, "sim: %s:%d: unknown load '%s'\n", path, line_no, load_name);
+            continue;
+        }
+
+        if (wake != last_wake) {
+            wakes++;
+            last_wake = wake;
+        }
+
+        double mas[SIM_PHASE_COUNT] = {0};
+        sim_model_charge(model, load, radio_on, epd_on, us, mas);
+
+        double span_mas = 0;
+        for (int i = 0; i < SIM_PHASE_COUNT; i++) {
+            rail_mas[i] += mas[i];
+            span_mas += mas[i];
+        }
+        if (load == SIM_LOAD_SLEEP) {
+            sleep_us += us;
+        } else {
+            awake_us += us;
+        }
+
+        int i;
+        for (i = 0; i < label_count; i++) {
+            if (strcmp(labels[i].label, label) == 0) {
+                break;
+            }
+        }
+        if (i == label_count && label_count < MAX_LABELS) {
+            snprintf(labels[i].label, LABEL_LEN, "%s", label);
+            labels[i].us = 0;
+            labels[i].mas = 0;
+            label_count++;
+        }
+        if (i < label_count) {
+            labels[i].us += us;
+            labels[i].mas += span_mas;
+        }
+    }
+    fclose(f);
+
+    if (wakes == 0) {
+        fprintf(stderr, "sim: %s holds no spans\n", path);
+        return -1;
+    }
+
+    double total_mas = 0;
+    for (int i = 0; i < SIM_PHASE_COUNT; i++) {
+        total_mas += rail_mas[i];
+    }
+    double total_mah = total_mas / 3600.0;
+    double hours = (awake_us + sleep_us) / 3.6e9;
+    double avg_ma = hours > 0 ? total_mah / hours : 0;
+
+    printf("\n==== Energy: %lu wakes over %.1f h (virtual) ====\n", wakes, hours);
+    printf("Awake:       %.1f s total, %.2f s per wake\n", awake_us / 1e6, awake_us / 1e6 / wakes);
+    printf("Charge:      %.3f mAh total\n", total_mah);
+    printf("Per refresh: %.3f mAh (one wake incl. its sleep)\n", total_mah / wakes);
+    printf("Per rail:\n");
+    for (int i = 0; i < SIM_PHASE_COUNT; i++) {
+        printf("  %-16s %9.3f mAh (%4.1f%%)\n", sim_phase_name((sim_phase_t)i), rail_mas[i] / 3600.0,
+               total_mas > 0 ? 100.0 * rail_mas[i] / total_mas : 0);
+    }
+    printf("Per activity:\n");
+    qsort(labels, label_count, sizeof(labels[0]), compare_mas);
+    for (int i = 0; i < label_count; i++) {
+        printf("  %-16s %9.3f mAh (%4.1f%%) %10.2f s\n", labels[i].label, labels[i].mas / 3600.0,
+               total_mas > 0 ? 100.0 * labels[i].mas / total_mas : 0, labels[i].us / 1e6);
+    }
+    printf("Average:     %.3f mA -> %.0f days on %.0f mAh\n", avg_ma,
+           avg_ma > 0 ? model->battery_mah / avg_ma / 24.0 : 0, model->battery_mah);
+    return 0;
+}
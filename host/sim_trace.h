@@ -0,0 +1,52 @@
+#pragma once
+
+#include "sim_model.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Energy traces
+ *
+ * A trace is a CSV of time spans, one per line:
+ *     wake,label,load,radio,epd,us
+ * e.g. "3,epd_refresh,refresh,0,1,1500000". load is one of awake, rx, tx,
+ * refresh, sleep; radio/epd say whether that rail was powered. quote_sim
+ * writes one per state directory; traces from other sources (a device log
+ * converted to spans) can be costed the same way.
+ */
+
+/**
+ * Start appending spans for one wake
+ *
+ * @param path Trace file (created with a header if missing)
+ * @param wake Boot number written in the first column
+ * @return 0 on success, -1 if the file cannot be opened
+ */
+int sim_trace_open(const char* path, uint32_t wake);
+
+/**
+ * Record a span; consecutive spans with the same label and state are merged
+ */
+void sim_trace_span(const char* label, sim_load_t load, bool radio_on, bool epd_on, int64_t us);
+
+/**
+ * Write the pending span and close the file
+ */
+void sim_trace_close(void);
+
+/**
+ * Cost a trace with a current model and print the energy report
+ *
+ * @param path Trace file
+ * @param model Current model to apply
+ * @return 0 on success, -1 if the trace cannot be read
+ */
+int sim_trace_report(const char* path, const sim_model_t* model);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,378 @@
+// tls_bench: cost of each firmware TLS trust mode (CONFIG_QUOTE_TLS_TRUST_*)
+// against the mock server's TLS listener: handshake time, TLS heap per
+// connection, flash taken by the trust anchors, and the largest TLS records
+// in each direction (what CONFIG_MBEDTLS_SSL_IN/OUT_CONTENT_LEN must hold).
+// The local test CA (QUOTE_SIM_CA) stands in for the pinned root.
+//
+// Measures OpenSSL through libcurl, not mbedtls: times and heap are relative
+// between modes, not device numbers. The host also parses the whole bundle
+// per connection, where the device looks up one root, so the bundle's heap
+// is overstated; its flash estimate uses the esp_crt_bundle format.
+
+#include <curl/curl.h>
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include <openssl/x509v3.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_RUNS 20
+#define MAX_RUNS 1000
+#define DEFAULT_BUNDLE "/etc/ssl/certs/ca-certificates.crt"
+#define LOCAL_TLS_URL "https://localhost:8443/api/randomquote?language=it"
+
+// Cipher suites of trust_store.txt's "ecdsa-first" (TLS 1.2 names)
+#define SUITES_ECDSA_FIRST "ECDHE-ECDSA-AES128-GCM-SHA256:ECDHE-ECDSA-AES256-GCM-SHA384:" \
+                           "ECDHE-RSA-AES128-GCM-SHA256:ECDHE-RSA-AES256-GCM-SHA384"
+
+typedef enum {
+    TRUST_FULL,      // Full bundle, any suite: the previous firmware default
+    TRUST_BUNDLE,    // Full bundle, ECDSA-first suites
+    TRUST_CA,        // Pinned root certificate
+    TRUST_KEY,       // Pinned root public key
+} trust_mode_t;
+
+static const char* const mode_names[] = {"full", "bundle", "ca", "key"};
+
+// Heap accounting for OpenSSL, i.e. the TLS stack (installed before curl
+// initializes it)
+static struct {
+    size_t current;
+    size_t peak;
+} heap;
+
+typedef union {
+    size_t size;
+    max_align_t align;
+} alloc_header_t;
+
+static void* counting_malloc(size_t size, const char* file, int line) {
+    alloc_header_t* block = malloc(sizeof(alloc_header_t) + size);
+    if (block == NULL) {
+        return NULL;
+    }
+    block->size = size;
+    heap.current += size;
+    if (heap.current > heap.peak) {
+        heap.peak = heap.current;
+    }
+    return block + 1;
+}
+
+static void counting_free(void* ptr, const char* file, int line) {
+    if (ptr == NULL) {
+        return;
+    }
+    alloc_header_t* block = (alloc_header_t*)ptr - 1;
+    heap.current -= block->size;
+    free(block);
+}
+
+static void* counting_realloc(void* ptr, size_t size, const char* file, int line) {
+    if (ptr == NULL) {
+        return counting_malloc(size, file, line);
+    }
+    if (size == 0) {
+        counting_free(ptr, file, line);
+        return NULL;
+    }
+    alloc_header_t* block = (alloc_header_t*)ptr - 1;
+    size_t old_size = block->size;
+    block = realloc(block, sizeof(alloc_header_t) + size);
+    if (block == NULL) {
+        return NULL;
+    }
+    block->size = size;
+    heap.current = heap.current - old_size + size;
+    if (heap.current > heap.peak) {
+        heap.peak = heap.current;
+    }
+    return block + 1;
+}
+
+// Pinned root of the key mode, loaded from the test CA
+static struct {
+    EVP_PKEY* key;
+    unsigned char sha256[32];
+} pin;
+
+// Largest TLS records seen in the current mode
+static struct {
+    size_t in;
+    size_t out;
+} records;
+
+static size_t discard(char* data, size_t size, size_t nmemb, void* user_data) {
+    return size * nmemb;
+}
+
+static int compare_double(const void* a, const void* b) {
+    double diff = *(const double*)a - *(const double*)b;
+    return (diff > 0) - (diff < 0);
+}
+
+static char* read_file(const char* path, size_t* len) {
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char* data = malloc(size + 1);
+    if (data != NULL && fread(data, 1, size, f) != (size_t)size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    if (data != NULL) {
+        data[size] = '\0';
+        *len = size;
+    }
+    return data;
+}
+
+// Flash the anchors of a PEM file take on the device: DER certificates (ca),
+// SubjectPublicKeyInfo + SHA-256 (key), or esp_crt_bundle entries of
+// subject name + public key with two length bytes each (bundle)
+static size_t anchors_flash(const char* pem, size_t pem_len, trust_mode_t mode, int* count) {
+    BIO* bio = BIO_new_mem_buf(pem, (int)pem_len);
+    size_t flash = 0;
+    *count = 0;
+    X509* cert;
+    while ((cert = PEM_read_bio_X509(bio, NULL, NULL, NULL)) != NULL) {
+        int spki = i2d_X509_PUBKEY(X509_get_X509_PUBKEY(cert), NULL);
+        if (mode == TRUST_CA) {
+            flash += i2d_X509(cert, NULL);
+        } else if (mode == TRUST_KEY) {
+            flash += spki + 32;
+        } else {
+            flash += 4 + i2d_X509_NAME(X509_get_subject_name(cert), NULL) + spki;
+        }
+        (*count)++;
+        X509_free(cert);
+    }
+    BIO_free(bio);
+    return flash;
+}
+
+static bool load_pin(const char* ca_pem, size_t ca_len) {
+    BIO* bio = BIO_new_mem_buf(ca_pem, (int)ca_len);
+    X509* cert = PEM_read_bio_X509(bio, NULL, NULL, NULL);
+    BIO_free(bio);
+    if (cert == NULL) {
+        return false;
+    }
+    unsigned char* spki = NULL;
+    int spki_len = i2d_X509_PUBKEY(X509_get_X509_PUBKEY(cert), &spki);
+    EVP_Digest(spki, spki_len, pin.sha256, NULL, EVP_sha256(), NULL);
+    OPENSSL_free(spki);
+    pin.key = X509_get_pubkey(cert);
+    X509_free(cert);
+    return pin.key != NULL;
+}
+
+static bool pinned_key(X509* cert) {
+    unsigned char* spki = NULL;
+    unsigned char digest[32];
+    int spki_len = i2d_X509_PUBKEY(X509_get_X509_PUBKEY(cert), &spki);
+    EVP_Digest(spki, spki_len, digest, NULL, EVP_sha256(), NULL);
+    OPENSSL_free(spki);
+    return memcmp(digest, pin.sha256, sizeof(digest)) == 0 || X509_verify(cert, pin.key) == 1;
+}
+
+// Key mode as the firmware's verify callback does it: every certificate the
+// server sends is signed by the next one and valid now, and the top one
+// carries the pinned key or is signed by it. curl checks the host name.
+static int verify_pinned_key(X509_STORE_CTX* ctx, void* arg) {
+    X509* leaf = X509_STORE_CTX_get0_cert(ctx);
+    STACK_OF(X509)* sent = X509_STORE_CTX_get0_untrusted(ctx);
+    X509* cert = leaf;
+    int depth = 0;
+    for (;;) {
+        if (X509_cmp_current_time(X509_get0_notBefore(cert)) > 0 ||
+            X509_cmp_current_time(X509_get0_notAfter(cert)) < 0) {
+            X509_STORE_CTX_set_error(ctx, X509_V_ERR_CERT_HAS_EXPIRED);
+            return 0;
+        }
+        if (pinned_key(cert)) {
+            return 1;
+        }
+        // Next certificate in the sent chain (index 0 is the leaf)
+        X509* issuer = sent != NULL && depth + 1 < sk_X509_num(sent) ? sk_X509_value(sent, depth + 1) : NULL;
+        if (issuer == NULL || X509_verify(cert, X509_get0_pubkey(issuer)) != 1) {
+            X509_STORE_CTX_set_error(ctx, X509_V_ERR_UNABLE_TO_GET_ISSUER_CERT_LOCALLY);
+            return 0;
+        }
+        cert = issuer;
+        depth++;
+    }
+}
+
+static void record_sizes(int write_p, int version, int content_type, const void* buf, size_t len,
+                         SSL* ssl, void* arg) {
+    if (content_type != SSL3_RT_HEADER || len < 5) {
+        return;
+    }
+    const unsigned char* header = buf;
+    size_t size = (size_t)header[3] << 8 | header[4];
+    size_t* largest = write_p ? &records.out : &records.in;
+    if (size > *largest) {
+        *largest = size;
+    }
+}
+
+static CURLcode setup_ssl_ctx(CURL* curl, void* ssl_ctx, void* user_data) {
+    SSL_CTX* ctx = ssl_ctx;
+    SSL_CTX_set_msg_callback(ctx, record_sizes);
+    if (*(const trust_mode_t*)user_data == TRUST_KEY) {
+        SSL_CTX_set_cert_verify_callback(ctx, verify_pinned_key, NULL);
+    }
+    return CURLE_OK;
+}
+
+static int run_mode(trust_mode_t mode, const char* url, int runs, const char* bundle_pem, size_t bundle_len,
+                    const char* ca_pem, size_t ca_len) {
+    static double handshake_ms[MAX_RUNS];
+    static trust_mode_t current;
+    current = mode;
+    records.in = records.out = 0;
+
+    // The device's anchors: the full bundle plus the test CA standing in for
+    // the real roots (bundle modes), or the test CA alone (pinned modes)
+    char* anchors = NULL;
+    size_t anchors_len = 0;
+    if (mode == TRUST_FULL || mode == TRUST_BUNDLE) {
+        anchors = malloc(bundle_len + ca_len + 1);
+        memcpy(anchors, bundle_pem, bundle_len);
+        anchors[bundle_len] = '\n';
+        memcpy(anchors + bundle_len + 1, ca_pem, ca_len);
+        anchors_len = bundle_len + ca_len + 1;
+    }
+    int roots = 0;
+    size_t flash = mode == TRUST_CA || mode == TRUST_KEY ? anchors_flash(ca_pem, ca_len, mode, &roots)
+                                                         : anchors_flash(anchors, anchors_len, mode, &roots);
+
+    size_t peak_sum = 0;
+    int ok = 0;
+    for (int i = 0; i < runs; i++) {
+        CURL* curl = curl_easy_init();
+        curl_easy_setopt(curl, CURLOPT_URL, url);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, discard);
+        curl_easy_setopt(curl, CURLOPT_SSLVERSION, CURL_SSLVERSION_TLSv1_2 | CURL_SSLVERSION_MAX_TLSv1_2);
+        curl_easy_setopt(curl, CURLOPT_SSL_SESSIONID_CACHE, 0L);
+        curl_easy_setopt(curl, CURLOPT_CA_CACHE_TIMEOUT, 0L);
+        curl_easy_setopt(curl, CURLOPT_CAPATH, NULL);
+        curl_easy_setopt(curl, CURLOPT_SSL_CTX_FUNCTION, setup_ssl_ctx);
+        curl_easy_setopt(curl, CURLOPT_SSL_CTX_DATA, &current);
+        if (mode != TRUST_FULL) {
+            curl_easy_setopt(curl, CURLOPT_SSL_CIPHER_LIST, SUITES_ECDSA_FIRST);
+        }
+        struct curl_blob blob = {
+            .data = mode == TRUST_CA ? (void*)ca_pem : anchors,
+            .len = mode == TRUST_CA ? ca_len : anchors_len,
+            .flags = CURL_BLOB_NOCOPY,
+        };
+        if (mode == TRUST_KEY) {
+            curl_easy_setopt(curl, CURLOPT_CAINFO, NULL);  // Trust comes from the verify callback only
+        } else {
+            curl_easy_setopt(curl, CURLOPT_CAINFO_BLOB, &blob);
+        }
+
+        heap.peak = heap.current;
+        size_t before = heap.current;
+        CURLcode res = curl_easy_perform(curl);
+        long status = 0;
+        curl_off_t connect_us = 0, appconnect_us = 0;
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+        curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME_T, &connect_us);
+        curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME_T, &appconnect_us);
+        curl_easy_cleanup(curl);
+        peak_sum += heap.peak - before;
+
+        if (res != CURLE_OK || status != 200) {
+            fprintf(stderr, "%s: %s (status %ld)\n", mode_names[mode],
+                    res != CURLE_OK ? curl_easy_strerror(res) : "rejected", status);
+            free(anchors);
+            return -1;
+        }
+        handshake_ms[i] = (appconnect_us - connect_us) / 1e3;
+        ok++;
+    }
+    free(anchors);
+
+    qsort(handshake_ms, runs, sizeof(handshake_ms[0]), compare_double);
+    printf("%-8s %5d %7d/%-3d %8.2f %8.2f %10zu %10zu %8zu %8zu\n", mode_names[mode], roots, ok, runs,
+           handshake_ms[runs / 2], handshake_ms[(runs * 95) / 100], peak_sum / runs, flash, records.in,
+           records.out);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    // Before anything initializes OpenSSL
+    CRYPTO_set_mem_functions(counting_malloc, counting_realloc, counting_free);
+
+    int runs = DEFAULT_RUNS;
+    const char* bundle_file = DEFAULT_BUNDLE;
+    const char* url = strncmp(QUOTABLE_API_URL, "https://", 8) == 0 ? QUOTABLE_API_URL : LOCAL_TLS_URL;
+
+    static const struct option long_options[] = {
+        {"runs", required_argument, NULL, 'n'},
+        {"bundle", required_argument, NULL, 'b'},
+        {"url", required_argument, NULL, 'u'},
+        {NULL, 0, NULL, 0},
+    };
+    int c;
+    while ((c = getopt_long(argc, argv, "n:b:u:", long_options, NULL)) != -1) {
+        switch (c) {
+            case 'n': runs = atoi(optarg); break;
+            case 'b': bundle_file = optarg; break;
+            case 'u': url = optarg; break;
+            default:
+                fprintf(stderr, "Usage: %s [--runs N] [--bundle PEM] [--url https://...]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (runs < 1 || runs > MAX_RUNS) {
+        fprintf(stderr, "--runs must be 1..%d\n", MAX_RUNS);
+        return 2;
+    }
+
+    const char* ca_file = getenv("QUOTE_SIM_CA");
+    size_t ca_len = 0, bundle_len = 0;
+    char* ca_pem = ca_file != NULL ? read_file(ca_file, &ca_len) : NULL;
+    char* bundle_pem = read_file(bundle_file, &bundle_len);
+    if (ca_pem == NULL || !load_pin(ca_pem, ca_len)) {
+        fprintf(stderr, "Set QUOTE_SIM_CA to the mock server's CA certificate (the pinned root)\n");
+        return 2;
+    }
+    if (bundle_pem == NULL) {
+        fprintf(stderr, "Cannot read the certificate bundle %s\n", bundle_file);
+        return 2;
+    }
+
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    printf("TLS benchmark: %s, %d handshakes per mode (TLS 1.2, no session resumption)\n", url, runs);
+    printf("%-8s %5s %11s %8s %8s %10s %10s %8s %8s\n", "mode", "roots", "ok", "p50 ms", "p95 ms",
+           "peak heap", "flash", "rec in", "rec out");
+
+    int failures = 0;
+    for (trust_mode_t mode = TRUST_FULL; mode <= TRUST_KEY; mode++) {
+        if (run_mode(mode, url, runs, bundle_pem, bundle_len, ca_pem, ca_len) != 0) {
+            failures++;
+        }
+    }
+
+    curl_global_cleanup();
+    free(bundle_pem);
+    free(ca_pem);
+    EVP_PKEY_free(pin.key);
+    return failures == 0 ? 0 : 1;
+}
@@ -1,111 +1,86 @@
 #include "battery.h"
-#include "epdiy.h"
-#include "driver/adc.h"
-#include "esp_adc_cal.h"
+#include "battery_filter.h"
+#include "battery_model.h"
+#include "display_ui.h"
+#include "hal_adc.h"
+#include "hal_display.h"
+#include "hal_time.h"
 #include "esp_log.h"
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
-#include "nvs_flash.h"
+#include "binlog.h"
 #include "nvs.h"
+#include "device_state.h"
 #include <time.h>
 
 static const char *TAG = "BATTERY";
-#define BATTERY_NVS_NAMESPACE "battery_log"
-#define BATTERY_READING_KEY "last_reading"
 
-// Hardware configuration
-#define BATT_PIN_GPIO 36
-#define BATT_ADC_CHANNEL ADC1_CHANNEL_0    // GPIO 36 = ADC1_CH0
-#define BATT_ADC_ATTEN ADC_ATTEN_DB_11     // 0-3.3V range
-#define BATT_ADC_WIDTH ADC_WIDTH_BIT_12    // 12-bit resolution (0-4095)
-#define BATT_SAMPLES 64                     // Number of samples to average
+// Sampling configuration (ADC channel/attenuation/calibration live in hal_adc)
+#define BATT_SAMPLES 128                    // Samples per back-to-back burst (~5ms)
+#define BATT_TRIM_PERCENT 25                // Drop lowest/highest 25% (interquartile mean)
+#define BATT_SETTLE_MS 100                  // Divider settle time after EPD power-on
+
+// Display phase used for piggybacked sampling:
+//   DISPLAY_POWER_SETTLED   - rail up, panel idle: fixed, repeatable load (default)
+//   DISPLAY_POWER_REFRESHED - right after the refresh pulse, battery still recovering
+#define BATT_SAMPLE_PHASE DISPLAY_POWER_SETTLED
 
 // Battery characteristics
 #define BATT_VOLTAGE_DIVIDER 2.0           // Hardware voltage divider ratio
-#define BATT_MIN_VOLTAGE 3.0               // Voltage at 0%
-#define BATT_MAX_VOLTAGE 4.0               // Voltage at 100% (anything above = 100%)
 
-// ADC calibration
-static esp_adc_cal_characteristics_t adc_chars;
 static bool initialized = false;
 
 // Last reading cache
 static battery_reading_t last_reading = {0};
 
-esp_err_t battery_init(void) {
-    ESP_LOGI(TAG, "Initializing battery voltage monitoring on GPIO %d...", BATT_PIN_GPIO);
+// Set once a voltage has been sampled this wake (while the display was powered)
+static bool voltage_cached = false;
 
-    // Configure ADC1 width (resolution)
-    esp_err_t err = adc1_config_width(BATT_ADC_WIDTH);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to configure ADC width: %s", esp_err_to_name(err));
-        return err;
+esp_err_t battery_init(void) {
+    if (initialized) {
+        return ESP_OK;
     }
 
-    // Configure ADC1 channel with attenuation
-    err = adc1_config_channel_atten(BATT_ADC_CHANNEL, BATT_ADC_ATTEN);
+    ESP_LOGI(TAG, "Initializing battery voltage monitoring on GPIO %d...", HAL_ADC_BATTERY_GPIO);
+
+    esp_err_t err = hal_adc_init();
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to configure ADC channel attenuation: %s", esp_err_to_name(err));
         return err;
     }
 
-    // Characterize ADC for calibration (uses eFuse vref if available)
-    esp_adc_cal_value_t val_type = esp_adc_cal_characterize(
-        ADC_UNIT_1,
-        BATT_ADC_ATTEN,
-        BATT_ADC_WIDTH,
-        1100,  // Default vref (will be overridden by eFuse if available)
-        &adc_chars
-    );
-
-    // Log calibration method used
-    if (val_type == ESP_ADC_CAL_VAL_EFUSE_VREF) {
-        ESP_LOGI(TAG, "ADC calibrated using eFuse Vref: %lu mV", (unsigned long)adc_chars.vref);
-    } else if (val_type == ESP_ADC_CAL_VAL_EFUSE_TP) {
-        ESP_LOGI(TAG, "ADC calibrated using eFuse Two Point");
-    } else {
-        ESP_LOGI(TAG, "ADC calibrated using Default Vref: 1100 mV");
-    }
-
     initialized = true;
     ESP_LOGI(TAG, "Battery monitoring initialized successfully");
     return ESP_OK;
 }
 
-float battery_read_voltage(void) {
-    if (!initialized) {
-        ESP_LOGE(TAG, "Battery module not initialized! Call battery_init() first.");
-        return -1.0;
-    }
-
-    // Power on EPD to enable voltage divider
-    epd_poweron();
-    vTaskDelay(pdMS_TO_TICKS(100));  // Increased stabilization time from 50ms to 100ms
-
-    // Read multiple samples with delays and average
-    // Adding delays between samples reduces noise
-    uint32_t adc_sum = 0;
+// Capture and convert one burst; the caller must have the EPD rail on and settled
+static float battery_sample_burst(void) {
+    // Capture one back-to-back burst; a conversion takes ~40us, so the whole
+    // burst fits in a few milliseconds instead of 64 x 2ms tick delays.
+    // Noise is handled by the trimmed mean below rather than by spacing samples.
+    uint16_t samples[BATT_SAMPLES];
+    int64_t burst_start = hal_time_us();
     for (int i = 0; i < BATT_SAMPLES; i++) {
-        int raw = adc1_get_raw(BATT_ADC_CHANNEL);
-        if (raw < 0) {
-            ESP_LOGE(TAG, "ADC read error: %d", raw);
-            epd_poweroff();
+        int raw = 0;
+        esp_err_t err = hal_adc_read(&raw);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "ADC read error: %s", esp_err_to_name(err));
             return -1.0;
         }
-        adc_sum += (uint32_t)raw;
-
-        // Small delay between samples to allow ADC to settle
-        if (i < BATT_SAMPLES - 1) {
-            vTaskDelay(pdMS_TO_TICKS(2));
-        }
+        samples[i] = (uint16_t)raw;
     }
-    uint32_t adc_average = adc_sum / BATT_SAMPLES;
+    int64_t burst_us = hal_time_us() - burst_start;
 
-    // Power off EPD
-    epd_poweroff();
+    // Reject outliers (WiFi/EPD switching spikes) and average the middle half
+    battery_filter_result_t filtered;
+    battery_filter_trimmed_mean(samples, BATT_SAMPLES, BATT_TRIM_PERCENT, &filtered);
+    uint32_t adc_average = filtered.value;
 
     // Convert ADC reading to voltage (in millivolts) using calibration
-    uint32_t voltage_mv = esp_adc_cal_raw_to_voltage(adc_average, &adc_chars);
+    int calibrated_mv = 0;
+    if (hal_adc_to_mv((int)adc_average, &calibrated_mv) != ESP_OK) {
+        // Uncalibrated fallback: linear over the 12dB range
+        calibrated_mv = (int)((adc_average * HAL_ADC_FULL_SCALE_MV) / HAL_ADC_MAX_RAW);
+    }
+    uint32_t voltage_mv = (uint32_t)calibrated_mv;
 
     // Account for voltage divider (2:1 ratio)
     float actual_voltage = ((float)voltage_mv / 1000.0) * BATT_VOLTAGE_DIVIDER;
@@ -114,53 +89,77 @@ float battery_read_voltage(void) {
     last_reading.adc_raw = adc_average;
     last_reading.voltage_mv = voltage_mv;
     last_reading.actual_voltage = actual_voltage;
+    voltage_cached = true;
+
+    BINLOG_I(TAG, "Battery voltage: %.2f V (ADC filtered: %lu, median: %lu, spread: %lu, ADC mV: %lu)",
+             actual_voltage, (unsigned long)adc_average, (unsigned long)filtered.median,
+             (unsigned long)filtered.spread, (unsigned long)voltage_mv);
+    BINLOG_I(TAG, "Sampled %d readings in %lld us (%u trimmed, %d%% at each end)",
+             BATT_SAMPLES, (long long)burst_us, (unsigned)filtered.trimmed, BATT_TRIM_PERCENT);
+
+    return actual_voltage;
+}
+
+void battery_display_power_hook(display_power_phase_t phase) {
+    // One sample per wake is enough; later refreshes reuse it
+    if (!initialized || voltage_cached || phase != BATT_SAMPLE_PHASE) {
+        return;
+    }
+
+    BINLOG_I(TAG, "Sampling battery on display power cycle (phase %d)", (int)phase);
+    battery_sample_burst();
+}
 
-    ESP_LOGI(TAG, "Battery voltage: %.2f V (ADC avg: %lu, ADC mV: %lu)",
-             actual_voltage, (unsigned long)adc_average, (unsigned long)voltage_mv);
+float battery_read_voltage(void) {
+    if (!initialized) {
+        ESP_LOGE(TAG, "Battery module not initialized! Call battery_init() first.");
+        return -1.0;
+    }
+
+    // Power on EPD to enable voltage divider
+    hal_display_power_on();
+    hal_delay_ms(BATT_SETTLE_MS);
+
+    float actual_voltage = battery_sample_burst();
+
+    // Power off EPD
+    hal_display_power_off();
 
     return actual_voltage;
 }
 
 float battery_read_percentage(void) {
-    float voltage = battery_read_voltage();
+    // Reuse the sample taken during a display refresh this wake; only power
+    // the rail separately if no refresh happened (or the hook is not wired)
+    float voltage;
+    if (voltage_cached) {
+        voltage = last_reading.actual_voltage;
+        BINLOG_I(TAG, "Using battery voltage cached from display power cycle: %.2f V", voltage);
+    } else {
+        voltage = battery_read_voltage();
+    }
 
     if (voltage < 0) {
         ESP_LOGE(TAG, "Failed to read battery voltage");
         return -1.0;
     }
 
-    // Calculate percentage based on Li-ion discharge curve
-    // 3.0V = 0% (safe cutoff), 3.7V = ~50% (nominal), 4.2V = 100%
-    float percentage = ((voltage - BATT_MIN_VOLTAGE) / (BATT_MAX_VOLTAGE - BATT_MIN_VOLTAGE)) * 100.0;
-
-    // Clamp to 0-100% range (handle charging spikes and deep discharge)
-    if (percentage > 100.0) {
-        percentage = 100.0;
-    } else if (percentage < 0.0) {
-        percentage = 0.0;
-    }
+    // Map voltage through the piecewise Li-ion discharge curve (clamped 0-100%)
+    uint32_t battery_mv = (uint32_t)(voltage * 1000.0f + 0.5f);
+    float percentage = battery_model_percentage(battery_mv);
 
-    ESP_LOGI(TAG, "Battery percentage: %.1f%%", percentage);
+    BINLOG_I(TAG, "Battery percentage: %.1f%%", percentage);
 
-    // Save complete reading to NVS for debugging
+    // Save complete reading for debugging
     last_reading.percentage = percentage;
-    time(&last_reading.timestamp);
+    last_reading.timestamp = hal_time_now();
 
-    // Save to NVS
-    nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open(BATTERY_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
-    if (err == ESP_OK) {
-        err = nvs_set_blob(nvs_handle, BATTERY_READING_KEY, &last_reading, sizeof(battery_reading_t));
-        if (err == ESP_OK) {
-            nvs_commit(nvs_handle);
-            ESP_LOGI(TAG, "Battery reading saved to NVS");
-        } else {
-            ESP_LOGW(TAG, "Failed to save battery reading to NVS: %s", esp_err_to_name(err));
-        }
-        nvs_close(nvs_handle);
-    } else {
-        ESP_LOGW(TAG, "Failed to open NVS for battery log: %s", esp_err_to_name(err));
-    }
+    // Append to the discharge history used for runtime estimates
+    battery_model_record(last_reading.timestamp, battery_mv);
+
+    // Keep in the persistent state record (flushed to NVS periodically)
+    device_state_get()->last_battery = last_reading;
+    device_state_commit();
 
     return percentage;
 }
@@ -170,17 +169,13 @@ esp_err_t battery_get_last_reading(battery_reading_t* reading) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open(BATTERY_NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
-    if (err != ESP_OK) {
-        return err;
+    const battery_reading_t *stored = &device_state_get()->last_battery;
+    if (stored->timestamp == 0 && stored->adc_raw == 0) {
+        return ESP_ERR_NVS_NOT_FOUND;
     }
 
-    size_t required_size = sizeof(battery_reading_t);
-    err = nvs_get_blob(nvs_handle, BATTERY_READING_KEY, reading, &required_size);
-    nvs_close(nvs_handle);
-
-    return err;
+    *reading = *stored;
+    return ESP_OK;
 }
 
 void battery_print_last_reading(void) {
@@ -203,6 +198,6 @@ void battery_print_last_reading(void) {
     } else if (err == ESP_ERR_NVS_NOT_FOUND) {
         ESP_LOGI(TAG, "No battery reading found in NVS (device not yet run on battery)");
     } else {
-        ESP_LOGE(TAG, "Failed to retrieve battery reading from NVS: %s", esp_err_to_name(err));
+        ESP_LOGE(TAG, "Failed to retrieve battery reading: %s", esp_err_to_name(err));
     }
 }
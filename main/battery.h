@@ -3,13 +3,14 @@
 #include <esp_err.h>
 #include <stdbool.h>
 #include <time.h>
+#include "display_ui.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 /**
- * Battery reading data structure (stored in NVS)
+ * Battery reading data structure (kept in the persistent device state)
  */
 typedef struct {
     time_t timestamp;        // Unix timestamp of reading
@@ -21,7 +22,8 @@ typedef struct {
 
 /**
  * Initialize battery voltage monitoring
- * Configures ADC1 Channel 0 (GPIO 36) with calibration
+ * Configures ADC1 Channel 0 (GPIO 36) through the oneshot driver with
+ * curve/line fitting calibration. Safe to call more than once.
  *
  * NOTE: Must be called before battery_read_percentage()
  *
@@ -29,13 +31,23 @@ typedef struct {
  */
 esp_err_t battery_init(void);
 
+/**
+ * Display power hook that samples the battery while the EPD rail is on
+ * Register with display_set_power_hook() after battery_init(); the first
+ * refresh of the wake caches a voltage so no separate power cycle is needed
+ *
+ * @param phase Current display power phase
+ */
+void battery_display_power_hook(display_power_phase_t phase);
+
 /**
  * Read battery percentage
- * Powers on EPD voltage divider, reads ADC, calculates percentage
+ * Uses the voltage cached by battery_display_power_hook() when available,
+ * otherwise powers on the EPD voltage divider and reads the ADC itself
  *
- * Uses averaged readings (64 samples) for stability
+ * Uses a 128-sample burst reduced with an interquartile (trimmed) mean
  * Accounts for 2:1 voltage divider on hardware
- * Automatically saves reading to NVS for debugging
+ * Automatically saves reading (and history) to the device state for debugging
  *
  * @return Battery percentage (0-100), or -1.0 on error
  */
@@ -50,7 +62,7 @@ float battery_read_percentage(void);
 float battery_read_voltage(void);
 
 /**
- * Get last battery reading from NVS
+ * Get last battery reading from the persistent device state
  * Useful for debugging when serial console not available
  *
  * @param reading Pointer to battery_reading_t structure to fill
@@ -59,7 +71,7 @@ float battery_read_voltage(void);
 esp_err_t battery_get_last_reading(battery_reading_t* reading);
 
 /**
- * Print last battery reading from NVS to console
+ * Print last battery reading to console
  * Useful for debugging after running on battery
  */
 void battery_print_last_reading(void);
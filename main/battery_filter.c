@@ -0,0 +1,46 @@
+#include "battery_filter.h"
+
+void battery_filter_sort(uint16_t* samples, size_t count) {
+    for (size_t i = 1; i < count; i++) {
+        uint16_t value = samples[i];
+        size_t j = i;
+        while (j > 0 && samples[j - 1] > value) {
+            samples[j] = samples[j - 1];
+            j--;
+        }
+        samples[j] = value;
+    }
+}
+
+uint32_t battery_filter_median(uint16_t* samples, size_t count) {
+    battery_filter_sort(samples, count);
+
+    if (count % 2 == 0) {
+        return ((uint32_t)samples[count / 2 - 1] + samples[count / 2] + 1) / 2;
+    }
+    return samples[count / 2];
+}
+
+void battery_filter_trimmed_mean(uint16_t* samples, size_t count, uint8_t trim_percent,
+                                 battery_filter_result_t* result) {
+    if (trim_percent > 49) {
+        trim_percent = 49;
+    }
+
+    // Median sorts the burst, so the trimmed window is contiguous afterwards
+    result->median = battery_filter_median(samples, count);
+
+    size_t trim = (count * trim_percent) / 100;
+    size_t first = trim;
+    size_t last = count - trim;  // Exclusive
+
+    uint32_t sum = 0;
+    for (size_t i = first; i < last; i++) {
+        sum += samples[i];
+    }
+
+    size_t kept = last - first;
+    result->value = (sum + kept / 2) / kept;
+    result->spread = samples[last - 1] - samples[first];
+    result->trimmed = count - kept;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Result of filtering one burst of raw ADC samples
+ */
+typedef struct {
+    uint32_t value;          // Filtered raw ADC value
+    uint32_t median;         // Median of the burst
+    uint32_t spread;         // Max - min of the samples kept after trimming
+    size_t trimmed;          // Samples dropped at both ends, outliers or not (fixed by trim_percent)
+} battery_filter_result_t;
+
+/**
+ * Sort a burst of raw ADC samples in place (ascending)
+ * Insertion sort: bursts are small (<= a few hundred samples)
+ *
+ * @param samples Array of raw samples
+ * @param count Number of samples
+ */
+void battery_filter_sort(uint16_t* samples, size_t count);
+
+/**
+ * Median of a burst of raw ADC samples
+ * Sorts the array in place
+ *
+ * @param samples Array of raw samples
+ * @param count Number of samples (must be > 0)
+ * @return Median value
+ */
+uint32_t battery_filter_median(uint16_t* samples, size_t count);
+
+/**
+ * Trimmed mean of a burst of raw ADC samples
+ * Sorts the array in place, drops trim_percent of the samples at each end
+ * and averages the rest (25% = interquartile mean)
+ *
+ * @param samples Array of raw samples
+ * @param count Number of samples (must be > 0)
+ * @param trim_percent Percentage trimmed from each end (0-49)
+ * @param result Filled with the filtered value and burst statistics
+ */
+void battery_filter_trimmed_mean(uint16_t* samples, size_t count, uint8_t trim_percent,
+                                 battery_filter_result_t* result);
+
+#ifdef __cplusplus
+}
+#endif
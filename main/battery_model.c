@@ -0,0 +1,173 @@
+#include "battery_model.h"
+#include "device_state.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "BATTERY_MODEL";
+
+// Battery characteristics
+#define BATTERY_CAPACITY_MAH 2000          // Nominal cell capacity, for mAh/wake reporting
+#define BATTERY_CHARGE_JUMP_MV 100         // Rise that marks a charge (starts new segment)
+#define BATTERY_MIN_VALID_TIME 1704067200  // 2024-01-01: older timestamps mean no SNTP yet
+
+// Estimate requirements (avoid projecting from noise)
+#define ESTIMATE_MIN_SAMPLES 6
+#define ESTIMATE_MIN_SPAN_SEC (6 * 3600)
+
+// Li-ion discharge curve under the light EPD-rail load, highest voltage first
+typedef struct {
+    uint16_t voltage_mv;
+    uint8_t percentage;
+} curve_point_t;
+
+static const curve_point_t discharge_curve[] = {
+    {4150, 100},
+    {4100, 95},
+    {4000, 85},
+    {3950, 78},
+    {3900, 70},
+    {3850, 62},
+    {3800, 53},
+    {3750, 43},
+    {3700, 33},
+    {3650, 24},
+    {3600, 16},
+    {3550, 10},
+    {3500, 6},
+    {3400, 3},
+    {3300, 1},
+    {3000, 0},
+};
+#define CURVE_POINTS (sizeof(discharge_curve) / sizeof(discharge_curve[0]))
+
+// History ring lives in the persistent device state (RTC memory, flushed to NVS)
+static battery_history_t* history_get(void) {
+    return &device_state_get()->battery_history;
+}
+
+float battery_model_percentage(uint32_t voltage_mv) {
+    if (voltage_mv >= discharge_curve[0].voltage_mv) {
+        return 100.0;
+    }
+    if (voltage_mv <= discharge_curve[CURVE_POINTS - 1].voltage_mv) {
+        return 0.0;
+    }
+
+    // Interpolate within the segment containing voltage_mv
+    for (size_t i = 1; i < CURVE_POINTS; i++) {
+        const curve_point_t *hi = &discharge_curve[i - 1];
+        const curve_point_t *lo = &discharge_curve[i];
+        if (voltage_mv >= lo->voltage_mv) {
+            float fraction = (float)(voltage_mv - lo->voltage_mv) /
+                             (float)(hi->voltage_mv - lo->voltage_mv);
+            return lo->percentage + fraction * (hi->percentage - lo->percentage);
+        }
+    }
+
+    return 0.0;
+}
+
+// Index of the i-th oldest entry
+static size_t history_index(const battery_history_t* history, size_t i) {
+    return (history->head + BATTERY_HISTORY_SIZE - history->count + i) % BATTERY_HISTORY_SIZE;
+}
+
+static const battery_history_entry_t* history_newest(const battery_history_t* history) {
+    if (history->count == 0) {
+        return NULL;
+    }
+    return &history->entries[history_index(history, history->count - 1)];
+}
+
+esp_err_t battery_model_record(time_t timestamp, uint32_t voltage_mv) {
+    battery_history_t *history = history_get();
+
+    if (timestamp < BATTERY_MIN_VALID_TIME) {
+        ESP_LOGW(TAG, "Wall-clock time not set, reading not added to history");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const battery_history_entry_t *newest = history_newest(history);
+    if (newest != NULL && voltage_mv > (uint32_t)newest->voltage_mv + BATTERY_CHARGE_JUMP_MV) {
+        ESP_LOGI(TAG, "Voltage rose %lu mV since last wake, battery charged - new discharge segment",
+                 (unsigned long)(voltage_mv - newest->voltage_mv));
+        history->count = 0;
+    }
+
+    battery_history_entry_t *slot = &history->entries[history->head];
+    slot->timestamp = (uint32_t)timestamp;
+    slot->voltage_mv = (uint16_t)voltage_mv;
+    slot->reserved = 0;
+    history->head = (history->head + 1) % BATTERY_HISTORY_SIZE;
+    if (history->count < BATTERY_HISTORY_SIZE) {
+        history->count++;
+    }
+
+    device_state_commit();
+    return ESP_OK;
+}
+
+esp_err_t battery_model_estimate(float wakes_per_day, battery_estimate_t* estimate) {
+    if (estimate == NULL || wakes_per_day <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const battery_history_t *history = history_get();
+    size_t n = history->count;
+    if (n < ESTIMATE_MIN_SAMPLES) {
+        return ESP_ERR_NOT_FINISHED;
+    }
+
+    uint32_t t0 = history->entries[history_index(history, 0)].timestamp;
+    uint32_t t_last = history_newest(history)->timestamp;
+    if (t_last <= t0 || (t_last - t0) < ESTIMATE_MIN_SPAN_SEC) {
+        return ESP_ERR_NOT_FINISHED;
+    }
+
+    // Least-squares fit of percentage vs. time (in days since oldest reading)
+    float sum_t = 0, sum_p = 0, sum_tt = 0, sum_tp = 0;
+    for (size_t i = 0; i < n; i++) {
+        const battery_history_entry_t *e = &history->entries[history_index(history, i)];
+        float t = (float)(e->timestamp - t0) / 86400.0f;
+        float p = battery_model_percentage(e->voltage_mv);
+        sum_t += t;
+        sum_p += p;
+        sum_tt += t * t;
+        sum_tp += t * p;
+    }
+
+    float denom = n * sum_tt - sum_t * sum_t;
+    if (denom <= 0) {
+        return ESP_ERR_NOT_FINISHED;
+    }
+    float slope = (n * sum_tp - sum_t * sum_p) / denom;  // %/day, negative while discharging
+    float intercept = (sum_p - slope * sum_t) / n;
+    if (slope >= 0) {
+        return ESP_ERR_NOT_FINISHED;
+    }
+
+    float span_days = (float)(t_last - t0) / 86400.0f;
+    float percent_now = intercept + slope * span_days;
+    if (percent_now < 0) {
+        percent_now = 0;
+    } else if (percent_now > 100) {
+        percent_now = 100;
+    }
+
+    estimate->samples = (uint16_t)n;
+    estimate->observed_wakes_per_day = (float)(n - 1) / span_days;
+    estimate->percent_per_wake = -slope / estimate->observed_wakes_per_day;
+    estimate->mah_per_wake = estimate->percent_per_wake / 100.0f * BATTERY_CAPACITY_MAH;
+    estimate->percent_now = percent_now;
+    estimate->remaining_days = percent_now / (estimate->percent_per_wake * wakes_per_day);
+
+    ESP_LOGI(TAG, "Discharge: %.3f%%/wake (%.2f mAh), %.1f wakes/day observed, %.1f days left at %.1f wakes/day",
+             estimate->percent_per_wake, estimate->mah_per_wake, estimate->observed_wakes_per_day,
+             estimate->remaining_days, wakes_per_day);
+
+    return ESP_OK;
+}
+
+void battery_model_get_history(battery_history_t* out) {
+    *out = *history_get();
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BATTERY_HISTORY_SIZE 48        // Readings kept in the ring (~1-2 days of wakes)
+#define BATTERY_HISTORY_VERSION 1      // Layout of battery_history_t; bump when it changes
+
+/**
+ * One compact battery history sample (8 bytes)
+ */
+typedef struct {
+    uint32_t timestamp;      // Unix timestamp of reading
+    uint16_t voltage_mv;     // Battery voltage in millivolts (after divider compensation)
+    uint16_t reserved;
+} battery_history_entry_t;
+
+/**
+ * Ring of recent battery readings (part of the persistent device state)
+ */
+typedef struct {
+    uint8_t version;         // BATTERY_HISTORY_VERSION
+    uint8_t head;            // Index of next slot to write
+    uint8_t count;           // Valid entries (0..BATTERY_HISTORY_SIZE)
+    uint8_t reserved;
+    battery_history_entry_t entries[BATTERY_HISTORY_SIZE];
+} battery_history_t;
+
+/**
+ * Runtime estimate derived from the discharge history
+ */
+typedef struct {
+    float percent_now;           // Percentage of the newest reading
+    float percent_per_wake;      // Measured charge used per wake cycle (%)
+    float mah_per_wake;          // Same, in mAh for the configured capacity
+    float observed_wakes_per_day;
+    float remaining_days;        // At the requested wake rate
+    uint16_t samples;            // Readings used for the fit
+} battery_estimate_t;
+
+/**
+ * Convert battery voltage to state of charge
+ * Piecewise-linear lookup on a Li-ion discharge curve, so the flat
+ * 3.6-3.9 V plateau maps to the middle of the range instead of
+ * being compressed by a straight line
+ *
+ * @param voltage_mv Battery voltage in millivolts
+ * @return Percentage (0-100)
+ */
+float battery_model_percentage(uint32_t voltage_mv);
+
+/**
+ * Append a reading to the history ring (persisted with the device state)
+ * A jump of more than BATTERY_CHARGE_JUMP_MV starts a new discharge
+ * segment (battery was charged). Readings without a valid wall-clock
+ * time (SNTP not yet synced after cold boot) are ignored.
+ *
+ * @param timestamp Unix timestamp of reading
+ * @param voltage_mv Battery voltage in millivolts
+ * @return ESP_OK on success, ESP_ERR_INVALID_ARG if timestamp is invalid
+ */
+esp_err_t battery_model_record(time_t timestamp, uint32_t voltage_mv);
+
+/**
+ * Estimate remaining runtime from the history
+ * Fits charge vs. time by least squares, divides by the observed wake
+ * count to get charge per wake, and projects at the given wake rate
+ *
+ * @param wakes_per_day Expected wake rate of the sleep scheduler
+ * @param estimate Filled on success
+ * @return ESP_OK, or ESP_ERR_NOT_FINISHED if history is too short/flat
+ */
+esp_err_t battery_model_estimate(float wakes_per_day, battery_estimate_t* estimate);
+
+/**
+ * Get a copy of the history ring
+ *
+ * @param history Filled with the current ring
+ */
+void battery_model_get_history(battery_history_t* history);
+
+#ifdef __cplusplus
+}
+#endif
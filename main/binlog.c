@@ -0,0 +1,254 @@
+#include "binlog.h"
+#include "rtc_budget.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+static const char *TAG = "BINLOG";
+#define BINLOG_MAGIC 0x424C4F47  // "BLOG"
+
+// Format each record with vsnprintf(NULL, 0) (not printed) so binlog_report()
+// can compare against text logging. That puts back a few us of formatting per
+// record on the wake path, so it is a measurement option, off by default
+#ifndef BINLOG_ESTIMATE_TEXT_COST  // Set by the host build
+#include "sdkconfig.h"
+#ifdef CONFIG_QUOTE_BINLOG_TEXT_ESTIMATE
+#define BINLOG_ESTIMATE_TEXT_COST 1
+#else
+#define BINLOG_ESTIMATE_TEXT_COST 0
+#endif
+#endif
+
+typedef struct {
+    uint32_t magic;
+    uint32_t next;           // Slot to write next
+    uint32_t count;          // Valid slots
+    uint32_t wake_seq;       // Incremented every boot, tags dumps
+    binlog_record_t slots[BINLOG_SLOT_COUNT];
+} binlog_ring_t;
+RTC_BUDGET_CHECK(binlog_ring_t, RTC_BUDGET_BINLOG);
+
+// Survives deep sleep so a dump on a later (button) wake shows earlier cycles
+static RTC_NOINIT_ATTR binlog_ring_t ring;
+
+static portMUX_TYPE ring_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Per-wake cost accounting
+static uint32_t wake_records = 0;
+static int64_t wake_binlog_us = 0;
+#if BINLOG_ESTIMATE_TEXT_COST
+static uint32_t wake_text_bytes = 0;
+#endif
+
+void binlog_init(void) {
+    if (ring.magic != BINLOG_MAGIC || ring.next >= BINLOG_SLOT_COUNT ||
+        ring.count > BINLOG_SLOT_COUNT) {
+        memset(&ring, 0, sizeof(ring));
+        ring.magic = BINLOG_MAGIC;
+    }
+    ring.wake_seq++;
+}
+
+static bool put_bytes(binlog_record_t* rec, const void* data, size_t len) {
+    if (rec->payload_len + len > sizeof(rec->payload)) {
+        rec->truncated = 1;
+        return false;
+    }
+    memcpy(rec->payload + rec->payload_len, data, len);
+    rec->payload_len += len;
+    return true;
+}
+
+static bool put_u32(binlog_record_t* rec, uint32_t value) {
+    return put_bytes(rec, &value, sizeof(value));
+}
+
+static bool put_string(binlog_record_t* rec, const char* str) {
+    if (str == NULL) {
+        str = "(null)";
+    }
+    size_t room = sizeof(rec->payload) - rec->payload_len;
+    if (room < 2) {
+        rec->truncated = 1;
+        return false;
+    }
+    size_t len = strnlen(str, room - 1);
+    if (str[len] != '\0') {
+        rec->truncated = 1;
+    }
+    uint8_t len_byte = (uint8_t)len;
+    put_bytes(rec, &len_byte, 1);
+    return put_bytes(rec, str, len);
+}
+
+// Walk the format string and pack each argument by its conversion type.
+// tools/binlog_decode.py mirrors this parser exactly.
+static void pack_args(binlog_record_t* rec, const char* fmt, va_list ap) {
+    for (const char* p = fmt; *p != '\0'; p++) {
+        if (*p != '%') {
+            continue;
+        }
+        p++;
+        if (*p == '%') {
+            continue;
+        }
+
+        // Flags
+        while (*p != '\0' && strchr("-+ #0", *p) != NULL) {
+            p++;
+        }
+        // Width
+        if (*p == '*') {
+            if (!put_u32(rec, (uint32_t)va_arg(ap, int))) return;
+            p++;
+        } else {
+            while (isdigit((unsigned char)*p)) p++;
+        }
+        // Precision
+        if (*p == '.') {
+            p++;
+            if (*p == '*') {
+                if (!put_u32(rec, (uint32_t)va_arg(ap, int))) return;
+                p++;
+            } else {
+                while (isdigit((unsigned char)*p)) p++;
+            }
+        }
+        // Length modifier
+        char length = 0;
+        if (*p == 'h') {
+            p++;
+            if (*p == 'h') p++;
+        } else if (*p == 'l') {
+            p++;
+            length = 'l';
+            if (*p == 'l') {
+                p++;
+                length = 'L';  // long long
+            }
+        } else if (*p == 'j') {
+            p++;
+            length = 'L';
+        } else if (*p == 'z' || *p == 't' || *p == 'L') {
+            length = *p;
+            p++;
+        }
+
+        bool ok = true;
+        switch (*p) {
+            case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+                if (length == 'L') {
+                    uint64_t value = va_arg(ap, unsigned long long);
+                    ok = put_bytes(rec, &value, sizeof(value));
+                } else if (length == 'l') {
+                    ok = put_u32(rec, (uint32_t)va_arg(ap, unsigned long));
+                } else if (length == 'z') {
+                    ok = put_u32(rec, (uint32_t)va_arg(ap, size_t));
+                } else if (length == 't') {
+                    ok = put_u32(rec, (uint32_t)va_arg(ap, ptrdiff_t));
+                } else {
+                    ok = put_u32(rec, (uint32_t)va_arg(ap, unsigned int));
+                }
+                break;
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A': {
+                float value = (length == 'L') ? (float)va_arg(ap, long double) : (float)va_arg(ap, double);
+                ok = put_bytes(rec, &value, sizeof(value));
+                break;
+            }
+            case 's':
+                ok = put_string(rec, va_arg(ap, const char*));
+                break;
+            case 'p':
+                ok = put_u32(rec, (uint32_t)(uintptr_t)va_arg(ap, void*));
+                break;
+            case 'n':
+                (void)va_arg(ap, void*);
+                break;
+            default:
+                return;  // Unknown conversion: stop, decoder does the same
+        }
+        if (!ok) {
+            return;
+        }
+    }
+}
+
+void binlog_write(esp_log_level_t level, const char* tag, const char* fmt, ...) {
+    if (ring.magic != BINLOG_MAGIC) {
+        return;  // Called before binlog_init()
+    }
+
+    int64_t start = esp_timer_get_time();
+
+    binlog_record_t rec;
+    rec.fmt = (uint32_t)(uintptr_t)fmt;
+    rec.tag = (uint32_t)(uintptr_t)tag;
+    rec.timestamp_ms = esp_log_timestamp();
+    rec.level = (uint8_t)level;
+    rec.payload_len = 0;
+    rec.truncated = 0;
+    rec.reserved = 0;
+
+    va_list ap;
+    va_start(ap, fmt);
+    pack_args(&rec, fmt, ap);
+    va_end(ap);
+
+    portENTER_CRITICAL(&ring_lock);
+    ring.slots[ring.next] = rec;
+    ring.next = (ring.next + 1) % BINLOG_SLOT_COUNT;
+    if (ring.count < BINLOG_SLOT_COUNT) {
+        ring.count++;
+    }
+    portEXIT_CRITICAL(&ring_lock);
+
+    int64_t elapsed = esp_timer_get_time() - start;
+    wake_records++;
+    wake_binlog_us += elapsed;
+
+#if BINLOG_ESTIMATE_TEXT_COST
+    // Estimate what the text path would have cost: formatted length plus the
+    // "I (12345) TAG: " prefix and newline, all pushed out at console baud
+    va_start(ap, fmt);
+    int text_len = vsnprintf(NULL, 0, fmt, ap);
+    va_end(ap);
+
+    wake_text_bytes += (text_len > 0 ? text_len : 0) + strlen(tag) + 14;
+#endif
+}
+
+void binlog_dump(void) {
+    ESP_LOGI(TAG, "BINLOG-BEGIN wake=%lu count=%lu", (unsigned long)ring.wake_seq,
+             (unsigned long)ring.count);
+
+    size_t first = (ring.next + BINLOG_SLOT_COUNT - ring.count) % BINLOG_SLOT_COUNT;
+    char line[BINLOG_SLOT_SIZE * 2 + 1];
+    for (size_t i = 0; i < ring.count; i++) {
+        const uint8_t *bytes = (const uint8_t*)&ring.slots[(first + i) % BINLOG_SLOT_COUNT];
+        for (size_t j = 0; j < BINLOG_SLOT_SIZE; j++) {
+            snprintf(line + j * 2, 3, "%02x", bytes[j]);
+        }
+        ESP_LOGI(TAG, "BINLOG %s", line);
+    }
+
+    ESP_LOGI(TAG, "BINLOG-END");
+}
+
+void binlog_report(void) {
+#if BINLOG_ESTIMATE_TEXT_COST
+    // 10 bits per byte on the wire (start + 8 data + stop)
+    uint32_t text_us = (uint32_t)((uint64_t)wake_text_bytes * 10 * 1000000 / BINLOG_CONSOLE_BAUD);
+
+    ESP_LOGI(TAG, "%lu records this wake: %lld us binary vs ~%lu us as text (%lu bytes at %d baud), ~%lld us saved",
+             (unsigned long)wake_records, (long long)wake_binlog_us, (unsigned long)text_us,
+             (unsigned long)wake_text_bytes, BINLOG_CONSOLE_BAUD, (long long)(text_us - wake_binlog_us));
+#else
+    ESP_LOGI(TAG, "%lu records this wake: %lld us binary", (unsigned long)wake_records,
+             (long long)wake_binlog_us);
+#endif
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_log.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 1 = hot-path BINLOG_x calls record into the RTC ring (decoded on a host)
+// 0 = BINLOG_x calls are plain ESP_LOGx text logging (host simulator)
+#ifndef BINLOG_ENABLED
+#define BINLOG_ENABLED 1
+#endif
+
+#define BINLOG_SLOT_SIZE 48            // Bytes per record (16 header + 32 payload)
+#define BINLOG_SLOT_COUNT 48           // Records kept in RTC memory (~2.3 KB)
+#define BINLOG_CONSOLE_BAUD 115200     // For the text-logging cost estimate
+
+/**
+ * One binary log record
+ * Format string and tag are stored as flash addresses; tools/binlog_decode.py
+ * resolves them from the firmware ELF. Arguments are packed by walking the
+ * format string: integers 4 bytes (8 for ll), floating point as float,
+ * strings as length byte + bytes (truncated to fit).
+ */
+typedef struct {
+    uint32_t fmt;            // Address of format string
+    uint32_t tag;            // Address of tag string
+    uint32_t timestamp_ms;   // esp_log_timestamp()
+    uint8_t level;           // esp_log_level_t
+    uint8_t payload_len;
+    uint8_t truncated;       // 1 if arguments did not fit
+    uint8_t reserved;
+    uint8_t payload[BINLOG_SLOT_SIZE - 16];
+} binlog_record_t;
+
+/**
+ * Initialize the binary log ring
+ * Keeps records from previous wakes if the RTC ring is intact
+ */
+void binlog_init(void);
+
+/**
+ * Record a log call (use the BINLOG_x macros instead)
+ *
+ * @param level Log level
+ * @param tag Log tag (must be a string literal / static string)
+ * @param fmt printf-style format (must be a string literal)
+ */
+void binlog_write(esp_log_level_t level, const char* tag, const char* fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+/**
+ * Print the ring to the console as hex lines for tools/binlog_decode.py
+ * Costs UART time: call only when someone is listening (button wake)
+ */
+void binlog_dump(void);
+
+/**
+ * Log the time spent in binary logging this wake, and with
+ * CONFIG_QUOTE_BINLOG_TEXT_ESTIMATE the estimated cost of emitting the same
+ * records as text
+ */
+void binlog_report(void);
+
+#if BINLOG_ENABLED
+// Info goes only to the ring; warnings/errors also go to the console as text
+#define BINLOG_I(tag, fmt, ...) binlog_write(ESP_LOG_INFO, tag, fmt, ##__VA_ARGS__)
+#define BINLOG_W(tag, fmt, ...) do { \
+        binlog_write(ESP_LOG_WARN, tag, fmt, ##__VA_ARGS__); \
+        ESP_LOGW(tag, fmt, ##__VA_ARGS__); \
+    } while (0)
+#define BINLOG_E(tag, fmt, ...) do { \
+        binlog_write(ESP_LOG_ERROR, tag, fmt, ##__VA_ARGS__); \
+        ESP_LOGE(tag, fmt, ##__VA_ARGS__); \
+    } while (0)
+#else
+#define BINLOG_I(tag, fmt, ...) ESP_LOGI(tag, fmt, ##__VA_ARGS__)
+#define BINLOG_W(tag, fmt, ...) ESP_LOGW(tag, fmt, ##__VA_ARGS__)
+#define BINLOG_E(tag, fmt, ...) ESP_LOGE(tag, fmt, ##__VA_ARGS__)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
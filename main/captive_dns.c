@@ -0,0 +1,167 @@
+#include "captive_dns.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "lwip/sockets.h"
+
+static const char *TAG = "CAPTIVE_DNS";
+
+#define DNS_PORT 53
+#define DNS_PACKET_SIZE 512       // Largest query over UDP without EDNS
+#define DNS_HEADER_SIZE 12
+#define DNS_ANSWER_SIZE 16        // Name pointer, type, class, TTL, length, IPv4
+#define DNS_TYPE_A 1
+#define DNS_TYPE_ANY 255
+#define DNS_CLASS_IN 1
+
+static volatile bool running = false;
+static uint32_t ap_addr = 0;      // Network byte order
+static uint32_t answered = 0;
+
+// Turn a query into its answer in place; returns the answer's length, 0 to drop it
+static int answer_query(uint8_t* packet, int len) {
+    if (len < DNS_HEADER_SIZE || (packet[2] & 0x80) != 0 || (packet[2] & 0x78) != 0) {
+        return 0;  // A response, or not a standard query
+    }
+    if ((packet[4] << 8 | packet[5]) != 1) {
+        return 0;
+    }
+
+    // The one question: uncompressed name, type, class
+    int pos = DNS_HEADER_SIZE;
+    while (pos < len && packet[pos] != 0) {
+        if ((packet[pos] & 0xC0) != 0) {
+            return 0;
+        }
+        pos += 1 + packet[pos];
+    }
+    pos += 1;
+    if (pos + 4 > len) {
+        return 0;
+    }
+    int type = packet[pos] << 8 | packet[pos + 1];
+    int class = packet[pos + 2] << 8 | packet[pos + 3];
+    pos += 4;
+    bool address = (type == DNS_TYPE_A || type == DNS_TYPE_ANY) && class == DNS_CLASS_IN;
+
+    // Header: response, authoritative, RD copied, no error; question kept,
+    // anything after it (e.g. an EDNS record) dropped
+    packet[2] = 0x84 | (packet[2] & 0x01);
+    packet[3] = 0x00;
+    packet[6] = 0;
+    packet[7] = address ? 1 : 0;  // Other types: empty answer, so the client does not wait
+    memset(packet + 8, 0, 4);
+    if (!address) {
+        return pos;
+    }
+    if (pos + DNS_ANSWER_SIZE > DNS_PACKET_SIZE) {
+        return 0;
+    }
+
+    uint8_t* answer = packet + pos;
+    answer[0] = 0xC0;             // Name: pointer to the question
+    answer[1] = DNS_HEADER_SIZE;
+    answer[2] = 0;
+    answer[3] = DNS_TYPE_A;
+    answer[4] = 0;
+    answer[5] = DNS_CLASS_IN;
+    answer[6] = (CAPTIVE_DNS_TTL_S >> 24) & 0xFF;
+    answer[7] = (CAPTIVE_DNS_TTL_S >> 16) & 0xFF;
+    answer[8] = (CAPTIVE_DNS_TTL_S >> 8) & 0xFF;
+    answer[9] = CAPTIVE_DNS_TTL_S & 0xFF;
+    answer[10] = 0;
+    answer[11] = 4;
+    memcpy(answer + 12, &ap_addr, 4);
+    return pos + DNS_ANSWER_SIZE;
+}
+
+static void captive_dns_task(void* param) {
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    struct sockaddr_in local = {
+        .sin_family = AF_INET,
+        .sin_port = htons(DNS_PORT),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    int reuse = 1;
+    struct timeval tv = {.tv_sec = CAPTIVE_DNS_POLL_MS / 1000, .tv_usec = (CAPTIVE_DNS_POLL_MS % 1000) * 1000};
+    if (sock < 0 ||
+        setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) != 0 ||
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) != 0 ||
+        bind(sock, (struct sockaddr*)&local, sizeof(local)) != 0) {
+        ESP_LOGE(TAG, "Cannot listen on port %d", DNS_PORT);
+        running = false;
+    }
+
+    uint8_t packet[DNS_PACKET_SIZE];
+    while (running) {
+        struct sockaddr_in client;
+        socklen_t client_len = sizeof(client);
+        int len = recvfrom(sock, packet, sizeof(packet), 0, (struct sockaddr*)&client, &client_len);
+        if (len <= 0) {
+            continue;  // Timeout: check running
+        }
+        int reply = answer_query(packet, len);
+        if (reply > 0) {
+            sendto(sock, packet, reply, 0, (struct sockaddr*)&client, client_len);
+            answered++;
+        }
+    }
+
+    if (sock >= 0) {
+        close(sock);
+    }
+    ESP_LOGI(TAG, "DNS responder stopped after %lu answers", (unsigned long)answered);
+    vTaskDelete(NULL);
+}
+
+// DHCP: the softAP as DNS server, and the portal URL for clients that read option 114
+static void configure_dhcp(esp_netif_t* netif, const esp_netif_ip_info_t* ip_info) {
+    static char portal_uri[32];
+    snprintf(portal_uri, sizeof(portal_uri), "http://" IPSTR "/", IP2STR(&ip_info->ip));
+
+    esp_netif_dns_info_t dns = {
+        .ip.u_addr.ip4.addr = ip_info->ip.addr,
+        .ip.type = ESP_IPADDR_TYPE_V4,
+    };
+    dhcps_offer_t offer_dns = OFFER_DNS;
+
+    esp_netif_dhcps_stop(netif);
+    esp_netif_set_dns_info(netif, ESP_NETIF_DNS_MAIN, &dns);
+    esp_netif_dhcps_option(netif, ESP_NETIF_OP_SET, ESP_NETIF_DOMAIN_NAME_SERVER,
+                           &offer_dns, sizeof(offer_dns));
+    esp_netif_dhcps_option(netif, ESP_NETIF_OP_SET, ESP_NETIF_CAPTIVEPORTAL_URI,
+                           portal_uri, strlen(portal_uri));
+    esp_netif_dhcps_start(netif);
+}
+
+esp_err_t captive_dns_start(void) {
+    if (running) {
+        return ESP_OK;
+    }
+
+    esp_netif_t* netif = esp_netif_get_handle_from_ifkey("WIFI_AP_DEF");
+    esp_netif_ip_info_t ip_info;
+    if (netif == NULL || esp_netif_get_ip_info(netif, &ip_info) != ESP_OK) {
+        ESP_LOGE(TAG, "No softAP interface");
+        return ESP_ERR_INVALID_STATE;
+    }
+    ap_addr = ip_info.ip.addr;
+    configure_dhcp(netif, &ip_info);
+
+    answered = 0;
+    running = true;
+    if (xTaskCreate(captive_dns_task, "captive_dns", CAPTIVE_DNS_STACK_SIZE, NULL, 4, NULL) != pdPASS) {
+        running = false;
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Answering every name with " IPSTR, IP2STR(&ip_info.ip));
+    return ESP_OK;
+}
+
+void captive_dns_stop(void) {
+    running = false;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CAPTIVE_DNS_TTL_S 60           // Answers are only valid while the phone is on the softAP
+#define CAPTIVE_DNS_STACK_SIZE 3072
+#define CAPTIVE_DNS_POLL_MS 1000       // Receive timeout: how fast captive_dns_stop() takes effect
+
+/**
+ * Start the captive-portal DNS responder on the softAP
+ * Every A query is answered with the softAP's address, so any name a phone
+ * looks up (including its connectivity check) leads to the portal. Other
+ * record types get an empty answer. DHCP offers the softAP as DNS server
+ * and the portal URL (option 114, RFC 8910) to clients that support it
+ *
+ * @return ESP_OK once the responder task runs
+ */
+esp_err_t captive_dns_start(void);
+
+/**
+ * Stop the responder (returns at once; the task exits within
+ * CAPTIVE_DNS_POLL_MS)
+ */
+void captive_dns_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
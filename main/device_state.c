@@ -0,0 +1,196 @@
+#include "device_state.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "rtc_budget.h"
+#include "esp_attr.h"
+#include "esp_rom_crc.h"
+#include "hal_nvs.h"
+#include <string.h>
+
+static const char *TAG = "DEVICE_STATE";
+#define STATE_NVS_NAMESPACE "dev_state"
+#define STATE_KEY "state"
+#define STATE_MAGIC 0x51535431  // "QST1"
+
+// Legacy per-key locations, read once when migrating
+#define LEGACY_WIFI_NAMESPACE "wifi_config"
+#define LEGACY_QUOTE_COUNT_KEY "quote_count"
+#define LEGACY_BATTERY_NAMESPACE "battery_log"
+#define LEGACY_BATTERY_READING_KEY "last_reading"
+#define LEGACY_BATTERY_HISTORY_KEY "history"
+
+RTC_BUDGET_CHECK(device_state_t, RTC_BUDGET_DEVICE_STATE);
+
+// Survives deep sleep and software reset; garbage after power loss (caught by CRC)
+static RTC_NOINIT_ATTR device_state_t rtc_state;
+
+static bool initialized = false;
+static uint32_t commits_counted = 0;  // hal_nvs_commits() already in flash_commits
+
+static uint32_t state_crc(const device_state_t* state) {
+    return esp_rom_crc32_le(0, (const uint8_t*)state, offsetof(device_state_t, crc));
+}
+
+static bool state_valid(const device_state_t* state) {
+    return state->magic == STATE_MAGIC &&
+           state->version == DEVICE_STATE_VERSION &&
+           state->size == sizeof(device_state_t) &&
+           state->crc == state_crc(state);
+}
+
+static bool history_valid(const battery_history_t* history) {
+    return history->version == BATTERY_HISTORY_VERSION &&
+           history->count <= BATTERY_HISTORY_SIZE &&
+           history->head < BATTERY_HISTORY_SIZE;
+}
+
+static void history_reset(battery_history_t* history) {
+    memset(history, 0, sizeof(*history));
+    history->version = BATTERY_HISTORY_VERSION;
+}
+
+static void state_reset(device_state_t* state) {
+    memset(state, 0, sizeof(*state));
+    state->magic = STATE_MAGIC;
+    state->version = DEVICE_STATE_VERSION;
+    state->size = sizeof(device_state_t);
+    history_reset(&state->battery_history);
+}
+
+static esp_err_t load_from_nvs(device_state_t* state) {
+    size_t size = sizeof(*state);
+    esp_err_t err = hal_nvs_get_blob(STATE_NVS_NAMESPACE, STATE_KEY, state, &size);
+
+    if (err == ESP_OK && (size != sizeof(*state) || !state_valid(state))) {
+        ESP_LOGW(TAG, "Stored state failed validation (size %u, CRC/version mismatch)", (unsigned)size);
+        err = ESP_ERR_INVALID_CRC;
+    }
+    return err;
+}
+
+// Rebuild the record from the per-key entries written by older firmware
+static void migrate_legacy(device_state_t* state) {
+    if (hal_nvs_get_u32(LEGACY_WIFI_NAMESPACE, LEGACY_QUOTE_COUNT_KEY, &state->quote_count) == ESP_OK) {
+        ESP_LOGI(TAG, "Migrated quote count: %lu", (unsigned long)state->quote_count);
+    }
+
+    size_t size = sizeof(state->last_battery);
+    if (hal_nvs_get_blob(LEGACY_BATTERY_NAMESPACE, LEGACY_BATTERY_READING_KEY,
+                         &state->last_battery, &size) != ESP_OK ||
+        size != sizeof(state->last_battery)) {
+        memset(&state->last_battery, 0, sizeof(state->last_battery));
+    }
+
+    battery_history_t history;
+    size = sizeof(history);
+    if (hal_nvs_get_blob(LEGACY_BATTERY_NAMESPACE, LEGACY_BATTERY_HISTORY_KEY, &history, &size) == ESP_OK &&
+        size == sizeof(history) && history_valid(&history)) {
+        state->battery_history = history;
+        ESP_LOGI(TAG, "Migrated battery history: %u readings", history.count);
+    }
+}
+
+static void shutdown_flush(void) {
+    // esp_restart() path (network reset): keep counters
+    device_state_count_commits();
+    device_state_flush();
+}
+
+void device_state_init(void) {
+    if (initialized) {
+        return;
+    }
+
+    if (state_valid(&rtc_state)) {
+        ESP_LOGI(TAG, "State restored from RTC memory (%lu wakes since last flush)",
+                 (unsigned long)rtc_state.wakes_since_flush);
+    } else {
+        esp_err_t err = load_from_nvs(&rtc_state);
+        if (err == ESP_OK) {
+            ESP_LOGI(TAG, "State loaded from NVS (RTC copy invalid - power loss or first boot)");
+        } else {
+            ESP_LOGI(TAG, "No valid stored state (%s), migrating legacy NVS keys", esp_err_to_name(err));
+            state_reset(&rtc_state);
+            migrate_legacy(&rtc_state);
+        }
+        rtc_state.wakes_since_flush = 0;
+    }
+
+    // The counters survive a history layout change; the readings start over
+    if (!history_valid(&rtc_state.battery_history)) {
+        ESP_LOGW(TAG, "Battery history version %u not supported, starting a new one",
+                 rtc_state.battery_history.version);
+        history_reset(&rtc_state.battery_history);
+    }
+
+    rtc_state.total_wakes++;
+    device_state_commit();
+
+    esp_register_shutdown_handler(shutdown_flush);
+    initialized = true;
+}
+
+device_state_t* device_state_get(void) {
+    return &rtc_state;
+}
+
+void device_state_commit(void) {
+    rtc_state.crc = state_crc(&rtc_state);
+}
+
+void device_state_count_commits(void) {
+    if (!initialized) {
+        return;
+    }
+    uint32_t commits = hal_nvs_commits();
+    rtc_state.flash_commits += commits - commits_counted;
+    commits_counted = commits;
+    device_state_commit();
+}
+
+esp_err_t device_state_flush(void) {
+    // Count the commits so far and this one, and clear the pending-wake
+    // counter in the flushed image
+    device_state_count_commits();
+    rtc_state.flash_commits++;
+    commits_counted++;
+    rtc_state.wakes_since_flush = 0;
+    device_state_commit();
+
+    esp_err_t err = hal_nvs_set_blob(STATE_NVS_NAMESPACE, STATE_KEY, &rtc_state, sizeof(rtc_state));
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error saving state: %s", esp_err_to_name(err));
+    } else {
+        ESP_LOGI(TAG, "State flushed to NVS (%u bytes, commit #%lu)",
+                 (unsigned)sizeof(rtc_state), (unsigned long)rtc_state.flash_commits);
+    }
+    return err;
+}
+
+bool device_state_end_wake(float battery_percent, float wakes_per_day) {
+    rtc_state.wakes_since_flush++;
+    device_state_count_commits();
+
+    bool low_battery = battery_percent >= 0 && battery_percent < DEVICE_STATE_LOW_BATTERY_PERCENT;
+    if (rtc_state.wakes_since_flush < DEVICE_STATE_FLUSH_INTERVAL && !low_battery) {
+        ESP_LOGI(TAG, "State kept in RTC memory (%lu/%d wakes until flush)",
+                 (unsigned long)rtc_state.wakes_since_flush, DEVICE_STATE_FLUSH_INTERVAL);
+        return false;
+    }
+
+    if (low_battery) {
+        ESP_LOGI(TAG, "Battery low (%.0f%%), flushing state every wake", battery_percent);
+    }
+    device_state_flush();
+
+    // Wear report: measured commits of all modules, of which the state's
+    // own flushes are one every DEVICE_STATE_FLUSH_INTERVAL wakes
+    float per_wake = rtc_state.total_wakes > 0 ?
+                     (float)rtc_state.flash_commits / rtc_state.total_wakes : 0.0f;
+    ESP_LOGI(TAG, "NVS commits (all modules): %lu over %lu wakes, %.2f/wake, ~%.1f/day "
+             "(state flushes ~%.1f/day)",
+             (unsigned long)rtc_state.flash_commits, (unsigned long)rtc_state.total_wakes,
+             per_wake, per_wake * wakes_per_day, wakes_per_day / DEVICE_STATE_FLUSH_INTERVAL);
+    return true;
+}
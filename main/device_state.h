@@ -0,0 +1,94 @@
+#pragma once
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "battery.h"
+#include "battery_model.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DEVICE_STATE_VERSION 1
+#define DEVICE_STATE_FLUSH_INTERVAL 12        // Wakes between flash flushes (~7h at 41 wakes/day)
+#define DEVICE_STATE_LOW_BATTERY_PERCENT 15   // Flush every wake below this charge
+
+/**
+ * Persistent device state
+ * Lives in RTC memory across deep sleep and is written to NVS only
+ * every DEVICE_STATE_FLUSH_INTERVAL wakes, on low battery, or before
+ * a reboot. Validated by CRC32 on every boot.
+ */
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;                       // sizeof(device_state_t), guards layout changes
+
+    uint32_t quote_count;                // Total quotes displayed
+    battery_reading_t last_battery;      // Last battery reading (debugging)
+    battery_history_t battery_history;   // Discharge history ring
+
+    // Flash wear accounting
+    uint32_t total_wakes;                // Wakes since the state was created
+    uint32_t wakes_since_flush;
+    uint32_t flash_commits;              // NVS commits of all modules (hal_nvs_commits())
+
+    uint32_t crc;                        // CRC32 of all fields above
+} device_state_t;
+
+/**
+ * Initialize persistent state
+ * Uses the RTC copy if its CRC is valid (wake from deep sleep), otherwise
+ * loads the NVS copy, otherwise migrates the legacy per-key NVS entries.
+ * Registers a shutdown handler so esp_restart() flushes to flash.
+ *
+ * NOTE: Must be called after nvs_flash_init() and before any other module
+ * reads state (quote counter, battery log)
+ */
+void device_state_init(void);
+
+/**
+ * Get the state record for reading or modification
+ * Call device_state_commit() after modifying it
+ *
+ * @return Pointer to the RTC-resident state
+ */
+device_state_t* device_state_get(void);
+
+/**
+ * Re-seal the RTC copy after a modification (recomputes CRC)
+ * Does not touch flash
+ */
+void device_state_commit(void);
+
+/**
+ * Add the NVS commits of this boot not counted yet to flash_commits
+ * Called at the end of the wake, before deep sleep and before a restart;
+ * the count since boot is lost with RAM. No-op before device_state_init().
+ */
+void device_state_count_commits(void);
+
+/**
+ * Account for the end of a wake cycle, before deep sleep
+ * Flushes to NVS if DEVICE_STATE_FLUSH_INTERVAL wakes have passed or
+ * the battery is low, and on a flush logs the measured NVS commit rate of
+ * all modules (flash_commits)
+ *
+ * @param battery_percent Current battery percentage, or < 0 if unknown
+ * @param wakes_per_day Expected wake rate, for the per-day figures
+ * @return true if the state was flushed: other RTC state with an NVS copy
+ *         saves now too, riding on the same flush cadence
+ */
+bool device_state_end_wake(float battery_percent, float wakes_per_day);
+
+/**
+ * Write the state to NVS now
+ *
+ * @return ESP_OK on success
+ */
+esp_err_t device_state_flush(void);
+
+#ifdef __cplusplus
+}
+#endif
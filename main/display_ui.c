@@ -1,138 +1,117 @@
 #include "display_ui.h"
-#include "epdiy.h"
-#include "firasans_20.h"
-#include "firasans_12.h"
-#include "opensans8.h"
-#include "wm_logo_64.h"
-#include "wm_logo_256.h"
+#include "hal_display.h"
+#include "hal_time.h"
+#include <stdio.h>
 #include <string.h>
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
 #include "esp_log.h"
+#include "binlog.h"
 
 static const char *TAG = "DISPLAY_UI";
 
-// High-level EPD state
-static EpdiyHighlevelState hl;
+// Optional callback run while the EPD power rail is up
+static display_power_hook_t power_hook = NULL;
 
-void display_init(void) {
-    ESP_LOGI(TAG, "Initializing e-paper display...");
+#define EPD_SETTLE_MS 100  // Rail stabilization time after power-on
 
-    // Initialize EPD with Lilygo T5-4.7 board and ED047TC1 display
-    epd_init(&epd_board_lilygo_t5_47, &ED047TC1, EPD_LUT_64K);
+void display_set_power_hook(display_power_hook_t hook) {
+    power_hook = hook;
+}
 
-    // VCOM voltage is hardware-set on this board, no software config needed
+// Power on the EPD rail and let it settle, then give the hook a chance to
+// use the rail (e.g. battery divider) before any refresh current is drawn
+static void display_power_on(void) {
+    hal_display_power_on();
+    hal_delay_ms(EPD_SETTLE_MS);
 
-    // Initialize high-level state with builtin waveform
-    hl = epd_hl_init(EPD_BUILTIN_WAVEFORM);
+    if (power_hook != NULL) {
+        power_hook(DISPLAY_POWER_SETTLED);
+    }
+}
 
-    // Set landscape orientation (960x540)
-    epd_set_rotation(EPD_ROT_LANDSCAPE);
+// Run the hook right after the last refresh, then drop the rail
+static void display_power_off(void) {
+    if (power_hook != NULL) {
+        power_hook(DISPLAY_POWER_REFRESHED);
+    }
 
-    ESP_LOGI(TAG, "Display initialized: %dx%d",
-             epd_rotated_display_width(),
-             epd_rotated_display_height());
+    hal_display_power_off();
+}
+
+void display_init(void) {
+    BINLOG_I(TAG, "Initializing e-paper display...");
+
+    // Lilygo T5-4.7 with ED047TC1 panel, landscape (960x540)
+    hal_display_init();
+
+    BINLOG_I(TAG, "Display initialized: %dx%d",
+             hal_display_width(),
+             hal_display_height());
 }
 
 void display_provisioning_mode(const char* ap_name) {
     ESP_LOGI(TAG, "Displaying provisioning mode message...");
 
-    uint8_t* fb = epd_hl_get_framebuffer(&hl);
-    if (fb == NULL) {
-        ESP_LOGE(TAG, "Failed to get framebuffer!");
-        return;
-    }
-
-    // Clear framebuffer to white
-    epd_clear();
+    // Clear the panel
+    hal_display_clear_screen();
 
     // Power on display
-    epd_poweron();
-    vTaskDelay(pdMS_TO_TICKS(100));
-
-    EpdFontProperties props = {
-        .fg_color = 0,      // Black (4-bit: 0x0)
-        .bg_color = 15,     // White (4-bit: 0xF)
-        .fallback_glyph = 0,
-        .flags = 0
-    };
-
-    // Draw 256x256 logo on the left, centered vertically
-    EpdRect logo_area = {
-        .x = 80,
-        .y = (540 - 256) / 2,  // Center vertically (142)
-        .width = wm_logo_256_width,
-        .height = wm_logo_256_height
-    };
-    epd_copy_to_framebuffer(logo_area, wm_logo_256_data, fb);
+    display_power_on();
+
+    // Draw 256x256 logo on the left, centered vertically (y = 142)
+    hal_display_draw_image(HAL_IMAGE_LOGO_256, 80, (540 - 256) / 2);
 
     // Display main message (to the right of the logo)
     // Use better word wrapping
     const char* msg1 = "Connect to";
     int x = 380, y = 200;
-    epd_write_string(&FiraSans_20, msg1, &x, &y, fb, &props);
+    hal_display_draw_text(HAL_FONT_LARGE, msg1, x, y);
 
     // Display SSID on second line
     char msg2[64];
     snprintf(msg2, sizeof(msg2), "'%s' network", ap_name);
     x = 380; y = 235;
-    epd_write_string(&FiraSans_20, msg2, &x, &y, fb, &props);
+    hal_display_draw_text(HAL_FONT_LARGE, msg2, x, y);
 
     // Display third line
     const char* msg3 = "to configure WiFi";
     x = 380; y = 270;
-    epd_write_string(&FiraSans_20, msg3, &x, &y, fb, &props);
+    hal_display_draw_text(HAL_FONT_LARGE, msg3, x, y);
 
-    // Display URL instruction
-    const char* msg4 = "Open: http://192.168.4.1";
+    // Display URL instruction (the captive portal usually opens the page by itself)
+    const char* msg4 = "The setup page opens by itself,";
     x = 380; y = 310;
-    epd_write_string(&FiraSans_12, msg4, &x, &y, fb, &props);
+    hal_display_draw_text(HAL_FONT_MEDIUM, msg4, x, y);
+    const char* msg5 = "or open: http://192.168.4.1";
+    x = 380; y = 340;
+    hal_display_draw_text(HAL_FONT_MEDIUM, msg5, x, y);
 
     // Update screen
-    enum EpdDrawError err = epd_hl_update_screen(&hl, MODE_GC16, 25);
-    if (err != EPD_DRAW_SUCCESS) {
-        ESP_LOGE(TAG, "Display update failed with error: %d", err);
-    }
+    hal_display_update();
 
     // Power off display to save energy
-    epd_poweroff();
+    display_power_off();
 }
 
 void display_connected_mode(const char* quote, const char* author, const char* datetime_text) {
-    ESP_LOGI(TAG, "Displaying quote with author...");
-
-    uint8_t* fb = epd_hl_get_framebuffer(&hl);
-    if (fb == NULL) {
-        ESP_LOGE(TAG, "Failed to get framebuffer!");
-        return;
-    }
+    BINLOG_I(TAG, "Displaying quote with author...");
 
     // Power on display
-    epd_poweron();
-    vTaskDelay(pdMS_TO_TICKS(100));
+    display_power_on();
 
     // IMPORTANT: Complete white screen refresh to remove all ghosting
-    ESP_LOGI(TAG, "Clearing screen with white refresh...");
+    BINLOG_I(TAG, "Clearing screen with white refresh...");
 
     // Fill framebuffer with white
-    memset(fb, 0xFF, epd_width() / 2 * epd_height());
+    hal_display_fill_white();
 
     // Update display with white screen (full refresh)
-    enum EpdDrawError err = epd_hl_update_screen(&hl, MODE_GC16, 25);
-    if (err != EPD_DRAW_SUCCESS) {
-        ESP_LOGE(TAG, "White screen update failed: %d", err);
+    if (hal_display_update() != ESP_OK) {
+        ESP_LOGE(TAG, "White screen update failed");
     }
-    vTaskDelay(pdMS_TO_TICKS(500));
-
-    // Now clear framebuffer for new content
-    epd_clear();
+    hal_delay_ms(500);
 
-    EpdFontProperties props = {
-        .fg_color = 0,      // Black (4-bit: 0x0)
-        .bg_color = 15,     // White (4-bit: 0xF)
-        .fallback_glyph = 0,
-        .flags = 0
-    };
+    // Now clear the panel for new content
+    hal_display_clear_screen();
 
     // Draw quote centered with basic wrapping
     // For simplicity, we'll use a fixed width and wrap words
@@ -166,17 +145,13 @@ void display_connected_mode(const char* quote, const char* author, const char* d
                 strcpy(test_line, word);
             }
 
-            int x = 0, text_y = 0;
-            int text_x1, text_y1, text_width, text_height;
-            epd_get_text_bounds(&FiraSans_20, test_line, &x, &text_y,
-                                &text_x1, &text_y1, &text_width, &text_height, &props);
+            int text_width = hal_display_text_width(HAL_FONT_LARGE, test_line);
 
             if (text_width > max_width && current_len > 0) {
                 // Line is too long, draw current line and start new one
-                epd_get_text_bounds(&FiraSans_20, line, &x, &text_y,
-                                    &text_x1, &text_y1, &text_width, &text_height, &props);
-                x = (960 - text_width) / 2;  // Center the line
-                epd_write_string(&FiraSans_20, line, &x, &y, fb, &props);
+                text_width = hal_display_text_width(HAL_FONT_LARGE, line);
+                int x = (960 - text_width) / 2;  // Center the line
+                hal_display_draw_text(HAL_FONT_LARGE, line, x, y);
                 y += line_height;
 
                 // Start new line with current word
@@ -192,12 +167,9 @@ void display_connected_mode(const char* quote, const char* author, const char* d
 
     // Draw final line of quote
     if (strlen(line) > 0) {
-        int x = 0, text_y = 0;
-        int text_x1, text_y1, text_width, text_height;
-        epd_get_text_bounds(&FiraSans_20, line, &x, &text_y,
-                            &text_x1, &text_y1, &text_width, &text_height, &props);
-        x = (960 - text_width) / 2;
-        epd_write_string(&FiraSans_20, line, &x, &y, fb, &props);
+        int text_width = hal_display_text_width(HAL_FONT_LARGE, line);
+        int x = (960 - text_width) / 2;
+        hal_display_draw_text(HAL_FONT_LARGE, line, x, y);
         y += line_height;  // Move down for author
     }
 
@@ -206,118 +178,63 @@ void display_connected_mode(const char* quote, const char* author, const char* d
     char author_text[256];
     snprintf(author_text, sizeof(author_text), "(%s)", author);
 
-    int x = 0, text_y = 0;
-    int text_x1, text_y1, text_width, text_height;
-    epd_get_text_bounds(&FiraSans_20, author_text, &x, &text_y,
-                        &text_x1, &text_y1, &text_width, &text_height, &props);
-    x = (960 - text_width) / 2;  // Center the author
-    epd_write_string(&FiraSans_20, author_text, &x, &y, fb, &props);
+    int text_width = hal_display_text_width(HAL_FONT_LARGE, author_text);
+    int x = (960 - text_width) / 2;  // Center the author
+    hal_display_draw_text(HAL_FONT_LARGE, author_text, x, y);
 
     // Datetime text at bottom-left corner (OpenSans8)
     x = 10;         // Left edge
     y = 540 - 15;   // Bottom edge
-    epd_write_string(&OpenSans8, datetime_text, &x, &y, fb, &props);
+    hal_display_draw_text(HAL_FONT_SMALL, datetime_text, x, y);
 
-    // Draw logo at bottom-right corner (64x64 icon)
-    EpdRect logo_area = {
-        .x = 960 - 64 - 10,  // 10px margin from right edge
-        .y = 540 - 64 - 10,  // 10px margin from bottom edge
-        .width = wm_logo_64_width,
-        .height = wm_logo_64_height
-    };
-    epd_copy_to_framebuffer(logo_area, wm_logo_64_data, fb);
+    // Draw logo at bottom-right corner (64x64 icon, 10px margins)
+    hal_display_draw_image(HAL_IMAGE_LOGO_64, 960 - 64 - 10, 540 - 64 - 10);
 
     // Update screen with new content
-    err = epd_hl_update_screen(&hl, MODE_GC16, 25);
-    if (err != EPD_DRAW_SUCCESS) {
-        ESP_LOGE(TAG, "Display update failed with error: %d", err);
-    } else {
-        ESP_LOGI(TAG, "Display updated successfully!");
+    if (hal_display_update() == ESP_OK) {
+        BINLOG_I(TAG, "Display updated successfully!");
     }
 
     // Power off display to save energy
-    epd_poweroff();
+    display_power_off();
 }
 
 void display_connecting(const char* ssid) {
-    ESP_LOGI(TAG, "Displaying connecting message...");
-
-    uint8_t* fb = epd_hl_get_framebuffer(&hl);
-    if (fb == NULL) {
-        ESP_LOGE(TAG, "Failed to get framebuffer!");
-        return;
-    }
+    BINLOG_I(TAG, "Displaying connecting message...");
 
-    // Clear framebuffer to white
-    epd_clear();
+    // Clear the panel
+    hal_display_clear_screen();
 
     // Power on display
-    epd_poweron();
-    vTaskDelay(pdMS_TO_TICKS(100));
-
-    EpdFontProperties props = {
-        .fg_color = 0,      // Black (4-bit: 0x0)
-        .bg_color = 15,     // White (4-bit: 0xF)
-        .fallback_glyph = 0,
-        .flags = 0
-    };
-
-    // Draw 256x256 logo on the left, centered vertically
-    EpdRect logo_area = {
-        .x = 80,
-        .y = (540 - 256) / 2,  // Center vertically (142)
-        .width = wm_logo_256_width,
-        .height = wm_logo_256_height
-    };
-    epd_copy_to_framebuffer(logo_area, wm_logo_256_data, fb);
+    display_power_on();
+
+    // Draw 256x256 logo on the left, centered vertically (y = 142)
+    hal_display_draw_image(HAL_IMAGE_LOGO_256, 80, (540 - 256) / 2);
 
     // Display connecting message (to the right of the logo)
     char msg[128];
     snprintf(msg, sizeof(msg), "Connecting to: %s", ssid);
     int x = 380, y = 250;
-    epd_write_string(&FiraSans_20, msg, &x, &y, fb, &props);
+    hal_display_draw_text(HAL_FONT_LARGE, msg, x, y);
 
     // Update screen
-    enum EpdDrawError err = epd_hl_update_screen(&hl, MODE_GC16, 25);
-    if (err != EPD_DRAW_SUCCESS) {
-        ESP_LOGE(TAG, "Display update failed with error: %d", err);
-    }
+    hal_display_update();
 
     // Power off display to save energy
-    epd_poweroff();
+    display_power_off();
 }
 
 void display_loading(const char* gerund) {
-    ESP_LOGI(TAG, "Displaying loading screen with gerund: %s", gerund);
-
-    uint8_t* fb = epd_hl_get_framebuffer(&hl);
-    if (fb == NULL) {
-        ESP_LOGE(TAG, "Failed to get framebuffer!");
-        return;
-    }
+    BINLOG_I(TAG, "Displaying loading screen with gerund: %s", gerund);
 
-    // Clear framebuffer to white
-    epd_clear();
+    // Clear the panel
+    hal_display_clear_screen();
 
     // Power on display
-    epd_poweron();
-    vTaskDelay(pdMS_TO_TICKS(100));
-
-    EpdFontProperties props = {
-        .fg_color = 0,      // Black (4-bit: 0x0)
-        .bg_color = 15,     // White (4-bit: 0xF)
-        .fallback_glyph = 0,
-        .flags = 0
-    };
-
-    // Draw 256x256 logo on the left, centered vertically
-    EpdRect logo_area = {
-        .x = 80,
-        .y = (540 - 256) / 2,  // Center vertically (142)
-        .width = wm_logo_256_width,
-        .height = wm_logo_256_height
-    };
-    epd_copy_to_framebuffer(logo_area, wm_logo_256_data, fb);
+    display_power_on();
+
+    // Draw 256x256 logo on the left, centered vertically (y = 142)
+    hal_display_draw_image(HAL_IMAGE_LOGO_256, 80, (540 - 256) / 2);
 
     // Create the message with three dots
     char message[64];
@@ -328,78 +245,52 @@ void display_loading(const char* gerund) {
     int x = 380;
     int y = 270;  // Center vertically
 
-    epd_write_string(&FiraSans_20, message, &x, &y, fb, &props);
+    hal_display_draw_text(HAL_FONT_LARGE, message, x, y);
 
     // Update screen
-    enum EpdDrawError err = epd_hl_update_screen(&hl, MODE_GC16, 25);
-    if (err != EPD_DRAW_SUCCESS) {
-        ESP_LOGE(TAG, "Display update failed with error: %d", err);
-    }
+    hal_display_update();
 
     // Power off display to save energy
-    epd_poweroff();
+    display_power_off();
 }
 
 void display_reset_confirmation(void) {
     ESP_LOGI(TAG, "Displaying network reset confirmation message...");
 
-    uint8_t* fb = epd_hl_get_framebuffer(&hl);
-    if (fb == NULL) {
-        ESP_LOGE(TAG, "Failed to get framebuffer!");
-        return;
-    }
-
-    // Clear framebuffer to white
-    epd_clear();
+    // Clear the panel
+    hal_display_clear_screen();
 
     // Power on display
-    epd_poweron();
-    vTaskDelay(pdMS_TO_TICKS(100));
-
-    EpdFontProperties props = {
-        .fg_color = 0,      // Black (4-bit: 0x0)
-        .bg_color = 15,     // White (4-bit: 0xF)
-        .fallback_glyph = 0,
-        .flags = 0
-    };
-
-    // Draw 256x256 logo on the left, centered vertically
-    EpdRect logo_area = {
-        .x = 80,
-        .y = (540 - 256) / 2,  // Center vertically (142)
-        .width = wm_logo_256_width,
-        .height = wm_logo_256_height
-    };
-    epd_copy_to_framebuffer(logo_area, wm_logo_256_data, fb);
+    display_power_on();
+
+    // Draw 256x256 logo on the left, centered vertically (y = 142)
+    hal_display_draw_image(HAL_IMAGE_LOGO_256, 80, (540 - 256) / 2);
 
     // Display reset message (to the right of the logo)
     // Use better word wrapping to fit on screen
     const char* msg1 = "To reset network";
     int x = 380, y = 180;
-    epd_write_string(&FiraSans_20, msg1, &x, &y, fb, &props);
+    hal_display_draw_text(HAL_FONT_LARGE, msg1, x, y);
 
     const char* msg2 = "configuration press";
     x = 380; y = 215;
-    epd_write_string(&FiraSans_20, msg2, &x, &y, fb, &props);
+    hal_display_draw_text(HAL_FONT_LARGE, msg2, x, y);
 
     const char* msg3 = "same button 3 times";
     x = 380; y = 250;
-    epd_write_string(&FiraSans_20, msg3, &x, &y, fb, &props);
+    hal_display_draw_text(HAL_FONT_LARGE, msg3, x, y);
 
     const char* msg4 = "in next 10 seconds";
     x = 380; y = 285;
-    epd_write_string(&FiraSans_20, msg4, &x, &y, fb, &props);
+    hal_display_draw_text(HAL_FONT_LARGE, msg4, x, y);
 
     const char* msg5 = "or wait to cancel.";
     x = 380; y = 320;
-    epd_write_string(&FiraSans_20, msg5, &x, &y, fb, &props);
+    hal_display_draw_text(HAL_FONT_LARGE, msg5, x, y);
 
     // Update screen
-    enum EpdDrawError err = epd_hl_update_screen(&hl, MODE_GC16, 25);
-    if (err != EPD_DRAW_SUCCESS) {
-        ESP_LOGE(TAG, "Display update failed with error: %d", err);
-    }
+    hal_display_update();
 
     // Power off display to save energy
-    epd_poweroff();
+    display_power_off();
 }
@@ -4,11 +4,35 @@
 extern "C" {
 #endif
 
+/**
+ * Point in a display refresh at which the power hook runs
+ * The EPD power rail is on in both phases
+ */
+typedef enum {
+    DISPLAY_POWER_SETTLED,    // Rail settled, before refresh (fixed EPD supply load)
+    DISPLAY_POWER_REFRESHED,  // Right after epd_hl_update_screen(), before power-off
+} display_power_phase_t;
+
+/**
+ * Callback run while the EPD power rail is on
+ * Must be short: it delays the refresh or the power-off
+ */
+typedef void (*display_power_hook_t)(display_power_phase_t phase);
+
 /**
  * Initialize the e-paper display
  */
 void display_init(void);
 
+/**
+ * Register a callback to run whenever the display powers its rail
+ * Lets other modules (battery divider) piggyback on the display's
+ * power cycle instead of toggling the rail themselves
+ *
+ * @param hook Callback, or NULL to remove
+ */
+void display_set_power_hook(display_power_hook_t hook);
+
 /**
  * Display provisioning mode message
  * Shows instructions to connect to the AP for WiFi configuration
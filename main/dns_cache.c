@@ -0,0 +1,269 @@
+#include "dns_cache.h"
+#include "hal_dns.h"
+#include "hal_time.h"
+#include "wake_budget.h"
+#include "esp_log.h"
+#include "rtc_budget.h"
+#include "esp_attr.h"
+#include "esp_rom_crc.h"
+#include "binlog.h"
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "DNS_CACHE";
+
+#define CACHE_MAGIC 0x444E5331  // "DNS1"
+#define LATENCY_WEIGHT 4        // A new lookup's latency enters the average with 1/4
+
+/**
+ * One cached answer
+ */
+typedef struct {
+    char host[DNS_CACHE_HOST_SIZE];   // "" if the slot is free
+    uint32_t addr;                    // IPv4, network byte order; 0 after a failed connection
+    uint32_t ttl_s;
+    int64_t resolved_at;              // Wall clock of the answer
+    int64_t used_at;                  // Wall clock of the last lookup (replacement order)
+    uint32_t lookup_ms;               // Average lookup latency: what a hit saves
+} dns_entry_t;
+
+/**
+ * Answers and hit counters across wakes
+ */
+typedef struct {
+    uint32_t magic;
+    dns_entry_t entries[DNS_CACHE_SLOTS];
+    uint32_t lookups;                 // Since power-on
+    uint32_t hits;
+    uint32_t stale_hits;
+    uint32_t saved_ms;
+    uint32_t crc;
+} dns_cache_t;
+RTC_BUDGET_CHECK(dns_cache_t, RTC_BUDGET_DNS_CACHE);
+
+// Survives deep sleep; reset by power loss (caught by CRC)
+static RTC_NOINIT_ATTR dns_cache_t cache;
+static bool loaded = false;
+
+// This wake
+static struct {
+    uint32_t lookups;
+    uint32_t hits;
+    uint32_t stale_hits;
+    uint32_t refreshed;               // Background answers stored
+    uint32_t saved_ms;
+    uint32_t spent_ms;                // Blocking lookups
+    uint32_t querying;                // Bit per entry: background query in flight
+} wake;
+
+static uint32_t cache_crc(void) {
+    return esp_rom_crc32_le(0, (const uint8_t*)&cache, offsetof(dns_cache_t, crc));
+}
+
+static void cache_commit(void) {
+    cache.crc = cache_crc();
+}
+
+static void cache_load(void) {
+    if (loaded) {
+        return;
+    }
+    loaded = true;
+    if (cache.magic != CACHE_MAGIC || cache.crc != cache_crc()) {
+        memset(&cache, 0, sizeof(cache));
+        cache.magic = CACHE_MAGIC;
+        cache_commit();
+    }
+}
+
+static bool parse_ipv4(const char* text, uint32_t* addr) {
+    unsigned a, b, c, d;
+    char tail;
+    if (sscanf(text, "%u.%u.%u.%u%c", &a, &b, &c, &d, &tail) != 4 || a > 255 || b > 255 || c > 255 || d > 255) {
+        return false;
+    }
+    uint8_t bytes[4] = {(uint8_t)a, (uint8_t)b, (uint8_t)c, (uint8_t)d};
+    memcpy(addr, bytes, sizeof(bytes));
+    return true;
+}
+
+static void format_ipv4(uint32_t addr, char* buffer, size_t buffer_size) {
+    const uint8_t* bytes = (const uint8_t*)&addr;
+    snprintf(buffer, buffer_size, "%u.%u.%u.%u", bytes[0], bytes[1], bytes[2], bytes[3]);
+}
+
+static bool url_host(const char* url, char* host, size_t host_size) {
+    const char* start = strstr(url, "://");
+    start = start != NULL ? start + 3 : url;
+    size_t len = strcspn(start, ":/?#");
+    if (len == 0 || len >= host_size) {
+        return false;
+    }
+    memcpy(host, start, len);
+    host[len] = '\0';
+    return true;
+}
+
+static dns_entry_t* find(const char* host) {
+    for (int i = 0; i < DNS_CACHE_SLOTS; i++) {
+        if (cache.entries[i].host[0] != '\0' && strcmp(cache.entries[i].host, host) == 0) {
+            return &cache.entries[i];
+        }
+    }
+    return NULL;
+}
+
+// Record an answer: the host's entry, a free one or the least recently used
+static void store(const char* host, const hal_dns_answer_t* answer, int64_t now) {
+    if (strlen(host) >= DNS_CACHE_HOST_SIZE) {
+        return;
+    }
+    dns_entry_t* entry = find(host);
+    uint32_t lookup_ms = (uint32_t)answer->elapsed_ms;
+    if (entry != NULL) {
+        lookup_ms = (entry->lookup_ms * (LATENCY_WEIGHT - 1) + lookup_ms) / LATENCY_WEIGHT;
+    } else {
+        entry = &cache.entries[0];
+        for (int i = 0; i < DNS_CACHE_SLOTS; i++) {
+            if (cache.entries[i].host[0] == '\0') {
+                entry = &cache.entries[i];
+                break;
+            }
+            if (cache.entries[i].used_at < entry->used_at) {
+                entry = &cache.entries[i];
+            }
+        }
+        snprintf(entry->host, sizeof(entry->host), "%s", host);
+        entry->used_at = now;
+    }
+    entry->addr = answer->addr;
+    entry->ttl_s = answer->ttl_s;
+    entry->resolved_at = now;
+    entry->lookup_ms = lookup_ms;
+    wake.querying &= ~(1u << (entry - cache.entries));
+    cache_commit();
+}
+
+static void refresh(dns_entry_t* entry) {
+    uint32_t bit = 1u << (entry - cache.entries);
+    if ((wake.querying & bit) == 0 && hal_dns_query(entry->host) == ESP_OK) {
+        wake.querying |= bit;
+    }
+}
+
+void dns_cache_collect(void) {
+    if (wake.querying == 0) {
+        return;
+    }
+    char host[HAL_DNS_HOST_SIZE];
+    hal_dns_answer_t answer;
+    while (hal_dns_collect(host, sizeof(host), &answer) == ESP_OK) {
+        store(host, &answer, hal_time_now());
+        wake.refreshed++;
+        BINLOG_I(TAG, "Refreshed %s in the background (%d ms, TTL %lu s)", host, answer.elapsed_ms,
+                 (unsigned long)answer.ttl_s);
+    }
+}
+
+esp_err_t dns_cache_lookup(const char* host, uint32_t* addr) {
+    if (parse_ipv4(host, addr)) {
+        return ESP_OK;
+    }
+    cache_load();
+    dns_cache_collect();  // Answers to earlier background queries first
+
+    int64_t now = hal_time_now();
+    wake.lookups++;
+    cache.lookups++;
+
+    dns_entry_t* entry = find(host);
+    int64_t age = entry != NULL ? now - entry->resolved_at : -1;
+    if (entry != NULL && entry->addr != 0 && age >= 0 && age < (int64_t)entry->ttl_s + DNS_CACHE_MAX_STALE_S) {
+        bool stale = age >= (int64_t)entry->ttl_s;
+        wake.hits++;
+        wake.stale_hits += stale;
+        wake.saved_ms += entry->lookup_ms;
+        cache.hits++;
+        cache.stale_hits += stale;
+        cache.saved_ms += entry->lookup_ms;
+        entry->used_at = now;
+        cache_commit();
+        if (stale) {
+            refresh(entry);
+        }
+        BINLOG_I(TAG, "%s: cached%s, answer %ld s old", host, stale ? " (expired, refreshing)" : "", (long)age);
+        *addr = entry->addr;
+        return ESP_OK;
+    }
+    cache_commit();
+
+    int64_t start_us = hal_time_us();
+    hal_dns_answer_t answer;
+    esp_err_t err = hal_dns_resolve(host, wake_budget_clamp_ms(DNS_CACHE_TIMEOUT_MS), &answer);
+    wake.spent_ms += (uint32_t)((hal_time_us() - start_us) / 1000);
+    if (err != ESP_OK) {
+        return err;
+    }
+    store(host, &answer, now);
+
+    char text[DNS_CACHE_ADDR_SIZE];
+    format_ipv4(answer.addr, text, sizeof(text));
+    BINLOG_I(TAG, "Resolved %s to %s in %d ms, TTL %lu s", host, text, answer.elapsed_ms,
+             (unsigned long)answer.ttl_s);
+    *addr = answer.addr;
+    return ESP_OK;
+}
+
+esp_err_t dns_cache_lookup_url(const char* url, uint32_t* addr) {
+    char host[DNS_CACHE_HOST_SIZE];
+    if (!url_host(url, host, sizeof(host))) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return dns_cache_lookup(host, addr);
+}
+
+esp_err_t dns_cache_lookup_text(const char* host, char* buffer, size_t buffer_size) {
+    uint32_t addr;
+    esp_err_t err = dns_cache_lookup(host, &addr);
+    if (err == ESP_OK) {
+        format_ipv4(addr, buffer, buffer_size);
+    }
+    return err;
+}
+
+void dns_cache_failed(const char* host) {
+    uint32_t addr;
+    if (parse_ipv4(host, &addr)) {
+        return;
+    }
+    cache_load();
+    dns_entry_t* entry = find(host);
+    if (entry == NULL || entry->addr == 0) {
+        return;
+    }
+    entry->addr = 0;
+    cache_commit();
+    ESP_LOGW(TAG, "Connection to the cached address of %s failed, resolving again", host);
+    refresh(entry);
+}
+
+void dns_cache_failed_url(const char* url) {
+    char host[DNS_CACHE_HOST_SIZE];
+    if (url_host(url, host, sizeof(host))) {
+        dns_cache_failed(host);
+    }
+}
+
+void dns_cache_report(void) {
+    if (wake.lookups == 0) {
+        return;
+    }
+    ESP_LOGI(TAG, "DNS: %lu lookups, %lu cached (%lu expired), %lu refreshed in the background, "
+             "~%lu ms saved, %lu ms spent resolving",
+             (unsigned long)wake.lookups, (unsigned long)wake.hits, (unsigned long)wake.stale_hits,
+             (unsigned long)wake.refreshed, (unsigned long)wake.saved_ms, (unsigned long)wake.spent_ms);
+    ESP_LOGI(TAG, "DNS since power-on: %lu/%lu lookups cached (%.0f%%, %lu expired), ~%.1f s saved",
+             (unsigned long)cache.hits, (unsigned long)cache.lookups, 100.0f * cache.hits / cache.lookups,
+             (unsigned long)cache.stale_hits, cache.saved_ms / 1e3);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <esp_err.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DNS_CACHE_SLOTS 4              // Quote API, Wikiquote, NTP pool, spare
+#define DNS_CACHE_HOST_SIZE 40
+#define DNS_CACHE_MAX_STALE_S 86400    // Expired answers are still used this long, refreshed in the background
+#define DNS_CACHE_TIMEOUT_MS 2000      // Blocking lookup on a miss
+#define DNS_CACHE_ADDR_SIZE 16         // "255.255.255.255"
+
+/**
+ * Address to connect to for a host: the cached answer, or a lookup now
+ *
+ * An answer past its TTL (up to DNS_CACHE_MAX_STALE_S) is still returned,
+ * and a background query refreshes it for later wakes: the hosts change
+ * addresses rarely, and a failed connection drops the entry.
+ * IP literals are returned as they are.
+ *
+ * @param host Host name
+ * @param addr IPv4 address (network byte order) out
+ * @return ESP_OK, or the lookup's error (the caller connects by name)
+ */
+esp_err_t dns_cache_lookup(const char* host, uint32_t* addr);
+
+/**
+ * dns_cache_lookup() for the host of a URL
+ */
+esp_err_t dns_cache_lookup_url(const char* url, uint32_t* addr);
+
+/**
+ * dns_cache_lookup() as dotted-quad text (e.g. for SNTP)
+ *
+ * @param host Host name
+ * @param buffer DNS_CACHE_ADDR_SIZE bytes
+ * @param buffer_size Its size
+ * @return ESP_OK, or the lookup's error
+ */
+esp_err_t dns_cache_lookup_text(const char* host, char* buffer, size_t buffer_size);
+
+/**
+ * A connection to the cached address of host failed: drop the address and
+ * query again in the background; the next lookup uses that answer if it
+ * has arrived, or resolves again
+ */
+void dns_cache_failed(const char* host);
+
+/**
+ * dns_cache_failed() for the host of a URL
+ */
+void dns_cache_failed_url(const char* url);
+
+/**
+ * Store background answers that have arrived; call after the wake's network
+ * traffic, before the radio goes off
+ */
+void dns_cache_collect(void);
+
+/**
+ * Log this wake's lookups, hits and the lookup time they saved, and the hit
+ * rate since power-on (kept in RTC memory)
+ */
+void dns_cache_report(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HAL_ADC_BATTERY_GPIO 36        // Battery divider input (ADC1_CH0) on the T5-4.7
+#define HAL_ADC_MAX_RAW 4095           // 12-bit conversion
+#define HAL_ADC_FULL_SCALE_MV 3300     // Nominal range at 12 dB attenuation
+
+/**
+ * Initialize the battery ADC channel and its calibration
+ * Safe to call more than once
+ *
+ * @return ESP_OK on success
+ */
+esp_err_t hal_adc_init(void);
+
+/**
+ * Take one conversion on the battery channel (~40 us on ESP32)
+ *
+ * @param raw Raw reading (0-HAL_ADC_MAX_RAW)
+ * @return ESP_OK on success
+ */
+esp_err_t hal_adc_read(int* raw);
+
+/**
+ * Convert a raw reading to millivolts at the ADC pin using calibration
+ *
+ * @param raw Raw reading (may be an average of several)
+ * @param mv Calibrated millivolts
+ * @return ESP_OK, or ESP_ERR_NOT_SUPPORTED if no calibration is available
+ */
+esp_err_t hal_adc_to_mv(int raw, int* mv);
+
+#ifdef __cplusplus
+}
+#endif
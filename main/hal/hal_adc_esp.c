@@ -0,0 +1,95 @@
+#include "hal_adc.h"
+#include "esp_adc/adc_oneshot.h"
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
+#include "esp_log.h"
+#include <stdbool.h>
+
+static const char *TAG = "HAL_ADC";
+
+#define BATT_ADC_UNIT ADC_UNIT_1
+#define BATT_ADC_CHANNEL ADC_CHANNEL_0     // GPIO 36 = ADC1_CH0
+#define BATT_ADC_ATTEN ADC_ATTEN_DB_12     // 0-3.3V range
+#define BATT_ADC_WIDTH ADC_BITWIDTH_12     // 12-bit resolution (0-4095)
+
+static adc_oneshot_unit_handle_t adc_handle = NULL;
+static adc_cali_handle_t adc_cali_handle = NULL;
+
+static bool adc_cali_init(void) {
+#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+    adc_cali_curve_fitting_config_t cali_config = {
+        .unit_id = BATT_ADC_UNIT,
+        .chan = BATT_ADC_CHANNEL,
+        .atten = BATT_ADC_ATTEN,
+        .bitwidth = BATT_ADC_WIDTH,
+    };
+    if (adc_cali_create_scheme_curve_fitting(&cali_config, &adc_cali_handle) == ESP_OK) {
+        ESP_LOGI(TAG, "ADC calibrated using curve fitting");
+        return true;
+    }
+#elif ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
+    // Classic ESP32 only supports line fitting (eFuse Two Point or Vref)
+    adc_cali_line_fitting_config_t cali_config = {
+        .unit_id = BATT_ADC_UNIT,
+        .atten = BATT_ADC_ATTEN,
+        .bitwidth = BATT_ADC_WIDTH,
+        .default_vref = 1100,  // Used only if eFuse holds no calibration
+    };
+    if (adc_cali_create_scheme_line_fitting(&cali_config, &adc_cali_handle) == ESP_OK) {
+        adc_cali_line_fitting_efuse_val_t efuse_val;
+        adc_cali_scheme_line_fitting_check_efuse(&efuse_val);
+        if (efuse_val == ADC_CALI_LINE_FITTING_EFUSE_VAL_EFUSE_TP) {
+            ESP_LOGI(TAG, "ADC calibrated using line fitting (eFuse Two Point)");
+        } else if (efuse_val == ADC_CALI_LINE_FITTING_EFUSE_VAL_EFUSE_VREF) {
+            ESP_LOGI(TAG, "ADC calibrated using line fitting (eFuse Vref)");
+        } else {
+            ESP_LOGI(TAG, "ADC calibrated using line fitting (Default Vref: 1100 mV)");
+        }
+        return true;
+    }
+#endif
+    ESP_LOGW(TAG, "No ADC calibration available, using uncalibrated conversion");
+    return false;
+}
+
+esp_err_t hal_adc_init(void) {
+    if (adc_handle != NULL) {
+        return ESP_OK;
+    }
+
+    adc_oneshot_unit_init_cfg_t unit_config = {
+        .unit_id = BATT_ADC_UNIT,
+        .ulp_mode = ADC_ULP_MODE_DISABLE,
+    };
+    esp_err_t err = adc_oneshot_new_unit(&unit_config, &adc_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create ADC unit: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    adc_oneshot_chan_cfg_t chan_config = {
+        .atten = BATT_ADC_ATTEN,
+        .bitwidth = BATT_ADC_WIDTH,
+    };
+    err = adc_oneshot_config_channel(adc_handle, BATT_ADC_CHANNEL, &chan_config);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to configure ADC channel: %s", esp_err_to_name(err));
+        adc_oneshot_del_unit(adc_handle);
+        adc_handle = NULL;
+        return err;
+    }
+
+    adc_cali_init();
+    return ESP_OK;
+}
+
+esp_err_t hal_adc_read(int* raw) {
+    return adc_oneshot_read(adc_handle, BATT_ADC_CHANNEL, raw);
+}
+
+esp_err_t hal_adc_to_mv(int raw, int* mv) {
+    if (adc_cali_handle == NULL) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    return adc_cali_raw_to_voltage(adc_cali_handle, raw, mv);
+}
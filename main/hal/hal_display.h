@@ -0,0 +1,109 @@
+#pragma once
+
+#include <esp_err.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Fonts available to the UI (epdiy font tables on the device)
+ */
+typedef enum {
+    HAL_FONT_LARGE,      // FiraSans 20 - quotes, screen messages
+    HAL_FONT_MEDIUM,     // FiraSans 12 - secondary text
+    HAL_FONT_SMALL,      // OpenSans 8 - status line
+} hal_font_t;
+
+/**
+ * Images available to the UI
+ */
+typedef enum {
+    HAL_IMAGE_LOGO_256,  // 256x256 logo (status screens)
+    HAL_IMAGE_LOGO_64,   // 64x64 logo (quote screen corner)
+} hal_image_t;
+
+/**
+ * Initialize the panel and allocate the framebuffer (landscape)
+ */
+void hal_display_init(void);
+
+/**
+ * @return Width in pixels after rotation
+ */
+int hal_display_width(void);
+
+/**
+ * @return Height in pixels after rotation
+ */
+int hal_display_height(void);
+
+/**
+ * Switch the EPD power rail on (also feeds the battery divider)
+ */
+void hal_display_power_on(void);
+
+/**
+ * Switch the EPD power rail off
+ */
+void hal_display_power_off(void);
+
+/**
+ * Fill the framebuffer with white (no refresh)
+ */
+void hal_display_fill_white(void);
+
+/**
+ * Flash the whole panel to clear it (epd_clear(), framebuffer untouched)
+ */
+void hal_display_clear_screen(void);
+
+/**
+ * Draw black text into the framebuffer
+ *
+ * @param font Font
+ * @param text UTF-8 text
+ * @param x Left edge
+ * @param y Baseline
+ */
+void hal_display_draw_text(hal_font_t font, const char* text, int x, int y);
+
+/**
+ * Measure text
+ *
+ * @param font Font
+ * @param text UTF-8 text
+ * @return Width in pixels
+ */
+int hal_display_text_width(hal_font_t font, const char* text);
+
+/**
+ * Copy an image into the framebuffer
+ *
+ * @param image Image
+ * @param x Left edge
+ * @param y Top edge
+ */
+void hal_display_draw_image(hal_image_t image, int x, int y);
+
+/**
+ * Push the framebuffer to the panel (full GC16 update)
+ * The rail must be on
+ *
+ * @return ESP_OK, or ESP_FAIL if the driver reported a draw error
+ */
+esp_err_t hal_display_update(void);
+
+/**
+ * Read one row of the framebuffer as gray levels (screenshots)
+ *
+ * @param y Row, from the top
+ * @param gray hal_display_width() levels, 0 = black, 15 = white
+ * @return ESP_OK, or ESP_ERR_INVALID_ARG for a row outside the screen
+ */
+esp_err_t hal_display_read_row(int y, uint8_t* gray);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,119 @@
+#include "hal_display.h"
+#include "epdiy.h"
+#include "firasans_20.h"
+#include "firasans_12.h"
+#include "opensans8.h"
+#include "wm_logo_64.h"
+#include "wm_logo_256.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "HAL_DISPLAY";
+
+// High-level EPD state
+static EpdiyHighlevelState hl;
+
+static const EpdFontProperties text_props = {
+    .fg_color = 0,      // Black (4-bit: 0x0)
+    .bg_color = 15,     // White (4-bit: 0xF)
+    .fallback_glyph = 0,
+    .flags = 0
+};
+
+static const EpdFont* font_table(hal_font_t font) {
+    switch (font) {
+        case HAL_FONT_MEDIUM:
+            return &FiraSans_12;
+        case HAL_FONT_SMALL:
+            return &OpenSans8;
+        case HAL_FONT_LARGE:
+        default:
+            return &FiraSans_20;
+    }
+}
+
+void hal_display_init(void) {
+    // Initialize EPD with Lilygo T5-4.7 board and ED047TC1 display
+    epd_init(&epd_board_lilygo_t5_47, &ED047TC1, EPD_LUT_64K);
+
+    // VCOM voltage is hardware-set on this board, no software config needed
+
+    // Initialize high-level state with builtin waveform
+    hl = epd_hl_init(EPD_BUILTIN_WAVEFORM);
+
+    // Set landscape orientation (960x540)
+    epd_set_rotation(EPD_ROT_LANDSCAPE);
+}
+
+int hal_display_width(void) {
+    return epd_rotated_display_width();
+}
+
+int hal_display_height(void) {
+    return epd_rotated_display_height();
+}
+
+void hal_display_power_on(void) {
+    epd_poweron();
+}
+
+void hal_display_power_off(void) {
+    epd_poweroff();
+}
+
+void hal_display_fill_white(void) {
+    memset(epd_hl_get_framebuffer(&hl), 0xFF, epd_width() / 2 * epd_height());
+}
+
+void hal_display_clear_screen(void) {
+    epd_clear();
+}
+
+void hal_display_draw_text(hal_font_t font, const char* text, int x, int y) {
+    epd_write_string(font_table(font), text, &x, &y, epd_hl_get_framebuffer(&hl), &text_props);
+}
+
+int hal_display_text_width(hal_font_t font, const char* text) {
+    int x = 0, y = 0;
+    int x1, y1, width, height;
+    epd_get_text_bounds(font_table(font), text, &x, &y, &x1, &y1, &width, &height, &text_props);
+    return width;
+}
+
+void hal_display_draw_image(hal_image_t image, int x, int y) {
+    EpdRect area = {.x = x, .y = y};
+    const uint8_t* data;
+
+    if (image == HAL_IMAGE_LOGO_64) {
+        area.width = wm_logo_64_width;
+        area.height = wm_logo_64_height;
+        data = wm_logo_64_data;
+    } else {
+        area.width = wm_logo_256_width;
+        area.height = wm_logo_256_height;
+        data = wm_logo_256_data;
+    }
+    epd_copy_to_framebuffer(area, data, epd_hl_get_framebuffer(&hl));
+}
+
+esp_err_t hal_display_update(void) {
+    enum EpdDrawError err = epd_hl_update_screen(&hl, MODE_GC16, 25);
+    if (err != EPD_DRAW_SUCCESS) {
+        ESP_LOGE(TAG, "Display update failed with error: %d", err);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t hal_display_read_row(int y, uint8_t* gray) {
+    // Landscape is the panel's native orientation: framebuffer rows are screen rows
+    if (y < 0 || y >= epd_height()) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const uint8_t* row = epd_hl_get_framebuffer(&hl) + y * epd_width() / 2;
+    for (int x = 0; x < epd_width(); x += 2) {
+        gray[x] = row[x / 2] & 0x0F;        // Even pixels in the low nibble
+        gray[x + 1] = row[x / 2] >> 4;
+    }
+    return ESP_OK;
+}
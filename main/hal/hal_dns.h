@@ -0,0 +1,59 @@
+#pragma once
+
+#include <esp_err.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HAL_DNS_HOST_SIZE 64
+#define HAL_DNS_MAX_PENDING 4     // Background queries in flight at once
+
+/**
+ * Answer to an A query
+ */
+typedef struct {
+    uint32_t addr;           // First IPv4 address, network byte order
+    uint32_t ttl_s;          // Smallest TTL along the answer (CNAMEs included)
+    int elapsed_ms;          // Query sent to answer received
+} hal_dns_answer_t;
+
+/**
+ * Resolve a host name to an IPv4 address (blocking)
+ * ESP-IDF: one UDP query to the station's DNS server, so the TTL is known;
+ * host: getaddrinfo() with the simulator's modeled latency and TTL
+ *
+ * @param host Host name
+ * @param timeout_ms Time to wait for the answer
+ * @param answer Address, TTL and latency out
+ * @return ESP_OK, ESP_ERR_TIMEOUT without an answer, ESP_ERR_NOT_FOUND if
+ *         the name has no address, ESP_ERR_INVALID_STATE without a network
+ */
+esp_err_t hal_dns_resolve(const char* host, uint32_t timeout_ms, hal_dns_answer_t* answer);
+
+/**
+ * Send a query and return at once; its answer is picked up later by
+ * hal_dns_collect() while other traffic goes on
+ *
+ * @param host Host name
+ * @return ESP_OK once sent, ESP_ERR_NO_MEM if HAL_DNS_MAX_PENDING queries
+ *         are already in flight
+ */
+esp_err_t hal_dns_query(const char* host);
+
+/**
+ * Take one answer to a hal_dns_query() that has arrived (does not wait)
+ * Queries still unanswered stay pending; they are dropped with deep sleep.
+ *
+ * @param host Buffer for the name the answer is for
+ * @param host_size Its size
+ * @param answer Address, TTL and latency out
+ * @return ESP_OK with an answer, ESP_ERR_NOT_FOUND if none has arrived
+ */
+esp_err_t hal_dns_collect(char* host, size_t host_size, hal_dns_answer_t* answer);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,227 @@
+#include "hal_dns.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "HAL_DNS";
+
+// Own minimal resolver instead of getaddrinfo(): lwIP's answers do not carry
+// their TTL, which the RTC cache (dns_cache.c) needs to outlive deep sleep
+#define DNS_PORT 53
+#define DNS_PACKET_SIZE 512       // Largest answer over UDP without EDNS
+#define DNS_HEADER_SIZE 12
+#define DNS_TYPE_A 1
+#define DNS_TYPE_CNAME 5
+#define DNS_CLASS_IN 1
+
+typedef struct {
+    uint16_t id;
+    char host[HAL_DNS_HOST_SIZE];   // "" if the slot is free
+    int64_t sent_us;
+} pending_query_t;
+
+static int background_sock = -1;
+static pending_query_t pending[HAL_DNS_MAX_PENDING];
+
+// UDP socket bound to the station's DNS server (from DHCP)
+static int open_socket(void) {
+    esp_netif_t* netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+    esp_netif_dns_info_t dns;
+    if (netif == NULL || esp_netif_get_dns_info(netif, ESP_NETIF_DNS_MAIN, &dns) != ESP_OK ||
+        dns.ip.type != ESP_IPADDR_TYPE_V4 || dns.ip.u_addr.ip4.addr == 0) {
+        return -1;
+    }
+
+    struct sockaddr_in server = {
+        .sin_family = AF_INET,
+        .sin_port = htons(DNS_PORT),
+        .sin_addr.s_addr = dns.ip.u_addr.ip4.addr,
+    };
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0) {
+        return -1;
+    }
+    if (connect(sock, (struct sockaddr*)&server, sizeof(server)) != 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+// A query for host, recursion desired
+static esp_err_t send_query(int sock, uint16_t id, const char* host) {
+    uint8_t packet[DNS_PACKET_SIZE] = {
+        id >> 8, id & 0xFF,
+        0x01, 0x00,          // RD
+        0x00, 0x01,          // QDCOUNT
+    };
+    int pos = DNS_HEADER_SIZE;
+    const char* label = host;
+    while (*label != '\0') {
+        size_t len = strcspn(label, ".");
+        if (len == 0 || len > 63 || pos + 1 + (int)len + 5 > DNS_PACKET_SIZE) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        packet[pos++] = (uint8_t)len;
+        memcpy(packet + pos, label, len);
+        pos += len;
+        label += len + (label[len] == '.');
+    }
+    packet[pos++] = 0;
+    packet[pos++] = 0;
+    packet[pos++] = DNS_TYPE_A;
+    packet[pos++] = 0;
+    packet[pos++] = DNS_CLASS_IN;
+    return send(sock, packet, pos, 0) == pos ? ESP_OK : ESP_FAIL;
+}
+
+// Offset past a (possibly compressed) name, -1 if it runs off the packet
+static int skip_name(const uint8_t* packet, int len, int pos) {
+    while (pos < len) {
+        uint8_t label = packet[pos];
+        if (label == 0) {
+            return pos + 1;
+        }
+        if ((label & 0xC0) == 0xC0) {
+            return pos + 2 <= len ? pos + 2 : -1;
+        }
+        pos += 1 + label;
+    }
+    return -1;
+}
+
+static esp_err_t parse_answer(const uint8_t* packet, int len, hal_dns_answer_t* answer) {
+    if (len < DNS_HEADER_SIZE || (packet[2] & 0x80) == 0) {
+        return ESP_FAIL;
+    }
+    if ((packet[3] & 0x0F) != 0) {
+        return ESP_ERR_NOT_FOUND;  // NXDOMAIN, SERVFAIL, ...
+    }
+
+    int questions = packet[4] << 8 | packet[5];
+    int records = packet[6] << 8 | packet[7];
+    int pos = DNS_HEADER_SIZE;
+    for (int i = 0; i < questions && pos >= 0; i++) {
+        pos = skip_name(packet, len, pos);
+        pos = pos >= 0 ? pos + 4 : pos;  // QTYPE, QCLASS
+    }
+
+    answer->addr = 0;
+    answer->ttl_s = UINT32_MAX;
+    for (int i = 0; i < records; i++) {
+        pos = pos >= 0 ? skip_name(packet, len, pos) : pos;
+        if (pos < 0 || pos + 10 > len) {
+            return ESP_FAIL;
+        }
+        int type = packet[pos] << 8 | packet[pos + 1];
+        uint32_t ttl = (uint32_t)packet[pos + 4] << 24 | (uint32_t)packet[pos + 5] << 16 |
+                       (uint32_t)packet[pos + 6] << 8 | packet[pos + 7];
+        int rdlength = packet[pos + 8] << 8 | packet[pos + 9];
+        pos += 10;
+        if (pos + rdlength > len) {
+            return ESP_FAIL;
+        }
+        if ((type == DNS_TYPE_A || type == DNS_TYPE_CNAME) && ttl < answer->ttl_s) {
+            answer->ttl_s = ttl;
+        }
+        if (type == DNS_TYPE_A && rdlength == 4 && answer->addr == 0) {
+            memcpy(&answer->addr, packet + pos, 4);
+        }
+        pos += rdlength;
+    }
+    return answer->addr != 0 ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t hal_dns_resolve(const char* host, uint32_t timeout_ms, hal_dns_answer_t* answer) {
+    int sock = open_socket();
+    if (sock < 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint16_t id = (uint16_t)esp_random();
+    int64_t start_us = esp_timer_get_time();
+    int64_t deadline_us = start_us + (int64_t)timeout_ms * 1000;
+    esp_err_t err = send_query(sock, id, host);
+    while (err == ESP_OK) {
+        int64_t left_us = deadline_us - esp_timer_get_time();
+        if (left_us <= 0) {
+            err = ESP_ERR_TIMEOUT;
+            break;
+        }
+        struct timeval tv = {.tv_sec = left_us / 1000000, .tv_usec = left_us % 1000000};
+        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+        uint8_t packet[DNS_PACKET_SIZE];
+        int len = recv(sock, packet, sizeof(packet), 0);
+        if (len < 0) {
+            err = ESP_ERR_TIMEOUT;
+        } else if (len >= 2 && (packet[0] << 8 | packet[1]) == id) {
+            err = parse_answer(packet, len, answer);
+            break;
+        }
+    }
+    close(sock);
+
+    answer->elapsed_ms = (int)((esp_timer_get_time() - start_us) / 1000);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Resolving %s failed: %s", host, esp_err_to_name(err));
+    }
+    return err;
+}
+
+esp_err_t hal_dns_query(const char* host) {
+    pending_query_t* slot = NULL;
+    for (int i = 0; i < HAL_DNS_MAX_PENDING && slot == NULL; i++) {
+        if (pending[i].host[0] == '\0') {
+            slot = &pending[i];
+        }
+    }
+    if (slot == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (background_sock < 0) {
+        background_sock = open_socket();
+        if (background_sock < 0) {
+            return ESP_ERR_INVALID_STATE;
+        }
+    }
+
+    uint16_t id = (uint16_t)esp_random();
+    esp_err_t err = send_query(background_sock, id, host);
+    if (err == ESP_OK) {
+        slot->id = id;
+        snprintf(slot->host, sizeof(slot->host), "%s", host);
+        slot->sent_us = esp_timer_get_time();
+    }
+    return err;
+}
+
+esp_err_t hal_dns_collect(char* host, size_t host_size, hal_dns_answer_t* answer) {
+    if (background_sock < 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    uint8_t packet[DNS_PACKET_SIZE];
+    int len;
+    while ((len = recv(background_sock, packet, sizeof(packet), MSG_DONTWAIT)) >= 2) {
+        uint16_t id = packet[0] << 8 | packet[1];
+        for (int i = 0; i < HAL_DNS_MAX_PENDING; i++) {
+            if (pending[i].host[0] == '\0' || pending[i].id != id) {
+                continue;
+            }
+            snprintf(host, host_size, "%s", pending[i].host);
+            pending[i].host[0] = '\0';
+            answer->elapsed_ms = (int)((esp_timer_get_time() - pending[i].sent_us) / 1000);
+            if (parse_answer(packet, len, answer) == ESP_OK) {
+                return ESP_OK;
+            }
+            ESP_LOGW(TAG, "No address for %s", host);
+            break;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
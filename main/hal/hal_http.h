@@ -0,0 +1,131 @@
+#pragma once
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HAL_HTTP_ETAG_SIZE 64
+#define HAL_HTTP_DATE_SIZE 32     // "Sat, 01 Mar 2025 08:00:00 GMT"
+#define HAL_HTTP_POOL_SIZE 2      // Idle keep-alive connections kept (one per upstream host)
+#define HAL_HTTP_TASK_STACK_SIZE 8192  // Per racing request: esp_http_client, TLS handshake, body callbacks
+
+/**
+ * Receive a chunk of the body as it arrives (streaming parsers)
+ */
+typedef void (*hal_http_data_cb_t)(const char* data, size_t length, void* ctx);
+
+/**
+ * Response of a GET, body stored in a caller-provided buffer or streamed
+ */
+typedef struct {
+    char* buffer;            // Body, NUL-terminated on return (unused with on_data)
+    size_t buffer_size;      // Capacity including the terminator
+    size_t length;           // Body bytes stored (received, with on_data)
+    int status;              // HTTP status code (0 if no response)
+    bool truncated;          // Body did not fit and was cut
+    hal_http_data_cb_t on_data;  // Optional: body goes here instead of buffer
+    void* data_ctx;              // Passed to on_data
+    char etag[HAL_HTTP_ETAG_SIZE];           // ETag header ("" if none)
+    char last_modified[HAL_HTTP_DATE_SIZE];  // Last-Modified header ("" if none)
+} hal_http_response_t;
+
+/**
+ * Perform a blocking HTTP(S) GET
+ * HTTPS servers are verified against the roots pinned for their host in
+ * main/certs/trust_store.txt, or the certificate bundle, as configured by
+ * CONFIG_QUOTE_TLS_TRUST_* (device), or the system/QUOTE_SIM_CA store (host). Uses a kept-alive connection to
+ * the same host if one is idle, like hal_http_get_first().
+ *
+ * @param url Full URL
+ * @param timeout_ms Network timeout
+ * @param response Buffer in, status and body out
+ * @return ESP_OK if a response was received (any status), error otherwise
+ */
+esp_err_t hal_http_get(const char* url, int timeout_ms, hal_http_response_t* response);
+
+/**
+ * One GET of a hal_http_get_first() race
+ */
+typedef struct {
+    const char* url;               // Full URL
+    uint32_t addr;                 // IPv4 to connect to (network byte order, e.g. from
+                                   // dns_cache), 0 to resolve the URL's host
+    int start_delay_ms;            // Start this long after the race begins (stagger)
+    const char* if_none_match;     // Optional conditional request validators;
+    const char* if_modified_since; // a match answers 304 without a body
+    hal_http_response_t response;  // Buffer in, status and body out
+    esp_err_t result;              // ESP_OK once a response arrived, ESP_ERR_NOT_FINISHED
+                                   // if not started or still running when the race ended
+    int elapsed_ms;                // Start to completion (set when finished)
+    bool reused;                   // Sent on a kept-alive connection (no DNS, TCP, TLS)
+} hal_http_request_t;
+
+/**
+ * Request statistics since boot
+ */
+typedef struct {
+    uint32_t requests;       // Completed requests (any status or transport error)
+    uint32_t reused;         // Of which sent on a kept-alive connection
+    uint32_t total_ms;       // Sum of their latencies (start to completion)
+    uint32_t max_ms;         // Slowest
+    uint32_t stack_free_min; // Lowest unused stack of a request task in bytes (0: none ran)
+} hal_http_stats_t;
+
+/**
+ * Decide whether a completed request wins the race
+ *
+ * @param index Position in the request array
+ * @param request Completed request (result ESP_OK or a transport error)
+ * @param ctx User context
+ * @return true to stop the race with this request
+ */
+typedef bool (*hal_http_accept_cb_t)(int index, hal_http_request_t* request, void* ctx);
+
+/**
+ * Run several GETs concurrently and stop at the first accepted response
+ *
+ * Each request runs blocking in its own task (HAL_HTTP_TASK_STACK_SIZE) on
+ * the device and in one curl multi handle on the host, so a slow connect,
+ * handshake or body holds up only its own request. Requests start at their
+ * start_delay_ms unless the race is already won; completions are offered to
+ * accept() in order of arrival. The call returns when one is accepted or at
+ * the deadline, whichever comes first: requests still running then are
+ * abandoned, and their task closes the connection when the request times out
+ * (at the deadline) or ends. The body callbacks of abandoned requests are not
+ * called any more.
+ *
+ * A request whose response was read completely leaves its connection open
+ * (HAL_HTTP_POOL_SIZE at most, the longest idle is closed first), and the
+ * next request to the same scheme, host and port reuses it with its client
+ * and buffers. Aborted and failed requests close theirs.
+ *
+ * @param requests Requests to run (url, start_delay_ms and response buffer set)
+ * @param count Number of requests
+ * @param deadline_ms Time limit for the whole race
+ * @param accept Completion callback
+ * @param ctx Passed to accept()
+ * @return Index of the accepted request, or -1 if none was accepted in time
+ */
+int hal_http_get_first(hal_http_request_t* requests, int count, int deadline_ms,
+                       hal_http_accept_cb_t accept, void* ctx);
+
+/**
+ * Close the kept-alive connections, freeing their TLS sessions and buffers
+ * Call when a wake has no more requests to make. Waits up to two seconds
+ * for requests abandoned by a race to end (device).
+ */
+void hal_http_close_idle(void);
+
+/**
+ * @param stats Filled with the counters since boot
+ */
+void hal_http_get_stats(hal_http_stats_t* stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,707 @@
+#include "hal_http.h"
+#include "trust_store.h"
+#include "sdkconfig.h"
+#include "esp_http_client.h"
+#include "esp_crt_bundle.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/x509_crt.h"
+#include "mbedtls/sha256.h"
+#include "mbedtls/md.h"
+#include "mbedtls/pk.h"
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+static const char *TAG = "HAL_HTTP";
+
+static void copy_header(char* dest, size_t size, const char* value) {
+    snprintf(dest, size, "%s", value != NULL ? value : "");
+}
+
+// A racing request runs in a worker task; the caller's request is detached
+// (NULL) when the race gives up on it while the worker still runs
+typedef enum {
+    WORKER_IDLE,
+    WORKER_RUNNING,
+    WORKER_DONE,              // Result waiting for the caller
+} worker_state_t;
+
+typedef struct {
+    worker_state_t state;
+    hal_http_request_t* request;
+    esp_http_client_handle_t client;
+    const trust_host_t* trust;
+    TaskHandle_t task;
+    esp_err_t err;
+    int status;
+    bool by_addr;
+} http_worker_t;
+
+// Guards the workers' state and their requests
+static SemaphoreHandle_t worker_lock = NULL;
+
+// Append body chunks to the caller's buffer (keeping room for the
+// terminator) or pass them to the streaming callback; keep the validators.
+// A connect event means the request did not get a kept-alive connection.
+static void handle_event(esp_http_client_event_t *evt, hal_http_request_t *request) {
+    hal_http_response_t *response = &request->response;
+
+    if (evt->event_id == HTTP_EVENT_ON_CONNECTED) {
+        request->reused = false;
+    } else if (evt->event_id == HTTP_EVENT_ON_HEADER) {
+        if (strcasecmp(evt->header_key, "ETag") == 0) {
+            copy_header(response->etag, sizeof(response->etag), evt->header_value);
+        } else if (strcasecmp(evt->header_key, "Last-Modified") == 0) {
+            copy_header(response->last_modified, sizeof(response->last_modified), evt->header_value);
+        }
+    } else if (evt->event_id == HTTP_EVENT_ON_DATA && response->on_data != NULL) {
+        response->on_data((const char*)evt->data, evt->data_len, response->data_ctx);
+        response->length += evt->data_len;
+    } else if (evt->event_id == HTTP_EVENT_ON_DATA) {
+        size_t room = response->buffer_size - 1 - response->length;
+        size_t len = evt->data_len;
+        if (len > room) {
+            if (!response->truncated) {
+                ESP_LOGW(TAG, "Response buffer full, truncating data");
+            }
+            response->truncated = true;
+            len = room;
+        }
+        memcpy(response->buffer + response->length, evt->data, len);
+        response->length += len;
+    }
+}
+
+static esp_err_t http_event_handler(esp_http_client_event_t *evt) {
+    http_worker_t *worker = (http_worker_t*)evt->user_data;
+    xSemaphoreTake(worker_lock, portMAX_DELAY);
+    if (worker->request != NULL) {
+        handle_event(evt, worker->request);
+    }
+    xSemaphoreGive(worker_lock);
+    return ESP_OK;
+}
+
+// TLS trust (CONFIG_QUOTE_TLS_TRUST_*): roots pinned per host in the
+// generated trust_store.c, or the certificate bundle. esp-tls calls
+// trust_attach() in the worker task that sets up the connection, so the
+// host's settings are looked up by the worker.
+#define HTTP_TRUST_MAX_HOSTS 4
+
+static const trust_host_t* worker_trust(void);
+
+// ECDHE-ECDSA first: P-256 signatures are much cheaper to verify and
+// handshake messages smaller than with RSA certificates
+static const int suites_ecdsa[] = {
+    MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256,
+    MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_256_GCM_SHA384,
+    0,
+};
+static const int suites_ecdsa_first[] = {
+    MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256,
+    MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_256_GCM_SHA384,
+    MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256,
+    MBEDTLS_TLS_ECDHE_RSA_WITH_AES_256_GCM_SHA384,
+    0,
+};
+
+static const trust_host_t* trust_find(const char* url) {
+    const char* host = strstr(url, "://");
+    host = host != NULL ? host + 3 : url;
+    size_t len = strcspn(host, ":/");
+    for (size_t i = 0; i < trust_store_host_count; i++) {
+        if (strlen(trust_store_hosts[i].host) == len && strncmp(trust_store_hosts[i].host, host, len) == 0) {
+            return &trust_store_hosts[i];
+        }
+    }
+    return NULL;
+}
+
+#if CONFIG_QUOTE_TLS_TRUST_PINNED_CA
+// Parsed once per wake, by the racing task before the workers start; the
+// certificates stay in flash (nocopy)
+static mbedtls_x509_crt ca_chains[HTTP_TRUST_MAX_HOSTS];
+static bool ca_parsed[HTTP_TRUST_MAX_HOSTS];
+
+static mbedtls_x509_crt* ca_chain(const trust_host_t* trust) {
+    size_t index = trust - trust_store_hosts;
+    if (index >= HTTP_TRUST_MAX_HOSTS) {
+        ESP_LOGE(TAG, "Trust store has more than %d hosts", HTTP_TRUST_MAX_HOSTS);
+        return NULL;
+    }
+    if (!ca_parsed[index]) {
+        mbedtls_x509_crt_init(&ca_chains[index]);
+        for (int i = 0; i < trust->anchor_count; i++) {
+            const trust_anchor_t* anchor = trust->anchors[i];
+            int ret = mbedtls_x509_crt_parse_der_nocopy(&ca_chains[index], anchor->der, anchor->der_len);
+            if (ret != 0) {
+                ESP_LOGE(TAG, "Cannot parse pinned root %s: -0x%04x", anchor->name, -ret);
+            }
+        }
+        ca_parsed[index] = true;
+    }
+    return &ca_chains[index];
+}
+
+static void trust_release(void) {
+    for (int i = 0; i < HTTP_TRUST_MAX_HOSTS; i++) {
+        if (ca_parsed[i]) {
+            mbedtls_x509_crt_free(&ca_chains[i]);
+            ca_parsed[i] = false;
+        }
+    }
+}
+#elif CONFIG_QUOTE_TLS_TRUST_PINNED_KEY
+// mbedtls needs a CA chain to verify at all; the pinned keys are checked in
+// the verify callback instead (as esp_crt_bundle does with its own table)
+static mbedtls_x509_crt empty_chain;
+
+static bool signed_by_key(const mbedtls_x509_crt* crt, const trust_anchor_t* anchor) {
+    mbedtls_pk_context key;
+    mbedtls_pk_init(&key);
+    bool ok = false;
+    if (mbedtls_pk_parse_public_key(&key, anchor->key, anchor->key_len) == 0 &&
+        mbedtls_pk_can_do(&key, crt->MBEDTLS_PRIVATE(sig_pk))) {
+        const mbedtls_md_info_t* md = mbedtls_md_info_from_type(crt->MBEDTLS_PRIVATE(sig_md));
+        unsigned char hash[MBEDTLS_MD_MAX_SIZE];
+        ok = md != NULL && mbedtls_md(md, crt->tbs.p, crt->tbs.len, hash) == 0 &&
+             mbedtls_pk_verify_ext(crt->MBEDTLS_PRIVATE(sig_pk), crt->MBEDTLS_PRIVATE(sig_opts), &key,
+                                   crt->MBEDTLS_PRIVATE(sig_md), hash, mbedtls_md_get_size(md),
+                                   crt->MBEDTLS_PRIVATE(sig).p, crt->MBEDTLS_PRIVATE(sig).len) == 0;
+    }
+    mbedtls_pk_free(&key);
+    return ok;
+}
+
+// Called for each certificate of the verified chain. Only its top lacks a
+// trusted issuer: accept it if it carries a pinned key (a root or a cross-
+// signed root sent by the server) or is signed by one
+static int verify_pinned_key(void* ctx, mbedtls_x509_crt* crt, int depth, uint32_t* flags) {
+    const trust_host_t* trust = (const trust_host_t*)ctx;
+    if ((*flags & MBEDTLS_X509_BADCERT_NOT_TRUSTED) == 0) {
+        return 0;
+    }
+
+    uint8_t digest[32];
+    mbedtls_sha256(crt->pk_raw.p, crt->pk_raw.len, digest, 0);
+    for (int i = 0; i < trust->anchor_count; i++) {
+        if (memcmp(digest, trust->anchors[i]->key_sha256, sizeof(digest)) == 0 ||
+            signed_by_key(crt, trust->anchors[i])) {
+            ESP_LOGD(TAG, "Chain anchored at pinned key of %s", trust->anchors[i]->name);
+            *flags &= ~MBEDTLS_X509_BADCERT_NOT_TRUSTED;
+            return 0;
+        }
+    }
+    return 0;
+}
+
+static void trust_release(void) {
+}
+#else
+static void trust_release(void) {
+}
+#endif
+
+static esp_err_t trust_attach(void* conf_ptr) {
+    mbedtls_ssl_config* conf = (mbedtls_ssl_config*)conf_ptr;
+    const trust_host_t* trust = worker_trust();
+
+#if CONFIG_QUOTE_TLS_TRUST_BUNDLE
+    if (trust != NULL) {
+        mbedtls_ssl_conf_ciphersuites(conf, trust->suites == TRUST_SUITES_ECDSA ? suites_ecdsa : suites_ecdsa_first);
+    }
+    return esp_crt_bundle_attach(conf);
+#else
+    if (trust == NULL) {
+        // No CA chain is configured, so the handshake fails
+        ESP_LOGE(TAG, "No pinned roots for this host (main/certs/trust_store.txt)");
+        return ESP_ERR_NOT_FOUND;
+    }
+    mbedtls_ssl_conf_ciphersuites(conf, trust->suites == TRUST_SUITES_ECDSA ? suites_ecdsa : suites_ecdsa_first);
+#if CONFIG_QUOTE_TLS_TRUST_PINNED_CA
+    size_t index = trust - trust_store_hosts;
+    if (index >= HTTP_TRUST_MAX_HOSTS || !ca_parsed[index]) {
+        return ESP_FAIL;
+    }
+    mbedtls_ssl_conf_ca_chain(conf, &ca_chains[index], NULL);
+#else
+    mbedtls_ssl_conf_ca_chain(conf, &empty_chain, NULL);
+    mbedtls_ssl_conf_verify(conf, verify_pinned_key, (void*)trust);
+#endif
+    return ESP_OK;
+#endif
+}
+
+static void reset_response(hal_http_response_t* response) {
+    response->length = 0;
+    response->status = 0;
+    response->truncated = false;
+    response->etag[0] = '\0';
+    response->last_modified[0] = '\0';
+    if (response->on_data == NULL) {
+        response->buffer[0] = '\0';
+    }
+}
+
+static void terminate_body(hal_http_response_t* response) {
+    if (response->on_data == NULL) {
+        response->buffer[response->length] = '\0';
+    }
+}
+
+// TLS sessions racing at once; each costs a handshake and ~40 KB of heap
+#define HTTP_MAX_RACE 4
+#define HTTP_WORKER_WAIT_MS 10    // Retry interval while every worker is still busy
+#define HTTP_DRAIN_MS 2000        // hal_http_close_idle() waits this long for abandoned requests
+#define HTTP_ORIGIN_SIZE 96       // "https://host:port"
+#define HTTP_URL_SIZE 512
+#define HTTP_HOST_SIZE 64
+#define HTTP_NAME_SLOTS 8
+
+// Idle clients with their connection still open, one per origin
+typedef struct {
+    char origin[HTTP_ORIGIN_SIZE];
+    esp_http_client_handle_t client;
+    bool by_addr;             // Created to connect to request->addr (common name set)
+    int64_t idle_since_us;
+} idle_client_t;
+
+static idle_client_t pool[HAL_HTTP_POOL_SIZE];
+static hal_http_stats_t stats;
+
+static http_worker_t workers[HTTP_MAX_RACE];
+static EventGroupHandle_t worker_events = NULL;
+#define WORKER_BIT(n) ((EventBits_t)1 << (n))  // Worker n is done
+#define WORKER_BITS (WORKER_BIT(HTTP_MAX_RACE) - 1)
+
+// URLs with the host replaced by request->addr, per worker
+static char connect_urls[HTTP_MAX_RACE][HTTP_URL_SIZE];
+// Host names of clients connecting to an address: esp-tls keeps the common
+// name pointer for the client's lifetime, so the names are kept here
+static char names[HTTP_NAME_SLOTS][HTTP_HOST_SIZE];
+
+static const trust_host_t* worker_trust(void) {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    for (int i = 0; i < HTTP_MAX_RACE; i++) {
+        if (workers[i].state == WORKER_RUNNING && workers[i].task == self) {
+            return workers[i].trust;
+        }
+    }
+    return NULL;
+}
+
+// Length of the scheme, host and port part of a URL
+static size_t origin_length(const char* url) {
+    const char* host = strstr(url, "://");
+    host = host != NULL ? host + 3 : url;
+    const char* path = strchr(host, '/');
+    return path != NULL ? (size_t)(path - url) : strlen(url);
+}
+
+static esp_http_client_handle_t pool_take(const char* url, bool* by_addr) {
+    size_t len = origin_length(url);
+    for (int i = 0; i < HAL_HTTP_POOL_SIZE; i++) {
+        if (pool[i].client != NULL && strlen(pool[i].origin) == len &&
+            strncmp(pool[i].origin, url, len) == 0) {
+            esp_http_client_handle_t client = pool[i].client;
+            pool[i].client = NULL;
+            *by_addr = pool[i].by_addr;
+            return client;
+        }
+    }
+    return NULL;
+}
+
+// Keep a client whose response was read completely; the longest idle one
+// makes room if the pool is full
+static void pool_put(const char* url, esp_http_client_handle_t client, bool by_addr) {
+    size_t len = origin_length(url);
+    if (len >= HTTP_ORIGIN_SIZE) {
+        esp_http_client_cleanup(client);
+        return;
+    }
+
+    int slot = 0;
+    for (int i = 0; i < HAL_HTTP_POOL_SIZE; i++) {
+        if (pool[i].client == NULL) {
+            slot = i;
+            break;
+        }
+        if (pool[i].idle_since_us < pool[slot].idle_since_us) {
+            slot = i;
+        }
+    }
+    if (pool[slot].client != NULL) {
+        esp_http_client_cleanup(pool[slot].client);
+    }
+    snprintf(pool[slot].origin, sizeof(pool[slot].origin), "%.*s", (int)len, url);
+    pool[slot].client = client;
+    pool[slot].by_addr = by_addr;
+    pool[slot].idle_since_us = esp_timer_get_time();
+}
+
+static bool workers_idle(void) {
+    bool idle = true;
+    xSemaphoreTake(worker_lock, portMAX_DELAY);
+    for (int i = 0; i < HTTP_MAX_RACE; i++) {
+        idle &= workers[i].state == WORKER_IDLE;
+    }
+    xSemaphoreGive(worker_lock);
+    return idle;
+}
+
+void hal_http_close_idle(void) {
+    for (int i = 0; i < HAL_HTTP_POOL_SIZE; i++) {
+        if (pool[i].client != NULL) {
+            esp_http_client_cleanup(pool[i].client);
+            pool[i].client = NULL;
+        }
+    }
+
+    // Requests abandoned by a race may still be connecting with the roots
+    if (worker_lock != NULL) {
+        int64_t start_us = esp_timer_get_time();
+        while (!workers_idle()) {
+            if (esp_timer_get_time() - start_us > (int64_t)HTTP_DRAIN_MS * 1000) {
+                ESP_LOGW(TAG, "Abandoned requests still running, keeping the parsed roots");
+                return;
+            }
+            vTaskDelay(pdMS_TO_TICKS(HTTP_WORKER_WAIT_MS));
+        }
+    }
+    trust_release();  // No connection refers to the parsed roots any more
+}
+
+void hal_http_get_stats(hal_http_stats_t* out) {
+    *out = stats;
+}
+
+static void set_validators(esp_http_client_handle_t client, const hal_http_request_t* request) {
+    esp_http_client_delete_header(client, "If-None-Match");
+    esp_http_client_delete_header(client, "If-Modified-Since");
+    if (request->if_none_match != NULL && request->if_none_match[0] != '\0') {
+        esp_http_client_set_header(client, "If-None-Match", request->if_none_match);
+    }
+    if (request->if_modified_since != NULL && request->if_modified_since[0] != '\0') {
+        esp_http_client_set_header(client, "If-Modified-Since", request->if_modified_since);
+    }
+}
+
+static const char* intern_name(const char* host, size_t len) {
+    for (int i = 0; i < HTTP_NAME_SLOTS; i++) {
+        if (names[i][0] == '\0') {
+            if (len >= sizeof(names[i])) {
+                return NULL;
+            }
+            memcpy(names[i], host, len);
+            names[i][len] = '\0';
+            return names[i];
+        }
+        if (strlen(names[i]) == len && strncmp(names[i], host, len) == 0) {
+            return names[i];
+        }
+    }
+    return NULL;
+}
+
+// An idle client for the same origin is reused with its connection.
+//
+// With request->addr set the client connects to the address, so no lookup
+// happens; TLS (SNI, certificate name) and the Host header keep the name.
+// A kept-alive client made by name stays on its connection instead.
+static esp_http_client_handle_t start_request(hal_http_request_t* request, int slot, int timeout_ms,
+                                              bool* by_addr) {
+    bool pooled_by_addr = false;
+    esp_http_client_handle_t client = pool_take(request->url, &pooled_by_addr);
+    request->reused = client != NULL;
+
+    const char* url = request->url;
+    const char* host = strstr(url, "://");
+    host = host != NULL ? host + 3 : url;
+    size_t host_len = strcspn(host, ":/?#");
+    const char* name = NULL;
+    if (request->addr != 0 && (client == NULL || pooled_by_addr)) {
+        const uint8_t* a = (const uint8_t*)&request->addr;
+        int len = snprintf(connect_urls[slot], sizeof(connect_urls[slot]), "%.*s%u.%u.%u.%u%s",
+                           (int)(host - url), url, a[0], a[1], a[2], a[3], host + host_len);
+        name = intern_name(host, host_len);
+        if (name != NULL && len < (int)sizeof(connect_urls[slot])) {
+            url = connect_urls[slot];
+        } else {
+            name = NULL;
+        }
+    }
+    *by_addr = name != NULL || (client != NULL && pooled_by_addr);
+
+    if (client != NULL) {
+        esp_http_client_set_url(client, url);
+        esp_http_client_set_timeout_ms(client, timeout_ms);
+        esp_http_client_set_user_data(client, &workers[slot]);
+    } else {
+        esp_http_client_config_t config = {
+            .url = url,
+            .event_handler = http_event_handler,
+            .user_data = &workers[slot],
+            .timeout_ms = timeout_ms,
+            .buffer_size = 2048,
+            .crt_bundle_attach = trust_attach,
+            .common_name = name,
+        };
+        client = esp_http_client_init(&config);
+    }
+    if (client != NULL) {
+        set_validators(client, request);
+        if (name != NULL) {
+            char authority[HTTP_HOST_SIZE + 8];
+            snprintf(authority, sizeof(authority), "%.*s", (int)strcspn(host, "/?#"), host);
+            esp_http_client_set_header(client, "Host", authority);
+        }
+    }
+    return client;
+}
+
+static void count_request(const hal_http_request_t* request) {
+    stats.requests++;
+    stats.reused += request->reused;
+    stats.total_ms += (uint32_t)request->elapsed_ms;
+    if ((uint32_t)request->elapsed_ms > stats.max_ms) {
+        stats.max_ms = (uint32_t)request->elapsed_ms;
+    }
+}
+
+// One blocking GET (connect, TLS, headers, body) per task, so a slow
+// response holds up only its own request. A request the race gave up on
+// finishes here, bounded by its client timeout, and closes its connection.
+static void http_worker_task(void* arg) {
+    http_worker_t* worker = (http_worker_t*)arg;
+    esp_err_t err = esp_http_client_perform(worker->client);
+    int status = err == ESP_OK ? esp_http_client_get_status_code(worker->client) : 0;
+    uint32_t stack_free = uxTaskGetStackHighWaterMark(NULL);
+
+    xSemaphoreTake(worker_lock, portMAX_DELAY);
+    if (stats.stack_free_min == 0 || stack_free < stats.stack_free_min) {
+        stats.stack_free_min = stack_free;
+    }
+    worker->err = err;
+    worker->status = status;
+    bool abandoned = worker->request == NULL;
+    if (!abandoned) {
+        worker->state = WORKER_DONE;
+        xEventGroupSetBits(worker_events, WORKER_BIT(worker - workers));
+    }
+    xSemaphoreGive(worker_lock);
+
+    if (abandoned) {
+        esp_http_client_cleanup(worker->client);
+        xSemaphoreTake(worker_lock, portMAX_DELAY);
+        worker->client = NULL;
+        worker->state = WORKER_IDLE;
+        xSemaphoreGive(worker_lock);
+    }
+    vTaskDelete(NULL);
+}
+
+static bool workers_init(void) {
+    if (worker_lock == NULL) {
+        worker_lock = xSemaphoreCreateMutex();
+    }
+    if (worker_events == NULL) {
+        worker_events = xEventGroupCreate();
+    }
+    return worker_lock != NULL && worker_events != NULL;
+}
+
+static int worker_free_slot(void) {
+    int slot = -1;
+    xSemaphoreTake(worker_lock, portMAX_DELAY);
+    for (int i = 0; i < HTTP_MAX_RACE && slot < 0; i++) {
+        if (workers[i].state == WORKER_IDLE) {
+            slot = i;
+        }
+    }
+    xSemaphoreGive(worker_lock);
+    return slot;
+}
+
+static bool worker_start(int slot, hal_http_request_t* request, const trust_host_t* trust, int timeout_ms) {
+    http_worker_t* worker = &workers[slot];
+    worker->client = start_request(request, slot, timeout_ms, &worker->by_addr);
+    if (worker->client == NULL) {
+        ESP_LOGE(TAG, "Failed to initialize HTTP client");
+        return false;
+    }
+    worker->trust = trust;
+    worker->request = request;
+    worker->state = WORKER_RUNNING;  // Before the task: trust_attach() looks it up
+    if (xTaskCreate(http_worker_task, "http_get", HAL_HTTP_TASK_STACK_SIZE, worker,
+                    uxTaskPriorityGet(NULL), &worker->task) != pdPASS) {
+        ESP_LOGE(TAG, "No memory for the request task");
+        esp_http_client_cleanup(worker->client);
+        xSemaphoreTake(worker_lock, portMAX_DELAY);
+        worker->client = NULL;
+        worker->request = NULL;
+        worker->state = WORKER_IDLE;
+        xSemaphoreGive(worker_lock);
+        return false;
+    }
+    return true;
+}
+
+// Hand a finished worker's client to the pool (body read: connection
+// reusable) or close it; the worker is free again
+static void worker_collect(http_worker_t* worker, const char* url) {
+    if (worker->err == ESP_OK) {
+        pool_put(url, worker->client, worker->by_addr);
+    } else {
+        esp_http_client_cleanup(worker->client);
+    }
+    xSemaphoreTake(worker_lock, portMAX_DELAY);
+    worker->client = NULL;
+    worker->request = NULL;
+    worker->state = WORKER_IDLE;
+    xSemaphoreGive(worker_lock);
+}
+
+// Every request runs blocking in its own worker task, and this task waits
+// for completions, stagger starts and the deadline, whichever comes first.
+// Only this task touches the pool and the statistics.
+int hal_http_get_first(hal_http_request_t* requests, int count, int deadline_ms,
+                       hal_http_accept_cb_t accept, void* ctx) {
+    const trust_host_t* trust[HTTP_MAX_RACE];
+    int worker_of[HTTP_MAX_RACE];
+    int64_t started_us[HTTP_MAX_RACE] = {0};
+
+    if (count > HTTP_MAX_RACE) {
+        ESP_LOGW(TAG, "Racing only the first %d of %d requests", HTTP_MAX_RACE, count);
+        count = HTTP_MAX_RACE;
+    }
+    bool ready = workers_init();
+    for (int i = 0; i < count; i++) {
+        reset_response(&requests[i].response);
+        requests[i].result = ready ? ESP_ERR_NOT_FINISHED : ESP_ERR_NO_MEM;
+        requests[i].elapsed_ms = 0;
+        requests[i].reused = false;
+        trust[i] = trust_find(requests[i].url);
+        worker_of[i] = -1;
+#if CONFIG_QUOTE_TLS_TRUST_PINNED_CA
+        if (trust[i] != NULL) {
+            ca_chain(trust[i]);  // Parsed here, read by the workers
+        }
+#endif
+    }
+    if (!ready) {
+        ESP_LOGE(TAG, "No memory for the request workers");
+        return -1;
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    int winner = -1;
+    int finished = 0;
+    xEventGroupClearBits(worker_events, WORKER_BITS);
+
+    while (winner < 0 && finished < count) {
+        int elapsed_ms = (int)((esp_timer_get_time() - start_us) / 1000);
+        if (elapsed_ms >= deadline_ms) {
+            break;
+        }
+
+        int running = 0;
+        for (int i = 0; i < count; i++) {
+            running += worker_of[i] >= 0 && requests[i].result == ESP_ERR_NOT_FINISHED;
+        }
+
+        // Staggered starts, or at once when nothing else is in flight
+        int wake_ms = deadline_ms;
+        for (int i = 0; i < count; i++) {
+            hal_http_request_t* request = &requests[i];
+            if (request->result != ESP_ERR_NOT_FINISHED || worker_of[i] >= 0) {
+                continue;
+            }
+            if (elapsed_ms < request->start_delay_ms && running > 0) {
+                wake_ms = request->start_delay_ms < wake_ms ? request->start_delay_ms : wake_ms;
+                continue;
+            }
+            int slot = worker_free_slot();
+            if (slot < 0) {
+                // Abandoned requests of an earlier race are still finishing
+                wake_ms = elapsed_ms + HTTP_WORKER_WAIT_MS < wake_ms ? elapsed_ms + HTTP_WORKER_WAIT_MS : wake_ms;
+                continue;
+            }
+            if (!worker_start(slot, request, trust[i], deadline_ms - elapsed_ms)) {
+                request->result = ESP_FAIL;
+                finished++;
+                continue;
+            }
+            worker_of[i] = slot;
+            started_us[i] = esp_timer_get_time();
+            running++;
+        }
+        if (finished >= count) {
+            break;
+        }
+
+        int wait_ms = wake_ms - elapsed_ms;
+        EventBits_t done = xEventGroupWaitBits(worker_events, WORKER_BITS, pdTRUE, pdFALSE,
+                                               pdMS_TO_TICKS(wait_ms > 0 ? wait_ms : 1));
+
+        // Offer completions to accept() in the order of the requests
+        for (int i = 0; i < count && winner < 0; i++) {
+            if (worker_of[i] < 0 || requests[i].result != ESP_ERR_NOT_FINISHED ||
+                (done & WORKER_BIT(worker_of[i])) == 0) {
+                continue;
+            }
+            hal_http_request_t* request = &requests[i];
+            http_worker_t* worker = &workers[worker_of[i]];
+            request->response.status = worker->status;
+            request->result = worker->err;
+            if (worker->err != ESP_OK) {
+                ESP_LOGE(TAG, "HTTP GET %s failed: %s", request->url, esp_err_to_name(worker->err));
+            }
+            worker_collect(worker, request->url);
+            terminate_body(&request->response);
+            request->elapsed_ms = (int)((esp_timer_get_time() - started_us[i]) / 1000);
+            count_request(request);
+            finished++;
+
+            if (accept(i, request, ctx)) {
+                winner = i;
+            }
+        }
+    }
+
+    // Still running: abandoned, the worker closes the connection when it
+    // ends. Done but not offered: the response was read, keep the connection.
+    for (int i = 0; i < count; i++) {
+        if (worker_of[i] < 0 || requests[i].result != ESP_ERR_NOT_FINISHED) {
+            continue;
+        }
+        http_worker_t* worker = &workers[worker_of[i]];
+        xSemaphoreTake(worker_lock, portMAX_DELAY);
+        bool done = worker->state == WORKER_DONE;
+        if (!done) {
+            worker->request = NULL;
+        }
+        xSemaphoreGive(worker_lock);
+        if (done) {
+            worker_collect(worker, requests[i].url);
+        }
+    }
+    return winner;
+}
+
+static bool accept_any(int index, hal_http_request_t* request, void* ctx) {
+    return true;
+}
+
+esp_err_t hal_http_get(const char* url, int timeout_ms, hal_http_response_t* response) {
+    hal_http_request_t request = {.url = url, .response = *response};
+    hal_http_get_first(&request, 1, timeout_ms, accept_any, NULL);
+    *response = request.response;
+    return request.result == ESP_ERR_NOT_FINISHED ? ESP_ERR_TIMEOUT : request.result;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <esp_err.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Heap regions
+ */
+typedef enum {
+    HAL_MEM_INTERNAL,    // Internal DRAM (WiFi, TLS, stacks, DMA)
+    HAL_MEM_SPIRAM,      // External PSRAM (framebuffer, large buffers)
+    HAL_MEM_REGION_COUNT,
+} hal_mem_region_t;
+
+/**
+ * State of one heap region, in bytes
+ */
+typedef struct {
+    uint32_t total;
+    uint32_t free;
+    uint32_t min_free;       // Lowest free since boot (high-water mark of use)
+    uint32_t largest_free;   // Largest block that can be allocated now
+} hal_mem_heap_t;
+
+/**
+ * Measure a heap region
+ *
+ * @param region Region
+ * @param heap Filled on success
+ * @return ESP_OK, or ESP_ERR_NOT_SUPPORTED if the region does not exist or
+ *         cannot be measured (host)
+ */
+esp_err_t hal_mem_heap(hal_mem_region_t region, hal_mem_heap_t* heap);
+
+/**
+ * Stack of a running task that was never used since it started
+ *
+ * @param name Task name ("main", "conn_setup", "httpd", ...)
+ * @param free_min Bytes out
+ * @return ESP_OK, or ESP_ERR_NOT_FOUND if no such task runs (or on the host)
+ */
+esp_err_t hal_mem_task_stack(const char* name, uint32_t* free_min);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,33 @@
+#include "hal_mem.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const uint32_t region_caps[HAL_MEM_REGION_COUNT] = {
+    [HAL_MEM_INTERNAL] = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT,
+    [HAL_MEM_SPIRAM] = MALLOC_CAP_SPIRAM,
+};
+
+esp_err_t hal_mem_heap(hal_mem_region_t region, hal_mem_heap_t* heap) {
+    if (region >= HAL_MEM_REGION_COUNT) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    uint32_t caps = region_caps[region];
+    heap->total = heap_caps_get_total_size(caps);
+    if (heap->total == 0) {
+        return ESP_ERR_NOT_SUPPORTED;  // No PSRAM found at boot
+    }
+    heap->free = heap_caps_get_free_size(caps);
+    heap->min_free = heap_caps_get_minimum_free_size(caps);
+    heap->largest_free = heap_caps_get_largest_free_block(caps);
+    return ESP_OK;
+}
+
+esp_err_t hal_mem_task_stack(const char* name, uint32_t* free_min) {
+    TaskHandle_t task = xTaskGetHandle(name);
+    if (task == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    *free_min = uxTaskGetStackHighWaterMark(task);  // Bytes: stacks are sized in bytes on ESP-IDF
+    return ESP_OK;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <esp_err.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "nvs.h"  // ESP_ERR_NVS_* codes
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Key-value storage, one call per value
+ * Writes and erases commit immediately. Missing namespaces and keys
+ * return ESP_ERR_NVS_NOT_FOUND on both backends.
+ */
+
+/**
+ * Read a blob
+ *
+ * @param ns Namespace
+ * @param key Key
+ * @param out Destination buffer
+ * @param length In: buffer size, out: stored size
+ * @return ESP_OK, ESP_ERR_NVS_NOT_FOUND, or ESP_ERR_NVS_INVALID_LENGTH if the buffer is too small
+ */
+esp_err_t hal_nvs_get_blob(const char* ns, const char* key, void* out, size_t* length);
+
+/**
+ * Write and commit a blob
+ *
+ * @param ns Namespace
+ * @param key Key
+ * @param data Blob contents
+ * @param length Blob size in bytes
+ * @return ESP_OK on success
+ */
+esp_err_t hal_nvs_set_blob(const char* ns, const char* key, const void* data, size_t length);
+
+/**
+ * Read a NUL-terminated string
+ *
+ * @param ns Namespace
+ * @param key Key
+ * @param out Destination buffer
+ * @param length In: buffer size, out: stored size including terminator
+ * @return ESP_OK, ESP_ERR_NVS_NOT_FOUND, or ESP_ERR_NVS_INVALID_LENGTH
+ */
+esp_err_t hal_nvs_get_str(const char* ns, const char* key, char* out, size_t* length);
+
+/**
+ * Write and commit a string
+ *
+ * @param ns Namespace
+ * @param key Key
+ * @param value NUL-terminated string
+ * @return ESP_OK on success
+ */
+esp_err_t hal_nvs_set_str(const char* ns, const char* key, const char* value);
+
+/**
+ * Read a 32-bit unsigned value
+ *
+ * @param ns Namespace
+ * @param key Key
+ * @param out Value
+ * @return ESP_OK or ESP_ERR_NVS_NOT_FOUND
+ */
+esp_err_t hal_nvs_get_u32(const char* ns, const char* key, uint32_t* out);
+
+/**
+ * Erase a key and commit
+ *
+ * @param ns Namespace
+ * @param key Key
+ * @return ESP_OK, or ESP_ERR_NVS_NOT_FOUND if the key did not exist
+ */
+esp_err_t hal_nvs_erase_key(const char* ns, const char* key);
+
+/**
+ * Commits by hal_nvs_set_*() and hal_nvs_erase_key() since boot (a deep
+ * sleep wake is a boot), for the flash wear accounting of all modules
+ *
+ * @return Successful commits
+ */
+uint32_t hal_nvs_commits(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,98 @@
+#include "hal_nvs.h"
+#include "nvs_flash.h"
+
+static uint32_t commits = 0;  // Since boot
+
+esp_err_t hal_nvs_get_blob(const char* ns, const char* key, void* out, size_t* length) {
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(ns, NVS_READONLY, &nvs_handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    err = nvs_get_blob(nvs_handle, key, out, length);
+    nvs_close(nvs_handle);
+    return err;
+}
+
+esp_err_t hal_nvs_set_blob(const char* ns, const char* key, const void* data, size_t length) {
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(ns, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    err = nvs_set_blob(nvs_handle, key, data, length);
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs_handle);
+    }
+    if (err == ESP_OK) {
+        commits++;
+    }
+    nvs_close(nvs_handle);
+    return err;
+}
+
+esp_err_t hal_nvs_get_str(const char* ns, const char* key, char* out, size_t* length) {
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(ns, NVS_READONLY, &nvs_handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    err = nvs_get_str(nvs_handle, key, out, length);
+    nvs_close(nvs_handle);
+    return err;
+}
+
+esp_err_t hal_nvs_set_str(const char* ns, const char* key, const char* value) {
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(ns, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    err = nvs_set_str(nvs_handle, key, value);
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs_handle);
+    }
+    if (err == ESP_OK) {
+        commits++;
+    }
+    nvs_close(nvs_handle);
+    return err;
+}
+
+esp_err_t hal_nvs_get_u32(const char* ns, const char* key, uint32_t* out) {
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(ns, NVS_READONLY, &nvs_handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    err = nvs_get_u32(nvs_handle, key, out);
+    nvs_close(nvs_handle);
+    return err;
+}
+
+esp_err_t hal_nvs_erase_key(const char* ns, const char* key) {
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(ns, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    err = nvs_erase_key(nvs_handle, key);
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs_handle);
+    }
+    if (err == ESP_OK) {
+        commits++;
+    }
+    nvs_close(nvs_handle);
+    return err;
+}
+
+uint32_t hal_nvs_commits(void) {
+    return commits;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HAL_OTA_NAME_SIZE 32          // esp_app_desc_t version and project_name
+
+/**
+ * Identity of a firmware image, from its app descriptor
+ */
+typedef struct {
+    char version[HAL_OTA_NAME_SIZE];  // PROJECT_VER
+    char project[HAL_OTA_NAME_SIZE];  // CMake project name
+} hal_ota_app_t;
+
+/**
+ * Start writing an image into the app slot that is not running
+ * Flash is erased sector by sector as the image is written, so nothing is
+ * buffered and nothing is erased before the first write
+ *
+ * @param image_size Total size in bytes
+ * @return ESP_OK, ESP_ERR_INVALID_SIZE if it does not fit the slot,
+ *         ESP_ERR_INVALID_STATE if a write is already open
+ */
+esp_err_t hal_ota_begin(size_t image_size);
+
+/**
+ * Append to the image opened by hal_ota_begin()
+ *
+ * @param data Next bytes of the image
+ * @param length Their count
+ * @return ESP_OK on success
+ */
+esp_err_t hal_ota_write(const void* data, size_t length);
+
+/**
+ * Close the image: checks that it is complete and valid (the device also
+ * verifies the SHA-256 the build appends)
+ *
+ * @param activate Boot the new image from the next boot on (a deep sleep
+ *                 wake is a boot); it then has to call hal_ota_confirm()
+ * @return ESP_OK, ESP_ERR_INVALID_CRC if the image failed validation
+ */
+esp_err_t hal_ota_end(bool activate);
+
+/**
+ * Drop an open image; the slot is left unbootable
+ */
+void hal_ota_abort(void);
+
+/**
+ * @return Size of an app slot: the largest image hal_ota_begin() takes
+ */
+size_t hal_ota_slot_size(void);
+
+/**
+ * @param app Running image out
+ */
+void hal_ota_running(hal_ota_app_t* app);
+
+/**
+ * Read from the running image: the base a patch is applied to
+ *
+ * @param offset Byte offset in the image
+ * @param data Destination
+ * @param length Bytes to read
+ * @return ESP_OK on success
+ */
+esp_err_t hal_ota_read_running(size_t offset, void* data, size_t length);
+
+/**
+ * SHA-256 of the running image (the digest the build appended to it), which
+ * names the base a patch was made against
+ *
+ * @param digest 32 bytes out
+ * @return ESP_OK, an error if the image cannot be read or fails its check
+ */
+esp_err_t hal_ota_running_sha256(uint8_t digest[32]);
+
+/**
+ * Boot the previous image from the next boot on (a deep sleep wake is a
+ * boot), without restarting and without marking the running image invalid:
+ * hal_ota_rejected() does not report it
+ *
+ * @return ESP_OK, ESP_ERR_NOT_FOUND or an error if the other slot holds no
+ *         valid image
+ */
+esp_err_t hal_ota_fall_back(void);
+
+/**
+ * Image that was rolled back because it did not confirm its first boot
+ *
+ * @param app Filled if there is one
+ * @return true if the last image written was rejected
+ */
+bool hal_ota_rejected(hal_ota_app_t* app);
+
+/**
+ * @return true on the first boot of a new image, until hal_ota_confirm()
+ */
+bool hal_ota_pending_verify(void);
+
+/**
+ * Settle a new image on its first boot
+ *
+ * @param valid true: keep it. false: mark it invalid and restart into the
+ *              previous image (does not return)
+ * @return ESP_OK on success
+ */
+esp_err_t hal_ota_confirm(bool valid);
+
+#ifdef __cplusplus
+}
+#endif
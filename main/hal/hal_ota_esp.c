@@ -0,0 +1,122 @@
+#include "hal_ota.h"
+#include "esp_ota_ops.h"
+#include "esp_app_desc.h"
+#include "esp_partition.h"
+#include "esp_log.h"
+#include <stdio.h>
+
+static const char *TAG = "HAL_OTA";
+
+static esp_ota_handle_t handle = 0;
+static const esp_partition_t* target = NULL;  // Slot being written
+
+static void copy_app(hal_ota_app_t* app, const esp_app_desc_t* desc) {
+    snprintf(app->version, sizeof(app->version), "%s", desc->version);
+    snprintf(app->project, sizeof(app->project), "%s", desc->project_name);
+}
+
+esp_err_t hal_ota_begin(size_t image_size) {
+    if (target != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    const esp_partition_t* slot = esp_ota_get_next_update_partition(NULL);
+    if (slot == NULL) {
+        ESP_LOGE(TAG, "No update slot (partition table without ota_0/ota_1)");
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (image_size > slot->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Sequential writes: each sector is erased when the image reaches it
+    esp_err_t err = esp_ota_begin(slot, OTA_WITH_SEQUENTIAL_WRITES, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "esp_ota_begin failed: %s", esp_err_to_name(err));
+        return err;
+    }
+    target = slot;
+    ESP_LOGI(TAG, "Writing %u bytes to %s at 0x%lx", (unsigned)image_size,
+             slot->label, (unsigned long)slot->address);
+    return ESP_OK;
+}
+
+esp_err_t hal_ota_write(const void* data, size_t length) {
+    if (target == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return esp_ota_write(handle, data, length);
+}
+
+esp_err_t hal_ota_end(bool activate) {
+    if (target == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    // Checks the segments and the SHA-256 appended to the image
+    esp_err_t err = esp_ota_end(handle);
+    const esp_partition_t* slot = target;
+    target = NULL;
+    if (err == ESP_ERR_OTA_VALIDATE_FAILED) {
+        return ESP_ERR_INVALID_CRC;
+    }
+    if (err == ESP_OK && activate) {
+        err = esp_ota_set_boot_partition(slot);
+    }
+    return err;
+}
+
+void hal_ota_abort(void) {
+    if (target != NULL) {
+        esp_ota_abort(handle);
+        target = NULL;
+    }
+}
+
+size_t hal_ota_slot_size(void) {
+    const esp_partition_t* slot = esp_ota_get_next_update_partition(NULL);
+    return slot != NULL ? slot->size : 0;
+}
+
+void hal_ota_running(hal_ota_app_t* app) {
+    copy_app(app, esp_app_get_description());
+}
+
+esp_err_t hal_ota_read_running(size_t offset, void* data, size_t length) {
+    return esp_partition_read(esp_ota_get_running_partition(), offset, data, length);
+}
+
+esp_err_t hal_ota_running_sha256(uint8_t digest[32]) {
+    // Verifies the image and returns the digest appended to it
+    return esp_partition_get_sha256(esp_ota_get_running_partition(), digest);
+}
+
+esp_err_t hal_ota_fall_back(void) {
+    // The other slot; esp_ota_set_boot_partition() verifies the image in it
+    const esp_partition_t* previous = esp_ota_get_next_update_partition(NULL);
+    if (previous == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    return esp_ota_set_boot_partition(previous);
+}
+
+bool hal_ota_rejected(hal_ota_app_t* app) {
+    const esp_partition_t* invalid = esp_ota_get_last_invalid_partition();
+    esp_app_desc_t desc;
+    if (invalid == NULL || esp_ota_get_partition_description(invalid, &desc) != ESP_OK) {
+        return false;
+    }
+    copy_app(app, &desc);
+    return true;
+}
+
+bool hal_ota_pending_verify(void) {
+    esp_ota_img_states_t state;
+    return esp_ota_get_state_partition(esp_ota_get_running_partition(), &state) == ESP_OK &&
+           state == ESP_OTA_IMG_PENDING_VERIFY;
+}
+
+esp_err_t hal_ota_confirm(bool valid) {
+    if (!valid) {
+        return esp_ota_mark_app_invalid_rollback_and_reboot();
+    }
+    return esp_ota_mark_app_valid_cancel_rollback();
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HAL_WAKE_BUTTON_GPIO 39       // Upper button - quote refresh (EXT0)
+#define HAL_RESET_BUTTON_GPIO 35      // Reset button - network reset (EXT1)
+
+/**
+ * Reason for the current boot
+ */
+typedef enum {
+    HAL_WAKE_COLD,           // Power-on or reset, not from deep sleep
+    HAL_WAKE_TIMER,          // Sleep timer expired
+    HAL_WAKE_BUTTON,         // Quote refresh button
+    HAL_WAKE_RESET_BUTTON,   // Network reset button
+} hal_wake_cause_t;
+
+/**
+ * Configure the wake button GPIOs as inputs
+ */
+void hal_sleep_init(void);
+
+/**
+ * @return Why the chip booted
+ */
+hal_wake_cause_t hal_sleep_wake_cause(void);
+
+/**
+ * Arm the timer and both button wake sources, then enter deep sleep
+ * Does not return; the next wake is a fresh boot with RTC memory kept
+ *
+ * @param sleep_seconds Timer wake delay
+ */
+void hal_sleep_enter(uint32_t sleep_seconds);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,43 @@
+#include "hal_sleep.h"
+#include "esp_sleep.h"
+#include "driver/gpio.h"
+#include "driver/rtc_io.h"
+
+void hal_sleep_init(void) {
+    // GPIO 39 and 35 are input-only with no internal pullups;
+    // the board has external pullups on both buttons
+    gpio_config_t io_conf = {
+        .pin_bit_mask = (1ULL << HAL_WAKE_BUTTON_GPIO) | (1ULL << HAL_RESET_BUTTON_GPIO),
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE,
+    };
+    gpio_config(&io_conf);
+}
+
+hal_wake_cause_t hal_sleep_wake_cause(void) {
+    switch (esp_sleep_get_wakeup_cause()) {
+        case ESP_SLEEP_WAKEUP_TIMER:
+            return HAL_WAKE_TIMER;
+        case ESP_SLEEP_WAKEUP_EXT0:
+            return HAL_WAKE_BUTTON;
+        case ESP_SLEEP_WAKEUP_EXT1:
+            return HAL_WAKE_RESET_BUTTON;
+        default:
+            return HAL_WAKE_COLD;
+    }
+}
+
+void hal_sleep_enter(uint32_t sleep_seconds) {
+    esp_sleep_enable_timer_wakeup((uint64_t)sleep_seconds * 1000000ULL);
+
+    // Both buttons are RTC GPIOs, active low
+    esp_sleep_enable_ext0_wakeup(HAL_WAKE_BUTTON_GPIO, 0);
+    esp_sleep_enable_ext1_wakeup(1ULL << HAL_RESET_BUTTON_GPIO, ESP_EXT1_WAKEUP_ALL_LOW);
+
+    // Isolate GPIO12 pin from external circuits to prevent current leakage
+    rtc_gpio_isolate(GPIO_NUM_12);
+
+    esp_deep_sleep_start();
+}
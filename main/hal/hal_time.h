@@ -0,0 +1,48 @@
+#pragma once
+
+#include <esp_err.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Monotonic time since boot
+ * ESP-IDF: esp_timer; host: virtual clock of the simulator
+ *
+ * @return Microseconds since boot
+ */
+int64_t hal_time_us(void);
+
+/**
+ * Block the calling task
+ * On the host this advances the virtual clock instead of sleeping
+ *
+ * @param ms Delay in milliseconds
+ */
+void hal_delay_ms(uint32_t ms);
+
+/**
+ * Current wall-clock time
+ * Counts from 1970 after a cold boot until hal_time_sync() succeeds;
+ * kept across deep sleep by the RTC
+ *
+ * @return Unix timestamp
+ */
+time_t hal_time_now(void);
+
+/**
+ * Set the timezone and synchronize the wall clock over SNTP (blocking)
+ *
+ * @param server NTP server hostname
+ * @param tz POSIX TZ string for localtime()
+ * @param timeout_ms Maximum time to wait for the first sync
+ * @return ESP_OK when synchronized, ESP_ERR_TIMEOUT otherwise
+ */
+esp_err_t hal_time_sync(const char* server, const char* tz, uint32_t timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
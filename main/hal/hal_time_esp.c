@@ -0,0 +1,51 @@
+#include "hal_time.h"
+#include "esp_log.h"
+#include "binlog.h"
+#include "esp_timer.h"
+#include "esp_sntp.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdlib.h>
+
+static const char *TAG = "HAL_TIME";
+
+int64_t hal_time_us(void) {
+    return esp_timer_get_time();
+}
+
+void hal_delay_ms(uint32_t ms) {
+    vTaskDelay(pdMS_TO_TICKS(ms));
+}
+
+time_t hal_time_now(void) {
+    return time(NULL);
+}
+
+esp_err_t hal_time_sync(const char* server, const char* tz, uint32_t timeout_ms) {
+    BINLOG_I(TAG, "Initializing SNTP...");
+
+    setenv("TZ", tz, 1);
+    tzset();
+
+    esp_sntp_setoperatingmode(SNTP_OPMODE_POLL);
+    esp_sntp_setservername(0, server);
+    esp_sntp_init();
+
+    BINLOG_I(TAG, "SNTP initialized, waiting for time sync...");
+
+    // Poll once per second until the first sync or timeout
+    int retry = 0;
+    const int retry_count = timeout_ms / 1000;
+    while (esp_sntp_get_sync_status() == SNTP_SYNC_STATUS_RESET && ++retry < retry_count) {
+        BINLOG_I(TAG, "Waiting for system time to be set... (%d/%d)", retry, retry_count);
+        vTaskDelay(pdMS_TO_TICKS(1000));
+    }
+
+    if (retry < retry_count) {
+        BINLOG_I(TAG, "Time synchronized successfully");
+        return ESP_OK;
+    }
+
+    ESP_LOGW(TAG, "Time sync timeout, using default time");
+    return ESP_ERR_TIMEOUT;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <esp_err.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Connect to an access point in station mode and wait for an IP (blocking)
+ * The netif, event loop and WiFi driver must already be initialized
+ * (wifi_manager_init() on the device)
+ *
+ * @param ssid Network name
+ * @param password Passphrase (empty for open networks)
+ * @param timeout_ms Maximum time to wait for an address
+ * @return ESP_OK once an IP is assigned, ESP_ERR_TIMEOUT or ESP_FAIL otherwise
+ */
+esp_err_t hal_wifi_connect(const char* ssid, const char* password, uint32_t timeout_ms);
+
+/**
+ * Signal strength of the current association
+ *
+ * @param rssi RSSI in dBm
+ * @return ESP_OK, or ESP_ERR_INVALID_STATE if not connected
+ */
+esp_err_t hal_wifi_get_rssi(int8_t* rssi);
+
+/**
+ * Station's IPv4 address as text
+ *
+ * @param ip Buffer of at least 16 bytes ("192.168.1.23")
+ * @param size Buffer size
+ * @return ESP_OK, or ESP_ERR_INVALID_STATE if there is no address
+ */
+esp_err_t hal_wifi_get_ip(char* ip, size_t size);
+
+/**
+ * Disconnect and stop the radio
+ */
+void hal_wifi_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
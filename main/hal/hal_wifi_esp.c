@@ -0,0 +1,91 @@
+#include "hal_wifi.h"
+#include "esp_wifi.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "HAL_WIFI";
+
+#define CONNECTED_BIT BIT0
+#define FAILED_BIT BIT1
+
+static EventGroupHandle_t connect_events = NULL;
+
+static void connect_event_handler(void* arg, esp_event_base_t event_base,
+                                  int32_t event_id, void* event_data) {
+    if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
+        xEventGroupSetBits(connect_events, CONNECTED_BIT);
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
+        xEventGroupSetBits(connect_events, FAILED_BIT);
+    }
+}
+
+esp_err_t hal_wifi_connect(const char* ssid, const char* password, uint32_t timeout_ms) {
+    if (connect_events == NULL) {
+        connect_events = xEventGroupCreate();
+    }
+    xEventGroupClearBits(connect_events, CONNECTED_BIT | FAILED_BIT);
+
+    wifi_config_t wifi_config = {0};
+    strlcpy((char*)wifi_config.sta.ssid, ssid, sizeof(wifi_config.sta.ssid));
+    strlcpy((char*)wifi_config.sta.password, password, sizeof(wifi_config.sta.password));
+
+    esp_event_handler_instance_t wifi_handler, ip_handler;
+    esp_event_handler_instance_register(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED,
+                                        &connect_event_handler, NULL, &wifi_handler);
+    esp_event_handler_instance_register(IP_EVENT, IP_EVENT_STA_GOT_IP,
+                                        &connect_event_handler, NULL, &ip_handler);
+
+    esp_err_t err = esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+    if (err == ESP_OK) {
+        err = esp_wifi_connect();
+    }
+
+    if (err == ESP_OK) {
+        EventBits_t bits = xEventGroupWaitBits(connect_events, CONNECTED_BIT | FAILED_BIT,
+                                               pdTRUE, pdFALSE, pdMS_TO_TICKS(timeout_ms));
+        if (bits & CONNECTED_BIT) {
+            err = ESP_OK;
+        } else if (bits & FAILED_BIT) {
+            err = ESP_FAIL;
+        } else {
+            err = ESP_ERR_TIMEOUT;
+        }
+    }
+
+    esp_event_handler_instance_unregister(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, wifi_handler);
+    esp_event_handler_instance_unregister(IP_EVENT, IP_EVENT_STA_GOT_IP, ip_handler);
+
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Connection to %s failed: %s", ssid, esp_err_to_name(err));
+    }
+    return err;
+}
+
+esp_err_t hal_wifi_get_rssi(int8_t* rssi) {
+    wifi_ap_record_t ap_info;
+    if (esp_wifi_sta_get_ap_info(&ap_info) != ESP_OK) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    *rssi = ap_info.rssi;
+    return ESP_OK;
+}
+
+esp_err_t hal_wifi_get_ip(char* ip, size_t size) {
+    esp_netif_ip_info_t ip_info;
+    esp_netif_t* sta_netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+    if (sta_netif == NULL || esp_netif_get_ip_info(sta_netif, &ip_info) != ESP_OK || ip_info.ip.addr == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    snprintf(ip, size, IPSTR, IP2STR(&ip_info.ip));
+    return ESP_OK;
+}
+
+void hal_wifi_stop(void) {
+    esp_wifi_disconnect();
+    esp_wifi_stop();
+}
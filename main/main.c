@@ -8,12 +8,18 @@
 #include "wifi_manager.h"
 #include "sleep_manager.h"
 #include "battery.h"
+#include "device_state.h"
+#include "binlog.h"
+#include "wake_budget.h"
+#include "maintenance.h"
+#include "mem_profile.h"
 #include "gerunds.h"
 #include "driver/gpio.h"
 
 static const char *TAG = "MAIN";
 
 #define RESET_BUTTON_GPIO GPIO_NUM_35
+#define REFRESH_BUTTON_GPIO GPIO_NUM_39
 #define RESET_TIMEOUT_MS 10000  // 10 seconds
 #define RESET_PRESS_COUNT 3     // Require 3 button presses
 
@@ -54,6 +60,19 @@ static bool wait_for_reset_confirmation(void) {
     return false;
 }
 
+// Refresh button still held after a button wake: a short press is released
+// before the boot gets here and costs nothing
+static bool refresh_button_held(void) {
+    TickType_t start_time = xTaskGetTickCount();
+    while (gpio_get_level(REFRESH_BUTTON_GPIO) == 0) {
+        if ((xTaskGetTickCount() - start_time) >= pdMS_TO_TICKS(MAINTENANCE_HOLD_MS)) {
+            return true;
+        }
+        vTaskDelay(pdMS_TO_TICKS(50));  // Poll every 50ms
+    }
+    return false;
+}
+
 void app_main(void) {
     ESP_LOGI(TAG, "Starting Lilygo T5-4.7 Quote Display");
 
@@ -67,7 +86,13 @@ void app_main(void) {
     ESP_ERROR_CHECK(ret);
     ESP_LOGI(TAG, "NVS initialized");
 
-    // Print last battery reading from NVS (useful for debugging on battery)
+    // Restore persistent state (RTC copy after deep sleep, NVS after power loss)
+    device_state_init();
+
+    // Binary log ring for hot-path messages (decoded with tools/binlog_decode.py)
+    binlog_init();
+
+    // Print last battery reading (useful for debugging on battery)
     battery_print_last_reading();
 
     // Initialize sleep manager
@@ -80,19 +105,37 @@ void app_main(void) {
 
     if (is_wakeup) {
         if (is_button_wake) {
-            ESP_LOGI(TAG, "Woke from button press - fetching new quote immediately");
+            BINLOG_I(TAG, "Woke from button press - fetching new quote immediately");
+            // Someone is at the device: print the ring of recent wakes and
+            // the memory sizing report
+            binlog_dump();
+            mem_profile_dump();
+            // Held down: stay reachable for a while after this wake
+            if (refresh_button_held()) {
+                maintenance_request(MAINTENANCE_WINDOW_MIN, "button");
+            }
         } else if (is_reset_button_wake) {
-            ESP_LOGI(TAG, "Woke from reset button press - network reset requested");
+            BINLOG_I(TAG, "Woke from reset button press - network reset requested");
         } else {
-            ESP_LOGI(TAG, "Woke from timer - time for periodic quote update");
+            BINLOG_I(TAG, "Woke from timer - time for periodic quote update");
         }
     } else {
         ESP_LOGI(TAG, "Cold boot - first run");
     }
 
+    // Timer and button wakes get a bounded awake time; a cold boot keeps
+    // the full retry path into provisioning (stages are still profiled)
+    wake_budget_start(is_wakeup && !is_reset_button_wake ? WAKE_BUDGET_MS : 0);
+
     // Initialize e-paper display
     display_init();
 
+    // Sample the battery on the first display refresh of this wake, while
+    // the EPD rail (which also feeds the battery divider) is already on
+    if (battery_init() == ESP_OK) {
+        display_set_power_hook(battery_display_power_hook);
+    }
+
     // Handle reset button wake - network configuration reset
     if (is_reset_button_wake) {
         ESP_LOGI(TAG, "Displaying reset confirmation message");
@@ -119,7 +162,7 @@ void app_main(void) {
     // Show loading screen if waking from sleep (button or timer, not reset)
     if (is_wakeup && !is_reset_button_wake) {
         const char* random_gerund = get_random_gerund();
-        ESP_LOGI(TAG, "Displaying loading screen with: %s", random_gerund);
+        BINLOG_I(TAG, "Displaying loading screen with: %s", random_gerund);
         display_loading(random_gerund);
     }
 
@@ -129,7 +172,7 @@ void app_main(void) {
     // Start WiFi manager (silent if waking from sleep)
     ESP_ERROR_CHECK(wifi_manager_start(is_wakeup));
 
-    ESP_LOGI(TAG, "Initialization complete, WiFi manager will handle connection and quote display");
+    BINLOG_I(TAG, "Initialization complete, WiFi manager will handle connection and quote display");
 
     // Main loop - WiFi manager handles everything via event callbacks
     // After quote is displayed, the connection_setup_task will enter deep sleep
@@ -0,0 +1,283 @@
+#include "maintenance.h"
+#include "battery.h"
+#include "battery_model.h"
+#include "device_state.h"
+#include "mem_profile.h"
+#include "quote_provider.h"
+#include "wake_budget.h"
+#include "wifi_networks.h"
+#include "hal_http.h"
+#include "hal_mem.h"
+#include "hal_ota.h"
+#include "hal_sleep.h"
+#include "hal_time.h"
+#include "hal_wifi.h"
+#include "rtc_budget.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "cJSON.h"
+#include <stddef.h>
+#include <string.h>
+
+static const char *TAG = "MAINTENANCE";
+
+#define REQUEST_MAGIC 0x4D4E5431    // "MNT1"
+
+/**
+ * A window asked for and not yet taken
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t minutes;                // 0 = none
+    uint32_t crc;
+} maintenance_request_t;
+RTC_BUDGET_CHECK(maintenance_request_t, RTC_BUDGET_MAINTENANCE);
+
+// Survives deep sleep; a power loss drops the request (caught by CRC)
+static RTC_NOINIT_ATTR maintenance_request_t request;
+
+static uint32_t window_ms = 0;       // This wake's window
+
+static uint32_t request_crc(void) {
+    return esp_rom_crc32_le(0, (const uint8_t*)&request, offsetof(maintenance_request_t, crc));
+}
+
+static bool request_valid(void) {
+    return request.magic == REQUEST_MAGIC && request.crc == request_crc();
+}
+
+void maintenance_request(uint32_t minutes, const char* reason) {
+    if (minutes > MAINTENANCE_MAX_MIN) {
+        minutes = MAINTENANCE_MAX_MIN;
+    }
+    request.magic = REQUEST_MAGIC;
+    request.minutes = minutes;
+    request.crc = request_crc();
+    ESP_LOGI(TAG, "Maintenance window of %lu min requested (%s)", (unsigned long)minutes, reason);
+}
+
+bool maintenance_take(float battery_percent) {
+    if (!request_valid() || request.minutes == 0) {
+        return false;
+    }
+    if (battery_percent >= 0 && battery_percent < MAINTENANCE_MIN_BATTERY) {
+        ESP_LOGW(TAG, "Maintenance postponed: battery %.0f%%", battery_percent);
+        return false;
+    }
+    window_ms = request.minutes * 60000;
+    request.minutes = 0;
+    request.crc = request_crc();
+    return true;
+}
+
+uint32_t maintenance_window_ms(void) {
+    return window_ms;
+}
+
+static const char* wake_cause_name(hal_wake_cause_t cause) {
+    switch (cause) {
+        case HAL_WAKE_TIMER:
+            return "timer";
+        case HAL_WAKE_BUTTON:
+            return "button";
+        case HAL_WAKE_RESET_BUTTON:
+            return "reset_button";
+        case HAL_WAKE_COLD:
+        default:
+            return "cold";
+    }
+}
+
+static void add_device(cJSON* root) {
+    hal_ota_app_t running;
+    hal_ota_running(&running);
+    cJSON_AddStringToObject(root, "version", running.version);
+    cJSON_AddNumberToObject(root, "uptime_ms", (double)(hal_time_us() / 1000));
+    cJSON_AddNumberToObject(root, "time", (double)hal_time_now());
+    cJSON_AddStringToObject(root, "wake_cause", wake_cause_name(hal_sleep_wake_cause()));
+
+    device_state_count_commits();
+    const device_state_t* state = device_state_get();
+    cJSON* counters = cJSON_AddObjectToObject(root, "counters");
+    cJSON_AddNumberToObject(counters, "wakes", state->total_wakes);
+    cJSON_AddNumberToObject(counters, "quotes", state->quote_count);
+    cJSON_AddNumberToObject(counters, "nvs_commits", state->flash_commits);
+}
+
+static void add_phases(cJSON* root) {
+    cJSON* phases = cJSON_AddObjectToObject(root, "phases");
+    uint32_t expired[WAKE_STAGE_COUNT];
+    cJSON_AddNumberToObject(phases, "budgeted_wakes", wake_budget_outcomes(expired));
+    cJSON* expired_json = cJSON_AddObjectToObject(phases, "expired");
+    for (int i = 0; i < WAKE_STAGE_COUNT; i++) {
+        cJSON_AddNumberToObject(expired_json, wake_stage_name(i), expired[i]);
+    }
+
+    // Stage times in ms per wake, newest first
+    wake_profile_t profiles[WAKE_BUDGET_HISTORY];
+    int count = wake_budget_history(profiles, WAKE_BUDGET_HISTORY);
+    cJSON* history = cJSON_AddArrayToObject(phases, "history");
+    for (int n = 0; n < count; n++) {
+        cJSON* wake = cJSON_CreateObject();
+        cJSON_AddNumberToObject(wake, "budget_ms", profiles[n].budget_ms);
+        if (profiles[n].expired >= 0) {
+            cJSON_AddStringToObject(wake, "expired", wake_stage_name(profiles[n].expired));
+        } else {
+            cJSON_AddNullToObject(wake, "expired");
+        }
+        for (int i = 0; i < WAKE_STAGE_COUNT; i++) {
+            cJSON_AddNumberToObject(wake, wake_stage_name(i), profiles[n].stage_ms[i]);
+        }
+        cJSON_AddItemToArray(history, wake);
+    }
+}
+
+static void add_memory(cJSON* root) {
+    static const char* const region_names[HAL_MEM_REGION_COUNT] = {"internal", "spiram"};
+    cJSON* memory = cJSON_AddObjectToObject(root, "memory");
+    cJSON_AddNumberToObject(memory, "profiled_wakes", mem_profile_wakes());
+    for (int r = 0; r < HAL_MEM_REGION_COUNT; r++) {
+        hal_mem_heap_t heap;
+        if (hal_mem_heap(r, &heap) != ESP_OK) {
+            continue;
+        }
+        cJSON* region = cJSON_AddObjectToObject(memory, region_names[r]);
+        cJSON_AddNumberToObject(region, "total", heap.total);
+        cJSON_AddNumberToObject(region, "free", heap.free);
+        cJSON_AddNumberToObject(region, "min_free", heap.min_free);
+        cJSON_AddNumberToObject(region, "largest_free", heap.largest_free);
+
+        // Lows at the end of each stage, over every profiled wake
+        mem_profile_heap_t lows;
+        if (mem_profile_heap(r, &lows) != ESP_OK) {
+            continue;
+        }
+        cJSON* stages = cJSON_AddObjectToObject(region, "stages");
+        for (int i = 0; i < WAKE_STAGE_COUNT; i++) {
+            if (lows.min_free[i] == 0) {
+                continue;
+            }
+            cJSON* stage = cJSON_AddObjectToObject(stages, wake_stage_name(i));
+            cJSON_AddNumberToObject(stage, "min_free", lows.min_free[i]);
+            cJSON_AddNumberToObject(stage, "largest_free", lows.largest_free[i]);
+        }
+    }
+
+    static mem_profile_stack_t stacks[MEM_PROFILE_TASKS];  // Off the stack
+    int count = mem_profile_stacks(stacks, MEM_PROFILE_TASKS);
+    cJSON* tasks = cJSON_AddArrayToObject(root, "tasks");
+    for (int i = 0; i < count; i++) {
+        cJSON* task = cJSON_CreateObject();
+        cJSON_AddStringToObject(task, "name", stacks[i].name);
+        if (stacks[i].size > 0) {
+            cJSON_AddNumberToObject(task, "stack_size", stacks[i].size);
+            cJSON_AddNumberToObject(task, "suggested", stacks[i].suggested);
+        }
+        cJSON_AddNumberToObject(task, "stack_free_min", stacks[i].free_min);
+        cJSON_AddStringToObject(task, "stage", wake_stage_name(stacks[i].stage));
+        cJSON_AddItemToArray(tasks, task);
+    }
+}
+
+static void add_wifi(cJSON* root) {
+    cJSON* wifi = cJSON_AddObjectToObject(root, "wifi");
+    int8_t rssi;
+    if (hal_wifi_get_rssi(&rssi) == ESP_OK) {
+        cJSON_AddNumberToObject(wifi, "rssi", rssi);
+    }
+    // Stats only: passwords stay on the device
+    cJSON* networks = cJSON_AddArrayToObject(wifi, "networks");
+    for (int i = 0; i < wifi_networks_count(); i++) {
+        const wifi_network_t* network = wifi_networks_get(i);
+        cJSON* entry = cJSON_CreateObject();
+        cJSON_AddStringToObject(entry, "ssid", network->ssid);
+        cJSON_AddNumberToObject(entry, "channel", network->channel);
+        cJSON_AddNumberToObject(entry, "rssi", network->rssi);
+        cJSON_AddNumberToObject(entry, "connect_ms", network->connect_ms);
+        cJSON_AddNumberToObject(entry, "successes", network->successes);
+        cJSON_AddNumberToObject(entry, "failures", network->failures);
+        cJSON_AddNumberToObject(entry, "last_success", network->last_success);
+        cJSON_AddItemToArray(networks, entry);
+    }
+}
+
+static void add_fetch(cJSON* root) {
+    static quote_fetch_stats_t stats;  // Off the stack (about 200 bytes)
+    quote_provider_fetch_stats(&stats);
+    cJSON* fetch = cJSON_AddObjectToObject(root, "fetch");
+    cJSON_AddNumberToObject(fetch, "fetches", stats.fetches);
+    cJSON_AddNumberToObject(fetch, "network_quotes", stats.network_quotes);
+    cJSON_AddNumberToObject(fetch, "deadline_misses", stats.deadline_misses);
+    cJSON* providers = cJSON_AddArrayToObject(fetch, "providers");
+    for (int i = 0; i < QUOTE_STATS_PROVIDERS && stats.providers[i].name[0] != '\0'; i++) {
+        const quote_provider_stats_t* p = &stats.providers[i];
+        cJSON* entry = cJSON_CreateObject();
+        cJSON_AddStringToObject(entry, "name", p->name);
+        cJSON_AddNumberToObject(entry, "requests", p->requests);
+        cJSON_AddNumberToObject(entry, "quotes", p->quotes);
+        cJSON_AddNumberToObject(entry, "transport_errors", p->transport_errors);
+        cJSON_AddNumberToObject(entry, "http_errors", p->http_errors);
+        cJSON_AddNumberToObject(entry, "parse_errors", p->parse_errors);
+        cJSON_AddNumberToObject(entry, "rejected", p->rejected);
+        cJSON_AddNumberToObject(entry, "last_status", p->last_status);
+        cJSON_AddItemToArray(providers, entry);
+    }
+
+    hal_http_stats_t http;
+    hal_http_get_stats(&http);
+    cJSON* http_json = cJSON_AddObjectToObject(fetch, "http");
+    cJSON_AddNumberToObject(http_json, "requests", http.requests);
+    cJSON_AddNumberToObject(http_json, "reused", http.reused);
+    cJSON_AddNumberToObject(http_json, "avg_ms", http.requests > 0 ? http.total_ms / http.requests : 0);
+    cJSON_AddNumberToObject(http_json, "max_ms", http.max_ms);
+    cJSON_AddNumberToObject(http_json, "stack_free_min", http.stack_free_min);
+
+    quote_seen_stats_t seen;
+    quote_provider_seen_stats(&seen);
+    cJSON* seen_json = cJSON_AddObjectToObject(fetch, "seen");
+    cJSON_AddNumberToObject(seen_json, "quotes", seen.quotes);
+    cJSON_AddNumberToObject(seen_json, "repeats", seen.repeats);
+    cJSON_AddNumberToObject(seen_json, "fp_rate", seen.fp_rate);
+}
+
+static void add_battery(cJSON* root) {
+    cJSON* battery = cJSON_AddObjectToObject(root, "battery");
+    battery_reading_t last;
+    if (battery_get_last_reading(&last) == ESP_OK) {
+        cJSON* reading = cJSON_AddObjectToObject(battery, "last");
+        cJSON_AddNumberToObject(reading, "time", (double)last.timestamp);
+        cJSON_AddNumberToObject(reading, "voltage_mv", (int)(last.actual_voltage * 1000.0f + 0.5f));
+        cJSON_AddNumberToObject(reading, "percent", last.percentage);
+        cJSON_AddNumberToObject(reading, "adc_raw", last.adc_raw);
+    }
+
+    // [time, mV] pairs, oldest first
+    static battery_history_t history;  // Off the stack (about 400 bytes)
+    battery_model_get_history(&history);
+    cJSON* entries = cJSON_AddArrayToObject(battery, "history");
+    for (int i = 0; i < history.count; i++) {
+        const battery_history_entry_t* entry =
+            &history.entries[(history.head + BATTERY_HISTORY_SIZE - history.count + i) % BATTERY_HISTORY_SIZE];
+        cJSON* pair = cJSON_CreateArray();
+        cJSON_AddItemToArray(pair, cJSON_CreateNumber(entry->timestamp));
+        cJSON_AddItemToArray(pair, cJSON_CreateNumber(entry->voltage_mv));
+        cJSON_AddItemToArray(entries, pair);
+    }
+}
+
+char* maintenance_metrics_json(void) {
+    cJSON* root = cJSON_CreateObject();
+    if (root == NULL) {
+        return NULL;
+    }
+    add_device(root);
+    add_phases(root);
+    add_memory(root);
+    add_wifi(root);
+    add_fetch(root);
+    add_battery(root);
+    char* json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    return json;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MAINTENANCE_WINDOW_MIN 10          // Minutes the station stays up after the wake's work
+#define MAINTENANCE_MAX_MIN 30             // Longest window a request may ask for
+#define MAINTENANCE_MIN_BATTERY 20.0f      // Percent; a request waits for a wake above it
+#define MAINTENANCE_HOLD_MS 2000           // Refresh button held this long after a button wake
+
+/**
+ * Ask for a maintenance window on the next connected wake: the wake does
+ * its usual work, then keeps the station up and serves the metrics and
+ * screenshots over HTTP instead of going to sleep at once. Kept in RTC
+ * memory until a wake takes it.
+ *
+ * Set by the refresh button gesture (held MAINTENANCE_HOLD_MS) and by a
+ * "maintenance": <minutes> entry in the firmware manifest.
+ *
+ * @param minutes Window length, capped at MAINTENANCE_MAX_MIN
+ * @param reason Who asked (logged)
+ */
+void maintenance_request(uint32_t minutes, const char* reason);
+
+/**
+ * Take a pending request for this wake (call online, before the status
+ * line is drawn). Below MAINTENANCE_MIN_BATTERY the request stays pending.
+ *
+ * @param battery_percent Charge, negative if unknown
+ * @return true if this wake ends with a maintenance window
+ */
+bool maintenance_take(float battery_percent);
+
+/**
+ * @return Length of this wake's maintenance window in milliseconds, 0 if
+ *         maintenance_take() did not start one
+ */
+uint32_t maintenance_window_ms(void);
+
+/**
+ * Everything the device knows about how it has been doing, as JSON:
+ * firmware and counters, the wake-stage history, heap and PSRAM use now
+ * and per stage, task stack lows with suggested sizes (mem_profile.h),
+ * WiFi connect stats, quote fetch outcomes and the battery history.
+ *
+ * @return JSON text to release with cJSON_free(), NULL without memory
+ */
+char* maintenance_metrics_json(void);
+
+#ifdef __cplusplus
+}
+#endif
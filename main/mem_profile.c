@@ -0,0 +1,269 @@
+#include "mem_profile.h"
+#include "device_state.h"
+#include "wifi_manager.h"
+#include "webserver.h"
+#include "captive_dns.h"
+#include "hal_nvs.h"
+#include "hal_ota.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "MEM_PROFILE";
+
+#define PROFILE_MAGIC 0x514D5032      // "QMP2"
+#define PROFILE_NVS_NAMESPACE "mem_profile"
+#define PROFILE_NVS_KEY "lows"
+#define NOT_SEEN UINT32_MAX
+
+// Stack sizes of the ESP-IDF tasks come from sdkconfig; the host measures
+// no task, so its sizes are never used
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#define MAIN_STACK_SIZE CONFIG_ESP_MAIN_TASK_STACK_SIZE
+#define TCPIP_STACK_SIZE CONFIG_LWIP_TCPIP_TASK_STACK_SIZE
+#define EVENT_STACK_SIZE CONFIG_ESP_SYSTEM_EVENT_TASK_STACK_SIZE
+#define TIMER_STACK_SIZE CONFIG_ESP_TIMER_TASK_STACK_SIZE
+#define FREERTOS_TIMER_STACK_SIZE CONFIG_FREERTOS_TIMER_TASK_STACK_DEPTH
+#else
+#define MAIN_STACK_SIZE 0
+#define TCPIP_STACK_SIZE 0
+#define EVENT_STACK_SIZE 0
+#define TIMER_STACK_SIZE 0
+#define FREERTOS_TIMER_STACK_SIZE 0
+#endif
+
+static const struct {
+    const char* name;
+    uint32_t size;                    // 0: set by the driver
+} watched_tasks[MEM_PROFILE_TASKS] = {
+    {"main", MAIN_STACK_SIZE},                    // app_main: boot, WiFi start
+    {"conn_setup", WIFI_SETUP_STACK_SIZE},        // Wake cycle: HTTPS, JSON, display, OTA
+    {"httpd", WEBSERVER_STACK_SIZE},              // Portal and maintenance server
+    {"captive_dns", CAPTIVE_DNS_STACK_SIZE},      // Portal only
+    {"tiT", TCPIP_STACK_SIZE},                    // lwIP
+    {"sys_evt", EVENT_STACK_SIZE},                // Default event loop: wifi_manager's handlers
+    {"esp_timer", TIMER_STACK_SIZE},
+    {"Tmr Svc", FREERTOS_TIMER_STACK_SIZE},       // Retry and budget timers
+    {"wifi", 0},
+};
+
+/**
+ * Lows of one firmware version, as saved in NVS
+ */
+typedef struct {
+    uint32_t magic;
+    char version[HAL_OTA_NAME_SIZE];                           // Firmware they were measured on
+    uint32_t first_wake;                                       // device_state total_wakes when started
+    int8_t stack_stage[MEM_PROFILE_TASKS];
+    uint16_t stack_free[MEM_PROFILE_TASKS];                    // Bytes, UINT16_MAX = never seen
+    uint32_t heap_total[HAL_MEM_REGION_COUNT];                 // 0 = never measured
+    uint32_t heap_min_free[HAL_MEM_REGION_COUNT][WAKE_STAGE_COUNT];   // NOT_SEEN = never
+    uint32_t heap_largest[HAL_MEM_REGION_COUNT][WAKE_STAGE_COUNT];
+    uint32_t crc;
+} profile_store_t;
+
+// Loaded from NVS on the first sample of a wake; written back when a low
+// moved. RTC memory has no room left for it (rtc_budget.h)
+static profile_store_t profile;
+static bool profile_loaded = false;
+static bool profile_changed = false;                           // Since the last save
+
+static uint32_t profile_crc(const profile_store_t* p) {
+    return esp_rom_crc32_le(0, (const uint8_t*)p, offsetof(profile_store_t, crc));
+}
+
+static bool profile_valid(const profile_store_t* p, const char* version) {
+    return p->magic == PROFILE_MAGIC && p->crc == profile_crc(p) &&
+           strncmp(p->version, version, sizeof(p->version)) == 0;
+}
+
+static void profile_load(void) {
+    if (profile_loaded) {
+        return;
+    }
+    profile_loaded = true;
+
+    hal_ota_app_t running;
+    hal_ota_running(&running);
+    size_t size = sizeof(profile);
+    if (hal_nvs_get_blob(PROFILE_NVS_NAMESPACE, PROFILE_NVS_KEY, &profile, &size) == ESP_OK &&
+        size == sizeof(profile) && profile_valid(&profile, running.version)) {
+        return;
+    }
+
+    // New firmware (or first boot): its stacks and heap use start over
+    memset(&profile, 0, sizeof(profile));
+    profile.magic = PROFILE_MAGIC;
+    snprintf(profile.version, sizeof(profile.version), "%s", running.version);
+    profile.first_wake = device_state_get()->total_wakes;
+    memset(profile.stack_free, 0xFF, sizeof(profile.stack_free));
+    memset(profile.stack_stage, -1, sizeof(profile.stack_stage));
+    memset(profile.heap_min_free, 0xFF, sizeof(profile.heap_min_free));
+    memset(profile.heap_largest, 0xFF, sizeof(profile.heap_largest));
+    profile.crc = profile_crc(&profile);
+}
+
+// Keep a new low; true if it dropped by at least slack (or is the first)
+static bool lower(uint32_t* low, uint32_t value, uint32_t slack) {
+    if (value >= *low) {
+        return false;
+    }
+    bool moved = *low == NOT_SEEN || *low - value >= slack;
+    *low = value;
+    return moved;
+}
+
+void mem_profile_sample(void) {
+    profile_load();
+    wake_stage_t stage = wake_budget_stage();
+    bool changed = false;
+
+    for (int r = 0; r < HAL_MEM_REGION_COUNT; r++) {
+        hal_mem_heap_t heap;
+        if (hal_mem_heap(r, &heap) != ESP_OK) {
+            continue;
+        }
+        profile.heap_total[r] = heap.total;
+        changed |= lower(&profile.heap_min_free[r][stage], heap.min_free, MEM_PROFILE_HEAP_SLACK);
+        changed |= lower(&profile.heap_largest[r][stage], heap.largest_free, MEM_PROFILE_HEAP_SLACK);
+    }
+
+    for (int i = 0; i < MEM_PROFILE_TASKS; i++) {
+        uint32_t free_min;
+        if (hal_mem_task_stack(watched_tasks[i].name, &free_min) != ESP_OK || free_min >= profile.stack_free[i]) {
+            continue;
+        }
+        profile.stack_free[i] = free_min;
+        profile.stack_stage[i] = stage;
+        changed = true;
+    }
+
+    profile_changed |= changed;
+}
+
+void mem_profile_save(void) {
+    if (!profile_changed) {
+        return;
+    }
+    profile_changed = false;
+    profile.crc = profile_crc(&profile);
+    esp_err_t err = hal_nvs_set_blob(PROFILE_NVS_NAMESPACE, PROFILE_NVS_KEY, &profile, sizeof(profile));
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to save memory profile: %s", esp_err_to_name(err));
+    }
+}
+
+static uint32_t suggested_stack(uint32_t size, uint32_t free_min) {
+    if (size == 0 || free_min > size) {
+        return 0;
+    }
+    uint32_t need = size - free_min + MEM_PROFILE_STACK_MARGIN;
+    return (need + MEM_PROFILE_STACK_ROUND - 1) / MEM_PROFILE_STACK_ROUND * MEM_PROFILE_STACK_ROUND;
+}
+
+void mem_profile_report(void) {
+    mem_profile_sample();
+    mem_profile_save();
+
+    hal_mem_heap_t heap;
+    uint32_t setup_free;
+    if (hal_mem_heap(HAL_MEM_INTERNAL, &heap) != ESP_OK) {
+        return;  // Nothing measured (host)
+    }
+    if (hal_mem_task_stack("conn_setup", &setup_free) == ESP_OK) {
+        ESP_LOGI(TAG, "Internal heap low %lu of %lu (largest block %lu), conn_setup stack %lu of %d unused",
+                 (unsigned long)heap.min_free, (unsigned long)heap.total, (unsigned long)heap.largest_free,
+                 (unsigned long)setup_free, WIFI_SETUP_STACK_SIZE);
+    } else {
+        ESP_LOGI(TAG, "Internal heap low %lu of %lu (largest block %lu)",
+                 (unsigned long)heap.min_free, (unsigned long)heap.total, (unsigned long)heap.largest_free);
+    }
+}
+
+void mem_profile_dump(void) {
+    static const char* const region_names[HAL_MEM_REGION_COUNT] = {"Internal", "PSRAM"};
+    profile_load();
+    ESP_LOGI(TAG, "Memory profile of %s over %lu wakes (lowest seen)", profile.version,
+             (unsigned long)mem_profile_wakes());
+
+    for (int r = 0; r < HAL_MEM_REGION_COUNT; r++) {
+        mem_profile_heap_t heap;
+        if (mem_profile_heap(r, &heap) != ESP_OK) {
+            continue;
+        }
+        ESP_LOGI(TAG, "%s heap of %lu: free / largest block by the end of", region_names[r],
+                 (unsigned long)heap.total);
+        for (int s = 0; s < WAKE_STAGE_COUNT; s++) {
+            if (heap.min_free[s] > 0) {
+                ESP_LOGI(TAG, "  %-8s %8lu / %lu", wake_stage_name(s), (unsigned long)heap.min_free[s],
+                         (unsigned long)heap.largest_free[s]);
+            }
+        }
+    }
+
+    static mem_profile_stack_t stacks[MEM_PROFILE_TASKS];  // Off the stack being profiled
+    int count = mem_profile_stacks(stacks, MEM_PROFILE_TASKS);
+    if (count == 0) {
+        ESP_LOGI(TAG, "No task measured");
+        return;
+    }
+    ESP_LOGI(TAG, "Stack        size   used unused  stage    suggested");
+    uint32_t spare = 0;
+    for (int i = 0; i < count; i++) {
+        const mem_profile_stack_t* t = &stacks[i];
+        if (t->size == 0) {
+            ESP_LOGI(TAG, "%-11s     -      - %6lu  %-8s -", t->name, (unsigned long)t->free_min,
+                     wake_stage_name(t->stage));
+            continue;
+        }
+        ESP_LOGI(TAG, "%-11s %6lu %6lu %6lu  %-8s %lu", t->name, (unsigned long)t->size,
+                 (unsigned long)(t->size - t->free_min), (unsigned long)t->free_min,
+                 wake_stage_name(t->stage), (unsigned long)t->suggested);
+        if (t->suggested < t->size) {
+            spare += t->size - t->suggested;
+        }
+    }
+    ESP_LOGI(TAG, "Suggested sizes would return %lu bytes of stack", (unsigned long)spare);
+}
+
+uint32_t mem_profile_wakes(void) {
+    profile_load();
+    uint32_t total = device_state_get()->total_wakes;
+    return total >= profile.first_wake ? total - profile.first_wake + 1 : 0;
+}
+
+int mem_profile_stacks(mem_profile_stack_t* stacks, int max) {
+    profile_load();
+    int n = 0;
+    for (int i = 0; i < MEM_PROFILE_TASKS && n < max; i++) {
+        if (profile.stack_free[i] == UINT16_MAX) {
+            continue;
+        }
+        stacks[n].name = watched_tasks[i].name;
+        stacks[n].size = watched_tasks[i].size;
+        stacks[n].free_min = profile.stack_free[i];
+        stacks[n].stage = profile.stack_stage[i];
+        stacks[n].suggested = suggested_stack(watched_tasks[i].size, profile.stack_free[i]);
+        n++;
+    }
+    return n;
+}
+
+esp_err_t mem_profile_heap(hal_mem_region_t region, mem_profile_heap_t* heap) {
+    profile_load();
+    if (region >= HAL_MEM_REGION_COUNT || profile.heap_total[region] == 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    heap->total = profile.heap_total[region];
+    for (int s = 0; s < WAKE_STAGE_COUNT; s++) {
+        uint32_t min_free = profile.heap_min_free[region][s];
+        uint32_t largest = profile.heap_largest[region][s];
+        heap->min_free[s] = min_free != NOT_SEEN ? min_free : 0;
+        heap->largest_free[s] = largest != NOT_SEEN ? largest : 0;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <esp_err.h>
+#include <stdint.h>
+#include "hal_mem.h"
+#include "wake_budget.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MEM_PROFILE_TASKS 9                // Tasks whose stacks are watched (mem_profile.c)
+#define MEM_PROFILE_STACK_MARGIN 1024      // Headroom a suggested stack keeps over the deepest use seen
+#define MEM_PROFILE_STACK_ROUND 512        // Suggested stacks are rounded up to this
+#define MEM_PROFILE_HEAP_SLACK 256         // Smaller heap drops are kept for the wake but not saved
+
+/**
+ * Deepest use of one task's stack
+ */
+typedef struct {
+    const char* name;
+    uint32_t size;           // Configured stack in bytes, 0 if the driver sets it
+    uint32_t free_min;       // Lowest high-water mark seen: bytes never used
+    int stage;               // wake_stage_t in which it was reached
+    uint32_t suggested;      // Stack that keeps MEM_PROFILE_STACK_MARGIN, 0 if size unknown
+} mem_profile_stack_t;
+
+/**
+ * Lowest heap of one region at the end of each wake stage
+ */
+typedef struct {
+    uint32_t total;
+    uint32_t min_free[WAKE_STAGE_COUNT];      // Lowest free since boot, 0 = stage not measured
+    uint32_t largest_free[WAKE_STAGE_COUNT];  // Smallest largest block, 0 = not measured
+} mem_profile_heap_t;
+
+/**
+ * Sample the heap regions and the watched task stacks, and keep every new
+ * low with the wake stage that is running. Called by wake_budget_enter() at
+ * each stage boundary, and by whoever stops a task that would otherwise
+ * never be measured (the portal's and the maintenance window's httpd).
+ *
+ * The lows are loaded from NVS (one blob with a CRC) on the first sample
+ * and saved by mem_profile_save(); they start over when the firmware
+ * version changes.
+ * Walks the heaps and looks up MEM_PROFILE_TASKS tasks by name, well
+ * under a millisecond; does nothing where hal_mem measures nothing (host).
+ */
+void mem_profile_sample(void);
+
+/**
+ * Save the lows to NVS if a stack low or a heap low (by at least
+ * MEM_PROFILE_HEAP_SLACK) moved since the last save. Lows that were not
+ * saved are lost with deep sleep, so whoever samples after
+ * mem_profile_report() calls this too (the maintenance window).
+ */
+void mem_profile_save(void);
+
+/**
+ * End of wake: take a last sample, save the lows if they moved, and log
+ * this wake's internal heap low and conn_setup stack use
+ */
+void mem_profile_report(void);
+
+/**
+ * Log the sizing report: per-stage heap lows, and per task its size,
+ * deepest use, the stage that reached it and the suggested size. Printed on
+ * refresh button wakes.
+ */
+void mem_profile_dump(void);
+
+/**
+ * @return Wakes since the profile of this firmware version started (device_state total_wakes)
+ */
+uint32_t mem_profile_wakes(void);
+
+/**
+ * Stack lows of the tasks that were seen running
+ *
+ * @param stacks Out
+ * @param max Entries in stacks
+ * @return Number written
+ */
+int mem_profile_stacks(mem_profile_stack_t* stacks, int max);
+
+/**
+ * Heap lows of a region
+ *
+ * @param region Region
+ * @param heap Out
+ * @return ESP_OK, ESP_ERR_NOT_FOUND if the region was never measured
+ */
+esp_err_t mem_profile_heap(hal_mem_region_t region, mem_profile_heap_t* heap);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,253 @@
+#include "ota_delta.h"
+#include "hal_ota.h"
+#include "esp_log.h"
+#include "miniz.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "OTA_DELTA";
+
+#define PATCH_MAGIC 0x31504451      // "QDP1"
+#define RECORD_SIZE 12              // Add length, extra length, seek (int32)
+
+/*
+ * Patch: a header, then one zlib stream of records, each
+ *   add length, extra length, seek     (uint32, uint32, int32, little-endian)
+ *   add bytes:   image[i] = base[pos + i] + byte (mod 256); pos advances
+ *   extra bytes: copied into the image as they are
+ *   pos += seek
+ * Unchanged code and data are runs of zero add bytes, and code that only
+ * moved differs in a few address bytes, so the stream deflates well.
+ */
+
+typedef enum {
+    PART_RECORD,
+    PART_ADD,
+    PART_EXTRA,
+    PART_DONE,                      // Image complete
+} part_t;
+
+typedef struct {
+    tinfl_decompressor inflator;
+    uint8_t window[TINFL_LZ_DICT_SIZE];   // Inflated bytes, also the inflater's history
+    size_t window_pos;
+    uint8_t base[OTA_DELTA_READ_SIZE];    // Running image bytes being patched
+    uint8_t header[OTA_DELTA_HEADER_SIZE];
+    uint8_t record[RECORD_SIZE];
+    size_t header_received;
+    size_t record_received;
+    part_t part;
+    uint32_t add_left;
+    uint32_t extra_left;
+    int32_t seek;
+    int64_t base_pos;
+    size_t base_size;
+    size_t image_left;
+    size_t patch_size;
+    bool inflated;                  // Stream ended
+    uint8_t base_sha256[32];
+    ota_receiver_t* rx;
+    esp_err_t err;                  // First error; later data is dropped
+} delta_t;
+
+static delta_t* delta = NULL;       // Allocated for one patch only
+
+static uint32_t read_u32(const uint8_t* p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+esp_err_t ota_delta_begin(ota_receiver_t* rx, const uint8_t base_sha256[32]) {
+    if (delta != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    delta = calloc(1, sizeof(*delta));
+    if (delta == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    tinfl_init(&delta->inflator);
+    delta->rx = rx;
+    memcpy(delta->base_sha256, base_sha256, sizeof(delta->base_sha256));
+    return ESP_OK;
+}
+
+static esp_err_t check_header(delta_t* d) {
+    const uint8_t* h = d->header;
+    if (read_u32(h) != PATCH_MAGIC) {
+        ESP_LOGE(TAG, "Not a patch");
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (memcmp(h + 12, d->base_sha256, sizeof(d->base_sha256)) != 0) {
+        ESP_LOGE(TAG, "Patch is for another base image");
+        return ESP_ERR_INVALID_VERSION;
+    }
+    d->base_size = read_u32(h + 4);
+    d->image_left = read_u32(h + 8);
+    if (d->image_left != d->rx->size) {
+        ESP_LOGE(TAG, "Patch builds %u bytes, the manifest says %u", (unsigned)d->image_left,
+                 (unsigned)d->rx->size);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    d->part = PART_RECORD;
+    return ESP_OK;
+}
+
+// After a record's add and extra bytes: seek, then the next record
+static esp_err_t next_part(delta_t* d) {
+    if (d->add_left > 0) {
+        d->part = PART_ADD;
+        return ESP_OK;
+    }
+    if (d->extra_left > 0) {
+        d->part = PART_EXTRA;
+        return ESP_OK;
+    }
+    d->base_pos += d->seek;
+    d->seek = 0;
+    if (d->base_pos < 0 || d->base_pos > (int64_t)d->base_size) {
+        ESP_LOGE(TAG, "Seek outside the base image");
+        return ESP_ERR_INVALID_SIZE;
+    }
+    d->part = d->image_left == 0 ? PART_DONE : PART_RECORD;
+    return ESP_OK;
+}
+
+static esp_err_t parse_record(delta_t* d) {
+    d->add_left = read_u32(d->record);
+    d->extra_left = read_u32(d->record + 4);
+    d->seek = (int32_t)read_u32(d->record + 8);
+    d->record_received = 0;
+    if ((uint64_t)d->add_left + d->extra_left > d->image_left ||
+        d->base_pos + d->add_left > (int64_t)d->base_size) {
+        ESP_LOGE(TAG, "Record outside the images");
+        return ESP_ERR_INVALID_SIZE;
+    }
+    d->image_left -= d->add_left + d->extra_left;
+    return next_part(d);
+}
+
+// Inflated patch bytes: records, add bytes and extra bytes in turn
+static esp_err_t take(delta_t* d, const uint8_t* data, size_t length) {
+    esp_err_t err = ESP_OK;
+    while (length > 0 && err == ESP_OK) {
+        size_t n = length;
+        switch (d->part) {
+        case PART_RECORD:
+            n = RECORD_SIZE - d->record_received;
+            n = n < length ? n : length;
+            memcpy(d->record + d->record_received, data, n);
+            d->record_received += n;
+            if (d->record_received == RECORD_SIZE) {
+                err = parse_record(d);
+            }
+            break;
+        case PART_ADD:
+            n = n < d->add_left ? n : d->add_left;
+            n = n < sizeof(d->base) ? n : sizeof(d->base);
+            err = hal_ota_read_running((size_t)d->base_pos, d->base, n);
+            for (size_t i = 0; i < n; i++) {
+                d->base[i] += data[i];
+            }
+            if (err == ESP_OK) {
+                err = ota_receiver_write(d->rx, d->base, n);
+            }
+            d->base_pos += n;
+            d->add_left -= n;
+            if (err == ESP_OK && d->add_left == 0) {
+                err = next_part(d);
+            }
+            break;
+        case PART_EXTRA:
+            n = n < d->extra_left ? n : d->extra_left;
+            err = ota_receiver_write(d->rx, data, n);
+            d->extra_left -= n;
+            if (err == ESP_OK && d->extra_left == 0) {
+                err = next_part(d);
+            }
+            break;
+        case PART_DONE:
+            ESP_LOGE(TAG, "Patch continues past the end of the image");
+            return ESP_ERR_INVALID_SIZE;
+        }
+        data += n;
+        length -= n;
+    }
+    return err;
+}
+
+esp_err_t ota_delta_write(const void* data, size_t length) {
+    delta_t* d = delta;
+    if (d == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (d->err != ESP_OK) {
+        return d->err;
+    }
+    d->patch_size += length;
+
+    const uint8_t* in = data;
+    if (d->header_received < OTA_DELTA_HEADER_SIZE) {
+        size_t n = OTA_DELTA_HEADER_SIZE - d->header_received;
+        n = n < length ? n : length;
+        memcpy(d->header + d->header_received, in, n);
+        d->header_received += n;
+        in += n;
+        length -= n;
+        if (d->header_received < OTA_DELTA_HEADER_SIZE) {
+            return ESP_OK;
+        }
+        d->err = check_header(d);
+    }
+
+    // Inflate into the window, and take each stretch as it comes out
+    while (d->err == ESP_OK && !d->inflated) {
+        size_t in_size = length;
+        size_t out_size = TINFL_LZ_DICT_SIZE - d->window_pos;
+        tinfl_status status = tinfl_decompress(&d->inflator, in, &in_size, d->window,
+                                               d->window + d->window_pos, &out_size,
+                                               TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_HAS_MORE_INPUT);
+        in += in_size;
+        length -= in_size;
+        if (out_size > 0) {
+            d->err = take(d, d->window + d->window_pos, out_size);
+            d->window_pos = (d->window_pos + out_size) & (TINFL_LZ_DICT_SIZE - 1);
+        }
+        if (status < TINFL_STATUS_DONE) {
+            ESP_LOGE(TAG, "Patch stream corrupt (%d)", (int)status);
+            d->err = ESP_ERR_INVALID_CRC;
+        } else if (status == TINFL_STATUS_DONE) {
+            d->inflated = true;
+        } else if (status == TINFL_STATUS_NEEDS_MORE_INPUT) {
+            break;
+        }
+    }
+    if (d->err == ESP_OK && d->inflated && length > 0) {
+        ESP_LOGE(TAG, "Data after the end of the patch");
+        d->err = ESP_ERR_INVALID_SIZE;
+    }
+    return d->err;
+}
+
+esp_err_t ota_delta_finish(void) {
+    delta_t* d = delta;
+    if (d == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t err = d->err;
+    if (err == ESP_OK && (!d->inflated || d->part != PART_DONE)) {
+        ESP_LOGE(TAG, "Patch ended early: %u bytes of the image missing", (unsigned)d->image_left);
+        err = ESP_ERR_INVALID_SIZE;
+    }
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Rebuilt %u bytes from a %u-byte patch (%.1f%% of the image), %u bytes of RAM",
+                 (unsigned)d->rx->size, (unsigned)d->patch_size, 100.0f * d->patch_size / d->rx->size,
+                 (unsigned)sizeof(*d));
+    }
+    ota_delta_abort();
+    return err;
+}
+
+void ota_delta_abort(void) {
+    free(delta);
+    delta = NULL;
+}
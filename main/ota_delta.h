@@ -0,0 +1,57 @@
+#pragma once
+
+#include <esp_err.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "ota_update.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OTA_DELTA_HEADER_SIZE 44           // "QDP1", base size, image size, base SHA-256
+#define OTA_DELTA_READ_SIZE 1024           // Running image bytes read per step
+
+/**
+ * Start rebuilding an image from a patch (tools/delta_patch.py) against the
+ * running image. The rebuilt image goes to a receiver that was begun with
+ * the new image's size, SHA-256 and version, so it is checked exactly like
+ * a full download.
+ *
+ * RAM: one allocation of about 45 KB (the inflater, its 32 KB window and a
+ * read buffer) until ota_delta_finish() or ota_delta_abort(), whatever the
+ * image size.
+ *
+ * @param rx Receiver of the rebuilt image
+ * @param base_sha256 SHA-256 of the running image (hal_ota_running_sha256())
+ * @return ESP_OK, ESP_ERR_NO_MEM, ESP_ERR_INVALID_STATE if a patch is open
+ */
+esp_err_t ota_delta_begin(ota_receiver_t* rx, const uint8_t base_sha256[32]);
+
+/**
+ * Take the next piece of the patch as it downloads
+ *
+ * @return ESP_OK, or the first error (the patch is then dropped:
+ *         ESP_ERR_INVALID_VERSION for a patch against another image,
+ *         ESP_ERR_INVALID_CRC for a corrupt stream, ESP_ERR_INVALID_SIZE for
+ *         records outside either image, or the receiver's error)
+ */
+esp_err_t ota_delta_write(const void* data, size_t length);
+
+/**
+ * Check that the patch rebuilt the whole image, log its size against the
+ * image and free the buffers. The caller then finishes the receiver.
+ *
+ * @return ESP_OK, ESP_ERR_INVALID_SIZE if the patch ended early, or the
+ *         first error of ota_delta_write()
+ */
+esp_err_t ota_delta_finish(void);
+
+/**
+ * Drop an open patch (download failed) and free the buffers
+ */
+void ota_delta_abort(void);
+
+#ifdef __cplusplus
+}
+#endif
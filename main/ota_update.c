@@ -0,0 +1,456 @@
+#include "ota_update.h"
+#include "ota_delta.h"
+#include "maintenance.h"
+#include "hal_http.h"
+#include "hal_time.h"
+#include "esp_log.h"
+#include "rtc_budget.h"
+#include "esp_attr.h"
+#include "esp_rom_crc.h"
+#include "cJSON.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "OTA_UPDATE";
+
+#ifndef OTA_MANIFEST_URL  // Overridden by the host build to point at a local mock server
+#include "sdkconfig.h"
+#define OTA_MANIFEST_URL CONFIG_QUOTE_OTA_MANIFEST_URL
+#endif
+
+#define SCHEDULE_MAGIC 0x4F544131   // "OTA1"
+
+// Image layout (esp_image_header_t, first segment header, esp_app_desc_t)
+#define IMAGE_MAGIC 0xE9
+#define APP_DESC_OFFSET 32
+#define APP_DESC_MAGIC 0xABCD5432
+#define APP_VERSION_OFFSET (APP_DESC_OFFSET + 16)
+#define APP_PROJECT_OFFSET (APP_DESC_OFFSET + 48)
+
+_Static_assert(OTA_UPDATE_HEADER_SIZE == APP_PROJECT_OFFSET + HAL_OTA_NAME_SIZE,
+               "the held-back header must end with the project name");
+
+/**
+ * When the next manifest check is due
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t wakes_left;             // Connected wakes until the next check
+    uint32_t offline_wakes;          // New image not online yet: offline wakes in a row
+    uint32_t fell_back;              // The next new boot is the previous image: no probation
+    uint32_t crc;
+} ota_schedule_t;
+RTC_BUDGET_CHECK(ota_schedule_t, RTC_BUDGET_OTA_SCHEDULE);
+
+// Survives deep sleep; reset by power loss (caught by CRC), which makes a check due
+// and ends the probation of a new image
+static RTC_NOINIT_ATTR ota_schedule_t schedule;
+
+static uint32_t schedule_crc(void) {
+    return esp_rom_crc32_le(0, (const uint8_t*)&schedule, offsetof(ota_schedule_t, crc));
+}
+
+static void schedule_load(void) {
+    if (schedule.magic != SCHEDULE_MAGIC || schedule.crc != schedule_crc()) {
+        memset(&schedule, 0, sizeof(schedule));
+        schedule.magic = SCHEDULE_MAGIC;  // Power loss: check now
+    }
+}
+
+static void schedule_commit(void) {
+    schedule.crc = schedule_crc();
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+static bool parse_digest(const char* hex, uint8_t digest[32]) {
+    if (strlen(hex) != 64) {
+        return false;
+    }
+    for (int i = 0; i < 32; i++) {
+        int high = hex_value(hex[i * 2]);
+        int low = hex_value(hex[i * 2 + 1]);
+        if (high < 0 || low < 0) {
+            return false;
+        }
+        digest[i] = (uint8_t)(high << 4 | low);
+    }
+    return true;
+}
+
+esp_err_t ota_receiver_begin(ota_receiver_t* rx, size_t size, const char* sha256_hex, const char* version) {
+    memset(rx, 0, sizeof(*rx));
+    if (size <= OTA_UPDATE_HEADER_SIZE || size > hal_ota_slot_size()) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (sha256_hex != NULL) {
+        if (!parse_digest(sha256_hex, rx->digest)) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        rx->check_digest = true;
+    }
+    if (version != NULL) {
+        snprintf(rx->version, sizeof(rx->version), "%s", version);
+    }
+    rx->size = size;
+    rx->started_us = hal_time_us();
+    mbedtls_sha256_init(&rx->sha);
+    mbedtls_sha256_starts(&rx->sha, 0);
+    return ESP_OK;
+}
+
+// The start of the image: right magics, this project, the expected version
+static esp_err_t check_header(ota_receiver_t* rx) {
+    const uint8_t* h = rx->header;
+    uint32_t magic = h[APP_DESC_OFFSET] | h[APP_DESC_OFFSET + 1] << 8 |
+                     h[APP_DESC_OFFSET + 2] << 16 | (uint32_t)h[APP_DESC_OFFSET + 3] << 24;
+    if (h[0] != IMAGE_MAGIC || magic != APP_DESC_MAGIC) {
+        ESP_LOGE(TAG, "Not a firmware image");
+        return ESP_ERR_INVALID_VERSION;
+    }
+    snprintf(rx->app.version, sizeof(rx->app.version), "%.*s", HAL_OTA_NAME_SIZE - 1,
+             (const char*)h + APP_VERSION_OFFSET);
+    snprintf(rx->app.project, sizeof(rx->app.project), "%.*s", HAL_OTA_NAME_SIZE - 1,
+             (const char*)h + APP_PROJECT_OFFSET);
+
+    hal_ota_app_t running;
+    hal_ota_running(&running);
+    if (strcmp(rx->app.project, running.project) != 0) {
+        ESP_LOGE(TAG, "Image is for %s, not %s", rx->app.project, running.project);
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (rx->version[0] != '\0' && strcmp(rx->app.version, rx->version) != 0) {
+        ESP_LOGE(TAG, "Image is version %s, the manifest says %s", rx->app.version, rx->version);
+        return ESP_ERR_INVALID_VERSION;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t flash_write(ota_receiver_t* rx, const void* data, size_t length) {
+    int64_t start = hal_time_us();
+    esp_err_t err = hal_ota_write(data, length);
+    rx->flash_us += hal_time_us() - start;
+    return err;
+}
+
+esp_err_t ota_receiver_write(ota_receiver_t* rx, const void* data, size_t length) {
+    if (rx->err != ESP_OK) {
+        return rx->err;
+    }
+    if (rx->received + length > rx->size) {
+        ESP_LOGE(TAG, "More data than the %u bytes announced", (unsigned)rx->size);
+        ota_receiver_abort(rx);
+        rx->err = ESP_ERR_INVALID_SIZE;
+        return rx->err;
+    }
+    mbedtls_sha256_update(&rx->sha, data, length);
+
+    // Hold the header back until it is complete and checked
+    const uint8_t* bytes = data;
+    if (rx->received < OTA_UPDATE_HEADER_SIZE) {
+        size_t take = OTA_UPDATE_HEADER_SIZE - rx->received;
+        if (take > length) {
+            take = length;
+        }
+        memcpy(rx->header + rx->received, bytes, take);
+        rx->received += take;
+        bytes += take;
+        length -= take;
+        if (rx->received < OTA_UPDATE_HEADER_SIZE) {
+            return ESP_OK;
+        }
+
+        rx->err = check_header(rx);
+        if (rx->err == ESP_OK) {
+            rx->err = hal_ota_begin(rx->size);
+        }
+        if (rx->err == ESP_OK) {
+            rx->opened = true;
+            ESP_LOGI(TAG, "Receiving %s %s (%u bytes)", rx->app.project, rx->app.version, (unsigned)rx->size);
+            rx->err = flash_write(rx, rx->header, OTA_UPDATE_HEADER_SIZE);
+        }
+    }
+
+    if (rx->err == ESP_OK && length > 0) {
+        rx->err = flash_write(rx, bytes, length);
+        rx->received += length;
+    }
+    if (rx->err != ESP_OK) {
+        ota_receiver_abort(rx);
+    }
+    return rx->err;
+}
+
+esp_err_t ota_receiver_finish(ota_receiver_t* rx, bool activate) {
+    if (rx->err != ESP_OK) {
+        return rx->err;
+    }
+    if (!rx->opened || rx->received != rx->size) {
+        ESP_LOGE(TAG, "Image incomplete: %u of %u bytes", (unsigned)rx->received, (unsigned)rx->size);
+        ota_receiver_abort(rx);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    uint8_t digest[32];
+    mbedtls_sha256_finish(&rx->sha, digest);
+    mbedtls_sha256_free(&rx->sha);
+    if (rx->check_digest && memcmp(digest, rx->digest, sizeof(digest)) != 0) {
+        ESP_LOGE(TAG, "SHA-256 mismatch, image dropped");
+        ota_receiver_abort(rx);
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    int64_t start = hal_time_us();
+    esp_err_t err = hal_ota_end(activate);
+    rx->opened = false;
+    rx->flash_us += hal_time_us() - start;
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Image rejected: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    // Download and flash writes take turns, so both rates bound the update
+    float total_s = (hal_time_us() - rx->started_us) / 1e6f;
+    float flash_s = rx->flash_us / 1e6f;
+    ESP_LOGI(TAG, "Installed %s: %u bytes in %.1f s (%.1f KB/s), flash writes %.1f s (%.1f KB/s)%s",
+             rx->app.version, (unsigned)rx->size, total_s,
+             total_s > 0 ? rx->size / 1024.0f / total_s : 0.0f, flash_s,
+             flash_s > 0 ? rx->size / 1024.0f / flash_s : 0.0f,
+             activate ? ", boots next" : "");
+    return ESP_OK;
+}
+
+void ota_receiver_abort(ota_receiver_t* rx) {
+    if (rx->opened) {
+        hal_ota_abort();
+        rx->opened = false;
+    }
+    mbedtls_sha256_free(&rx->sha);
+    if (rx->err == ESP_OK) {
+        rx->err = ESP_FAIL;
+    }
+}
+
+static void image_data(const char* data, size_t length, void* ctx) {
+    ota_receiver_write((ota_receiver_t*)ctx, data, length);
+}
+
+static void patch_data(const char* data, size_t length, void* ctx) {
+    ota_delta_write(data, length);
+}
+
+// A path in the manifest is on the manifest's host
+static void image_url(char* url, size_t size, const char* manifest_url, const char* target) {
+    if (target[0] != '/') {
+        snprintf(url, size, "%s", target);
+        return;
+    }
+    const char* host = strstr(manifest_url, "://");
+    host = host != NULL ? host + 3 : manifest_url;
+    int origin = (int)(host - manifest_url + strcspn(host, "/?#"));
+    snprintf(url, size, "%.*s%s", origin, manifest_url, target);
+}
+
+// Stream the image, or a patch that rebuilds it from the running image
+// (base_sha256 not NULL), into the inactive slot
+static esp_err_t install(const char* url, const uint8_t* base_sha256, size_t size,
+                         const char* sha256_hex, const char* version) {
+    static ota_receiver_t rx;
+    esp_err_t err = ota_receiver_begin(&rx, size, sha256_hex, version);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Manifest entry unusable: %s", esp_err_to_name(err));
+        return err;
+    }
+    if (base_sha256 != NULL && (err = ota_delta_begin(&rx, base_sha256)) != ESP_OK) {
+        ota_receiver_abort(&rx);
+        return err;
+    }
+
+    hal_http_response_t response = {
+        .on_data = base_sha256 != NULL ? patch_data : image_data,
+        .data_ctx = &rx,
+    };
+    err = hal_http_get(url, OTA_UPDATE_TIMEOUT_MS, &response);
+    if (err != ESP_OK || response.status != 200) {
+        ESP_LOGW(TAG, "Download failed (%s, status %d)", esp_err_to_name(err), response.status);
+        err = err != ESP_OK ? err : ESP_ERR_INVALID_RESPONSE;
+    }
+    if (base_sha256 != NULL && err == ESP_OK) {
+        err = ota_delta_finish();
+    } else if (base_sha256 != NULL) {
+        ota_delta_abort();
+    }
+    if (err != ESP_OK) {
+        ota_receiver_abort(&rx);
+        return err;
+    }
+    return ota_receiver_finish(&rx, true);
+}
+
+esp_err_t ota_update_check(const char* manifest_url) {
+    static char manifest[OTA_UPDATE_MANIFEST_SIZE];
+    hal_http_response_t response = {
+        .buffer = manifest,
+        .buffer_size = sizeof(manifest),
+    };
+    esp_err_t err = hal_http_get(manifest_url, OTA_UPDATE_TIMEOUT_MS, &response);
+    if (err != ESP_OK || response.status != 200 || response.truncated) {
+        ESP_LOGW(TAG, "No manifest (%s, status %d)", esp_err_to_name(err), response.status);
+        hal_http_close_idle();
+        return err != ESP_OK ? err : ESP_ERR_INVALID_RESPONSE;
+    }
+
+    cJSON* root = cJSON_Parse(manifest);
+    const cJSON* maintenance = cJSON_GetObjectItem(root, "maintenance");
+    if (cJSON_IsNumber(maintenance) && maintenance->valuedouble > 0) {
+        maintenance_request((uint32_t)maintenance->valuedouble, "manifest");
+    }
+    const cJSON* version = cJSON_GetObjectItem(root, "version");
+    const cJSON* url = cJSON_GetObjectItem(root, "url");
+    const cJSON* size = cJSON_GetObjectItem(root, "size");
+    const cJSON* sha256 = cJSON_GetObjectItem(root, "sha256");
+    if (!cJSON_IsString(version) || !cJSON_IsString(url) || !cJSON_IsNumber(size) ||
+        !cJSON_IsString(sha256) || size->valuedouble <= 0) {
+        ESP_LOGW(TAG, "Manifest without version, url, size and sha256");
+        cJSON_Delete(root);
+        hal_http_close_idle();
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    hal_ota_app_t running;
+    hal_ota_app_t rejected;
+    hal_ota_running(&running);
+    if (strcmp(version->valuestring, running.version) == 0) {
+        ESP_LOGI(TAG, "Firmware %s is up to date", running.version);
+        err = ESP_ERR_NOT_FOUND;
+    } else if (hal_ota_rejected(&rejected) && strcmp(version->valuestring, rejected.version) == 0) {
+        ESP_LOGW(TAG, "Skipping %s: it was rolled back", rejected.version);
+        err = ESP_ERR_NOT_FOUND;
+    }
+    if (err != ESP_OK) {
+        cJSON_Delete(root);
+        hal_http_close_idle();
+        return err;
+    }
+
+    // A patch applies only to the image it was made against
+    char patch_url[OTA_UPDATE_URL_SIZE] = "";
+    uint8_t base_sha256[32];
+    uint8_t from[32];
+    const cJSON* patch = cJSON_GetObjectItem(root, "patch");
+    const cJSON* patch_from = cJSON_GetObjectItem(patch, "from");
+    const cJSON* patch_target = cJSON_GetObjectItem(patch, "url");
+    if (cJSON_IsString(patch_from) && cJSON_IsString(patch_target) &&
+        parse_digest(patch_from->valuestring, from) && hal_ota_running_sha256(base_sha256) == ESP_OK &&
+        memcmp(from, base_sha256, sizeof(from)) == 0) {
+        image_url(patch_url, sizeof(patch_url), manifest_url, patch_target->valuestring);
+    }
+
+    // Streamed: nothing of the image is buffered beyond its header
+    char target[OTA_UPDATE_URL_SIZE];
+    char image_version[HAL_OTA_NAME_SIZE];
+    char image_sha256[65];
+    size_t image_size = (size_t)size->valuedouble;
+    image_url(target, sizeof(target), manifest_url, url->valuestring);
+    snprintf(image_version, sizeof(image_version), "%s", version->valuestring);
+    snprintf(image_sha256, sizeof(image_sha256), "%s", sha256->valuestring);
+    cJSON_Delete(root);
+
+    err = ESP_ERR_NOT_FOUND;
+    if (patch_url[0] != '\0') {
+        ESP_LOGI(TAG, "Updating %s -> %s with a patch from %s", running.version, image_version, patch_url);
+        err = install(patch_url, base_sha256, image_size, image_sha256, image_version);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Patch failed (%s), downloading the full image", esp_err_to_name(err));
+        }
+    }
+    if (err != ESP_OK) {
+        ESP_LOGI(TAG, "Updating %s -> %s from %s", running.version, image_version, target);
+        err = install(target, NULL, image_size, image_sha256, image_version);
+    }
+    hal_http_close_idle();
+    return err;
+}
+
+esp_err_t ota_update_poll(float battery_percent) {
+    if (OTA_MANIFEST_URL[0] == '\0') {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    schedule_load();
+    if (schedule.wakes_left > 0) {
+        schedule.wakes_left--;
+        schedule_commit();
+        return ESP_ERR_NOT_FINISHED;
+    }
+    if (battery_percent >= 0 && battery_percent < OTA_UPDATE_MIN_BATTERY) {
+        ESP_LOGI(TAG, "Update check postponed: battery %.0f%%", battery_percent);
+        schedule_commit();
+        return ESP_ERR_NOT_FINISHED;
+    }
+
+    schedule.wakes_left = OTA_UPDATE_CHECK_WAKES;
+    schedule_commit();
+    return ota_update_check(OTA_MANIFEST_URL);
+}
+
+void ota_update_confirm(bool online) {
+    schedule_load();
+    hal_ota_app_t running;
+    hal_ota_running(&running);
+    if (hal_ota_pending_verify()) {
+        hal_ota_confirm(true);
+        bool fell_back = schedule.fell_back != 0;
+        schedule.offline_wakes = online || fell_back ? 0 : 1;
+        schedule.fell_back = 0;
+        schedule_commit();
+        if (fell_back) {
+            ESP_LOGW(TAG, "Fell back to firmware %s", running.version);
+        } else if (online) {
+            ESP_LOGI(TAG, "Firmware %s confirmed on its first boot", running.version);
+        } else {
+            ESP_LOGW(TAG, "Firmware %s booted offline, %d offline wakes until it falls back",
+                     running.version, OTA_UPDATE_OFFLINE_WAKES - 1);
+        }
+        return;
+    }
+    if (schedule.offline_wakes == 0) {
+        return;
+    }
+
+    // On probation: getting online once proves it
+    if (online) {
+        ESP_LOGI(TAG, "Firmware %s got online after %lu offline wakes", running.version,
+                 (unsigned long)schedule.offline_wakes);
+        schedule.offline_wakes = 0;
+        schedule_commit();
+        return;
+    }
+    schedule.offline_wakes++;
+    if (schedule.offline_wakes < OTA_UPDATE_OFFLINE_WAKES) {
+        schedule_commit();
+        return;
+    }
+    schedule.offline_wakes = 0;
+    esp_err_t err = hal_ota_fall_back();
+    schedule.fell_back = err == ESP_OK;
+    schedule_commit();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Firmware %s stayed offline, no image to fall back to: %s", running.version,
+                 esp_err_to_name(err));
+        return;
+    }
+    ESP_LOGE(TAG, "Firmware %s stayed offline for %d wakes, the next wake boots the previous image",
+             running.version, OTA_UPDATE_OFFLINE_WAKES);
+}
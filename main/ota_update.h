@@ -0,0 +1,127 @@
+#pragma once
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "hal_ota.h"
+#include "mbedtls/sha256.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OTA_UPDATE_CHECK_WAKES 40          // Connected wakes between manifest checks (about a day)
+#define OTA_UPDATE_MIN_BATTERY 30.0f       // Percent; no image is written below it
+#define OTA_UPDATE_OFFLINE_WAKES 3         // Offline wakes in a row before a new image falls back
+#define OTA_UPDATE_TIMEOUT_MS 10000        // Network timeout of the manifest and image requests
+#define OTA_UPDATE_MANIFEST_SIZE 768
+#define OTA_UPDATE_URL_SIZE 256
+#define OTA_UPDATE_HEADER_SIZE 112         // Image header, segment header and app descriptor
+                                           // up to project_name: checked before flash is touched
+
+/**
+ * An image arriving in pieces (HTTP download or portal upload), written to
+ * the inactive app slot as it comes: only the first OTA_UPDATE_HEADER_SIZE
+ * bytes are held back, until they show the image is for this project
+ */
+typedef struct {
+    size_t size;                       // Announced size
+    size_t received;
+    bool check_digest;                 // digest was given
+    uint8_t digest[32];                // Expected SHA-256 of the whole image
+    char version[HAL_OTA_NAME_SIZE];   // Expected version, "" for any
+    hal_ota_app_t app;                 // From the image's app descriptor
+    uint8_t header[OTA_UPDATE_HEADER_SIZE];
+    bool opened;                       // hal_ota_begin() done
+    esp_err_t err;                     // First error; later data is dropped
+    mbedtls_sha256_context sha;
+    int64_t started_us;
+    int64_t flash_us;                  // Time spent in hal_ota_write()
+} ota_receiver_t;
+
+/**
+ * Prepare to receive an image
+ *
+ * @param rx Receiver (static: it holds the SHA-256 state and the header)
+ * @param size Image size in bytes
+ * @param sha256_hex Expected SHA-256 as 64 hex digits, NULL to rely on the
+ *                   digest the build appends to the image
+ * @param version Version the app descriptor must carry, NULL for any
+ * @return ESP_OK, ESP_ERR_INVALID_SIZE if it cannot fit an app slot,
+ *         ESP_ERR_INVALID_ARG for a malformed digest
+ */
+esp_err_t ota_receiver_begin(ota_receiver_t* rx, size_t size, const char* sha256_hex, const char* version);
+
+/**
+ * Take the next piece of the image
+ *
+ * @return ESP_OK, or the receiver's first error (the image is then dropped:
+ *         ESP_ERR_INVALID_VERSION for another project or version,
+ *         ESP_ERR_INVALID_SIZE for more data than announced)
+ */
+esp_err_t ota_receiver_write(ota_receiver_t* rx, const void* data, size_t length);
+
+/**
+ * Check the complete image and log the transfer and flash rates
+ *
+ * @param activate Boot it from the next boot on
+ * @return ESP_OK, ESP_ERR_INVALID_SIZE if incomplete, ESP_ERR_INVALID_CRC
+ *         if the SHA-256 or the image validation failed
+ */
+esp_err_t ota_receiver_finish(ota_receiver_t* rx, bool activate);
+
+/**
+ * Drop a partly received image (transfer failed)
+ */
+void ota_receiver_abort(ota_receiver_t* rx);
+
+/**
+ * Check the manifest at CONFIG_QUOTE_OTA_MANIFEST_URL if it is due: on the
+ * first connected wake after a power loss, then every
+ * OTA_UPDATE_CHECK_WAKES connected wakes (RTC memory). Skipped below
+ * OTA_UPDATE_MIN_BATTERY and when no URL is configured. Call online, after
+ * the display refresh.
+ *
+ * @param battery_percent Charge, negative if unknown
+ * @return As ota_update_check(); ESP_ERR_NOT_FINISHED if not due,
+ *         ESP_ERR_NOT_SUPPORTED without a manifest URL
+ */
+esp_err_t ota_update_poll(float battery_percent);
+
+/**
+ * Fetch a manifest {"version":"1.1.0","url":"...","size":123,"sha256":"..."}
+ * and install its image unless that version is running or was rolled back
+ * before. The image streams into the inactive slot; the next boot (the
+ * next wake) runs it. A url starting with '/' is on the manifest's host.
+ *
+ * An optional "patch":{"from":"<SHA-256 of the base image>","url":"..."}
+ * is downloaded instead when it was made against the running image
+ * (ota_delta.h); if it fails, the full image is fetched in the same call.
+ *
+ * An optional "maintenance":<minutes> asks for a maintenance window on the
+ * next connected wake (maintenance.h), whatever the version.
+ *
+ * @param manifest_url Full URL
+ * @return ESP_OK if an image was installed, ESP_ERR_NOT_FOUND if there is
+ *         nothing to install, an error if the manifest or image failed
+ */
+esp_err_t ota_update_check(const char* manifest_url);
+
+/**
+ * Settle a new image. Its first boot reached this point, so it is confirmed
+ * (the bootloader rolls back an image still pending at the next boot, deep
+ * sleep wakes included; crashes before this point are rolled back that way).
+ * An image that has not been online yet is on probation in RTC memory: after
+ * OTA_UPDATE_OFFLINE_WAKES offline wakes in a row it falls back to the
+ * previous image from the next wake on, without a restart and without being
+ * reported as rejected, so the release is installed again once online.
+ * No-op for images that got online.
+ *
+ * @param online true if the station connected this wake, or the portal runs
+ */
+void ota_update_confirm(bool online);
+
+#ifdef __cplusplus
+}
+#endif
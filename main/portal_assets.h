@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * One file of the provisioning portal, stored in flash as it is sent
+ */
+typedef struct {
+    const char* uri;             // "/" and "/index.html" share the same data
+    const char* content_type;
+    const uint8_t* data;         // Minified, gzipped if that made it smaller
+    uint32_t size;
+    const char* etag;            // Quoted hash of data
+    bool gzip;                   // Send with Content-Encoding: gzip
+} portal_asset_t;
+
+/**
+ * Generated at build time from the files in main/portal/
+ * (tools/gen_portal_assets.py)
+ */
+extern const portal_asset_t portal_assets[];
+extern const size_t portal_asset_count;
+
+#ifdef __cplusplus
+}
+#endif
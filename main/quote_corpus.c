@@ -0,0 +1,40 @@
+#include "quote_provider.h"
+#include "esp_random.h"
+#include <stdio.h>
+
+// Quotes built into flash: shown when neither the network nor the prefetch
+// cache has one, so an offline wake still gets a different quote
+static const struct {
+    const char* text;
+    const char* author;
+} corpus[] = {
+    {"La semplicità è l'ultima sofisticazione.", "Leonardo da Vinci"},
+    {"Fatti non foste a viver come bruti, ma per seguir virtute e canoscenza.", "Dante Alighieri"},
+    {"Eppur si muove.", "Galileo Galilei"},
+    {"Chi va piano va sano e va lontano.", "Proverbio"},
+    {"Il dolce far niente.", "Anonimo"},
+    {"Ogni cosa che puoi immaginare, la natura l'ha già creata.", "Albert Einstein"},
+    {"Un libro è un giardino che si porta in tasca.", "Proverbio arabo"},
+    {"La pazienza è amara, ma il suo frutto è dolce.", "Jean-Jacques Rousseau"},
+    {"Chi non risica non rosica.", "Proverbio"},
+    {"L'amor che move il sole e l'altre stelle.", "Dante Alighieri"},
+    {"Il tempo è il più saggio dei consiglieri.", "Pericle"},
+    {"Non è mai troppo tardi per diventare ciò che avresti potuto essere.", "George Eliot"},
+    {"La vita è quello che ti succede mentre sei occupato a fare altri progetti.", "John Lennon"},
+    {"Sapere aude.", "Orazio"},
+    {"Il mondo è un libro e chi non viaggia ne legge solo una pagina.", "Sant'Agostino"},
+    {"Volere è potere.", "Proverbio"},
+};
+#define CORPUS_SIZE (sizeof(corpus) / sizeof(corpus[0]))
+
+static esp_err_t corpus_get(quote_t* quote) {
+    uint32_t index = esp_random() % CORPUS_SIZE;
+    snprintf(quote->text, sizeof(quote->text), "%s", corpus[index].text);
+    snprintf(quote->author, sizeof(quote->author), "%s", corpus[index].author);
+    return ESP_OK;
+}
+
+const quote_provider_t quote_provider_corpus = {
+    .name = "corpus",
+    .get = corpus_get,
+};
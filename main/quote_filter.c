@@ -0,0 +1,87 @@
+#include "quote_filter.h"
+#include <math.h>
+#include <string.h>
+
+#define QUOTE_FILTER_BITS (QUOTE_FILTER_BYTES * 8)
+#define FNV_OFFSET 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+static uint64_t fnv_normalized(uint64_t hash, const char* s) {
+    for (; *s != '\0'; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c >= 'A' && c <= 'Z') {
+            c += 'a' - 'A';
+        } else if (!((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c >= 0x80)) {
+            continue;
+        }
+        hash = (hash ^ c) * FNV_PRIME;
+    }
+    return hash;
+}
+
+uint64_t quote_filter_key(const char* text, const char* author) {
+    uint64_t hash = fnv_normalized(FNV_OFFSET, text);
+    hash = (hash ^ 0xFF) * FNV_PRIME;  // Separator: not a byte of normalized text
+    return fnv_normalized(hash, author);
+}
+
+void quote_filter_clear(quote_filter_t* filter) {
+    memset(filter, 0, sizeof(*filter));
+}
+
+// Bit i of the key's k positions: h1 + i * h2 (double hashing), h2 odd
+static uint32_t bit_index(uint64_t key, int i) {
+    uint32_t h1 = (uint32_t)key;
+    uint32_t h2 = (uint32_t)(key >> 32) | 1;
+    return (h1 + (uint32_t)i * h2) % QUOTE_FILTER_BITS;
+}
+
+static bool generation_contains(const uint8_t* bits, uint64_t key) {
+    for (int i = 0; i < QUOTE_FILTER_HASHES; i++) {
+        uint32_t bit = bit_index(key, i);
+        if ((bits[bit / 8] & (1u << (bit % 8))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool quote_filter_contains(const quote_filter_t* filter, uint64_t key) {
+    return generation_contains(filter->bits[0], key) || generation_contains(filter->bits[1], key);
+}
+
+bool quote_filter_add(quote_filter_t* filter, uint64_t key) {
+    if (quote_filter_contains(filter, key)) {
+        return false;
+    }
+
+    if (filter->count[filter->current] >= QUOTE_FILTER_CAPACITY) {
+        filter->current ^= 1;
+        filter->count[filter->current] = 0;
+        memset(filter->bits[filter->current], 0, QUOTE_FILTER_BYTES);
+    }
+
+    uint8_t* bits = filter->bits[filter->current];
+    for (int i = 0; i < QUOTE_FILTER_HASHES; i++) {
+        uint32_t bit = bit_index(key, i);
+        bits[bit / 8] |= 1u << (bit % 8);
+    }
+    filter->count[filter->current]++;
+    return true;
+}
+
+uint32_t quote_filter_count(const quote_filter_t* filter) {
+    return filter->count[0] + filter->count[1];
+}
+
+float quote_filter_fp_rate(const quote_filter_t* filter) {
+    float miss = 1.0f;
+    for (int g = 0; g < 2; g++) {
+        uint32_t set = 0;
+        for (size_t i = 0; i < QUOTE_FILTER_BYTES; i++) {
+            set += (uint32_t)__builtin_popcount(filter->bits[g][i]);
+        }
+        miss *= 1.0f - powf((float)set / QUOTE_FILTER_BITS, QUOTE_FILTER_HASHES);
+    }
+    return 1.0f - miss;
+}
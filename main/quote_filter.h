@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define QUOTE_FILTER_BYTES 1536        // Per generation (12288 bits)
+#define QUOTE_FILTER_CAPACITY 1024     // Quotes per generation before the older one is dropped
+#define QUOTE_FILTER_HASHES 7          // Bits set per quote (optimal at 12 bits/quote)
+
+/**
+ * Seen-quote Bloom filter with two generations
+ *
+ * New quotes go into the current generation; lookups check both. When the
+ * current one holds QUOTE_FILTER_CAPACITY quotes, the older generation is
+ * cleared and becomes current, so the filter remembers the last 1024-2048
+ * quotes and its false-positive rate never grows past that fill.
+ */
+typedef struct {
+    uint32_t count[2];                          // Quotes added to each generation
+    uint32_t current;                           // Generation receiving new quotes
+    uint8_t bits[2][QUOTE_FILTER_BYTES];
+} quote_filter_t;
+
+/**
+ * Key of a quote: 64-bit FNV-1a of text and author, ASCII case and
+ * anything but letters, digits and UTF-8 ignored, so spacing and
+ * punctuation variants of one quote match
+ */
+uint64_t quote_filter_key(const char* text, const char* author);
+
+/**
+ * Empty both generations
+ */
+void quote_filter_clear(quote_filter_t* filter);
+
+/**
+ * @return true if the key was (probably) added before
+ */
+bool quote_filter_contains(const quote_filter_t* filter, uint64_t key);
+
+/**
+ * Add a key, rotating generations when the current one is full
+ * @return true if the key was new (not already contained)
+ */
+bool quote_filter_add(quote_filter_t* filter, uint64_t key);
+
+/**
+ * @return Quotes remembered (both generations)
+ */
+uint32_t quote_filter_count(const quote_filter_t* filter);
+
+/**
+ * False-positive rate estimated from the bits set: a new key hits a
+ * generation with probability fill^k
+ *
+ * @return Probability (0-1) that an unseen quote is reported as seen
+ */
+float quote_filter_fp_rate(const quote_filter_t* filter);
+
+#ifdef __cplusplus
+}
+#endif
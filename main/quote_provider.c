@@ -0,0 +1,555 @@
+#include "quote_provider.h"
+#include "quote_filter.h"
+#include "dns_cache.h"
+#include "hal_http.h"
+#include "hal_nvs.h"
+#include "hal_time.h"
+#include "esp_log.h"
+#include "rtc_budget.h"
+#include "esp_attr.h"
+#include "esp_rom_crc.h"
+#include "binlog.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "QUOTE_PROVIDER";
+
+#define QUOTE_MAX_NETWORK 2           // Network providers per fetch (one body buffer each)
+#define QUOTE_BODY_BUFFER 4096        // 4KB per response (quotes are much smaller)
+#define QUOTE_URL_SIZE 256
+#define PREFETCH_MIN_MS 1500          // Budget left after a success needed to prefetch
+#define CACHE_MAGIC 0x51434831        // "QCH1"
+#define CACHE_AUTHOR_SIZE 96
+#define SEEN_MAGIC 0x51534E31         // "QSN1"
+#define SEEN_NVS_NAMESPACE "quote_seen"
+#define SEEN_NVS_KEY "filter"
+#define FETCH_STATS_MAGIC 0x51465331  // "QFS1"
+#define FETCH_STATS_NVS_NAMESPACE "quote_stats"
+#define FETCH_STATS_NVS_KEY "fetch"
+
+static const quote_provider_t* const default_network[] = {
+    &quote_provider_vercel,
+    &quote_provider_wikiquote,
+};
+static const quote_provider_t* const default_local[] = {
+    &quote_provider_cache,
+    &quote_provider_corpus,
+};
+
+typedef struct {
+    char text[QUOTE_MAX_LENGTH + 1];
+    char author[CACHE_AUTHOR_SIZE];
+} cached_quote_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t count;
+    cached_quote_t entries[QUOTE_CACHE_SLOTS];
+    uint32_t crc;
+} quote_cache_t;
+RTC_BUDGET_CHECK(quote_cache_t, RTC_BUDGET_QUOTE_CACHE);
+
+// Survives deep sleep; lost on power loss (caught by CRC), which only costs spares
+static RTC_NOINIT_ATTR quote_cache_t cache;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t repeats;              // Repeats rejected
+    uint32_t unsaved;              // New quotes since the last NVS snapshot
+    quote_filter_t filter;
+    uint32_t crc;
+} seen_store_t;
+RTC_BUDGET_CHECK(seen_store_t, RTC_BUDGET_QUOTE_SEEN);
+
+// Quotes already shown. RTC copy for every wake, NVS snapshot every
+// QUOTE_SEEN_SNAPSHOT_INSERTS new quotes: a power loss forgets at most those
+static RTC_NOINIT_ATTR seen_store_t seen;
+static bool seen_loaded = false;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t unsaved;              // Counter updates since the last NVS save
+    quote_fetch_stats_t counters;
+    uint32_t crc;
+} fetch_stats_t;
+RTC_BUDGET_CHECK(fetch_stats_t, RTC_BUDGET_FETCH_STATS);
+
+// Request outcomes for the metrics (maintenance.h). RTC copy for every wake,
+// saved to NVS only when the device state flushes (quote_provider_save_stats())
+static RTC_NOINIT_ATTR fetch_stats_t fetch_stats;
+static bool fetch_stats_loaded = false;
+
+static char body_buffers[QUOTE_MAX_NETWORK][QUOTE_BODY_BUFFER];
+static char urls[QUOTE_MAX_NETWORK][QUOTE_URL_SIZE];
+static quote_t spare;  // Prefetch target, kept off the stack
+
+/**
+ * State shared with the accept callback during one hal_http_get_first() round
+ */
+typedef struct {
+    const quote_provider_t* const* providers;
+    int provider_of[QUOTE_MAX_NETWORK];     // Request slot -> provider index
+    uint8_t attempts_left[QUOTE_MAX_NETWORK];
+    quote_t* quote;
+} race_t;
+
+static uint32_t cache_crc(const quote_cache_t* c) {
+    return esp_rom_crc32_le(0, (const uint8_t*)c, offsetof(quote_cache_t, crc));
+}
+
+static bool cache_valid(void) {
+    return cache.magic == CACHE_MAGIC && cache.count <= QUOTE_CACHE_SLOTS &&
+           cache.crc == cache_crc(&cache);
+}
+
+static void cache_commit(void) {
+    cache.crc = cache_crc(&cache);
+}
+
+int quote_provider_cached(void) {
+    return cache_valid() ? (int)cache.count : 0;
+}
+
+static void cache_push(const quote_t* quote) {
+    if (!cache_valid()) {
+        memset(&cache, 0, sizeof(cache));
+        cache.magic = CACHE_MAGIC;
+    }
+    if (cache.count >= QUOTE_CACHE_SLOTS) {
+        return;
+    }
+
+    cached_quote_t* entry = &cache.entries[cache.count++];
+    // Text is at most QUOTE_MAX_LENGTH (accepted quotes only); long author names are cut
+    snprintf(entry->text, sizeof(entry->text), "%.*s", (int)sizeof(entry->text) - 1, quote->text);
+    snprintf(entry->author, sizeof(entry->author), "%.*s", (int)sizeof(entry->author) - 1, quote->author);
+    cache_commit();
+    BINLOG_I(TAG, "Prefetched a quote from %s (%lu cached)", quote->source, (unsigned long)cache.count);
+}
+
+// Oldest prefetched quote first; each one is shown once
+static esp_err_t cache_get(quote_t* quote) {
+    if (quote_provider_cached() == 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    snprintf(quote->text, sizeof(quote->text), "%s", cache.entries[0].text);
+    snprintf(quote->author, sizeof(quote->author), "%s", cache.entries[0].author);
+    cache.count--;
+    memmove(&cache.entries[0], &cache.entries[1], cache.count * sizeof(cached_quote_t));
+    cache_commit();
+    return ESP_OK;
+}
+
+const quote_provider_t quote_provider_cache = {
+    .name = "cache",
+    .get = cache_get,
+};
+
+static uint32_t seen_crc(const seen_store_t* s) {
+    return esp_rom_crc32_le(0, (const uint8_t*)s, offsetof(seen_store_t, crc));
+}
+
+static bool seen_valid(const seen_store_t* s) {
+    return s->magic == SEEN_MAGIC && s->filter.current <= 1 && s->crc == seen_crc(s);
+}
+
+static void seen_load(void) {
+    if (seen_loaded) {
+        return;
+    }
+    seen_loaded = true;
+    if (seen_valid(&seen)) {
+        return;
+    }
+
+    size_t size = sizeof(seen);
+    if (hal_nvs_get_blob(SEEN_NVS_NAMESPACE, SEEN_NVS_KEY, &seen, &size) == ESP_OK &&
+        size == sizeof(seen) && seen_valid(&seen)) {
+        BINLOG_I(TAG, "Seen filter restored from NVS (%lu quotes)",
+                 (unsigned long)quote_filter_count(&seen.filter));
+        return;
+    }
+
+    memset(&seen, 0, sizeof(seen));
+    seen.magic = SEEN_MAGIC;
+    quote_filter_clear(&seen.filter);
+    seen.crc = seen_crc(&seen);
+}
+
+static void seen_snapshot(void) {
+    seen.unsaved = 0;
+    seen.crc = seen_crc(&seen);
+    esp_err_t err = hal_nvs_set_blob(SEEN_NVS_NAMESPACE, SEEN_NVS_KEY, &seen, sizeof(seen));
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to snapshot seen filter: %s", esp_err_to_name(err));
+    }
+}
+
+static bool seen_contains(const quote_t* quote) {
+    seen_load();
+    return quote_filter_contains(&seen.filter, quote_filter_key(quote->text, quote->author));
+}
+
+static void seen_add(const quote_t* quote) {
+    seen_load();
+    if (!quote_filter_add(&seen.filter, quote_filter_key(quote->text, quote->author))) {
+        return;
+    }
+    if (++seen.unsaved >= QUOTE_SEEN_SNAPSHOT_INSERTS) {
+        seen_snapshot();
+    } else {
+        seen.crc = seen_crc(&seen);
+    }
+}
+
+void quote_provider_seen_stats(quote_seen_stats_t* stats) {
+    seen_load();
+    stats->quotes = quote_filter_count(&seen.filter);
+    stats->repeats = seen.repeats;
+    stats->unsaved = seen.unsaved;
+    stats->fp_rate = quote_filter_fp_rate(&seen.filter);
+    stats->bytes = sizeof(seen);
+}
+
+static uint32_t fetch_stats_crc(void) {
+    return esp_rom_crc32_le(0, (const uint8_t*)&fetch_stats, offsetof(fetch_stats_t, crc));
+}
+
+static bool fetch_stats_valid(void) {
+    return fetch_stats.magic == FETCH_STATS_MAGIC && fetch_stats.crc == fetch_stats_crc();
+}
+
+// RTC copy, else the NVS copy (power loss), else zero
+static quote_fetch_stats_t* fetch_counters(void) {
+    if (!fetch_stats_loaded) {
+        fetch_stats_loaded = true;
+        size_t size = sizeof(fetch_stats);
+        if (!fetch_stats_valid() &&
+            (hal_nvs_get_blob(FETCH_STATS_NVS_NAMESPACE, FETCH_STATS_NVS_KEY, &fetch_stats, &size) != ESP_OK ||
+             size != sizeof(fetch_stats) || !fetch_stats_valid())) {
+            memset(&fetch_stats, 0, sizeof(fetch_stats));
+            fetch_stats.magic = FETCH_STATS_MAGIC;
+            fetch_stats.crc = fetch_stats_crc();
+        }
+    }
+    return &fetch_stats.counters;
+}
+
+static void fetch_stats_changed(void) {
+    fetch_stats.unsaved++;
+    fetch_stats.crc = fetch_stats_crc();
+}
+
+void quote_provider_save_stats(void) {
+    fetch_counters();
+    if (fetch_stats.unsaved == 0) {
+        return;
+    }
+    fetch_stats.unsaved = 0;
+    fetch_stats.crc = fetch_stats_crc();
+    esp_err_t err = hal_nvs_set_blob(FETCH_STATS_NVS_NAMESPACE, FETCH_STATS_NVS_KEY, &fetch_stats,
+                                     sizeof(fetch_stats));
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to save fetch counters: %s", esp_err_to_name(err));
+    }
+}
+
+// Counters of a provider, NULL once every slot belongs to another one
+static quote_provider_stats_t* provider_counters(const quote_provider_t* provider) {
+    quote_provider_stats_t* slots = fetch_counters()->providers;
+    for (int i = 0; i < QUOTE_STATS_PROVIDERS; i++) {
+        if (slots[i].name[0] == '\0') {
+            snprintf(slots[i].name, sizeof(slots[i].name), "%s", provider->name);
+        }
+        if (strncmp(slots[i].name, provider->name, sizeof(slots[i].name) - 1) == 0) {
+            return &slots[i];
+        }
+    }
+    return NULL;
+}
+
+typedef enum {
+    OUTCOME_SENT,
+    OUTCOME_QUOTE,
+    OUTCOME_TRANSPORT_ERROR,
+    OUTCOME_HTTP_ERROR,
+    OUTCOME_PARSE_ERROR,
+    OUTCOME_REJECTED,
+} outcome_t;
+
+static void count_request(const quote_provider_t* provider, outcome_t outcome, int status) {
+    quote_provider_stats_t* counters = provider_counters(provider);
+    if (counters != NULL) {
+        switch (outcome) {
+        case OUTCOME_SENT: counters->requests++; break;
+        case OUTCOME_QUOTE: counters->quotes++; break;
+        case OUTCOME_TRANSPORT_ERROR: counters->transport_errors++; break;
+        case OUTCOME_HTTP_ERROR: counters->http_errors++; break;
+        case OUTCOME_PARSE_ERROR: counters->parse_errors++; break;
+        case OUTCOME_REJECTED: counters->rejected++; break;
+        }
+        if (status != 0) {
+            counters->last_status = status;
+        }
+    }
+    fetch_stats_changed();
+}
+
+void quote_provider_fetch_stats(quote_fetch_stats_t* stats) {
+    *stats = *fetch_counters();
+}
+
+static bool accept_quote(int index, hal_http_request_t* request, void* ctx) {
+    race_t* race = (race_t*)ctx;
+    int p = race->provider_of[index];
+    const quote_provider_t* provider = race->providers[p];
+
+    if (request->result != ESP_OK) {
+        count_request(provider, OUTCOME_TRANSPORT_ERROR, 0);
+        if (request->addr != 0 && !request->reused) {
+            dns_cache_failed_url(request->url);  // The cached address may be gone
+        }
+        race->attempts_left[p] = 0;
+        return false;
+    }
+
+    BINLOG_I(TAG, "%s: HTTP %d, %d bytes in %d ms (%s connection)", provider->name,
+             request->response.status, (int)request->response.length, request->elapsed_ms,
+             request->reused ? "kept-alive" : "new");
+
+    // 304 only comes back to a conditional request: the provider's stored copy is current
+    int status = request->response.status;
+    if (status != 304 && (status != 200 || request->response.length == 0)) {
+        ESP_LOGE(TAG, "%s: HTTP request failed with status code: %d", provider->name, status);
+        count_request(provider, OUTCOME_HTTP_ERROR, status);
+        race->attempts_left[p] = 0;
+        return false;
+    }
+
+    if (provider->parse(&request->response, race->quote) != ESP_OK) {
+        ESP_LOGE(TAG, "%s: no quote in response", provider->name);
+        count_request(provider, OUTCOME_PARSE_ERROR, status);
+        race->attempts_left[p] = 0;
+        return false;
+    }
+
+    size_t quote_len = strlen(race->quote->text);
+    if (quote_len > QUOTE_MAX_LENGTH) {
+        ESP_LOGW(TAG, "%s: quote too long (%d chars > %d)", provider->name,
+                 (int)quote_len, QUOTE_MAX_LENGTH);
+        count_request(provider, OUTCOME_REJECTED, status);
+        return false;  // Re-requested while attempts are left
+    }
+
+    if (provider->dedup && seen_contains(race->quote)) {
+        BINLOG_W(TAG, "%s: quote already shown, rejected", provider->name);
+        seen.repeats++;
+        seen.crc = seen_crc(&seen);
+        count_request(provider, OUTCOME_REJECTED, status);
+        return false;  // Re-requested while attempts are left
+    }
+
+    // Also remembered from non-dedup providers, so random ones skip it later
+    seen_add(race->quote);
+    race->quote->source = provider->name;
+    count_request(provider, OUTCOME_QUOTE, status);
+    return true;
+}
+
+static void log_http_stats(void) {
+    hal_http_stats_t http;
+    hal_http_get_stats(&http);
+    if (http.requests > 0) {
+        BINLOG_I(TAG, "HTTP: %lu requests, %lu on kept-alive connections, avg %lu ms, max %lu ms",
+                 (unsigned long)http.requests, (unsigned long)http.reused,
+                 (unsigned long)(http.total_ms / http.requests), (unsigned long)http.max_ms);
+    }
+}
+
+static int start_delay_ms(const quote_schedule_t* schedule, int slot) {
+    return schedule->mode == QUOTE_SCHEDULE_RACE ? 0 : slot * (int)schedule->stagger_ms;
+}
+
+// Rounds of hal_http_get_first() until a provider delivers, every provider
+// is used up or the deadline passes
+static esp_err_t run_network(const quote_provider_t* const* providers, int count,
+                             const quote_schedule_t* schedule, int64_t deadline_us, quote_t* quote) {
+    race_t race = {.providers = providers, .quote = quote};
+    hal_http_request_t requests[QUOTE_MAX_NETWORK];
+
+    if (count > QUOTE_MAX_NETWORK) {
+        ESP_LOGW(TAG, "Using only the first %d of %d network providers", QUOTE_MAX_NETWORK, count);
+        count = QUOTE_MAX_NETWORK;
+    }
+    for (int p = 0; p < count; p++) {
+        race.attempts_left[p] = providers[p]->max_attempts;
+    }
+
+    for (;;) {
+        int remaining_ms = (int)((deadline_us - hal_time_us()) / 1000);
+        if (remaining_ms <= 0) {
+            ESP_LOGW(TAG, "Quote deadline reached");
+            return ESP_ERR_TIMEOUT;
+        }
+
+        // Requests in order of preference, up to the first provider that
+        // can answer without one: that answer wins at its start time
+        int n = 0;
+        int stored = -1;
+        for (int p = 0; p < count; p++) {
+            if (race.attempts_left[p] == 0) {
+                continue;
+            }
+            if (providers[p]->stored != NULL && providers[p]->stored(quote) == ESP_OK) {
+                stored = p;
+                break;
+            }
+            if (providers[p]->build_url(urls[n], sizeof(urls[n])) != ESP_OK) {
+                BINLOG_I(TAG, "%s: skipped", providers[p]->name);
+                race.attempts_left[p] = 0;
+                continue;
+            }
+            race.attempts_left[p]--;
+            race.provider_of[n] = p;
+            requests[n] = (hal_http_request_t){
+                .url = urls[n],
+                .start_delay_ms = start_delay_ms(schedule, n),
+                .response = {.buffer = body_buffers[n], .buffer_size = sizeof(body_buffers[n])},
+            };
+            if (providers[p]->prepare != NULL) {
+                providers[p]->prepare(&requests[n]);
+            }
+            dns_cache_lookup_url(urls[n], &requests[n].addr);  // By name if it fails
+            count_request(providers[p], OUTCOME_SENT, 0);
+            BINLOG_I(TAG, "%s: GET (start +%d ms)", providers[p]->name, requests[n].start_delay_ms);
+            n++;
+        }
+
+        if (n > 0) {
+            int limit_ms = remaining_ms;
+            if (stored >= 0 && start_delay_ms(schedule, n) < limit_ms) {
+                limit_ms = start_delay_ms(schedule, n);
+            }
+            if (limit_ms > 0 && hal_http_get_first(requests, n, limit_ms, accept_quote, &race) >= 0) {
+                return ESP_OK;
+            }
+        }
+
+        if (stored >= 0) {
+            providers[stored]->stored(quote);  // The race may have overwritten it
+            quote->source = providers[stored]->name;
+            BINLOG_I(TAG, "%s: stored quote, no request", quote->source);
+            return ESP_OK;
+        }
+        if (n == 0) {
+            return ESP_FAIL;
+        }
+    }
+}
+
+// Fetch one spare from a provider whose quotes change per request; bounded
+// by the time the main fetch left over
+static void prefetch(const quote_provider_t* const* providers, int count, int64_t deadline_us) {
+    const quote_provider_t* candidates[QUOTE_MAX_NETWORK];
+    int n = 0;
+    for (int p = 0; p < count && n < QUOTE_MAX_NETWORK; p++) {
+        if (providers[p]->prefetch) {
+            candidates[n++] = providers[p];
+        }
+    }
+
+    int remaining_ms = (int)((deadline_us - hal_time_us()) / 1000);
+    if (n == 0 || remaining_ms < PREFETCH_MIN_MS) {
+        return;
+    }
+
+    race_t race = {.providers = candidates, .quote = &spare};
+    hal_http_request_t requests[QUOTE_MAX_NETWORK];
+    int slots = 0;
+    for (int p = 0; p < n; p++) {
+        if (candidates[p]->build_url(urls[slots], sizeof(urls[slots])) != ESP_OK) {
+            continue;
+        }
+        race.provider_of[slots] = p;
+        requests[slots] = (hal_http_request_t){
+            .url = urls[slots],
+            .response = {.buffer = body_buffers[slots], .buffer_size = sizeof(body_buffers[slots])},
+        };
+        if (candidates[p]->prepare != NULL) {
+            candidates[p]->prepare(&requests[slots]);
+        }
+        dns_cache_lookup_url(urls[slots], &requests[slots].addr);
+        count_request(candidates[p], OUTCOME_SENT, 0);
+        slots++;
+    }
+
+    if (slots > 0 && hal_http_get_first(requests, slots, remaining_ms, accept_quote, &race) >= 0) {
+        cache_push(&spare);
+    }
+}
+
+esp_err_t quote_provider_run(const quote_provider_t* const* network, int network_count,
+                             const quote_provider_t* const* local, int local_count,
+                             const quote_schedule_t* schedule, quote_t* quote) {
+    int64_t start_us = hal_time_us();
+    int64_t deadline_us = start_us + (int64_t)schedule->deadline_ms * 1000;
+
+    quote->text[0] = '\0';
+    quote->author[0] = '\0';
+    quote->source = NULL;
+
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    if (network_count > 0 && schedule->deadline_ms > 0) {
+        err = run_network(network, network_count, schedule, deadline_us, quote);
+        quote_fetch_stats_t* counters = fetch_counters();
+        counters->fetches++;
+        counters->network_quotes += err == ESP_OK;
+        counters->deadline_misses += err == ESP_ERR_TIMEOUT;
+        fetch_stats_changed();
+    }
+
+    if (err == ESP_OK) {
+        BINLOG_I(TAG, "Quote from %s after %d ms (%d chars)", quote->source,
+                 (int)((hal_time_us() - start_us) / 1000), (int)strlen(quote->text));
+        if (schedule->prefetch && quote_provider_cached() < QUOTE_CACHE_SLOTS) {
+            prefetch(network, network_count, deadline_us);
+        }
+
+        quote_seen_stats_t stats;
+        quote_provider_seen_stats(&stats);
+        ESP_LOGI(TAG, "Seen filter: %lu quotes, %lu repeats rejected, FP ~%.2f%%, %u bytes",
+                 (unsigned long)stats.quotes, (unsigned long)stats.repeats,
+                 stats.fp_rate * 100.0f, (unsigned)stats.bytes);
+        log_http_stats();
+        return ESP_OK;
+    }
+
+    log_http_stats();
+
+    // Answers network providers kept from an earlier request (no radio)
+    for (int i = 0; i < network_count; i++) {
+        if (network[i]->stored != NULL && network[i]->stored(quote) == ESP_OK) {
+            quote->source = network[i]->name;
+            ESP_LOGW(TAG, "No network quote (%s), using stored %s", esp_err_to_name(err), quote->source);
+            return err;
+        }
+    }
+
+    for (int i = 0; i < local_count; i++) {
+        if (local[i]->get(quote) == ESP_OK) {
+            quote->source = local[i]->name;
+            ESP_LOGW(TAG, "No network quote (%s), using %s", esp_err_to_name(err), quote->source);
+            break;
+        }
+    }
+    return err;
+}
+
+esp_err_t quote_provider_fetch(const quote_schedule_t* schedule, quote_t* quote) {
+    quote_schedule_t defaults = QUOTE_SCHEDULE_DEFAULT();
+    return quote_provider_run(default_network, sizeof(default_network) / sizeof(default_network[0]),
+                              default_local, sizeof(default_local) / sizeof(default_local[0]),
+                              schedule != NULL ? schedule : &defaults, quote);
+}
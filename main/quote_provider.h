@@ -0,0 +1,204 @@
+#pragma once
+
+#include <esp_err.h>
+#include "hal_http.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define QUOTE_TEXT_SIZE 512
+#define QUOTE_AUTHOR_SIZE 128
+#define QUOTE_MAX_LENGTH 160           // Longest quote text accepted (bytes), fits the layout
+
+#define QUOTE_FETCH_DEADLINE_MS 6000   // Radio time for all network providers together
+#define QUOTE_STAGGER_MS 1500          // Start the next provider if the previous has not answered
+#define QUOTE_CACHE_SLOTS 2            // Prefetched quotes kept in RTC memory for offline wakes
+#define QUOTE_SEEN_SNAPSHOT_INSERTS 16 // New quotes between flash snapshots of the seen filter
+#define QUOTE_STATS_PROVIDERS 4        // Network providers with fetch counters
+
+/**
+ * A quote ready for display
+ */
+typedef struct {
+    char text[QUOTE_TEXT_SIZE];
+    char author[QUOTE_AUTHOR_SIZE];
+    const char* source;        // Name of the provider that supplied it
+} quote_t;
+
+/**
+ * One quote source
+ *
+ * Network providers set build_url and parse; the scheduler fetches them
+ * through hal_http_get_first(). Local providers set get and are only asked
+ * when no network provider delivered within the deadline.
+ *
+ * A network provider may also answer without a request (stored), e.g.
+ * when it already fetched today's quote: it then takes the place of its
+ * request and wins as soon as its start time comes.
+ */
+typedef struct {
+    const char* name;
+
+    /**
+     * Build the request URL
+     * @return ESP_OK, or an error to skip the provider this wake
+     */
+    esp_err_t (*build_url)(char* url, size_t size);
+
+    /**
+     * Optional: adjust the request before it starts (conditional request
+     * validators, streaming body callback)
+     */
+    void (*prepare)(hal_http_request_t* request);
+
+    /**
+     * Extract the quote from a 200 (body NUL-terminated unless streamed)
+     * or 304 response
+     */
+    esp_err_t (*parse)(const hal_http_response_t* response, quote_t* quote);
+
+    /**
+     * Optional: quote available without a request this wake
+     */
+    esp_err_t (*stored)(quote_t* quote);
+
+    uint8_t max_attempts;      // Requests per fetch; a quote over QUOTE_MAX_LENGTH is re-requested
+    bool prefetch;             // Every request returns a different quote: worth caching spares
+    bool dedup;                // Quotes already shown are rejected (and re-requested)
+
+    /**
+     * Produce a quote without the radio
+     */
+    esp_err_t (*get)(quote_t* quote);
+} quote_provider_t;
+
+typedef enum {
+    QUOTE_SCHEDULE_STAGGER,    // Next provider starts after stagger_ms (or when the previous failed)
+    QUOTE_SCHEDULE_RACE,       // All providers start at once (one TLS session each)
+} quote_schedule_mode_t;
+
+/**
+ * How the network providers share the deadline
+ */
+typedef struct {
+    quote_schedule_mode_t mode;
+    uint32_t deadline_ms;      // For the whole fetch, retries and prefetch included
+    uint32_t stagger_ms;       // QUOTE_SCHEDULE_STAGGER only
+    bool prefetch;             // Top up the RTC cache with the time left after a success
+} quote_schedule_t;
+
+#define QUOTE_SCHEDULE_DEFAULT() {              \
+    .mode = QUOTE_SCHEDULE_STAGGER,             \
+    .deadline_ms = QUOTE_FETCH_DEADLINE_MS,     \
+    .stagger_ms = QUOTE_STAGGER_MS,             \
+    .prefetch = true,                           \
+}
+
+// Providers (wikiquote.c, quote_corpus.c, quote_provider.c)
+extern const quote_provider_t quote_provider_vercel;     // Random Italian quote API
+extern const quote_provider_t quote_provider_wikiquote;  // Wikiquote quote of the day
+extern const quote_provider_t quote_provider_cache;      // Prefetched quotes in RTC memory
+extern const quote_provider_t quote_provider_corpus;     // Quotes built into flash
+
+/**
+ * Fetch a quote from the given providers
+ *
+ * Network providers are scheduled under one deadline and the first valid
+ * quote wins; if none delivers, stored answers of network providers and
+ * then local providers are asked in order. A deadline of 0 skips the
+ * network.
+ *
+ * @param network Network providers, in order of preference
+ * @param network_count Number of network providers
+ * @param local Local fallbacks, in order (may be NULL)
+ * @param local_count Number of local fallbacks
+ * @param schedule Deadline and start policy
+ * @param quote Filled whenever any provider delivered
+ * @return ESP_OK with a network quote, otherwise the network error
+ *         (quote filled by a stored answer or local fallback if one delivered)
+ */
+esp_err_t quote_provider_run(const quote_provider_t* const* network, int network_count,
+                             const quote_provider_t* const* local, int local_count,
+                             const quote_schedule_t* schedule, quote_t* quote);
+
+/**
+ * Fetch a quote from the default providers: the quote API and the
+ * Wikiquote quote of the day over the network, then the prefetched cache
+ * and the built-in corpus. Always fills the quote.
+ *
+ * @param schedule Deadline and start policy (NULL for QUOTE_SCHEDULE_DEFAULT)
+ * @param quote Quote to display
+ * @return ESP_OK with a network quote, otherwise the network error
+ */
+esp_err_t quote_provider_fetch(const quote_schedule_t* schedule, quote_t* quote);
+
+/**
+ * @return Quotes waiting in the prefetch cache
+ */
+int quote_provider_cached(void);
+
+/**
+ * Seen-quote filter statistics
+ */
+typedef struct {
+    uint32_t quotes;           // Quotes remembered
+    uint32_t repeats;          // Repeats rejected since the filter was created
+    uint32_t unsaved;          // New quotes not yet in the flash snapshot
+    float fp_rate;             // Estimated chance that an unseen quote is rejected
+    size_t bytes;              // RTC memory used (also the NVS snapshot size)
+} quote_seen_stats_t;
+
+/**
+ * Report the seen-quote filter state
+ *
+ * @param stats Filled with the current statistics
+ */
+void quote_provider_seen_stats(quote_seen_stats_t* stats);
+
+/**
+ * Outcomes of one network provider's requests
+ */
+typedef struct {
+    char name[16];
+    uint32_t requests;         // Sent, prefetch included; those without an outcome
+                               // below were dropped when another provider won
+    uint32_t quotes;           // Accepted
+    uint32_t transport_errors; // No response: connect, TLS, timeout
+    uint32_t http_errors;      // Status other than 200 and 304
+    uint32_t parse_errors;     // No quote in the body
+    uint32_t rejected;         // Too long or already shown (re-requested)
+    int32_t last_status;       // Of the last response, 0 = none yet
+} quote_provider_stats_t;
+
+/**
+ * Fetch outcomes since the counters were first saved (RTC memory, NVS copy)
+ */
+typedef struct {
+    uint32_t fetches;          // Fetches that used the network
+    uint32_t network_quotes;   // Of which ended with a network quote
+    uint32_t deadline_misses;  // Of which ran into the deadline
+    quote_provider_stats_t providers[QUOTE_STATS_PROVIDERS];  // By first request, unused: name ""
+} quote_fetch_stats_t;
+
+/**
+ * Report the network fetch outcomes
+ *
+ * @param stats Filled with the counters
+ */
+void quote_provider_fetch_stats(quote_fetch_stats_t* stats);
+
+/**
+ * Save the fetch counters to NVS if they changed since the last save
+ * Called when the device state flushes (device_state_end_wake()), so the
+ * counters add one commit per flush instead of one per fetch; a power loss forgets at most
+ * the fetches since then.
+ */
+void quote_provider_save_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
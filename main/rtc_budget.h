@@ -0,0 +1,41 @@
+#pragma once
+
+/**
+ * RTC slow memory budget
+ *
+ * Every RTC_NOINIT_ATTR variable lives in the 8 KB of RTC slow memory. Each
+ * one has an allocation here that its module checks with RTC_BUDGET_CHECK(),
+ * and the allocations together must fit RTC_BUDGET_SIZE, so a struct that
+ * grows fails the build here instead of at link time (or not at all, with
+ * other RTC users). Allocations are the struct sizes of the host build
+ * (64-bit, the larger ones) rounded up to 8 bytes. DOCUMENTATION.md
+ * ("RTC Memory Budget") lists them.
+ */
+
+#define RTC_BUDGET_SIZE 8192           // ESP32 RTC slow memory
+
+#define RTC_BUDGET_QUOTE_SEEN 3104     // quote_provider.c: seen filter (two generations)
+#define RTC_BUDGET_BINLOG 2320         // binlog.c: record ring
+#define RTC_BUDGET_WIFI_NETWORKS 600   // wifi_networks.c: known networks and stats
+#define RTC_BUDGET_QUOTE_CACHE 528     // quote_provider.c: prefetched quotes
+#define RTC_BUDGET_DEVICE_STATE 448    // device_state.c: counters and battery history
+#define RTC_BUDGET_QOTD 368            // wikiquote.c: today's quote of the day
+#define RTC_BUDGET_DNS_CACHE 320       // dns_cache.c: answers and hit counters
+#define RTC_BUDGET_FETCH_STATS 200     // quote_provider.c: fetch counters (NVS copy on flush)
+#define RTC_BUDGET_WAKE_BUDGET 152     // wake_budget.c: outcomes and wake history
+#define RTC_BUDGET_MAINTENANCE 16      // maintenance.c: requested window
+#define RTC_BUDGET_OTA_SCHEDULE 24     // ota_update.c: wakes to the next check, probation
+
+#define RTC_BUDGET_USED                                                                   \
+    (RTC_BUDGET_QUOTE_SEEN + RTC_BUDGET_BINLOG + RTC_BUDGET_WIFI_NETWORKS +               \
+     RTC_BUDGET_QUOTE_CACHE + RTC_BUDGET_DEVICE_STATE + RTC_BUDGET_QOTD +                 \
+     RTC_BUDGET_DNS_CACHE + RTC_BUDGET_FETCH_STATS + RTC_BUDGET_WAKE_BUDGET +             \
+     RTC_BUDGET_MAINTENANCE + RTC_BUDGET_OTA_SCHEDULE)
+
+_Static_assert(RTC_BUDGET_USED <= RTC_BUDGET_SIZE, "RTC allocations exceed RTC slow memory");
+
+/**
+ * Check a module's RTC state against its allocation (file scope)
+ */
+#define RTC_BUDGET_CHECK(type, budget) \
+    _Static_assert(sizeof(type) <= (budget), #type " outgrew " #budget " (rtc_budget.h)")
@@ -0,0 +1,256 @@
+#include "screenshot.h"
+#include "hal_display.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "SCREENSHOT";
+
+#define DEFLATE_MAX_MATCH 258
+#define ADLER_MOD 65521
+
+/*
+ * The PNG's zlib stream is one fixed-Huffman deflate block. The only
+ * matches are at distance 1, so a run of a repeated byte is a literal and
+ * one length code per 258 bytes: a white row (481 bytes of 4-bit pixels)
+ * costs 6 bytes, a row through a line of text a few hundred.
+ */
+
+typedef struct {
+    screenshot_write_t write;
+    void* ctx;
+    esp_err_t err;                  // First error; later output is dropped
+    size_t written;
+    int width;
+    uint32_t bits;                  // Deflate bits not yet in a byte, LSB first
+    int bit_count;
+    int prev;                       // Last literal, -1 before the first
+    int run;                        // Repeats of prev not yet coded
+    uint32_t adler_a;
+    uint32_t adler_b;
+    size_t idat_len;
+    uint8_t idat[8 + SCREENSHOT_IDAT_SIZE + 4];   // Length and type, data, CRC
+    uint8_t gray[];                 // One row of levels, then the packed PNG row
+} encoder_t;
+
+// Length codes 257..285: first length and extra bits
+static const uint16_t length_base[] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+};
+static const uint8_t length_extra[] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+};
+
+static void put_be32(uint8_t* p, uint32_t value) {
+    p[0] = value >> 24;
+    p[1] = value >> 16;
+    p[2] = value >> 8;
+    p[3] = value;
+}
+
+static void emit(encoder_t* e, const void* data, size_t length) {
+    if (e->err == ESP_OK) {
+        e->err = e->write(data, length, e->ctx);
+        e->written += length;
+    }
+}
+
+// A whole PNG chunk in one write
+static void emit_chunk(encoder_t* e, const char* type, const uint8_t* data, size_t length) {
+    uint8_t chunk[8 + 13 + 4];      // Largest small chunk is IHDR
+    put_be32(chunk, length);
+    memcpy(chunk + 4, type, 4);
+    if (length > 0) {
+        memcpy(chunk + 8, data, length);
+    }
+    put_be32(chunk + 8 + length, esp_rom_crc32_le(0, chunk + 4, 4 + length));
+    emit(e, chunk, 12 + length);
+}
+
+static void flush_idat(encoder_t* e) {
+    if (e->idat_len == 0) {
+        return;
+    }
+    put_be32(e->idat, e->idat_len);
+    memcpy(e->idat + 4, "IDAT", 4);
+    put_be32(e->idat + 8 + e->idat_len, esp_rom_crc32_le(0, e->idat + 4, 4 + e->idat_len));
+    emit(e, e->idat, 12 + e->idat_len);
+    e->idat_len = 0;
+}
+
+static void put_byte(encoder_t* e, uint8_t byte) {
+    e->idat[8 + e->idat_len++] = byte;
+    if (e->idat_len == SCREENSHOT_IDAT_SIZE) {
+        flush_idat(e);
+    }
+}
+
+static void put_bits(encoder_t* e, uint32_t value, int count) {
+    e->bits |= value << e->bit_count;
+    e->bit_count += count;
+    while (e->bit_count >= 8) {
+        put_byte(e, e->bits & 0xFF);
+        e->bits >>= 8;
+        e->bit_count -= 8;
+    }
+}
+
+// Huffman codes are packed starting with their most significant bit
+static void put_code(encoder_t* e, uint32_t code, int length) {
+    uint32_t reversed = 0;
+    for (int i = 0; i < length; i++) {
+        reversed = reversed << 1 | (code >> i & 1);
+    }
+    put_bits(e, reversed, length);
+}
+
+static void put_literal(encoder_t* e, uint8_t byte) {
+    if (byte < 144) {
+        put_code(e, 0x30 + byte, 8);
+    } else {
+        put_code(e, 0x190 + byte - 144, 9);
+    }
+}
+
+// The previous `length` bytes again (distance 1)
+static void put_match(encoder_t* e, int length) {
+    int i = sizeof(length_base) / sizeof(length_base[0]) - 1;
+    while (length_base[i] > length) {
+        i--;
+    }
+    int symbol = 257 + i;
+    if (symbol < 280) {
+        put_code(e, symbol - 256, 7);
+    } else {
+        put_code(e, 0xC0 + symbol - 280, 8);
+    }
+    put_bits(e, length - length_base[i], length_extra[i]);
+    put_code(e, 0, 5);              // Distance code 0: distance 1
+}
+
+static void flush_run(encoder_t* e) {
+    if (e->run >= 3) {
+        put_match(e, e->run);
+    } else {
+        for (int i = 0; i < e->run; i++) {
+            put_literal(e, e->prev);
+        }
+    }
+    e->run = 0;
+}
+
+static void deflate_bytes(encoder_t* e, const uint8_t* data, size_t length) {
+    uint32_t a = e->adler_a, b = e->adler_b;
+    for (size_t i = 0; i < length; i++) {
+        a += data[i];
+        b += a;
+        if (data[i] == e->prev) {
+            if (++e->run == DEFLATE_MAX_MATCH) {
+                flush_run(e);
+            }
+            continue;
+        }
+        flush_run(e);
+        put_literal(e, data[i]);
+        e->prev = data[i];
+    }
+    // A row is at most a few KB: no overflow before the reduction
+    e->adler_a = a % ADLER_MOD;
+    e->adler_b = b % ADLER_MOD;
+}
+
+static void encode_png(encoder_t* e, int height) {
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    emit(e, signature, sizeof(signature));
+
+    uint8_t ihdr[13];
+    put_be32(ihdr, e->width);
+    put_be32(ihdr + 4, height);
+    ihdr[8] = 4;                    // Bit depth
+    ihdr[9] = 0;                    // Grayscale
+    ihdr[10] = 0;                   // Deflate
+    ihdr[11] = 0;                   // Adaptive filtering (every row: none)
+    ihdr[12] = 0;                   // Not interlaced
+    emit_chunk(e, "IHDR", ihdr, sizeof(ihdr));
+
+    put_byte(e, 0x78);              // zlib: deflate, 32 KB window
+    put_byte(e, 0x01);              // No dictionary, fastest
+    put_bits(e, 1, 1);              // Final block
+    put_bits(e, 1, 2);              // Fixed Huffman codes
+
+    uint8_t* row = e->gray + e->width;
+    size_t row_size = 1 + (e->width + 1) / 2;
+    for (int y = 0; y < height && e->err == ESP_OK; y++) {
+        e->err = hal_display_read_row(y, e->gray);
+        row[0] = 0;                 // Filter: none
+        for (int x = 0; x < e->width; x += 2) {
+            uint8_t right = x + 1 < e->width ? e->gray[x + 1] : 0;
+            row[1 + x / 2] = e->gray[x] << 4 | right;
+        }
+        deflate_bytes(e, row, row_size);
+    }
+
+    flush_run(e);
+    put_code(e, 0, 7);              // End of block
+    if (e->bit_count > 0) {
+        put_bits(e, 0, 8 - e->bit_count);
+    }
+    put_byte(e, e->adler_b >> 8);
+    put_byte(e, e->adler_b);
+    put_byte(e, e->adler_a >> 8);
+    put_byte(e, e->adler_a);
+    flush_idat(e);
+    emit_chunk(e, "IEND", NULL, 0);
+}
+
+static void encode_pgm(encoder_t* e, int height) {
+    char header[32];
+    int length = snprintf(header, sizeof(header), "P5\n%d %d\n15\n", e->width, height);
+    emit(e, header, length);
+    for (int y = 0; y < height && e->err == ESP_OK; y++) {
+        e->err = hal_display_read_row(y, e->gray);
+        emit(e, e->gray, e->width);
+    }
+}
+
+esp_err_t screenshot_encode(screenshot_format_t format, screenshot_write_t write, void* ctx) {
+    int width = hal_display_width();
+    int height = hal_display_height();
+
+    // Levels of a row, then the row packed two pixels per byte behind its filter byte
+    encoder_t* e = calloc(1, sizeof(*e) + width + 1 + (width + 1) / 2);
+    if (e == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    e->write = write;
+    e->ctx = ctx;
+    e->width = width;
+    e->prev = -1;
+    e->adler_a = 1;
+
+    if (format == SCREENSHOT_PNG) {
+        encode_png(e, height);
+    } else {
+        encode_pgm(e, height);
+    }
+
+    esp_err_t err = e->err;
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "%dx%d %s: %u bytes", width, height, format == SCREENSHOT_PNG ? "PNG" : "PGM",
+                 (unsigned)e->written);
+    } else {
+        ESP_LOGW(TAG, "Screenshot stopped: %s", esp_err_to_name(err));
+    }
+    free(e);
+    return err;
+}
+
+const char* screenshot_content_type(screenshot_format_t format) {
+    return format == SCREENSHOT_PNG ? "image/png" : "image/x-portable-graymap";
+}
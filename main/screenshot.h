@@ -0,0 +1,54 @@
+#pragma once
+
+#include <esp_err.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SCREENSHOT_IDAT_SIZE 4096          // PNG bytes buffered per IDAT chunk (one write)
+
+/**
+ * Image formats of a screenshot
+ */
+typedef enum {
+    SCREENSHOT_PGM,      // Binary PGM, one byte per pixel (maxval 15)
+    SCREENSHOT_PNG,      // 4-bit grayscale PNG, two pixels per byte
+} screenshot_format_t;
+
+/**
+ * Sink of the encoded image: an HTTP chunk, a file...
+ *
+ * @return ESP_OK, or an error that stops the encoder
+ */
+typedef esp_err_t (*screenshot_write_t)(const void* data, size_t length, void* ctx);
+
+/**
+ * Encode the framebuffer as it is now, row by row (hal_display_read_row()),
+ * without copying it: the PGM goes out a row per write, the PNG an IDAT
+ * chunk of up to SCREENSHOT_IDAT_SIZE bytes per write. Levels are the
+ * panel's 16 grays, 15 = white.
+ *
+ * The PNG is deflated with the fixed Huffman code and runs of repeated bytes
+ * only, which is what an e-paper screen is made of (white margins, black
+ * strokes): a white screen is 3.3 KB against 259 KB of framebuffer, and
+ * the worst case (no byte repeats the one before) is 12% over it.
+ *
+ * RAM: one allocation of about 6 KB while encoding.
+ *
+ * @param format Image format
+ * @param write Sink, called with the image in order
+ * @param ctx Passed to write
+ * @return ESP_OK, ESP_ERR_NO_MEM, or the first error of write or the display
+ */
+esp_err_t screenshot_encode(screenshot_format_t format, screenshot_write_t write, void* ctx);
+
+/**
+ * @return MIME type of a format
+ */
+const char* screenshot_content_type(screenshot_format_t format);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * TLS cipher suites offered to a host
+ */
+typedef enum {
+    TRUST_SUITES_ECDSA_FIRST,    // ECDHE-ECDSA, then ECDHE-RSA
+    TRUST_SUITES_ECDSA,          // ECDHE-ECDSA only
+} trust_suites_t;
+
+/**
+ * Root a host may chain to; which fields are set depends on the trust mode
+ */
+typedef struct {
+    const char* name;            // Common name, for logs
+    const uint8_t* der;          // Certificate (pinned CA mode)
+    uint16_t der_len;
+    const uint8_t* key;          // SubjectPublicKeyInfo (pinned key mode)
+    uint16_t key_len;
+    uint8_t key_sha256[32];      // SHA-256 of key, matched against certificates the server sends
+} trust_anchor_t;
+
+/**
+ * Trust settings of one host
+ */
+typedef struct {
+    const char* host;
+    const trust_anchor_t* const* anchors;
+    uint8_t anchor_count;        // 0 in bundle mode
+    trust_suites_t suites;
+} trust_host_t;
+
+/**
+ * Generated at build time from main/certs/trust_store.txt
+ * (tools/gen_trust_store.py)
+ */
+extern const trust_host_t trust_store_hosts[];
+extern const size_t trust_store_host_count;
+
+#ifdef __cplusplus
+}
+#endif
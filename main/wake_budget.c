@@ -0,0 +1,196 @@
+#include "wake_budget.h"
+#include "mem_profile.h"
+#include "hal_time.h"
+#include "esp_log.h"
+#include "rtc_budget.h"
+#include "esp_attr.h"
+#include "esp_rom_crc.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "WAKE_BUDGET";
+
+#define STATS_MAGIC 0x57424732  // "WBG2"
+
+static const char* const stage_names[WAKE_STAGE_COUNT] = {
+    "boot", "wifi", "sntp", "quote", "display", "update",
+};
+
+/**
+ * A past wake, packed for RTC memory
+ */
+typedef struct {
+    uint16_t stage_cs[WAKE_STAGE_COUNT];     // Centiseconds per stage (up to 655 s)
+    uint8_t budget_s;                        // 0 = no budget
+    int8_t expired;                          // Stage that used up the budget, -1 = none
+} stored_profile_t;
+
+/**
+ * Budget outcomes across wakes
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t wakes;                          // Wakes with a budget
+    uint32_t expired[WAKE_STAGE_COUNT];      // Wakes whose budget ran out in each stage
+    uint8_t history_head;                    // Next slot to write
+    uint8_t history_count;
+    stored_profile_t history[WAKE_BUDGET_HISTORY];
+    uint32_t crc;
+} budget_stats_t;
+RTC_BUDGET_CHECK(budget_stats_t, RTC_BUDGET_WAKE_BUDGET);
+
+// Survives deep sleep; reset by power loss (caught by CRC)
+static RTC_NOINIT_ATTR budget_stats_t stats;
+
+static int64_t deadline_us = 0;              // 0: unlimited
+static uint32_t budget_ms = 0;
+static wake_stage_t current = WAKE_STAGE_BOOT;
+static int64_t stage_start_us = 0;
+static int64_t stage_us[WAKE_STAGE_COUNT];
+static int expired_stage = -1;
+
+static uint32_t stats_crc(void) {
+    return esp_rom_crc32_le(0, (const uint8_t*)&stats, offsetof(budget_stats_t, crc));
+}
+
+static void stats_commit(void) {
+    stats.crc = stats_crc();
+}
+
+void wake_budget_start(uint32_t ms) {
+    budget_ms = ms;
+    deadline_us = ms > 0 ? (int64_t)ms * 1000 : 0;  // hal_time_us() counts from boot
+    current = WAKE_STAGE_BOOT;
+    stage_start_us = 0;
+    memset(stage_us, 0, sizeof(stage_us));
+    expired_stage = -1;
+
+    if (stats.magic != STATS_MAGIC || stats.crc != stats_crc() || stats.history_head >= WAKE_BUDGET_HISTORY) {
+        memset(&stats, 0, sizeof(stats));
+        stats.magic = STATS_MAGIC;
+    }
+    if (ms > 0) {
+        stats.wakes++;
+    }
+    stats_commit();
+}
+
+void wake_budget_enter(wake_stage_t stage) {
+    mem_profile_sample();  // Lows of the stage that ends
+    int64_t now = hal_time_us();
+    stage_us[current] += now - stage_start_us;
+    stage_start_us = now;
+    current = stage;
+}
+
+wake_stage_t wake_budget_stage(void) {
+    return current;
+}
+
+uint32_t wake_budget_remaining_ms(void) {
+    if (deadline_us == 0) {
+        return WAKE_BUDGET_UNLIMITED;
+    }
+    int64_t left_us = deadline_us - (int64_t)WAKE_BUDGET_RESERVE_MS * 1000 - hal_time_us();
+    return left_us > 0 ? (uint32_t)(left_us / 1000) : 0;
+}
+
+uint32_t wake_budget_clamp_ms(uint32_t timeout_ms) {
+    uint32_t remaining = wake_budget_remaining_ms();
+    return timeout_ms < remaining ? timeout_ms : remaining;
+}
+
+void wake_budget_expire(void) {
+    if (expired_stage >= 0) {
+        return;
+    }
+    expired_stage = current;
+    stats.expired[current]++;
+    stats_commit();
+    ESP_LOGW(TAG, "Wake budget (%lu ms) used up in %s after %lld ms", (unsigned long)budget_ms,
+             stage_names[current], (long long)(hal_time_us() / 1000));
+}
+
+bool wake_budget_check(void) {
+    if (wake_budget_remaining_ms() > 0) {
+        return true;
+    }
+    wake_budget_expire();
+    return false;
+}
+
+const char* wake_budget_expired_stage(void) {
+    return expired_stage >= 0 ? stage_names[expired_stage] : NULL;
+}
+
+const char* wake_stage_name(wake_stage_t stage) {
+    return stage < WAKE_STAGE_COUNT ? stage_names[stage] : "?";
+}
+
+static void history_add(void) {
+    stored_profile_t* entry = &stats.history[stats.history_head];
+    for (int i = 0; i < WAKE_STAGE_COUNT; i++) {
+        int64_t cs = stage_us[i] / 10000;
+        entry->stage_cs[i] = cs < UINT16_MAX ? (uint16_t)cs : UINT16_MAX;
+    }
+    entry->budget_s = budget_ms / 1000 < UINT8_MAX ? budget_ms / 1000 : UINT8_MAX;
+    entry->expired = expired_stage;
+    stats.history_head = (stats.history_head + 1) % WAKE_BUDGET_HISTORY;
+    if (stats.history_count < WAKE_BUDGET_HISTORY) {
+        stats.history_count++;
+    }
+    stats_commit();
+}
+
+int wake_budget_history(wake_profile_t* profiles, int max) {
+    int n = 0;
+    for (; n < stats.history_count && n < max; n++) {
+        const stored_profile_t* entry =
+            &stats.history[(stats.history_head + WAKE_BUDGET_HISTORY - 1 - n) % WAKE_BUDGET_HISTORY];
+        for (int i = 0; i < WAKE_STAGE_COUNT; i++) {
+            profiles[n].stage_ms[i] = entry->stage_cs[i] * 10u;
+        }
+        profiles[n].budget_ms = entry->budget_s * 1000u;
+        profiles[n].expired = entry->expired;
+    }
+    return n;
+}
+
+uint32_t wake_budget_outcomes(uint32_t expired[WAKE_STAGE_COUNT]) {
+    memcpy(expired, stats.expired, sizeof(stats.expired));
+    return stats.wakes;
+}
+
+void wake_budget_report(void) {
+    wake_budget_enter(current);  // Close the running stage
+    history_add();
+
+    char profile[128];
+    int len = 0;
+    int64_t total_us = 0;
+    for (int i = 0; i < WAKE_STAGE_COUNT; i++) {
+        total_us += stage_us[i];
+        len += snprintf(profile + len, sizeof(profile) - len, "%s%s %.1f", i > 0 ? ", " : "",
+                        stage_names[i], stage_us[i] / 1e6);
+        if (len >= (int)sizeof(profile)) {
+            break;
+        }
+    }
+
+    if (budget_ms > 0) {
+        ESP_LOGI(TAG, "Awake %.1f s of %.1f s budget (%s)", total_us / 1e6, budget_ms / 1e3, profile);
+    } else {
+        ESP_LOGI(TAG, "Awake %.1f s, no budget (%s)", total_us / 1e6, profile);
+    }
+    if (expired_stage >= 0) {
+        uint32_t expired_wakes = 0;
+        for (int i = 0; i < WAKE_STAGE_COUNT; i++) {
+            expired_wakes += stats.expired[i];
+        }
+        ESP_LOGW(TAG, "Budget ran out in %s (%lu of %lu budgeted wakes: wifi %lu, sntp %lu, quote %lu)",
+                 stage_names[expired_stage], (unsigned long)expired_wakes, (unsigned long)stats.wakes,
+                 (unsigned long)stats.expired[WAKE_STAGE_WIFI], (unsigned long)stats.expired[WAKE_STAGE_SNTP],
+                 (unsigned long)stats.expired[WAKE_STAGE_QUOTE]);
+    }
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef WAKE_BUDGET_MS                 // Overridable at build time
+#define WAKE_BUDGET_MS 30000           // Awake time of a timer/button wake, boot to sleep
+#endif
+#define WAKE_BUDGET_RESERVE_MS 7000    // Kept back for the final refresh, settle and state save
+#define WAKE_BUDGET_UNLIMITED UINT32_MAX
+#define WAKE_BUDGET_HISTORY 8          // Wake profiles kept in RTC memory
+
+/**
+ * Stages of a wake, in order
+ */
+typedef enum {
+    WAKE_STAGE_BOOT,         // Boot, loading screen
+    WAKE_STAGE_WIFI,         // Station connect, retries and retry waits
+    WAKE_STAGE_SNTP,         // Time sync
+    WAKE_STAGE_QUOTE,        // Quote providers
+    WAKE_STAGE_DISPLAY,      // Final refresh, settle, state persistence
+    WAKE_STAGE_UPDATE,       // Firmware check and download (ota_update.h), outside the budget
+    WAKE_STAGE_COUNT,
+} wake_stage_t;
+
+/**
+ * Time per stage of one past wake
+ */
+typedef struct {
+    uint32_t stage_ms[WAKE_STAGE_COUNT];
+    uint32_t budget_ms;      // 0 = no budget
+    int expired;             // Stage that used up the budget, -1 if none did
+} wake_profile_t;
+
+/**
+ * Start the budget of this wake; time since boot already counts
+ *
+ * @param budget_ms Awake time allowed, boot to sleep (0 = unlimited, stages
+ *                  are still profiled)
+ */
+void wake_budget_start(uint32_t budget_ms);
+
+/**
+ * Mark the start of a stage; the time since the previous mark is charged
+ * to the previous stage, and its memory use is sampled (mem_profile.h)
+ */
+void wake_budget_enter(wake_stage_t stage);
+
+/**
+ * @return Stage running now
+ */
+wake_stage_t wake_budget_stage(void);
+
+/**
+ * Time the network stages may still use: the budget minus the reserve for
+ * the display stage minus the time awake so far
+ *
+ * @return Milliseconds (0 when used up), WAKE_BUDGET_UNLIMITED without a budget
+ */
+uint32_t wake_budget_remaining_ms(void);
+
+/**
+ * @return timeout_ms, shortened to the remaining budget
+ */
+uint32_t wake_budget_clamp_ms(uint32_t timeout_ms);
+
+/**
+ * Check before starting more work in the current stage. The first failed
+ * check records the current stage as the one that used up the budget.
+ *
+ * @return true if time remains
+ */
+bool wake_budget_check(void);
+
+/**
+ * Give up on the current stage (e.g. the time left cannot cover the next
+ * retry); recorded like a failed check
+ */
+void wake_budget_expire(void);
+
+/**
+ * @return Name of the stage that used up the budget this wake, NULL if none did
+ */
+const char* wake_budget_expired_stage(void);
+
+/**
+ * @return Short stage name ("boot", "wifi", "sntp", "quote", "display",
+ *         "update")
+ */
+const char* wake_stage_name(wake_stage_t stage);
+
+/**
+ * Close the current stage and log the wake's profile: time per stage, the
+ * stage that used up the budget and how often each stage did so (kept in
+ * RTC memory across wakes). The profile joins the history.
+ */
+void wake_budget_report(void);
+
+/**
+ * Profiles of the last wakes (RTC memory, lost on power loss)
+ *
+ * @param profiles Out, newest first
+ * @param max Entries in profiles
+ * @return Number written (at most WAKE_BUDGET_HISTORY)
+ */
+int wake_budget_history(wake_profile_t* profiles, int max);
+
+/**
+ * Budget outcomes since power loss
+ *
+ * @param expired Out: wakes whose budget ran out in each stage
+ * @return Wakes that had a budget
+ */
+uint32_t wake_budget_outcomes(uint32_t expired[WAKE_STAGE_COUNT]);
+
+#ifdef __cplusplus
+}
+#endif
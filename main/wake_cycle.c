@@ -0,0 +1,180 @@
+#include "wake_cycle.h"
+#include "display_ui.h"
+#include "wikiquote.h"
+#include "quote_provider.h"
+#include "battery.h"
+#include "battery_model.h"
+#include "device_state.h"
+#include "wake_budget.h"
+#include "dns_cache.h"
+#include "ota_update.h"
+#include "maintenance.h"
+#include "mem_profile.h"
+#include "hal_http.h"
+#include "hal_time.h"
+#include "hal_wifi.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "binlog.h"
+#include <stdio.h>
+#include <time.h>
+
+static const char *TAG = "WAKE_CYCLE";
+
+#define MIN_SLEEP_MINUTES 10
+#define MAX_SLEEP_MINUTES 60
+// Mean wake rate of the uniform random sleep interval, for runtime projection
+#define SLEEP_WAKES_PER_DAY (24.0f * 60.0f / ((MIN_SLEEP_MINUTES + MAX_SLEEP_MINUTES) / 2.0f))
+
+#define SNTP_SERVER "pool.ntp.org"
+#define SNTP_TIMEZONE "CET-1CEST,M3.5.0,M10.5.0/3"  // Europe/Rome with DST
+#define SNTP_TIMEOUT_MS 10000
+#define DISPLAY_SETTLE_MS 2000  // Let the panel finish powering down before sleep
+
+static void get_formatted_time(char* buffer, size_t buffer_size) {
+    time_t now = hal_time_now();
+    struct tm timeinfo;
+    localtime_r(&now, &timeinfo);
+
+    // Format: "Last update: DD/MM/YYYY HH:MM"
+    strftime(buffer, buffer_size, "Last update: %d/%m/%Y %H:%M", &timeinfo);
+}
+
+static uint32_t increment_quote_count(void) {
+    device_state_t *state = device_state_get();
+    state->quote_count++;
+    device_state_commit();  // RTC only; flushed to NVS with the rest of the state
+
+    BINLOG_I(TAG, "Incrementing quote count to %lu", (unsigned long)state->quote_count);
+    return state->quote_count;
+}
+
+uint32_t wake_cycle_run(bool online) {
+    // Battery was normally sampled during the loading/connecting screen refresh
+    // (display power hook); this only powers the rail itself if no refresh ran
+    esp_err_t batt_err = battery_init();
+    float battery_percent = -1.0;
+    if (batt_err == ESP_OK) {
+        battery_percent = battery_read_percentage();
+        if (battery_percent >= 0) {
+            BINLOG_I(TAG, "Battery percentage: %.1f%%", battery_percent);
+        } else {
+            ESP_LOGW(TAG, "Failed to read battery percentage");
+        }
+    } else {
+        ESP_LOGW(TAG, "Battery init failed: %s", esp_err_to_name(batt_err));
+    }
+
+    // Synchronize wall-clock time (kept by the RTC across deep sleep)
+    if (online) {
+        wake_budget_enter(WAKE_STAGE_SNTP);
+        if (wake_budget_check()) {
+            // By address from the DNS cache (no lookup on a hit); a pool
+            // server that does not answer is dropped from the cache
+            char ntp_addr[DNS_CACHE_ADDR_SIZE];
+            bool by_addr = dns_cache_lookup_text(SNTP_SERVER, ntp_addr, sizeof(ntp_addr)) == ESP_OK;
+            if (hal_time_sync(by_addr ? ntp_addr : SNTP_SERVER, SNTP_TIMEZONE,
+                              wake_budget_clamp_ms(SNTP_TIMEOUT_MS)) != ESP_OK && by_addr) {
+                dns_cache_failed(SNTP_SERVER);
+            }
+        }
+    }
+
+    // Initialize wikiquote
+    wikiquote_init();
+
+    // Calculate random sleep duration BEFORE displaying (needed for next update time)
+    uint32_t random_minutes = MIN_SLEEP_MINUTES + (esp_random() % (MAX_SLEEP_MINUTES - MIN_SLEEP_MINUTES + 1));
+    uint32_t sleep_seconds = random_minutes * 60;
+
+    // Get a quote: network providers under one deadline (cut to what the
+    // wake budget has left, none when offline), then stored/cache/corpus
+    wake_budget_enter(WAKE_STAGE_QUOTE);
+    quote_schedule_t schedule = QUOTE_SCHEDULE_DEFAULT();
+    schedule.deadline_ms = online && wake_budget_check() ? wake_budget_clamp_ms(schedule.deadline_ms) : 0;
+    static quote_t quote;
+    esp_err_t err = quote_provider_fetch(&schedule, &quote);
+    hal_http_close_idle();  // Retries and prefetch are done: free the TLS sessions
+    dns_cache_collect();    // Background refreshes answered meanwhile
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Showing a %s quote: %s", quote.source, esp_err_to_name(err));
+        if (online) {
+            wake_budget_check();  // Records the quote stage if it used up the budget
+        }
+    }
+    wake_budget_enter(WAKE_STAGE_DISPLAY);
+
+    uint32_t quote_count = increment_quote_count();
+
+    // Format datetime string with quote counter and next update time
+    char datetime_str[192];
+    char time_part[64];
+    get_formatted_time(time_part, sizeof(time_part));
+
+    // A maintenance window keeps the station up before the sleep starts
+    bool maintenance = online && maintenance_take(battery_percent);
+
+    // Calculate next update time
+    time_t next_update = hal_time_now() + sleep_seconds + maintenance_window_ms() / 1000;
+    struct tm next_update_tm;
+    localtime_r(&next_update, &next_update_tm);
+    char next_update_str[32];
+    strftime(next_update_str, sizeof(next_update_str), "%H:%M", &next_update_tm);
+
+    // Format battery part: percentage plus projected runtime once enough history exists
+    char battery_str[32];
+    battery_estimate_t estimate;
+    if (battery_percent < 0) {
+        snprintf(battery_str, sizeof(battery_str), "batt: --%%");
+    } else if (battery_model_estimate(SLEEP_WAKES_PER_DAY, &estimate) == ESP_OK) {
+        snprintf(battery_str, sizeof(battery_str), "batt: %.0f%% (~%.0fd)",
+                 battery_percent, estimate.remaining_days);
+    } else {
+        snprintf(battery_str, sizeof(battery_str), "batt: %.0f%%", battery_percent);
+    }
+
+    // Note where to reach a maintenance window, or why the quote is not
+    // fresh: the stage that used up the budget
+    char note[32] = "";
+    const char* expired = wake_budget_expired_stage();
+    char ip[16];
+    if (maintenance && hal_wifi_get_ip(ip, sizeof(ip)) == ESP_OK) {
+        snprintf(note, sizeof(note), " - maintenance %s", ip);
+    } else if (expired != NULL) {
+        snprintf(note, sizeof(note), " - timeout: %s", expired);
+    } else if (!online) {
+        snprintf(note, sizeof(note), " - offline");
+    }
+
+    snprintf(datetime_str, sizeof(datetime_str), "%s - quotes: %lu - next: %s - %s%s",
+             time_part, (unsigned long)quote_count, next_update_str, battery_str, note);
+
+    // Update display with quote, author and time (always filled, the corpus cannot fail)
+    display_connected_mode(quote.text, quote.author, datetime_str);
+
+    // Wait a bit to ensure display is fully powered off
+    hal_delay_ms(DISPLAY_SETTLE_MS);
+
+    // Persist counters/battery history to flash only every few wakes
+    if (device_state_end_wake(battery_percent, SLEEP_WAKES_PER_DAY)) {
+        quote_provider_save_stats();
+    }
+
+    // Keep a new firmware image that got this far online, then look for the
+    // next one now and then (the quote is already on screen; the next wake
+    // boots an installed image)
+    wake_budget_enter(WAKE_STAGE_UPDATE);
+    ota_update_confirm(online);
+    if (online) {
+        ota_update_poll(battery_percent);
+    }
+
+    binlog_report();
+    dns_cache_report();
+    wake_budget_report();
+    mem_profile_report();
+
+    ESP_LOGI(TAG, "Entering deep sleep for %lu minutes (%lu seconds)...",
+             (unsigned long)random_minutes, (unsigned long)sleep_seconds);
+    return sleep_seconds;
+}
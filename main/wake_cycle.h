@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Run the work of one wake once the network is up, or once it is given up
+ * Reads the battery, syncs time over SNTP, fetches a quote, renders it
+ * with the status line, persists the device state, and confirms or checks
+ * for firmware updates (ota_update.h). Uses only the HAL, so the same code
+ * runs on the device (connection_setup_task) and in the host simulator.
+ *
+ * Network stages are cut to the wake budget (wake_budget.h). Offline, or
+ * when the budget is used up, the best stored quote is shown (today's quote
+ * of the day, the prefetch cache, the built-in corpus) and the status line
+ * says why.
+ *
+ * @param online true if the station is connected
+ * @return Seconds to sleep until the next wake (random 10-60 minutes)
+ */
+uint32_t wake_cycle_run(bool online);
+
+#ifdef __cplusplus
+}
+#endif
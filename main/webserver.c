@@ -1,15 +1,51 @@
 #include "webserver.h"
 #include "wifi_manager.h"
-#include "config_page.h"
+#include "wifi_scan.h"
+#include "wifi_networks.h"
+#include "ota_update.h"
+#include "portal_assets.h"
+#include "screenshot.h"
+#include "maintenance.h"
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include "esp_http_server.h"
 #include "esp_log.h"
+#include "esp_netif.h"
 #include "esp_system.h"
+#include "esp_timer.h"
+#include "cJSON.h"
 
 static const char *TAG = "WEBSERVER";
 
 static httpd_handle_t server = NULL;
+static char portal_url[32] = "http://192.168.4.1/";  // From the softAP's address at start
+static int64_t started_us = 0;
+
+// Connectivity checks phones and laptops run after joining a network. Any
+// answer other than the expected one (204, "Success") makes the OS open its
+// captive portal window; a redirect to the portal makes that window show it
+static const struct {
+    const char* uri;
+    const char* os;
+} connectivity_checks[] = {
+    {"/generate_204", "Android"},
+    {"/gen_204", "Android"},
+    {"/hotspot-detect.html", "Apple"},
+    {"/library/test/success.html", "Apple"},
+    {"/connecttest.txt", "Windows"},
+    {"/ncsi.txt", "Windows"},
+    {"/redirect", "Windows"},
+    {"/canonical.html", "Firefox"},
+    {"/success.txt", "Firefox"},
+};
+#define CONNECTIVITY_CHECK_COUNT (sizeof(connectivity_checks) / sizeof(connectivity_checks[0]))
+
+#define ETAG_HEADER_SIZE 64     // If-None-Match we compare; longer lists are treated as no match
+#define UPDATE_CHUNK_SIZE 4096  // Upload read per httpd_req_recv(), one flash sector
+#define UPDATE_RECV_RETRIES 3   // Socket timeouts tolerated in a row during an upload
+#define UPDATE_RESTART_MS 1000  // Lets the response reach the browser before the restart
 
 // URL decode helper function
 static void url_decode(char *dst, const char *src) {
@@ -42,23 +78,74 @@ static void url_decode(char *dst, const char *src) {
     *dst = '\0';
 }
 
-// Handler for GET / - serves the configuration page
-static esp_err_t config_page_handler(httpd_req_t *req) {
-    ESP_LOGI(TAG, "Serving configuration page");
-    httpd_resp_set_type(req, "text/html");
-    httpd_resp_send(req, config_html, HTTPD_RESP_USE_STRLEN);
-    return ESP_OK;
+// Send an asset straight from flash, as stored (no copy, no compression at runtime)
+static esp_err_t send_asset(httpd_req_t *req, const portal_asset_t* asset) {
+    httpd_resp_set_type(req, asset->content_type);
+    if (asset->gzip) {
+        httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    }
+    return httpd_resp_send(req, (const char*)asset->data, asset->size);
 }
 
-// Handler for POST /save - receives WiFi credentials
-static esp_err_t save_handler(httpd_req_t *req) {
-    ESP_LOGI(TAG, "Received WiFi configuration");
+// Handler for GET of a portal asset (user_ctx) - 304 if the browser has it
+static esp_err_t asset_handler(httpd_req_t *req) {
+    const portal_asset_t* asset = req->user_ctx;
 
-    char buf[256];
+    // Cached copies are revalidated on every load, so a firmware update shows at once
+    httpd_resp_set_hdr(req, "ETag", asset->etag);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+
+    char etag[ETAG_HEADER_SIZE];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", etag, sizeof(etag)) == ESP_OK &&
+        strstr(etag, asset->etag) != NULL) {
+        ESP_LOGI(TAG, "%s not modified", asset->uri);
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    ESP_LOGI(TAG, "Serving %s (%lu bytes%s)", asset->uri, (unsigned long)asset->size, asset->gzip ? ", gzip" : "");
+    return send_asset(req, asset);
+}
+
+static esp_err_t redirect_to_portal(httpd_req_t *req) {
+    httpd_resp_set_status(req, "302 Found");
+    httpd_resp_set_hdr(req, "Location", portal_url);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    return httpd_resp_send(req, NULL, 0);
+}
+
+// Handler for GET of a connectivity check URL (user_ctx: the OS) - 302 to the portal
+static esp_err_t connectivity_check_handler(httpd_req_t *req) {
+    ESP_LOGI(TAG, "%s connectivity check %s, redirecting to the portal", (const char*)req->user_ctx, req->uri);
+    return redirect_to_portal(req);
+}
+
+// Any other URL (DNS sends every name here): 302 to the portal
+static esp_err_t not_found_handler(httpd_req_t *req, httpd_err_code_t error) {
+    ESP_LOGI(TAG, "Redirecting %s to the portal", req->uri);
+    return redirect_to_portal(req);
+}
+
+// Handler for GET /scan.json - networks seen by the background scan
+// (?refresh scans again); the page polls it while "scanning" is true
+static esp_err_t scan_handler(httpd_req_t *req) {
+    char query[16];
+    bool refresh = httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+                   strstr(query, "refresh") != NULL;
+
+    char json[WIFI_SCAN_JSON_SIZE];
+    size_t len = wifi_scan_json(json, sizeof(json), refresh);
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    return httpd_resp_send(req, json, len);
+}
+
+// Read a urlencoded POST body into buf (NUL-terminated); errors are answered here
+static esp_err_t recv_form(httpd_req_t *req, char* buf, size_t size) {
     int ret, remaining = req->content_len;
 
-    // Read POST body
-    if (remaining >= sizeof(buf)) {
+    if (remaining >= size) {
         ESP_LOGE(TAG, "Content too long");
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Content too long");
         return ESP_FAIL;
@@ -72,12 +159,84 @@ static esp_err_t save_handler(httpd_req_t *req) {
         return ESP_FAIL;
     }
     buf[ret] = '\0';
+    return ESP_OK;
+}
+
+// Saved networks, last good first, without passwords:
+// {"max":5,"networks":[{"s":"Home","r":-54,"l":1830,"t":1760000000,"n":42,"f":1}]}
+static esp_err_t send_networks(httpd_req_t *req) {
+    cJSON* root = cJSON_CreateObject();
+    cJSON_AddNumberToObject(root, "max", WIFI_NETWORKS_MAX);
+    cJSON* list = cJSON_AddArrayToObject(root, "networks");
+    for (int i = 0; i < wifi_networks_count(); i++) {
+        const wifi_network_t* network = wifi_networks_get(i);
+        cJSON* entry = cJSON_CreateObject();
+        cJSON_AddStringToObject(entry, "s", network->ssid);
+        cJSON_AddNumberToObject(entry, "r", network->rssi);
+        cJSON_AddNumberToObject(entry, "l", network->connect_ms);
+        cJSON_AddNumberToObject(entry, "t", network->last_success);
+        cJSON_AddNumberToObject(entry, "n", network->successes);
+        cJSON_AddNumberToObject(entry, "f", network->failures);
+        cJSON_AddItemToArray(list, entry);
+    }
+    char* json = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (json == NULL) {
+        return httpd_resp_send_500(req);
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    esp_err_t err = httpd_resp_sendstr(req, json);
+    cJSON_free(json);
+    return err;
+}
+
+// Handler for GET /networks.json - the saved networks and their stats
+static esp_err_t networks_handler(httpd_req_t *req) {
+    return send_networks(req);
+}
+
+// Handler for POST /forget - remove a saved network (ssid=...), answers
+// with the remaining list
+static esp_err_t forget_handler(httpd_req_t *req) {
+    char buf[128];
+    if (recv_form(req, buf, sizeof(buf)) != ESP_OK) {
+        return ESP_FAIL;
+    }
+
+    // Decoded text is never longer than the encoded one
+    char ssid[100] = {0};
+    char ssid_encoded[100] = {0};
+    if (httpd_query_key_value(buf, "ssid", ssid_encoded, sizeof(ssid_encoded)) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "SSID required");
+        return ESP_FAIL;
+    }
+    url_decode(ssid, ssid_encoded);
+
+    if (wifi_networks_remove(ssid) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Network not saved");
+        return ESP_FAIL;
+    }
+    return send_networks(req);
+}
+
+// Handler for POST /save - receives WiFi credentials
+static esp_err_t save_handler(httpd_req_t *req) {
+    ESP_LOGI(TAG, "Received WiFi configuration");
+
+    // Read POST body
+    char buf[256];
+    if (recv_form(req, buf, sizeof(buf)) != ESP_OK) {
+        return ESP_FAIL;
+    }
 
     ESP_LOGI(TAG, "Received data: %s", buf);
 
     // Parse form data
-    char ssid[33] = {0};
-    char password[65] = {0};
+    // Decoded sizes as the encoded ones: the lengths are checked after decoding
+    char ssid[100] = {0};
+    char password[100] = {0};
     char ssid_encoded[100] = {0};
     char pass_encoded[100] = {0};
 
@@ -115,40 +274,158 @@ static esp_err_t save_handler(httpd_req_t *req) {
     ESP_LOGI(TAG, "Parsed credentials - SSID: %s, Password: %s", ssid,
              strlen(password) > 0 ? "****" : "(none)");
 
-    // Save credentials
-    err = wifi_manager_save_credentials(ssid, password);
+    // Try the credentials live, at the access point if the scan saw the
+    // network; they are only saved once the station has an IP
+    wifi_scan_ap_t ap;
+    bool seen = wifi_scan_find(ssid, &ap);
+    err = wifi_manager_test_credentials(ssid, password, seen ? ap.channel : 0, seen ? ap.bssid : NULL);
+    if (err == ESP_ERR_INVALID_STATE) {
+        ESP_LOGW(TAG, "A connection test is already running");
+    } else if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start the connection test");
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to connect");
+        return ESP_FAIL;
+    } else {
+        // How long the user needed from the softAP coming up to a submitted network
+        ESP_LOGI(TAG, "Configured %lld s after the portal started",
+                 (esp_timer_get_time() - started_us) / 1000000);
+    }
+
+    // The status page polls /status.json; a reload does not post again
+    httpd_resp_set_status(req, "303 See Other");
+    httpd_resp_set_hdr(req, "Location", "/connecting.html");
+    return httpd_resp_send(req, NULL, 0);
+}
+
+// Handler for GET /status.json - result of the credentials test:
+// {"state":"testing|connected|failed|idle","reason":"wrong password"}
+static esp_err_t status_handler(httpd_req_t *req) {
+    static const char* const names[] = {
+        [WIFI_PROVISION_IDLE] = "idle",
+        [WIFI_PROVISION_TESTING] = "testing",
+        [WIFI_PROVISION_CONNECTED] = "connected",
+        [WIFI_PROVISION_FAILED] = "failed",
+    };
+    const char* reason = NULL;
+    wifi_provision_state_t state = wifi_manager_provision_status(&reason);
+
+    // Reasons are fixed strings from wifi_manager.c: nothing to escape
+    char json[96];
+    if (reason != NULL) {
+        snprintf(json, sizeof(json), "{\"state\":\"%s\",\"reason\":\"%s\"}", names[state], reason);
+    } else {
+        snprintf(json, sizeof(json), "{\"state\":\"%s\",\"reason\":null}", names[state]);
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    return httpd_resp_sendstr(req, json);
+}
+
+static esp_err_t send_chunk(const void* data, size_t length, void* ctx) {
+    return httpd_resp_send_chunk(ctx, data, length);
+}
+
+// Handler for GET /screen.png and /screen.pgm - what the panel shows,
+// encoded row by row from the framebuffer into chunked transfer
+static esp_err_t screen_handler(httpd_req_t *req) {
+    screenshot_format_t format = (screenshot_format_t)(intptr_t)req->user_ctx;
+    httpd_resp_set_type(req, screenshot_content_type(format));
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    esp_err_t err = screenshot_encode(format, send_chunk, req);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to save credentials");
-        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to save");
+        return ESP_FAIL;  // Headers are gone: dropping the connection ends the response
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+// Handler for GET /metrics.json - maintenance_metrics_json()
+static esp_err_t metrics_handler(httpd_req_t *req) {
+    char* json = maintenance_metrics_json();
+    if (json == NULL) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
         return ESP_FAIL;
     }
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    esp_err_t err = httpd_resp_sendstr(req, json);
+    cJSON_free(json);
+    return err;
+}
 
-    // Send success response
-    const char* resp =
-        "<!DOCTYPE html>"
-        "<html>"
-        "<head>"
-        "<meta charset='UTF-8'>"
-        "<style>"
-        "body{font-family:Arial;text-align:center;padding:50px;}"
-        "h2{color:#4CAF50;}"
-        "</style>"
-        "</head>"
-        "<body>"
-        "<h2>✓ Configuration Saved!</h2>"
-        "<p>Device is restarting...</p>"
-        "<p>Please reconnect to your WiFi network.</p>"
-        "</body>"
-        "</html>";
-
-    httpd_resp_set_type(req, "text/html");
-    httpd_resp_send(req, resp, HTTPD_RESP_USE_STRLEN);
-
-    // Restart after a short delay to allow response to be sent
-    ESP_LOGI(TAG, "Restarting in 2 seconds...");
-    vTaskDelay(pdMS_TO_TICKS(2000));
+static void restart_callback(void* arg) {
     esp_restart();
+}
+
+// Handler for POST /update (maintenance server only: the portal's softAP is
+// open) - a firmware image as the raw body, streamed into the inactive app
+// slot; an optional X-Image-SHA256 header (hex) is checked too. Restarts
+// into the new image once it is answered:
+//   curl --data-binary @build/t5_epd_hello_world.bin http://<device address>/update
+static esp_err_t update_handler(httpd_req_t *req) {
+    char sha256[65] = "";
+    bool has_digest = httpd_req_get_hdr_value_str(req, "X-Image-SHA256", sha256, sizeof(sha256)) == ESP_OK;
+
+    // Static: one upload at a time (the server has a single task)
+    static ota_receiver_t rx;
+    esp_err_t err = ota_receiver_begin(&rx, req->content_len, has_digest ? sha256 : NULL, NULL);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Update of %u bytes refused: %s", (unsigned)req->content_len, esp_err_to_name(err));
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST,
+                            err == ESP_ERR_INVALID_ARG ? "Bad X-Image-SHA256" : "Image size does not fit");
+        return ESP_FAIL;
+    }
+
+    char* chunk = malloc(UPDATE_CHUNK_SIZE);
+    if (chunk == NULL) {
+        return httpd_resp_send_500(req);
+    }
+    size_t remaining = req->content_len;
+    int timeouts = 0;
+    while (remaining > 0 && err == ESP_OK) {
+        int ret = httpd_req_recv(req, chunk, remaining < UPDATE_CHUNK_SIZE ? remaining : UPDATE_CHUNK_SIZE);
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT && ++timeouts <= UPDATE_RECV_RETRIES) {
+            continue;
+        }
+        if (ret <= 0) {
+            err = ESP_ERR_TIMEOUT;
+            break;
+        }
+        timeouts = 0;
+        remaining -= ret;
+        err = ota_receiver_write(&rx, chunk, ret);
+    }
+    free(chunk);
+
+    if (err == ESP_ERR_TIMEOUT) {
+        ota_receiver_abort(&rx);
+        ESP_LOGE(TAG, "Upload stopped with %u bytes left", (unsigned)remaining);
+        return ESP_FAIL;  // Connection is gone: nothing to answer
+    }
+    if (err == ESP_OK) {
+        err = ota_receiver_finish(&rx, true);
+    }
+    if (err != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST,
+                            err == ESP_ERR_INVALID_VERSION ? "Not a firmware image for this device" :
+                            err == ESP_ERR_INVALID_CRC ? "Image corrupted (checksum mismatch)" :
+                            "Image could not be written");
+        return ESP_FAIL;
+    }
 
+    char json[96];
+    snprintf(json, sizeof(json), "{\"version\":\"%s\",\"bytes\":%u}", rx.app.version, (unsigned)rx.size);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json);
+
+    const esp_timer_create_args_t args = {
+        .callback = restart_callback,
+        .name = "update_restart",
+    };
+    esp_timer_handle_t timer;
+    if (esp_timer_create(&args, &timer) == ESP_OK) {
+        esp_timer_start_once(timer, (uint64_t)UPDATE_RESTART_MS * 1000);
+    }
     return ESP_OK;
 }
 
@@ -157,8 +434,15 @@ esp_err_t webserver_start(void) {
 
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.lru_purge_enable = true;
-    config.max_uri_handlers = 8;
-    config.stack_size = 8192;
+    config.max_uri_handlers = portal_asset_count + CONNECTIVITY_CHECK_COUNT + 8;  // + /scan.json, /status.json, /networks.json, /save, /forget, /screen.png, /screen.pgm, spare
+    config.stack_size = WEBSERVER_STACK_SIZE;
+
+    esp_netif_ip_info_t ip_info;
+    esp_netif_t* ap_netif = esp_netif_get_handle_from_ifkey("WIFI_AP_DEF");
+    if (ap_netif != NULL && esp_netif_get_ip_info(ap_netif, &ip_info) == ESP_OK) {
+        snprintf(portal_url, sizeof(portal_url), "http://" IPSTR "/", IP2STR(&ip_info.ip));
+    }
+    started_us = esp_timer_get_time();
 
     esp_err_t err = httpd_start(&server, &config);
     if (err != ESP_OK) {
@@ -166,14 +450,50 @@ esp_err_t webserver_start(void) {
         return err;
     }
 
-    // Register GET / handler
-    httpd_uri_t uri_get = {
-        .uri = "/",
+    // Register a GET handler per portal asset ("/" is index.html)
+    for (size_t i = 0; i < portal_asset_count; i++) {
+        httpd_uri_t uri_get = {
+            .uri = portal_assets[i].uri,
+            .method = HTTP_GET,
+            .handler = asset_handler,
+            .user_ctx = (void*)&portal_assets[i]
+        };
+        httpd_register_uri_handler(server, &uri_get);
+    }
+
+    // Register GET /scan.json handler
+    httpd_uri_t uri_scan = {
+        .uri = "/scan.json",
+        .method = HTTP_GET,
+        .handler = scan_handler,
+        .user_ctx = NULL
+    };
+    httpd_register_uri_handler(server, &uri_scan);
+
+    // Register GET /status.json handler
+    httpd_uri_t uri_status = {
+        .uri = "/status.json",
         .method = HTTP_GET,
-        .handler = config_page_handler,
+        .handler = status_handler,
         .user_ctx = NULL
     };
-    httpd_register_uri_handler(server, &uri_get);
+    httpd_register_uri_handler(server, &uri_status);
+
+    // Register GET /networks.json and POST /forget handlers
+    httpd_uri_t uri_networks = {
+        .uri = "/networks.json",
+        .method = HTTP_GET,
+        .handler = networks_handler,
+        .user_ctx = NULL
+    };
+    httpd_register_uri_handler(server, &uri_networks);
+    httpd_uri_t uri_forget = {
+        .uri = "/forget",
+        .method = HTTP_POST,
+        .handler = forget_handler,
+        .user_ctx = NULL
+    };
+    httpd_register_uri_handler(server, &uri_forget);
 
     // Register POST /save handler
     httpd_uri_t uri_post = {
@@ -184,10 +504,87 @@ esp_err_t webserver_start(void) {
     };
     httpd_register_uri_handler(server, &uri_post);
 
+    // Register GET /screen.png and /screen.pgm handlers
+    httpd_uri_t uri_screen_png = {
+        .uri = "/screen.png",
+        .method = HTTP_GET,
+        .handler = screen_handler,
+        .user_ctx = (void*)(intptr_t)SCREENSHOT_PNG
+    };
+    httpd_register_uri_handler(server, &uri_screen_png);
+    httpd_uri_t uri_screen_pgm = {
+        .uri = "/screen.pgm",
+        .method = HTTP_GET,
+        .handler = screen_handler,
+        .user_ctx = (void*)(intptr_t)SCREENSHOT_PGM
+    };
+    httpd_register_uri_handler(server, &uri_screen_pgm);
+
+    // Register connectivity check handlers, and the redirect for everything else
+    for (size_t i = 0; i < CONNECTIVITY_CHECK_COUNT; i++) {
+        httpd_uri_t uri_check = {
+            .uri = connectivity_checks[i].uri,
+            .method = HTTP_GET,
+            .handler = connectivity_check_handler,
+            .user_ctx = (void*)connectivity_checks[i].os
+        };
+        httpd_register_uri_handler(server, &uri_check);
+    }
+    httpd_register_err_handler(server, HTTPD_404_NOT_FOUND, not_found_handler);
+
     ESP_LOGI(TAG, "Web server started successfully");
     return ESP_OK;
 }
 
+esp_err_t webserver_start_maintenance(void) {
+    if (server != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    ESP_LOGI(TAG, "Starting maintenance server...");
+
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.max_uri_handlers = 4;  // /metrics.json, /screen.png, /screen.pgm, /update
+    config.stack_size = WEBSERVER_STACK_SIZE;
+
+    esp_err_t err = httpd_start(&server, &config);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error starting server: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    httpd_uri_t uri_metrics = {
+        .uri = "/metrics.json",
+        .method = HTTP_GET,
+        .handler = metrics_handler,
+        .user_ctx = NULL
+    };
+    httpd_register_uri_handler(server, &uri_metrics);
+    httpd_uri_t uri_screen_png = {
+        .uri = "/screen.png",
+        .method = HTTP_GET,
+        .handler = screen_handler,
+        .user_ctx = (void*)(intptr_t)SCREENSHOT_PNG
+    };
+    httpd_register_uri_handler(server, &uri_screen_png);
+    httpd_uri_t uri_screen_pgm = {
+        .uri = "/screen.pgm",
+        .method = HTTP_GET,
+        .handler = screen_handler,
+        .user_ctx = (void*)(intptr_t)SCREENSHOT_PGM
+    };
+    httpd_register_uri_handler(server, &uri_screen_pgm);
+    httpd_uri_t uri_update = {
+        .uri = "/update",
+        .method = HTTP_POST,
+        .handler = update_handler,
+        .user_ctx = NULL
+    };
+    httpd_register_uri_handler(server, &uri_update);
+
+    ESP_LOGI(TAG, "Maintenance server started");
+    return ESP_OK;
+}
+
 esp_err_t webserver_stop(void) {
     if (server != NULL) {
         ESP_LOGI(TAG, "Stopping web server...");
@@ -6,6 +6,8 @@
 extern "C" {
 #endif
 
+#define WEBSERVER_STACK_SIZE 8192      // httpd task of the portal and the maintenance server
+
 /**
  * Start the HTTP configuration web server
  * Serves the WiFi configuration page and handles credential submission
@@ -14,6 +16,16 @@ extern "C" {
  */
 esp_err_t webserver_start(void);
 
+/**
+ * Start the maintenance server on the station interface: /metrics.json
+ * (maintenance.h), the screenshots and POST /update, none of the portal's
+ * pages. Firmware uploads are only taken here, behind the network's own
+ * authentication, never on the portal's open softAP
+ *
+ * @return ESP_OK on success, ESP_ERR_INVALID_STATE if a server is running
+ */
+esp_err_t webserver_start_maintenance(void);
+
 /**
  * Stop the HTTP configuration web server
  *
@@ -1,12 +1,18 @@
 #include "wifi_manager.h"
 #include "display_ui.h"
 #include "webserver.h"
-#include "wikiquote.h"
+#include "captive_dns.h"
 #include "sleep_manager.h"
-#include "battery.h"
+#include "wake_cycle.h"
+#include "wake_budget.h"
+#include "wifi_scan.h"
+#include "wifi_networks.h"
+#include "ota_update.h"
+#include "maintenance.h"
+#include "mem_profile.h"
+#include "binlog.h"
+#include <stdint.h>
 #include <string.h>
-#include <time.h>
-#include <sys/time.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
 #include "esp_wifi.h"
@@ -14,38 +20,57 @@
 #include "esp_log.h"
 #include "esp_netif.h"
 #include "esp_mac.h"
-#include "esp_sntp.h"
-#include "nvs_flash.h"
-#include "nvs.h"
+#include "esp_timer.h"
 
 static const char *TAG = "WIFI_MANAGER";
 
-#define WIFI_NVS_NAMESPACE "wifi_config"
-#define WIFI_SSID_KEY "ssid"
-#define WIFI_PASS_KEY "password"
-#define WIFI_QUOTE_COUNT_KEY "quote_count"
 #define AP_SSID_PREFIX "WMQuote_"
-#define MAX_RETRY 3
-#define MAX_RETRY_CYCLES 10
-#define RETRY_DELAY_MS 60000  // 1 minute
 
 static int retry_count = 0;
 static int retry_cycle = 0;
 static bool provisioning_mode = false;
 static bool display_updated = false;
-static TaskHandle_t connection_task_handle = NULL;
+static bool offline = false;  // Wake budget used up: station given up for this wake
+static bool hinted = false;   // Connecting straight to a known channel and BSSID
+
+// Saved network selection: the last good one at its access point, then one
+// scan and the saved networks in range, strongest first
+static int current = -1;                          // wifi_networks index being tried
+static int candidates[WIFI_NETWORKS_MAX];
+static int candidate_count = 0;
+static int candidate_next = 0;
+static bool scanned = false;                      // This cycle's scan started
+static int64_t attempt_started_us = 0;
+static TaskHandle_t connection_task_handle = NULL;  // Event task only (see WIFI_MANAGER_EVENT)
 static TimerHandle_t retry_timer = NULL;
-static uint32_t quote_count = 0;
+static TimerHandle_t budget_timer = NULL;
+
+// Credentials test from the portal (event task and web server task)
+static volatile wifi_provision_state_t provision_state = WIFI_PROVISION_IDLE;
+static const char* volatile provision_reason = NULL;
+static char pending_ssid[33];
+static char pending_password[65];
+static int provision_attempts = 0;
+static int64_t provision_started_us = 0;
+static TimerHandle_t provision_timer = NULL;
+
+// Timer callbacks that would start the connection setup task post this
+// instead, so the task is only created on the event task, where
+// IP_EVENT_STA_GOT_IP creates it too: the check of connection_task_handle
+// and xTaskCreate() cannot interleave
+ESP_EVENT_DEFINE_BASE(WIFI_MANAGER_EVENT);
+enum {
+    WIFI_MANAGER_EVENT_BUDGET_EXPIRED,  // budget_timer fired before an IP
+};
 
 // Forward declarations
 static void wifi_event_handler(void* arg, esp_event_base_t event_base,
                                int32_t event_id, void* event_data);
 static void start_provisioning_mode(void);
-static esp_err_t load_credentials(char* ssid, char* password);
-static void start_sta_mode(const char* ssid, const char* password);
-static void initialize_sntp(void);
-static void get_formatted_time(char* buffer, size_t buffer_size);
-static esp_err_t load_quote_count(void);
+static void drop_ap_hint(void);
+static void start_sta_mode(void);
+static void budget_timer_callback(TimerHandle_t xTimer);
+static void provision_failed(const char* reason);
 
 esp_err_t wifi_manager_init(void) {
     ESP_LOGI(TAG, "Initializing WiFi manager...");
@@ -69,9 +94,8 @@ esp_err_t wifi_manager_init(void) {
                                                &wifi_event_handler, NULL));
     ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP,
                                                &wifi_event_handler, NULL));
-
-    // Load quote counter from NVS
-    load_quote_count();
+    ESP_ERROR_CHECK(esp_event_handler_register(WIFI_MANAGER_EVENT, ESP_EVENT_ANY_ID,
+                                               &wifi_event_handler, NULL));
 
     ESP_LOGI(TAG, "WiFi manager initialized");
     return ESP_OK;
@@ -80,21 +104,18 @@ esp_err_t wifi_manager_init(void) {
 esp_err_t wifi_manager_start(bool silent) {
     ESP_LOGI(TAG, "Starting WiFi manager...");
 
-    char ssid[33] = {0};
-    char password[65] = {0};
-
-    // Try to load credentials from NVS
-    esp_err_t err = load_credentials(ssid, password);
+    wifi_networks_init();
 
-    if (err == ESP_OK && strlen(ssid) > 0) {
-        // Credentials found, try to connect
-        ESP_LOGI(TAG, "Found saved credentials for SSID: %s", ssid);
+    if (wifi_networks_count() > 0) {
+        // Credentials found, try to connect (the last good network first)
+        const char* ssid = wifi_networks_get(0)->ssid;
+        BINLOG_I(TAG, "Found %d saved networks, last good: %s", wifi_networks_count(), ssid);
         if (!silent) {
             display_connecting(ssid);
         } else {
-            ESP_LOGI(TAG, "Silent reconnection, skipping connection message");
+            BINLOG_I(TAG, "Silent reconnection, skipping connection message");
         }
-        start_sta_mode(ssid, password);
+        start_sta_mode();
     } else {
         // No credentials, start provisioning mode
         ESP_LOGI(TAG, "No credentials found, starting provisioning mode");
@@ -104,84 +125,292 @@ esp_err_t wifi_manager_start(bool silent) {
     return ESP_OK;
 }
 
-esp_err_t wifi_manager_save_credentials(const char* ssid, const char* password) {
+esp_err_t wifi_manager_save_credentials(const char* ssid, const char* password,
+                                        uint8_t channel, const uint8_t* bssid) {
     ESP_LOGI(TAG, "Saving WiFi credentials to NVS...");
 
-    nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open(WIFI_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    // Added to the saved networks (or updated), and tried first next time
+    esp_err_t err = wifi_networks_add(ssid, password, channel, bssid);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error opening NVS handle: %s", esp_err_to_name(err));
-        return err;
+        ESP_LOGE(TAG, "Error saving credentials: %s", esp_err_to_name(err));
+    } else if (channel != 0 && bssid != NULL) {
+        ESP_LOGI(TAG, "Access point "MACSTR" on channel %u saved for a scan-free connect",
+                 MAC2STR(bssid), channel);
     }
+    return err;
+}
 
-    // Save SSID
-    err = nvs_set_str(nvs_handle, WIFI_SSID_KEY, ssid);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving SSID: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
+static void provision_timer_callback(TimerHandle_t xTimer) {
+    if (provision_state == WIFI_PROVISION_TESTING) {
+        provision_failed("no answer from the network");
+    }
+}
+
+esp_err_t wifi_manager_test_credentials(const char* ssid, const char* password,
+                                        uint8_t channel, const uint8_t* bssid) {
+    if (!provisioning_mode || provision_state == WIFI_PROVISION_TESTING ||
+        provision_state == WIFI_PROVISION_CONNECTED) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    strlcpy(pending_ssid, ssid, sizeof(pending_ssid));
+    strlcpy(pending_password, password, sizeof(pending_password));
+
+    wifi_config_t wifi_config = {0};
+    strlcpy((char*)wifi_config.sta.ssid, ssid, sizeof(wifi_config.sta.ssid));
+    strlcpy((char*)wifi_config.sta.password, password, sizeof(wifi_config.sta.password));
+    wifi_config.sta.listen_interval = 3;
+
+    // The access point from the portal's scan: no all-channel scan, which
+    // would also take the radio off the softAP's channel for longer
+    hinted = channel != 0 && bssid != NULL;
+    if (hinted) {
+        wifi_config.sta.channel = channel;
+        wifi_config.sta.bssid_set = true;
+        memcpy(wifi_config.sta.bssid, bssid, sizeof(wifi_config.sta.bssid));
     }
 
-    // Save password
-    err = nvs_set_str(nvs_handle, WIFI_PASS_KEY, password);
+    // The station cannot scan and connect at once
+    wifi_scan_stop();
+    esp_err_t err = esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving password: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
+        ESP_LOGE(TAG, "Station config rejected: %s", esp_err_to_name(err));
+        wifi_scan_start();
         return err;
     }
 
-    // Commit changes
-    err = nvs_commit(nvs_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error committing NVS: %s", esp_err_to_name(err));
-    } else {
-        ESP_LOGI(TAG, "WiFi credentials saved successfully");
+    provision_attempts = 1;
+    provision_reason = NULL;
+    provision_state = WIFI_PROVISION_TESTING;
+    provision_started_us = esp_timer_get_time();
+    if (provision_timer == NULL) {
+        provision_timer = xTimerCreate("provision_timer", pdMS_TO_TICKS(WIFI_PROVISION_TIMEOUT_MS),
+                                       pdFALSE,  // One-shot timer
+                                       NULL,
+                                       provision_timer_callback);
+    }
+    if (provision_timer != NULL) {
+        xTimerReset(provision_timer, 0);
     }
 
-    nvs_close(nvs_handle);
-    return err;
+    wake_budget_enter(WAKE_STAGE_WIFI);
+    BINLOG_I(TAG, "Trying credentials for SSID: %s", ssid);
+    esp_wifi_connect();
+    return ESP_OK;
 }
 
-static esp_err_t load_credentials(char* ssid, char* password) {
-    nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open(WIFI_NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
-    if (err != ESP_OK) {
-        ESP_LOGW(TAG, "No saved credentials found");
-        return err;
+wifi_provision_state_t wifi_manager_provision_status(const char** reason) {
+    wifi_provision_state_t state = provision_state;
+    if (reason != NULL) {
+        *reason = state == WIFI_PROVISION_FAILED ? provision_reason : NULL;
     }
+    return state;
+}
 
-    size_t ssid_len = 33;
-    size_t pass_len = 65;
+// Nothing saved: the portal stays up for another try
+static void provision_failed(const char* reason) {
+    if (provision_timer != NULL) {
+        xTimerStop(provision_timer, 0);
+    }
+    provision_reason = reason;
+    provision_state = WIFI_PROVISION_FAILED;
+    hinted = false;
+    BINLOG_W(TAG, "Credentials for %s failed: %s", pending_ssid, reason);
+    memset(pending_password, 0, sizeof(pending_password));
+
+    // Disconnecting posts one more STA_DISCONNECTED, ignored as no test runs
+    esp_wifi_disconnect();
+    wifi_scan_start();
+}
 
-    err = nvs_get_str(nvs_handle, WIFI_SSID_KEY, ssid, &ssid_len);
-    if (err == ESP_OK) {
-        err = nvs_get_str(nvs_handle, WIFI_PASS_KEY, password, &pass_len);
+// A disconnect while testing: retry, or tell the page why
+static void provision_disconnected(uint8_t reason) {
+    switch (reason) {
+        case WIFI_REASON_AUTH_FAIL:
+        case WIFI_REASON_AUTH_EXPIRE:
+        case WIFI_REASON_MIC_FAILURE:
+        case WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT:
+        case WIFI_REASON_HANDSHAKE_TIMEOUT:
+            provision_failed("wrong password");
+            return;
+        default:
+            break;
     }
+    if (provision_attempts < WIFI_PROVISION_ATTEMPTS) {
+        provision_attempts++;
+        if (hinted) {
+            drop_ap_hint();
+        }
+        ESP_LOGI(TAG, "Connection failed (reason %u), retrying... (%d/%d)",
+                 reason, provision_attempts, WIFI_PROVISION_ATTEMPTS);
+        esp_wifi_connect();
+        return;
+    }
+    provision_failed(reason == WIFI_REASON_NO_AP_FOUND ? "network not found" : "connection failed");
+}
 
-    nvs_close(nvs_handle);
-    return err;
+// Connected with the tested credentials: keep them
+static void provision_succeeded(const wifi_ap_record_t* ap_info) {
+    if (provision_timer != NULL) {
+        xTimerStop(provision_timer, 0);
+    }
+    uint32_t connect_ms = (esp_timer_get_time() - provision_started_us) / 1000;
+    if (ap_info != NULL) {
+        wifi_manager_save_credentials(pending_ssid, pending_password, ap_info->primary, ap_info->bssid);
+        wifi_networks_connected(0, ap_info->primary, ap_info->bssid, ap_info->rssi, connect_ms);
+    } else {
+        wifi_manager_save_credentials(pending_ssid, pending_password, 0, NULL);
+    }
+    memset(pending_password, 0, sizeof(pending_password));
+    provision_state = WIFI_PROVISION_CONNECTED;
+    BINLOG_I(TAG, "Credentials verified in %lu ms", (unsigned long)connect_ms);
 }
 
-static void start_sta_mode(const char* ssid, const char* password) {
-    ESP_LOGI(TAG, "Starting WiFi in station mode...");
+// Portal down, softAP off; the station stays associated
+static void finish_provisioning(void) {
+    // The page polls the status about once a second
+    vTaskDelay(pdMS_TO_TICKS(WIFI_PROVISION_HANDOVER_MS));
+
+    mem_profile_sample();  // The portal's tasks, before they are gone
+    captive_dns_stop();
+    webserver_stop();
+    provisioning_mode = false;
+    esp_wifi_set_mode(WIFI_MODE_STA);
+    esp_wifi_set_ps(WIFI_PS_MIN_MODEM);
+    BINLOG_I(TAG, "Provisioning done, continuing without restart");
+}
+
+// Back to the all-channel scan for the remaining attempts
+static void drop_ap_hint(void) {
+    wifi_config_t wifi_config;
+    if (esp_wifi_get_config(WIFI_IF_STA, &wifi_config) == ESP_OK) {
+        wifi_config.sta.channel = 0;
+        wifi_config.sta.bssid_set = false;
+        esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+    }
+    hinted = false;
+    ESP_LOGW(TAG, "Access point not reached, scanning all channels");
+}
+
+// Try a saved network, at a known access point if channel is not 0
+static void connect_network(int index, uint8_t channel, const uint8_t* bssid) {
+    const wifi_network_t* network = wifi_networks_get(index);
+    if (network == NULL) {
+        return;
+    }
 
     wifi_config_t wifi_config = {0};
-    strlcpy((char*)wifi_config.sta.ssid, ssid, sizeof(wifi_config.sta.ssid));
-    strlcpy((char*)wifi_config.sta.password, password, sizeof(wifi_config.sta.password));
+    strlcpy((char*)wifi_config.sta.ssid, network->ssid, sizeof(wifi_config.sta.ssid));
+    strlcpy((char*)wifi_config.sta.password, network->password, sizeof(wifi_config.sta.password));
 
     // Increase beacon timeout threshold to reduce warnings
     wifi_config.sta.listen_interval = 3;
 
+    // Known access point: probe its channel only instead of scanning all 13
+    hinted = channel != 0 && bssid != NULL;
+    if (hinted) {
+        wifi_config.sta.channel = channel;
+        wifi_config.sta.bssid_set = true;
+        memcpy(wifi_config.sta.bssid, bssid, sizeof(wifi_config.sta.bssid));
+        BINLOG_I(TAG, "Connecting to %s on channel %u", network->ssid, channel);
+    } else {
+        BINLOG_I(TAG, "Connecting to %s", network->ssid);
+    }
+    esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+
+    current = index;
+    attempt_started_us = esp_timer_get_time();
+    esp_wifi_connect();
+}
+
+// Start of a cycle: the network that worked last, where it was
+static void connect_last_good(void) {
+    const wifi_network_t* network = wifi_networks_get(0);
+    scanned = false;
+    candidate_count = 0;
+    if (network->channel == 0 && wifi_networks_count() > 1) {
+        // Without an access point the driver would scan for this one
+        // network only; one scan serves all of them
+        scanned = true;
+        if (wifi_scan_start() == ESP_OK) {
+            return;
+        }
+    }
+    connect_network(0, network->channel, network->bssid);
+}
+
+// Next attempt of the cycle: after one scan, the saved networks it saw,
+// strongest first, at the access point it saw
+static void connect_next(void) {
+    if (!scanned) {
+        scanned = true;
+        if (wifi_scan_start() == ESP_OK) {
+            return;  // scan_done_callback() goes on
+        }
+    }
+    if (candidate_count == 0) {
+        // Scan failed or saw none of them: let the driver search by name
+        for (int i = 0; i < wifi_networks_count(); i++) {
+            candidates[i] = i;
+        }
+        candidate_count = wifi_networks_count();
+        candidate_next = 0;
+    }
+
+    int index = candidates[candidate_next++ % candidate_count];
+    wifi_scan_ap_t ap;
+    if (wifi_scan_find(wifi_networks_get(index)->ssid, &ap)) {
+        connect_network(index, ap.channel, ap.bssid);
+    } else {
+        connect_network(index, 0, NULL);
+    }
+}
+
+static void scan_done_callback(void) {
+    if (provisioning_mode || offline || display_updated) {
+        return;
+    }
+
+    int8_t rssi[WIFI_NETWORKS_MAX];
+    for (int i = 0; i < wifi_networks_count(); i++) {
+        wifi_scan_ap_t ap;
+        rssi[i] = wifi_scan_find(wifi_networks_get(i)->ssid, &ap) ? ap.rssi : WIFI_NETWORKS_NOT_SEEN;
+    }
+    candidate_count = wifi_networks_rank(rssi, candidates);
+    candidate_next = 0;
+    BINLOG_I(TAG, "%d of %d saved networks in range", candidate_count, wifi_networks_count());
+    connect_next();
+}
+
+static void start_sta_mode(void) {
+    BINLOG_I(TAG, "Starting WiFi in station mode...");
+
+    // Networks are configured per attempt once the station runs (STA_START)
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
+    wifi_scan_set_done_callback(scan_done_callback);
 
     // Set WiFi power save mode to reduce beacon timeout warnings
     ESP_ERROR_CHECK(esp_wifi_set_ps(WIFI_PS_MIN_MODEM));
 
+    // Connecting, retries and retry waits are charged to the wifi stage;
+    // when the wake budget runs out the wake goes on offline
+    wake_budget_enter(WAKE_STAGE_WIFI);
+    uint32_t budget_ms = wake_budget_remaining_ms();
+    if (budget_ms != WAKE_BUDGET_UNLIMITED) {
+        budget_timer = xTimerCreate("budget_timer", pdMS_TO_TICKS(budget_ms > 0 ? budget_ms : 1),
+                                    pdFALSE,  // One-shot timer
+                                    NULL,
+                                    budget_timer_callback);
+        if (budget_timer != NULL) {
+            xTimerStart(budget_timer, 0);
+        }
+    }
+
     ESP_ERROR_CHECK(esp_wifi_start());
 
     retry_count = 0;
     provisioning_mode = false;
+    offline = false;
     display_updated = false;  // Reset flag for new connection
 }
 
@@ -210,153 +439,65 @@ static void start_provisioning_mode(void) {
     // Copy SSID to config
     strlcpy((char*)ap_config.ap.ssid, ap_ssid, sizeof(ap_config.ap.ssid));
 
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_AP));
+    // APSTA: the station interface stays unconnected and only scans for the portal
+    provisioning_mode = true;
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_APSTA));
     ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_AP, &ap_config));
     ESP_ERROR_CHECK(esp_wifi_start());
 
-    // Start web server
-    webserver_start();
+    // Results are usually ready by the time a phone has joined and opened the page
+    wifi_scan_start();
+
+    // Start web server, and send every name a phone looks up to it.
+    // A new firmware image whose portal is up can take another update: keep it
+    if (webserver_start() == ESP_OK) {
+        ota_update_confirm(true);
+    }
+    captive_dns_start();
 
     // Update display
     display_provisioning_mode(ap_ssid);
 
-    provisioning_mode = true;
     display_updated = false;  // Reset flag for next connection attempt
 }
 
-static void initialize_sntp(void) {
-    ESP_LOGI(TAG, "Initializing SNTP...");
-
-    // Set timezone to Europe/Rome (CET-1CEST with DST)
-    setenv("TZ", "CET-1CEST,M3.5.0,M10.5.0/3", 1);
-    tzset();
-
-    // Initialize SNTP
-    esp_sntp_setoperatingmode(SNTP_OPMODE_POLL);
-    esp_sntp_setservername(0, "pool.ntp.org");
-    esp_sntp_init();
-
-    ESP_LOGI(TAG, "SNTP initialized, waiting for time sync...");
-
-    // Wait for time to be set (max 10 seconds)
-    int retry = 0;
-    const int retry_count = 10;
-    while (esp_sntp_get_sync_status() == SNTP_SYNC_STATUS_RESET && ++retry < retry_count) {
-        ESP_LOGI(TAG, "Waiting for system time to be set... (%d/%d)", retry, retry_count);
-        vTaskDelay(pdMS_TO_TICKS(1000));
-    }
-
-    if (retry < retry_count) {
-        ESP_LOGI(TAG, "Time synchronized successfully");
-    } else {
-        ESP_LOGW(TAG, "Time sync timeout, using default time");
-    }
-}
-
-static void get_formatted_time(char* buffer, size_t buffer_size) {
-    time_t now;
-    struct tm timeinfo;
-
-    time(&now);
-    localtime_r(&now, &timeinfo);
-
-    // Format: "Last update: DD/MM/YYYY HH:MM"
-    strftime(buffer, buffer_size, "Last update: %d/%m/%Y %H:%M", &timeinfo);
-}
-
 // Timer callback to retry WiFi connection after delay
 static void retry_timer_callback(TimerHandle_t xTimer) {
     ESP_LOGI(TAG, "Retry timer expired, attempting to reconnect (cycle %d/%d)...",
-             retry_cycle + 1, MAX_RETRY_CYCLES);
+             retry_cycle + 1, WIFI_MAX_RETRY_CYCLES);
     retry_count = 0;  // Reset retry count for new cycle
     retry_cycle++;
-    esp_wifi_connect();
+    connect_last_good();
 }
 
 // Task to handle connection setup (SNTP, quote fetching, display update)
 // Runs in separate task with larger stack to avoid overflow
 static void connection_setup_task(void* param) {
-    ESP_LOGI(TAG, "Connection setup task started");
-
-    // Read battery FIRST, right after WiFi connection but before any transmissions
-    // WiFi is connected but not actively transmitting yet, reducing interference
-    ESP_LOGI(TAG, "Reading battery voltage (WiFi connected but idle)...");
-    esp_err_t batt_err = battery_init();
-    float battery_percent = -1.0;
-    if (batt_err == ESP_OK) {
-        battery_percent = battery_read_percentage();
-        if (battery_percent >= 0) {
-            ESP_LOGI(TAG, "Battery percentage: %.1f%%", battery_percent);
-        } else {
-            ESP_LOGW(TAG, "Failed to read battery percentage");
-        }
-    } else {
-        ESP_LOGW(TAG, "Battery init failed: %s", esp_err_to_name(batt_err));
-    }
-
-    // Initialize SNTP and get current time
-    initialize_sntp();
-
-    // Initialize wikiquote
-    wikiquote_init();
-
-    // Calculate random sleep duration BEFORE displaying (needed for next update time)
-    uint32_t min_sleep_minutes = 10;
-    uint32_t max_sleep_minutes = 60;
-    uint32_t random_minutes = min_sleep_minutes + (esp_random() % (max_sleep_minutes - min_sleep_minutes + 1));
-    uint32_t sleep_seconds = random_minutes * 60;
-
-    // Get a random quote with author
-    char quote[512];
-    char author[128];
-    esp_err_t err = wikiquote_get_random_quote_with_author(quote, sizeof(quote),
-                                                            author, sizeof(author));
-
-    // Increment quote counter
-    wifi_manager_increment_quote_count();
-
-    // Format datetime string with quote counter and next update time
-    char datetime_str[192];
-    char time_part[64];
-    get_formatted_time(time_part, sizeof(time_part));
-
-    // Calculate next update time
-    time_t now;
-    time(&now);
-    time_t next_update = now + sleep_seconds;
-    struct tm next_update_tm;
-    localtime_r(&next_update, &next_update_tm);
-    char next_update_str[32];
-    strftime(next_update_str, sizeof(next_update_str), "%H:%M", &next_update_tm);
-
-    // Format datetime string with battery percentage
-    if (battery_percent >= 0) {
-        snprintf(datetime_str, sizeof(datetime_str), "%s - quotes: %lu - next: %s - batt: %.0f%%",
-                 time_part, (unsigned long)wifi_manager_get_quote_count(), next_update_str, battery_percent);
-    } else {
-        snprintf(datetime_str, sizeof(datetime_str), "%s - quotes: %lu - next: %s - batt: --%%",
-                 time_part, (unsigned long)wifi_manager_get_quote_count(), next_update_str);
-    }
+    bool online = (bool)(uintptr_t)param;
+    BINLOG_I(TAG, "Connection setup task started (%s)", online ? "online" : "offline");
 
-    // Update display with quote, author and time
-    if (err == ESP_OK) {
-        display_connected_mode(quote, author, datetime_str);
-    } else {
-        // Fallback if quote fetch fails
-        display_connected_mode("La semplicità è l'ultima sofisticazione.",
-                              "Leonardo da Vinci", datetime_str);
+    if (provisioning_mode) {
+        finish_provisioning();
     }
 
+    // Battery, SNTP, quote fetch, display and state persistence
+    uint32_t sleep_seconds = wake_cycle_run(online);
+
     display_updated = true;
 
-    ESP_LOGI(TAG, "Connection setup task completed");
+    // Maintenance window: stay on the network and serve the metrics
+    uint32_t window_ms = maintenance_window_ms();
+    if (window_ms > 0 && webserver_start_maintenance() == ESP_OK) {
+        ESP_LOGI(TAG, "Maintenance window: %lu s", (unsigned long)(window_ms / 1000));
+        vTaskDelay(pdMS_TO_TICKS(window_ms));
+        mem_profile_sample();
+        mem_profile_save();  // The window ran after the end-of-wake save
+        webserver_stop();
+    }
 
-    // Wait a bit to ensure display is fully powered off
-    vTaskDelay(pdMS_TO_TICKS(2000));
+    BINLOG_I(TAG, "Connection setup task completed");
 
     // Enter deep sleep
-    ESP_LOGI(TAG, "Entering deep sleep for %lu minutes (%lu seconds)...",
-             (unsigned long)random_minutes, (unsigned long)sleep_seconds);
     sleep_manager_enter_deep_sleep(sleep_seconds);
 
     // This line will never be reached as device enters deep sleep
@@ -364,34 +505,75 @@ static void connection_setup_task(void* param) {
     vTaskDelete(NULL);
 }
 
+// Give up on the station for this wake: show stored content and sleep
+// (event task only)
+static void go_offline(void) {
+    if (display_updated || connection_task_handle != NULL) {
+        return;
+    }
+    wake_budget_expire();
+    BINLOG_W(TAG, "Wake budget used up while connecting, continuing offline");
+
+    offline = true;
+    if (retry_timer != NULL) {
+        xTimerDelete(retry_timer, 0);
+        retry_timer = NULL;
+    }
+    esp_wifi_stop();
+
+    xTaskCreate(connection_setup_task,
+               "conn_setup",
+               WIFI_SETUP_STACK_SIZE,
+               (void*)(uintptr_t)false,
+               5,
+               &connection_task_handle);
+}
+
+static void budget_timer_callback(TimerHandle_t xTimer) {
+    // Timer task: hand over to the event task (WIFI_MANAGER_EVENT)
+    if (esp_event_post(WIFI_MANAGER_EVENT, WIFI_MANAGER_EVENT_BUDGET_EXPIRED, NULL, 0, 0) != ESP_OK) {
+        xTimerChangePeriod(xTimer, pdMS_TO_TICKS(WIFI_EVENT_POST_RETRY_MS), 0);  // Queue full: again shortly
+    }
+}
+
 static void wifi_event_handler(void* arg, esp_event_base_t event_base,
                                int32_t event_id, void* event_data) {
     if (event_base == WIFI_EVENT) {
         switch (event_id) {
             case WIFI_EVENT_STA_START:
-                ESP_LOGI(TAG, "WiFi station started, connecting...");
-                esp_wifi_connect();
+                if (!provisioning_mode) {
+                    BINLOG_I(TAG, "WiFi station started, connecting...");
+                    connect_last_good();
+                }
                 break;
 
             case WIFI_EVENT_STA_DISCONNECTED:
-                if (!provisioning_mode) {
-                    if (retry_count < MAX_RETRY) {
+                if (provisioning_mode && provision_state == WIFI_PROVISION_TESTING) {
+                    wifi_event_sta_disconnected_t* event = (wifi_event_sta_disconnected_t*) event_data;
+                    provision_disconnected(event->reason);
+                } else if (!provisioning_mode && !offline) {
+                    wifi_networks_failed(current);
+                    if (retry_count < WIFI_MAX_RETRY) {
                         ESP_LOGI(TAG, "Connection failed, retrying... (%d/%d)",
-                                retry_count + 1, MAX_RETRY);
-                        esp_wifi_connect();
+                                retry_count + 1, WIFI_MAX_RETRY);
                         retry_count++;
+                        connect_next();
                     } else {
                         // Reached max retry attempts for this cycle
-                        if (retry_cycle < MAX_RETRY_CYCLES) {
+                        if (retry_cycle < WIFI_MAX_RETRY_CYCLES &&
+                            wake_budget_remaining_ms() < WIFI_RETRY_DELAY_MS) {
+                            // The wait would outlast the wake budget
+                            go_offline();
+                        } else if (retry_cycle < WIFI_MAX_RETRY_CYCLES) {
                             ESP_LOGW(TAG, "Failed to connect after %d attempts (cycle %d/%d), waiting 1 minute before retry...",
-                                    MAX_RETRY, retry_cycle + 1, MAX_RETRY_CYCLES);
+                                    WIFI_MAX_RETRY, retry_cycle + 1, WIFI_MAX_RETRY_CYCLES);
 
                             // Create one-shot timer for retry delay
                             if (retry_timer != NULL) {
                                 xTimerDelete(retry_timer, 0);
                             }
                             retry_timer = xTimerCreate("retry_timer",
-                                                       pdMS_TO_TICKS(RETRY_DELAY_MS),
+                                                       pdMS_TO_TICKS(WIFI_RETRY_DELAY_MS),
                                                        pdFALSE,  // One-shot timer
                                                        NULL,
                                                        retry_timer_callback);
@@ -400,7 +582,7 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base,
                             }
                         } else {
                             ESP_LOGW(TAG, "Failed to connect after %d retry cycles, switching to provisioning mode",
-                                    MAX_RETRY_CYCLES);
+                                    WIFI_MAX_RETRY_CYCLES);
                             // Stop STA mode first
                             esp_wifi_stop();
                             // Start provisioning mode
@@ -427,17 +609,32 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base,
             default:
                 break;
         }
+    } else if (event_base == WIFI_MANAGER_EVENT && event_id == WIFI_MANAGER_EVENT_BUDGET_EXPIRED) {
+        go_offline();
     } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
         ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
-        ESP_LOGI(TAG, "Got IP address: " IPSTR, IP2STR(&event->ip_info.ip));
+        BINLOG_I(TAG, "Got IP address: " IPSTR, IP2STR(&event->ip_info.ip));
+
+        wifi_ap_record_t ap_info;
+        bool have_ap_info = esp_wifi_sta_get_ap_info(&ap_info) == ESP_OK;
+        if (provisioning_mode) {
+            if (provision_state != WIFI_PROVISION_TESTING) {
+                return;  // Late IP after a failed or timed-out test
+            }
+            provision_succeeded(have_ap_info ? &ap_info : NULL);
+        } else if (have_ap_info) {
+            // Moves it to the front: the next wake tries it first
+            wifi_networks_connected(current, ap_info.primary, ap_info.bssid, ap_info.rssi,
+                                    (esp_timer_get_time() - attempt_started_us) / 1000);
+        }
 
         // Only update display once to prevent flashing on DHCP renewals
         if (!display_updated && connection_task_handle == NULL) {
             // Create task with large stack for HTTPS, JSON parsing, and display
             xTaskCreate(connection_setup_task,
                        "conn_setup",
-                       12288,  // 12KB stack for HTTPS and JSON
-                       NULL,
+                       WIFI_SETUP_STACK_SIZE,
+                       (void*)(uintptr_t)true,
                        5,
                        &connection_task_handle);
         }
@@ -445,98 +642,27 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base,
         retry_count = 0;
         retry_cycle = 0;
 
-        // Clean up retry timer if it exists
+        // Clean up retry and budget timers if they exist
         if (retry_timer != NULL) {
             xTimerDelete(retry_timer, 0);
             retry_timer = NULL;
         }
+        if (budget_timer != NULL) {
+            xTimerDelete(budget_timer, 0);
+            budget_timer = NULL;
+        }
     }
 }
 
-static esp_err_t load_quote_count(void) {
-    nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open(WIFI_NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
-    if (err != ESP_OK) {
-        ESP_LOGW(TAG, "No saved quote count found, starting from 0");
-        quote_count = 0;
-        return ESP_OK;
-    }
-
-    err = nvs_get_u32(nvs_handle, WIFI_QUOTE_COUNT_KEY, &quote_count);
-    if (err != ESP_OK) {
-        ESP_LOGW(TAG, "Failed to read quote count, starting from 0");
-        quote_count = 0;
-    } else {
-        ESP_LOGI(TAG, "Loaded quote count: %lu", (unsigned long)quote_count);
-    }
-
-    nvs_close(nvs_handle);
-    return ESP_OK;
-}
-
-uint32_t wifi_manager_get_quote_count(void) {
-    return quote_count;
-}
-
-esp_err_t wifi_manager_increment_quote_count(void) {
-    quote_count++;
-    ESP_LOGI(TAG, "Incrementing quote count to %lu", (unsigned long)quote_count);
-
-    nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open(WIFI_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error opening NVS handle for quote count: %s", esp_err_to_name(err));
-        return err;
-    }
-
-    err = nvs_set_u32(nvs_handle, WIFI_QUOTE_COUNT_KEY, quote_count);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error saving quote count: %s", esp_err_to_name(err));
-        nvs_close(nvs_handle);
-        return err;
-    }
-
-    err = nvs_commit(nvs_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error committing quote count: %s", esp_err_to_name(err));
-    } else {
-        ESP_LOGI(TAG, "Quote count saved successfully");
-    }
-
-    nvs_close(nvs_handle);
-    return err;
-}
-
 esp_err_t wifi_manager_delete_credentials(void) {
     ESP_LOGI(TAG, "Deleting WiFi credentials from NVS...");
 
-    nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open(WIFI_NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    // Every saved network, with its access point and stats
+    esp_err_t err = wifi_networks_clear();
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error opening NVS handle for credential deletion: %s", esp_err_to_name(err));
-        return err;
-    }
-
-    // Erase SSID
-    err = nvs_erase_key(nvs_handle, WIFI_SSID_KEY);
-    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
-        ESP_LOGE(TAG, "Error erasing SSID: %s", esp_err_to_name(err));
-    }
-
-    // Erase password
-    err = nvs_erase_key(nvs_handle, WIFI_PASS_KEY);
-    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
-        ESP_LOGE(TAG, "Error erasing password: %s", esp_err_to_name(err));
-    }
-
-    // Commit changes
-    err = nvs_commit(nvs_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Error committing NVS changes: %s", esp_err_to_name(err));
+        ESP_LOGE(TAG, "Error deleting credentials: %s", esp_err_to_name(err));
     } else {
         ESP_LOGI(TAG, "WiFi credentials deleted successfully");
     }
-
-    nvs_close(nvs_handle);
     return err;
 }
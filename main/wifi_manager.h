@@ -2,11 +2,35 @@
 
 #include <esp_err.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// Station connection retry policy (also replayed by the host simulator)
+#define WIFI_MAX_RETRY 3              // Reconnects per cycle after the first attempt
+#define WIFI_MAX_RETRY_CYCLES 10      // Cycles before falling back to provisioning
+#define WIFI_RETRY_DELAY_MS 60000     // Pause between cycles (1 minute)
+
+// Credentials from the portal are tried live before they are saved
+#define WIFI_PROVISION_TIMEOUT_MS 20000   // No IP by then: reported as failed
+#define WIFI_PROVISION_ATTEMPTS 2         // Connects before giving up (wrong password: one)
+#define WIFI_PROVISION_HANDOVER_MS 3000   // Portal kept up after success so the page can show it
+
+#define WIFI_SETUP_STACK_SIZE 12288   // connection_setup_task: HTTPS, JSON, display, OTA
+#define WIFI_EVENT_POST_RETRY_MS 100  // Budget expiry re-posted after this when the event queue is full
+
+/**
+ * State of a credentials test started from the portal
+ */
+typedef enum {
+    WIFI_PROVISION_IDLE,       // Nothing submitted yet
+    WIFI_PROVISION_TESTING,    // Station connecting
+    WIFI_PROVISION_CONNECTED,  // Saved; the portal closes and the wake cycle runs
+    WIFI_PROVISION_FAILED,     // Not saved; see the reason, the portal stays up
+} wifi_provision_state_t;
+
 /**
  * Initialize WiFi manager
  * Sets up WiFi subsystem, event loop, and network interface
@@ -26,29 +50,43 @@ esp_err_t wifi_manager_start(bool silent);
 
 /**
  * Save WiFi credentials to NVS
- * Stores SSID and password for persistent configuration
+ * Stores SSID and password for persistent configuration, and the access
+ * point to connect to without scanning if the portal's scan saw it
  *
  * @param ssid WiFi SSID (max 32 characters)
  * @param password WiFi password (max 64 characters)
+ * @param channel Channel of the access point, 0 if unknown
+ * @param bssid BSSID of the access point (6 bytes), NULL if unknown
  * @return ESP_OK on success
  */
-esp_err_t wifi_manager_save_credentials(const char* ssid, const char* password);
+esp_err_t wifi_manager_save_credentials(const char* ssid, const char* password,
+                                        uint8_t channel, const uint8_t* bssid);
 
 /**
- * Get current quote counter value
- * Retrieves the total number of quotes displayed from NVS
+ * Try credentials from the portal without leaving provisioning
+ * Returns at once. The station connects next to the softAP (APSTA); with an
+ * IP the credentials are saved and the device goes on to the normal wake
+ * cycle in the same boot. A wrong password or an unreachable network is
+ * reported through wifi_manager_provision_status() and nothing is saved
  *
- * @return Current quote count
+ * @param ssid WiFi SSID (max 32 characters)
+ * @param password WiFi password (max 64 characters)
+ * @param channel Channel of the access point, 0 if unknown
+ * @param bssid BSSID of the access point (6 bytes), NULL if unknown
+ * @return ESP_OK if the test started, ESP_ERR_INVALID_STATE if not
+ *         provisioning or a test is already running
  */
-uint32_t wifi_manager_get_quote_count(void);
+esp_err_t wifi_manager_test_credentials(const char* ssid, const char* password,
+                                        uint8_t channel, const uint8_t* bssid);
 
 /**
- * Increment quote counter
- * Increments and saves the quote counter to NVS
+ * State of the last credentials test
  *
- * @return ESP_OK on success
+ * @param reason Short failure reason out ("wrong password", ...), NULL
+ *               unless failed; may be NULL
+ * @return Test state
  */
-esp_err_t wifi_manager_increment_quote_count(void);
+wifi_provision_state_t wifi_manager_provision_status(const char** reason);
 
 /**
  * Delete WiFi credentials from NVS
@@ -0,0 +1,257 @@
+#include "wifi_networks.h"
+#include "esp_log.h"
+#include "rtc_budget.h"
+#include "esp_attr.h"
+#include "esp_rom_crc.h"
+#include "hal_nvs.h"
+#include "hal_time.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "WIFI_NETWORKS";
+#define NETWORKS_NVS_NAMESPACE "wifi_config"
+#define NETWORKS_KEY "networks"
+#define NETWORKS_MAGIC 0x514E5731    // "QNW1"
+#define CLOCK_SET_EPOCH 1700000000   // Earlier: not synchronized since the cold boot
+
+// Single network written by older firmware, imported once
+#define LEGACY_SSID_KEY "ssid"
+#define LEGACY_PASS_KEY "password"
+#define LEGACY_CHANNEL_KEY "channel"
+#define LEGACY_BSSID_KEY "bssid"
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;                   // sizeof(networks_store_t), guards layout changes
+    uint8_t count;
+    uint8_t connects_since_flush;
+    wifi_network_t networks[WIFI_NETWORKS_MAX];   // Most recently connected first
+    uint32_t crc;                    // CRC32 of all fields above
+} networks_store_t;
+RTC_BUDGET_CHECK(networks_store_t, RTC_BUDGET_WIFI_NETWORKS);
+
+// Survives deep sleep, so stats need no flash write per wake
+static RTC_NOINIT_ATTR networks_store_t store;
+
+static uint32_t store_crc(const networks_store_t* s) {
+    return esp_rom_crc32_le(0, (const uint8_t*)s, offsetof(networks_store_t, crc));
+}
+
+static bool store_valid(const networks_store_t* s) {
+    return s->magic == NETWORKS_MAGIC &&
+           s->version == WIFI_NETWORKS_VERSION &&
+           s->size == sizeof(networks_store_t) &&
+           s->count <= WIFI_NETWORKS_MAX &&
+           s->crc == store_crc(s);
+}
+
+static void store_reset(void) {
+    memset(&store, 0, sizeof(store));
+    store.magic = NETWORKS_MAGIC;
+    store.version = WIFI_NETWORKS_VERSION;
+    store.size = sizeof(networks_store_t);
+}
+
+static void store_commit(void) {
+    store.crc = store_crc(&store);
+}
+
+static esp_err_t store_flush(void) {
+    store.connects_since_flush = 0;
+    store_commit();
+    esp_err_t err = hal_nvs_set_blob(NETWORKS_NVS_NAMESPACE, NETWORKS_KEY, &store, sizeof(store));
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error saving networks: %s", esp_err_to_name(err));
+    } else {
+        ESP_LOGI(TAG, "%u networks saved to NVS", store.count);
+    }
+    return err;
+}
+
+static esp_err_t load_from_nvs(void) {
+    size_t size = sizeof(store);
+    esp_err_t err = hal_nvs_get_blob(NETWORKS_NVS_NAMESPACE, NETWORKS_KEY, &store, &size);
+    if (err == ESP_OK && (size != sizeof(store) || !store_valid(&store))) {
+        ESP_LOGW(TAG, "Stored networks failed validation (size %u)", (unsigned)size);
+        err = ESP_ERR_INVALID_CRC;
+    }
+    return err;
+}
+
+// The access point hint is not carried over: the first connect saves it again
+static void migrate_legacy(void) {
+    wifi_network_t* network = &store.networks[0];
+    size_t ssid_len = sizeof(network->ssid);
+    size_t pass_len = sizeof(network->password);
+    if (hal_nvs_get_str(NETWORKS_NVS_NAMESPACE, LEGACY_SSID_KEY, network->ssid, &ssid_len) != ESP_OK ||
+        network->ssid[0] == '\0') {
+        memset(network, 0, sizeof(*network));
+        return;
+    }
+    if (hal_nvs_get_str(NETWORKS_NVS_NAMESPACE, LEGACY_PASS_KEY, network->password, &pass_len) != ESP_OK) {
+        network->password[0] = '\0';
+    }
+    store.count = 1;
+    if (store_flush() == ESP_OK) {
+        hal_nvs_erase_key(NETWORKS_NVS_NAMESPACE, LEGACY_SSID_KEY);
+        hal_nvs_erase_key(NETWORKS_NVS_NAMESPACE, LEGACY_PASS_KEY);
+        hal_nvs_erase_key(NETWORKS_NVS_NAMESPACE, LEGACY_CHANNEL_KEY);
+        hal_nvs_erase_key(NETWORKS_NVS_NAMESPACE, LEGACY_BSSID_KEY);
+        ESP_LOGI(TAG, "Imported saved network %s", network->ssid);
+    }
+}
+
+void wifi_networks_init(void) {
+    if (store_valid(&store)) {
+        return;
+    }
+    esp_err_t err = load_from_nvs();
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "%u networks loaded from NVS", store.count);
+    } else {
+        store_reset();
+        migrate_legacy();
+    }
+    store_commit();
+}
+
+int wifi_networks_count(void) {
+    return store.count;
+}
+
+const wifi_network_t* wifi_networks_get(int index) {
+    if (index < 0 || index >= store.count) {
+        return NULL;
+    }
+    return &store.networks[index];
+}
+
+int wifi_networks_find(const char* ssid) {
+    for (int i = 0; i < store.count; i++) {
+        if (strcmp(store.networks[i].ssid, ssid) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Move an entry to the front, shifting the ones before it back
+static void move_to_front(int index) {
+    if (index <= 0) {
+        return;
+    }
+    wifi_network_t network = store.networks[index];
+    memmove(&store.networks[1], &store.networks[0], index * sizeof(network));
+    store.networks[0] = network;
+}
+
+esp_err_t wifi_networks_add(const char* ssid, const char* password,
+                            uint8_t channel, const uint8_t* bssid) {
+    int index = wifi_networks_find(ssid);
+    if (index < 0) {
+        if (store.count == WIFI_NETWORKS_MAX) {
+            ESP_LOGW(TAG, "List full, forgetting %s", store.networks[store.count - 1].ssid);
+        } else {
+            store.count++;
+        }
+        // The last slot is free or the least recently used
+        index = store.count - 1;
+        memset(&store.networks[index], 0, sizeof(store.networks[index]));
+        snprintf(store.networks[index].ssid, sizeof(store.networks[index].ssid), "%s", ssid);
+    }
+
+    wifi_network_t* network = &store.networks[index];
+    snprintf(network->password, sizeof(network->password), "%s", password);
+    network->channel = 0;
+    if (channel != 0 && bssid != NULL) {
+        network->channel = channel;
+        memcpy(network->bssid, bssid, sizeof(network->bssid));
+    }
+    move_to_front(index);
+
+    ESP_LOGI(TAG, "Saved network %s (%d of %d)", ssid, store.count, WIFI_NETWORKS_MAX);
+    return store_flush();
+}
+
+esp_err_t wifi_networks_remove(const char* ssid) {
+    int index = wifi_networks_find(ssid);
+    if (index < 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    memmove(&store.networks[index], &store.networks[index + 1],
+            (store.count - index - 1) * sizeof(store.networks[0]));
+    store.count--;
+    memset(&store.networks[store.count], 0, sizeof(store.networks[0]));
+
+    ESP_LOGI(TAG, "Forgot network %s", ssid);
+    return store_flush();
+}
+
+esp_err_t wifi_networks_clear(void) {
+    store_reset();
+    return store_flush();
+}
+
+void wifi_networks_connected(int index, uint8_t channel, const uint8_t* bssid,
+                             int8_t rssi, uint32_t connect_ms) {
+    if (index < 0 || index >= store.count) {
+        return;
+    }
+    wifi_network_t* network = &store.networks[index];
+    bool changed = index != 0 || network->channel != channel ||
+                   memcmp(network->bssid, bssid, sizeof(network->bssid)) != 0;
+
+    network->channel = channel;
+    memcpy(network->bssid, bssid, sizeof(network->bssid));
+    network->rssi = rssi;
+    network->connect_ms = connect_ms > UINT16_MAX ? UINT16_MAX : connect_ms;
+    time_t now = hal_time_now();
+    if (now >= CLOCK_SET_EPOCH) {
+        network->last_success = (uint32_t)now;
+    }
+    if (network->successes < UINT16_MAX) {
+        network->successes++;
+    }
+    move_to_front(index);
+    store.connects_since_flush++;
+
+    ESP_LOGI(TAG, "Connected to %s in %lu ms at %d dBm, channel %u",
+             store.networks[0].ssid, (unsigned long)connect_ms, rssi, channel);
+
+    // Order and access point matter for the next wake; stats can wait
+    if (changed || store.connects_since_flush >= WIFI_NETWORKS_FLUSH_INTERVAL) {
+        store_flush();
+    } else {
+        store_commit();
+    }
+}
+
+void wifi_networks_failed(int index) {
+    if (index < 0 || index >= store.count) {
+        return;
+    }
+    if (store.networks[index].failures < UINT16_MAX) {
+        store.networks[index].failures++;
+    }
+    store_commit();
+}
+
+int wifi_networks_rank(const int8_t* rssi, int* order) {
+    int n = 0;
+    for (int i = 0; i < store.count; i++) {
+        if (rssi[i] == WIFI_NETWORKS_NOT_SEEN) {
+            continue;
+        }
+        // Insertion by RSSI; equal signals keep the recently used first
+        int j = n;
+        while (j > 0 && rssi[order[j - 1]] < rssi[i]) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = i;
+        n++;
+    }
+    return n;
+}
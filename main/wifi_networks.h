@@ -0,0 +1,122 @@
+#pragma once
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WIFI_NETWORKS_MAX 5                 // Saved networks; adding one more drops the least recently used
+#define WIFI_NETWORKS_VERSION 1
+#define WIFI_NETWORKS_FLUSH_INTERVAL 12     // Connects between stats-only flushes to flash
+#define WIFI_NETWORKS_NOT_SEEN INT8_MIN     // RSSI of a network the scan did not see
+
+/**
+ * A saved network and how connecting to it went
+ */
+typedef struct {
+    char ssid[33];
+    char password[65];
+    uint8_t channel;                 // Access point of the last connect, 0 = unknown (scan)
+    uint8_t bssid[6];
+    int8_t rssi;                     // dBm at the last connect, 0 = never connected
+    uint16_t connect_ms;             // Last connect, from esp_wifi_connect() to the IP
+    uint32_t last_success;           // Epoch seconds of the last connect, 0 = never or clock unset
+    uint16_t successes;
+    uint16_t failures;               // Failed attempts
+} wifi_network_t;
+
+/**
+ * Load the saved networks
+ * Uses the RTC copy if its CRC is valid (wake from deep sleep), otherwise
+ * the NVS copy, otherwise imports the single SSID/password written by
+ * older firmware. Call after nvs_flash_init()
+ */
+void wifi_networks_init(void);
+
+/**
+ * @return Number of saved networks
+ */
+int wifi_networks_count(void);
+
+/**
+ * Saved network by position, most recently connected first: index 0 is
+ * the last network that worked
+ *
+ * @param index 0 .. wifi_networks_count() - 1
+ * @return The entry, NULL if out of range
+ */
+const wifi_network_t* wifi_networks_get(int index);
+
+/**
+ * @param ssid Network name
+ * @return Position of the network, -1 if not saved
+ */
+int wifi_networks_find(const char* ssid);
+
+/**
+ * Save a network, or change the password of a saved one
+ * It moves to the front, so the next connect tries it first. With the list
+ * full the least recently used network is dropped. Written to flash at once
+ *
+ * @param ssid WiFi SSID (max 32 characters)
+ * @param password WiFi password (max 64 characters)
+ * @param channel Channel of the access point, 0 if unknown
+ * @param bssid BSSID of the access point (6 bytes), NULL if unknown
+ * @return ESP_OK on success
+ */
+esp_err_t wifi_networks_add(const char* ssid, const char* password,
+                            uint8_t channel, const uint8_t* bssid);
+
+/**
+ * Forget a network (written to flash at once)
+ *
+ * @param ssid Network name
+ * @return ESP_OK, or ESP_ERR_NOT_FOUND if it was not saved
+ */
+esp_err_t wifi_networks_remove(const char* ssid);
+
+/**
+ * Forget every network (written to flash at once)
+ *
+ * @return ESP_OK on success
+ */
+esp_err_t wifi_networks_clear(void);
+
+/**
+ * Record a successful connect: the network moves to the front with its
+ * access point and stats. Flash is written when the order or the access
+ * point changed, otherwise every WIFI_NETWORKS_FLUSH_INTERVAL connects
+ *
+ * @param index Network connected to
+ * @param channel Channel of the access point
+ * @param bssid BSSID of the access point (6 bytes)
+ * @param rssi Signal at connect time, dBm
+ * @param connect_ms Time from the connect request to the IP
+ */
+void wifi_networks_connected(int index, uint8_t channel, const uint8_t* bssid,
+                             int8_t rssi, uint32_t connect_ms);
+
+/**
+ * Count a failed attempt (RTC memory only, flushed with the next write)
+ *
+ * @param index Network tried
+ */
+void wifi_networks_failed(int index);
+
+/**
+ * Order in which to try the saved networks after a scan: the ones the scan
+ * saw, strongest first. Networks it did not see are left out
+ *
+ * @param rssi Per saved network (by index), the scan's RSSI or
+ *             WIFI_NETWORKS_NOT_SEEN
+ * @param order Indexes out (WIFI_NETWORKS_MAX entries)
+ * @return Number of indexes written
+ */
+int wifi_networks_rank(const int8_t* rssi, int* order);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,239 @@
+#include "wifi_scan.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_wifi.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "WIFI_SCAN";
+
+// Results, written by the event task, read by the web server
+static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+static wifi_scan_ap_t aps[WIFI_SCAN_MAX_APS];
+static int ap_count = 0;
+static int64_t scanned_at_us = 0;     // 0 before the first scan completed
+static int64_t started_at_us = 0;
+static bool scanning = false;
+static bool handler_registered = false;
+static bool held = false;             // No automatic rescans: the station is busy connecting
+static wifi_scan_done_cb_t done_callback = NULL;
+
+// Keep the strongest access point per SSID, strongest SSID first
+static int collect(const wifi_ap_record_t* records, int count, wifi_scan_ap_t* out) {
+    int n = 0;
+    for (int i = 0; i < count; i++) {
+        const char* ssid = (const char*)records[i].ssid;
+        if (ssid[0] == '\0') {
+            continue;  // Hidden network
+        }
+        int slot = 0;
+        while (slot < n && strcmp(out[slot].ssid, ssid) != 0) {
+            slot++;
+        }
+        if (slot < n && out[slot].rssi >= records[i].rssi) {
+            continue;
+        }
+        if (slot == n && n == WIFI_SCAN_MAX_APS) {
+            // Full: replace the weakest if this one is stronger
+            slot = 0;
+            for (int j = 1; j < n; j++) {
+                if (out[j].rssi < out[slot].rssi) {
+                    slot = j;
+                }
+            }
+            if (out[slot].rssi >= records[i].rssi) {
+                continue;
+            }
+        } else if (slot == n) {
+            n++;
+        }
+        strlcpy(out[slot].ssid, ssid, sizeof(out[slot].ssid));
+        memcpy(out[slot].bssid, records[i].bssid, sizeof(out[slot].bssid));
+        out[slot].rssi = records[i].rssi;
+        out[slot].channel = records[i].primary;
+        out[slot].authmode = (uint8_t)records[i].authmode;
+    }
+
+    // Insertion sort by RSSI: n is small
+    for (int i = 1; i < n; i++) {
+        wifi_scan_ap_t ap = out[i];
+        int j = i - 1;
+        while (j >= 0 && out[j].rssi < ap.rssi) {
+            out[j + 1] = out[j];
+            j--;
+        }
+        out[j + 1] = ap;
+    }
+    return n;
+}
+
+static void scan_done_handler(void* arg, esp_event_base_t event_base,
+                              int32_t event_id, void* event_data) {
+    // The driver's list must be fetched (and so freed) even when unused
+    uint16_t count = 0;
+    esp_wifi_scan_get_ap_num(&count);
+    wifi_ap_record_t* records = count > 0 ? calloc(count, sizeof(wifi_ap_record_t)) : NULL;
+    if (records == NULL) {
+        count = 0;
+    }
+    esp_wifi_scan_get_ap_records(&count, records);
+
+    static wifi_scan_ap_t found[WIFI_SCAN_MAX_APS];
+    int n = collect(records, count, found);
+    free(records);
+
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&lock);
+    memcpy(aps, found, n * sizeof(found[0]));
+    ap_count = n;
+    scanned_at_us = now;
+    scanning = false;
+    portEXIT_CRITICAL(&lock);
+
+    ESP_LOGI(TAG, "Scan done in %lld ms: %u access points, %d networks",
+             (now - started_at_us) / 1000, count, n);
+
+    if (done_callback != NULL) {
+        done_callback();
+    }
+}
+
+void wifi_scan_set_done_callback(wifi_scan_done_cb_t callback) {
+    done_callback = callback;
+}
+
+static esp_err_t start_scan(void) {
+    if (!handler_registered) {
+        esp_err_t err = esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_SCAN_DONE,
+                                                   &scan_done_handler, NULL);
+        if (err != ESP_OK) {
+            return err;
+        }
+        handler_registered = true;
+    }
+
+    portENTER_CRITICAL(&lock);
+    bool running = scanning;
+    scanning = true;
+    portEXIT_CRITICAL(&lock);
+    if (running) {
+        return ESP_OK;
+    }
+
+    // Short dwell and regular returns to the home channel keep the softAP
+    // (and a phone loading the portal) responsive during the scan
+    wifi_scan_config_t config = {
+        .show_hidden = false,
+        .scan_type = WIFI_SCAN_TYPE_ACTIVE,
+        .scan_time.active = {.min = 0, .max = WIFI_SCAN_DWELL_MS},
+        .home_chan_dwell_time = WIFI_SCAN_HOME_DWELL_MS,
+    };
+    started_at_us = esp_timer_get_time();
+    esp_err_t err = esp_wifi_scan_start(&config, false);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Scan not started: %s", esp_err_to_name(err));
+        portENTER_CRITICAL(&lock);
+        scanning = false;
+        portEXIT_CRITICAL(&lock);
+    }
+    return err;
+}
+
+esp_err_t wifi_scan_start(void) {
+    held = false;
+    return start_scan();
+}
+
+void wifi_scan_stop(void) {
+    held = true;
+    portENTER_CRITICAL(&lock);
+    bool running = scanning;
+    scanning = false;
+    portEXIT_CRITICAL(&lock);
+    if (running) {
+        esp_wifi_scan_stop();
+    }
+}
+
+// Append a JSON string, escaped
+static size_t json_string(char* buffer, size_t size, size_t len, const char* text) {
+    if (len < size) {
+        buffer[len] = '"';
+    }
+    len++;
+    for (const char* c = text; *c != '\0'; c++) {
+        char escaped[8];
+        if (*c == '"' || *c == '\\') {
+            snprintf(escaped, sizeof(escaped), "\\%c", *c);
+        } else if ((unsigned char)*c < 0x20) {
+            snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char)*c);
+        } else {
+            escaped[0] = *c;
+            escaped[1] = '\0';
+        }
+        for (const char* e = escaped; *e != '\0'; e++, len++) {
+            if (len < size) {
+                buffer[len] = *e;
+            }
+        }
+    }
+    if (len < size) {
+        buffer[len] = '"';
+    }
+    return len + 1;
+}
+
+size_t wifi_scan_json(char* buffer, size_t buffer_size, bool refresh) {
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&lock);
+    bool stale = scanned_at_us == 0 || now - scanned_at_us > (int64_t)WIFI_SCAN_MAX_AGE_MS * 1000;
+    portEXIT_CRITICAL(&lock);
+    if ((refresh || stale) && !held) {
+        start_scan();
+    }
+
+    // Static: only the web server's task calls this
+    static wifi_scan_ap_t copy[WIFI_SCAN_MAX_APS];
+    portENTER_CRITICAL(&lock);
+    int n = ap_count;
+    memcpy(copy, aps, n * sizeof(aps[0]));
+    int64_t scanned_at = scanned_at_us;
+    bool running = scanning;
+    portEXIT_CRITICAL(&lock);
+
+    size_t len = snprintf(buffer, buffer_size, "{\"scanning\":%s,\"age\":%lld,\"aps\":[",
+                          running ? "true" : "false",
+                          scanned_at == 0 ? -1LL : (long long)((now - scanned_at) / 1000000));
+    const size_t tail = 3;  // "]}" and the terminator
+    for (int i = 0; i < n; i++) {
+        size_t entry = len;
+        len += snprintf(buffer + len, buffer_size - len, "%s{\"s\":", i > 0 ? "," : "");
+        len = json_string(buffer, buffer_size, len, copy[i].ssid);
+        if (len < buffer_size) {
+            len += snprintf(buffer + len, buffer_size - len, ",\"r\":%d,\"a\":%u,\"c\":%u}",
+                            copy[i].rssi, copy[i].authmode, copy[i].channel);
+        }
+        if (len + tail > buffer_size) {
+            len = entry;  // Weakest networks dropped
+            break;
+        }
+    }
+    len += snprintf(buffer + len, buffer_size - len, "]}");
+    return len;
+}
+
+bool wifi_scan_find(const char* ssid, wifi_scan_ap_t* ap) {
+    bool found = false;
+    portENTER_CRITICAL(&lock);
+    for (int i = 0; i < ap_count && !found; i++) {
+        if (strcmp(aps[i].ssid, ssid) == 0) {
+            *ap = aps[i];
+            found = true;
+        }
+    }
+    portEXIT_CRITICAL(&lock);
+    return found;
+}
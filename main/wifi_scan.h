@@ -0,0 +1,82 @@
+#pragma once
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WIFI_SCAN_MAX_APS 20           // Networks kept, strongest first (one entry per SSID)
+#define WIFI_SCAN_MAX_AGE_MS 30000     // Results older than this are refreshed when polled
+#define WIFI_SCAN_DWELL_MS 120         // Active scan time per channel
+#define WIFI_SCAN_HOME_DWELL_MS 30     // Back on the softAP's channel between scanned channels
+#define WIFI_SCAN_JSON_SIZE 2048       // WIFI_SCAN_MAX_APS with 32-byte SSIDs; the weakest are dropped if escaping needs more
+
+/**
+ * A network seen by the last scan
+ */
+typedef struct {
+    char ssid[33];
+    uint8_t bssid[6];                  // Strongest access point of the SSID
+    int8_t rssi;                       // dBm
+    uint8_t channel;
+    uint8_t authmode;                  // wifi_auth_mode_t
+} wifi_scan_ap_t;
+
+/**
+ * Called from the event task when a scan's results are in
+ */
+typedef void (*wifi_scan_done_cb_t)(void);
+
+/**
+ * Start a background scan (the radio must be started, STA or APSTA mode)
+ * Returns at once; a scan already running is left alone. Results replace
+ * the cached ones when the scan completes
+ *
+ * @return ESP_OK if a scan is running
+ */
+esp_err_t wifi_scan_start(void);
+
+/**
+ * Be told when scans complete
+ *
+ * @param callback Called after the results are cached, NULL for none
+ */
+void wifi_scan_set_done_callback(wifi_scan_done_cb_t callback);
+
+/**
+ * Stop a running scan, and the automatic rescans of wifi_scan_json(), while
+ * the station connects (until the next wifi_scan_start()). Cached results
+ * stay available
+ */
+void wifi_scan_stop(void);
+
+/**
+ * Cached results as compact JSON, for the portal to poll:
+ * {"scanning":true,"age":12,"aps":[{"s":"ssid","r":-54,"a":3,"c":6},...]}
+ * age is in seconds, -1 before the first scan completed. Starts a new scan
+ * if the results are older than WIFI_SCAN_MAX_AGE_MS or refresh is set,
+ * unless wifi_scan_stop() holds scanning
+ *
+ * @param buffer Output buffer (WIFI_SCAN_JSON_SIZE bytes)
+ * @param buffer_size Its size
+ * @param refresh Scan again even if the results are recent
+ * @return Length written
+ */
+size_t wifi_scan_json(char* buffer, size_t buffer_size, bool refresh);
+
+/**
+ * Look up a network in the cached results
+ *
+ * @param ssid Network name
+ * @param ap Entry out
+ * @return true if the last scan saw it
+ */
+bool wifi_scan_find(const char* ssid, wifi_scan_ap_t* ap);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,239 +1,697 @@
 #include "wikiquote.h"
-#include "esp_http_client.h"
+#include "quote_provider.h"
+#include "hal_time.h"
+#include "hal_nvs.h"
+#include "rtc_budget.h"
+#include "esp_attr.h"
+#include "esp_rom_crc.h"
 #include "esp_log.h"
-#include "esp_tls.h"
-#include "esp_crt_bundle.h"
+#include "binlog.h"
 #include "cJSON.h"
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <time.h>
 
 static const char *TAG = "WIKIQUOTE";
 
+#ifndef QUOTABLE_API_URL  // Overridden by the host build to point at a local mock server
 #define QUOTABLE_API_URL "https://quotes-api-three.vercel.app/api/randomquote?language=it"
-#define MAX_HTTP_OUTPUT_BUFFER 4096   // 4KB buffer (quotes are much smaller)
-#define MAX_QUOTE_LENGTH 160          // Max allowed quote text length
+#endif
+#ifndef WIKIQUOTE_API_URL
+#define WIKIQUOTE_API_URL "https://en.wikiquote.org/w/api.php"
+#endif
+// Wikitext of the day's page, e.g. titles=Wikiquote:Quote_of_the_day/March_1,_2025
+// (utf8=1: non-ASCII as UTF-8 rather than \uXXXX escapes)
+#define WIKIQUOTE_QOTD_QUERY "?action=query&format=json&formatversion=2&utf8=1&prop=revisions" \
+                             "&rvprop=content&rvslots=main&titles=Wikiquote:Quote_of_the_day/"
+#define HTTP_TIMEOUT_MS 10000         // 10 second timeout
 #define MAX_FETCH_RETRIES 5           // Max retries when quote is too long
+#define MIN_VALID_TIME 1704067200     // 2024-01-01: older means no SNTP yet (no date for the QOTD)
 
-static char http_response_buffer[MAX_HTTP_OUTPUT_BUFFER];
-static int http_response_len = 0;
+static quote_t result;  // wikiquote_get_random_quote*() result, kept off the stack
 
-// HTTP event handler
-static esp_err_t http_event_handler(esp_http_client_event_t *evt) {
-    switch(evt->event_id) {
-        case HTTP_EVENT_ON_DATA:
-            if (http_response_len + evt->data_len < MAX_HTTP_OUTPUT_BUFFER - 1) {  // Leave room for null terminator
-                memcpy(http_response_buffer + http_response_len, evt->data, evt->data_len);
-                http_response_len += evt->data_len;
-            } else {
-                ESP_LOGW(TAG, "Response buffer full, truncating data");
-            }
-            break;
-        default:
-            break;
-    }
+esp_err_t wikiquote_init(void) {
+    BINLOG_I(TAG, "Wikiquote client initialized");
     return ESP_OK;
 }
 
-esp_err_t wikiquote_init(void) {
-    ESP_LOGI(TAG, "Wikiquote client initialized");
+// ---------------------------------------------------------------------------
+// Quote API (quotes-api-three.vercel.app)
+// ---------------------------------------------------------------------------
+
+static esp_err_t vercel_build_url(char* url, size_t size) {
+    snprintf(url, size, "%s", QUOTABLE_API_URL);
     return ESP_OK;
 }
 
-esp_err_t wikiquote_get_random_quote(const char* author_name, char* quote_buffer, size_t buffer_size) {
-    ESP_LOGI(TAG, "Fetching random quote from Quotable.io...");
-
-    // Reset response buffer
-    memset(http_response_buffer, 0, sizeof(http_response_buffer));
-    http_response_len = 0;
-
-    // Use Quotable.io API for random quotes (English)
-    // For specific authors, use: https://api.quotable.io/random?author=author-slug
-    const char *url = QUOTABLE_API_URL;
-
-    ESP_LOGI(TAG, "API URL: %s", url);
-
-    // Configure HTTP client with TLS certificate verification
-    esp_http_client_config_t config = {
-        .url = url,
-        .event_handler = http_event_handler,
-        .timeout_ms = 10000,         // 10 second timeout
-        .buffer_size = 2048,         // 2KB internal buffer (quotes are small)
-        .transport_type = HTTP_TRANSPORT_OVER_SSL,
-        .crt_bundle_attach = esp_crt_bundle_attach,  // Use certificate bundle for verification
+// Italian API JSON format: {"quote": "quote text", "author": "author name", "tags": "..."}
+static esp_err_t vercel_parse(const hal_http_response_t* response, quote_t* quote) {
+    size_t length = response->length;
+    cJSON *root = cJSON_Parse(response->buffer);
+    if (root == NULL) {
+        const char *error_ptr = cJSON_GetErrorPtr();
+        if (error_ptr != NULL) {
+            ESP_LOGE(TAG, "JSON parse error before: %.50s", error_ptr);
+        }
+        ESP_LOGE(TAG, "Failed to parse JSON (response length: %d)", (int)length);
+        return ESP_FAIL;
+    }
+
+    esp_err_t err = ESP_FAIL;
+    cJSON *quote_field = cJSON_GetObjectItem(root, "quote");
+    cJSON *author = cJSON_GetObjectItem(root, "author");
+
+    if (quote_field && cJSON_IsString(quote_field) && author && cJSON_IsString(author)) {
+        snprintf(quote->text, sizeof(quote->text), "%s", quote_field->valuestring);
+        snprintf(quote->author, sizeof(quote->author), "%s", author->valuestring);
+        BINLOG_I(TAG, "Quote (%d chars): %.100s...", (int)strlen(quote->text), quote->text);
+        BINLOG_I(TAG, "Author: %s", quote->author);
+        err = ESP_OK;
+    } else {
+        ESP_LOGE(TAG, "Failed to find 'quote' or 'author' field in JSON");
+    }
+
+    cJSON_Delete(root);
+    return err;
+}
+
+const quote_provider_t quote_provider_vercel = {
+    .name = "quote_api",
+    .build_url = vercel_build_url,
+    .parse = vercel_parse,
+    .max_attempts = MAX_FETCH_RETRIES,
+    .prefetch = true,
+    .dedup = true,             // Random source: repeats are common
+};
+
+// ---------------------------------------------------------------------------
+// Wikiquote quote of the day: {{Qotd|quote=...|author=...}} on the day's page
+// ---------------------------------------------------------------------------
+//
+// The MediaWiki API response is parsed as it streams in: a JSON layer finds
+// the page "content" string and unescapes it, a wikitext layer finds the
+// {{Qotd}} template and writes its quote/author parameters as plain text.
+// Nothing but the two output fields is kept, so the response size does not
+// matter. The result is stored with its date and validators; timer wakes on
+// the same day use it without a request, and after a power loss the NVS
+// copy is revalidated with a conditional GET (304, no body).
+
+#define QOTD_NVS_NAMESPACE "qotd"
+#define QOTD_NVS_KEY "record"
+#define QOTD_MAGIC 0x51445431        // "QDT1"
+#define QOTD_AUTHOR_SIZE 96
+#define QOTD_LABEL_SIZE 128          // Text of one [[link]] / {{template}} while it is open
+#define QOTD_NAME_SIZE 12            // Template parameter name
+
+/**
+ * Today's quote of the day, as last fetched
+ */
+typedef struct {
+    uint32_t magic;
+    uint32_t date;                           // Page date, YYYYMMDD local time
+    char etag[HAL_HTTP_ETAG_SIZE];
+    char last_modified[HAL_HTTP_DATE_SIZE];
+    char text[QUOTE_MAX_LENGTH + 1];         // Empty: the page had no usable quote
+    char author[QOTD_AUTHOR_SIZE];
+} qotd_record_t;
+
+typedef struct {
+    qotd_record_t record;
+    uint32_t crc;
+} qotd_rtc_t;
+RTC_BUDGET_CHECK(qotd_rtc_t, RTC_BUDGET_QOTD);
+
+// Copy confirmed during the current power cycle (survives deep sleep only)
+static RTC_NOINIT_ATTR qotd_rtc_t qotd_rtc;
+
+static qotd_record_t qotd;
+static bool qotd_loaded = false;
+static bool qotd_trusted = false;    // From RTC: no need to ask the server again today
+
+/**
+ * Plain-text writer for one template parameter
+ */
+typedef struct {
+    char* out;
+    size_t size;
+    size_t len;
+    bool space;          // Whitespace pending before the next character
+    uint8_t quotes;      // Apostrophes pending: one is text, two or more are emphasis
+    bool in_tag;         // Inside <...>
+    char entity[8];      // &...; being collected
+    uint8_t entity_len;
+} plain_t;
+
+typedef enum {
+    JSON_SCAN,
+    JSON_STRING,
+    JSON_STRING_ESCAPE,
+    JSON_AFTER_KEY,
+    JSON_AFTER_COLON,
+    JSON_CONTENT,
+    JSON_CONTENT_ESCAPE,
+    JSON_CONTENT_UNICODE,
+    JSON_DONE,
+} json_state_t;
+
+typedef enum {
+    WT_SEEK,             // Looking for "{{Qotd"
+    WT_TEMPLATE,         // Template name, before the first parameter
+    WT_NAME,             // Parameter name, up to '='
+    WT_VALUE,            // Parameter value
+    WT_DONE,
+} wikitext_state_t;
+
+/**
+ * Streaming extractor state (one response at a time)
+ */
+typedef struct {
+    json_state_t json;
+    uint8_t key_pos;         // Characters of "content" matched so far (0xFF: mismatch)
+    uint8_t hex_digits;
+    uint32_t code;           // \uXXXX being decoded
+    uint32_t high_surrogate;
+
+    wikitext_state_t wikitext;
+    uint8_t seek_pos;
+    char pending;            // '[', ']', '{' or '}' waiting for its pair
+    int depth;               // Link/template nesting inside the Qotd template
+    char open;               // '[' or '{' of the outermost open markup
+    bool label_pipe;         // Outermost markup had a '|'
+    char label[QOTD_LABEL_SIZE];
+    size_t label_len;
+    char name[QOTD_NAME_SIZE];
+    size_t name_len;
+    plain_t* field;          // Output of the current parameter (NULL: not needed)
+    plain_t quote;
+    plain_t author;
+} qotd_stream_t;
+
+static qotd_stream_t stream;
+
+static void plain_putc(plain_t* plain, char c) {
+    if (c == ' ' || c == '\n' || c == '\t' || c == '\r') {
+        plain->space = true;
+        return;
+    }
+    if (plain->space && plain->len > 0 && plain->len + 1 < plain->size) {
+        plain->out[plain->len++] = ' ';
+    }
+    plain->space = false;
+    if (plain->len + 1 < plain->size) {
+        plain->out[plain->len++] = c;
+    }
+}
+
+static void plain_flush_entity(plain_t* plain) {
+    static const struct {
+        const char* name;
+        char c;
+    } entities[] = {
+        {"&quot;", '"'}, {"&amp;", '&'}, {"&nbsp;", ' '}, {"&#39;", '\''}, {"&lt;", '<'}, {"&gt;", '>'},
     };
 
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    if (client == NULL) {
-        ESP_LOGE(TAG, "Failed to initialize HTTP client");
-        return ESP_FAIL;
+    plain->entity[plain->entity_len] = '\0';
+    for (size_t i = 0; i < sizeof(entities) / sizeof(entities[0]); i++) {
+        if (strcmp(plain->entity, entities[i].name) == 0) {
+            plain_putc(plain, entities[i].c);
+            plain->entity_len = 0;
+            return;
+        }
     }
+    for (uint8_t i = 0; i < plain->entity_len; i++) {
+        plain_putc(plain, plain->entity[i]);  // Unknown: keep as written
+    }
+    plain->entity_len = 0;
+}
 
-    // Perform HTTP GET request
-    esp_err_t err = esp_http_client_perform(client);
+// Wikitext character to plain text: emphasis quotes and HTML tags dropped,
+// common entities decoded, whitespace collapsed
+static void plain_feed(plain_t* plain, char c) {
+    if (plain->in_tag) {
+        if (c == '>') {
+            plain->in_tag = false;
+            plain->space = true;
+        }
+        return;
+    }
+    if (plain->entity_len > 0) {
+        if (plain->entity_len < sizeof(plain->entity) - 2 && c != ';' && c != ' ' && c != '&') {
+            plain->entity[plain->entity_len++] = c;
+            return;
+        }
+        if (c == ';') {
+            plain->entity[plain->entity_len++] = c;
+            plain_flush_entity(plain);
+            return;
+        }
+        plain_flush_entity(plain);
+    }
+    if (c == '\'') {
+        plain->quotes++;
+        return;
+    }
+    if (plain->quotes == 1) {
+        plain_putc(plain, '\'');
+    }
+    plain->quotes = 0;
 
-    if (err == ESP_OK) {
-        int status_code = esp_http_client_get_status_code(client);
-        int content_length = esp_http_client_get_content_length(client);
-        ESP_LOGI(TAG, "HTTP GET Status = %d, expected_length = %d, received = %d",
-                status_code, content_length, http_response_len);
-
-        if (status_code == 200 && http_response_len > 0) {
-            // Null-terminate response
-            http_response_buffer[http_response_len] = '\0';
-
-            // Debug: Print first 500 and last 100 chars of response
-            ESP_LOGI(TAG, "Response preview (first 500): %.500s", http_response_buffer);
-            if (http_response_len > 100) {
-                ESP_LOGI(TAG, "Response preview (last 100): %s",
-                         http_response_buffer + http_response_len - 100);
-            }
+    if (c == '<') {
+        plain->in_tag = true;
+    } else if (c == '&') {
+        plain->entity[0] = c;
+        plain->entity_len = 1;
+    } else {
+        plain_putc(plain, c);
+    }
+}
 
-            // Parse JSON
-            cJSON *root = cJSON_Parse(http_response_buffer);
-            if (root == NULL) {
-                const char *error_ptr = cJSON_GetErrorPtr();
-                if (error_ptr != NULL) {
-                    ESP_LOGE(TAG, "JSON parse error before: %.50s", error_ptr);
-                }
-                ESP_LOGE(TAG, "Failed to parse JSON (response length: %d)", http_response_len);
-                esp_http_client_cleanup(client);
-                return ESP_FAIL;
-            }
+static void plain_finish(plain_t* plain) {
+    if (plain->entity_len > 0) {
+        plain_flush_entity(plain);
+    }
+    if (plain->quotes == 1) {
+        plain_putc(plain, '\'');
+    }
+    plain->quotes = 0;
+    plain->out[plain->len] = '\0';
+}
 
-            // Italian API JSON format: {"quote": "quote text", "author": "author name", "tags": "..."}
-            cJSON *quote_field = cJSON_GetObjectItem(root, "quote");
-            cJSON *author = cJSON_GetObjectItem(root, "author");
+static void wikitext_end_param(qotd_stream_t* s) {
+    if (s->field != NULL) {
+        plain_finish(s->field);
+    }
+    s->field = NULL;
+    s->name_len = 0;
+}
 
-            if (quote_field && cJSON_IsString(quote_field)) {
-                const char *quote_text = quote_field->valuestring;
+static void wikitext_pair(qotd_stream_t* s, char c) {
+    if (c == '[' || c == '{') {
+        if (++s->depth == 1) {
+            s->open = c;
+            s->label_pipe = false;
+            s->label_len = 0;
+        }
+        return;
+    }
 
-                // Just return the quote text (author will be extracted separately)
-                snprintf(quote_buffer, buffer_size, "%s", quote_text);
+    if (s->depth == 0) {
+        if (c == '}') {
+            wikitext_end_param(s);  // End of the Qotd template
+            s->wikitext = WT_DONE;
+        }
+        return;
+    }
 
-                ESP_LOGI(TAG, "Quote extracted: %.100s...", quote_buffer);
-                cJSON_Delete(root);
-                esp_http_client_cleanup(client);
-                return ESP_OK;
-            } else {
-                ESP_LOGE(TAG, "Failed to find 'quote' field in JSON");
-            }
+    // [[target|label]] keeps the label, {{name|arg}} the last argument,
+    // {{name}} nothing
+    if (--s->depth == 0 && s->field != NULL && (s->open == '[' || s->label_pipe)) {
+        for (size_t i = 0; i < s->label_len; i++) {
+            plain_feed(s->field, s->label[i]);
+        }
+    }
+}
+
+static void wikitext_single(qotd_stream_t* s, char c) {
+    if (s->depth > 0) {
+        if (s->depth == 1 && c == '|') {
+            s->label_pipe = true;
+            s->label_len = 0;
+        } else if (s->label_len < sizeof(s->label)) {
+            s->label[s->label_len++] = c;
+        }
+        return;
+    }
+
+    if (c == '|') {
+        wikitext_end_param(s);
+        s->wikitext = WT_NAME;
+        return;
+    }
+
+    if (s->wikitext == WT_NAME) {
+        if (c == '=') {
+            s->name[s->name_len] = '\0';
+            s->field = strcmp(s->name, "quote") == 0 ? &s->quote :
+                       strcmp(s->name, "author") == 0 ? &s->author : NULL;
+            s->wikitext = WT_VALUE;
+        } else if (c != ' ' && c != '\n' && s->name_len < sizeof(s->name) - 1) {
+            s->name[s->name_len++] = c;
+        }
+    } else if (s->wikitext == WT_VALUE && s->field != NULL) {
+        plain_feed(s->field, c);
+    }
+}
+
+// One character of the page wikitext
+static void wikitext_feed(qotd_stream_t* s, char c) {
+    static const char marker[] = "{{Qotd";
 
-            cJSON_Delete(root);
-            err = ESP_FAIL;
+    if (s->wikitext == WT_DONE) {
+        return;
+    }
+    if (s->wikitext == WT_SEEK) {
+        if (c == marker[s->seek_pos]) {
+            if (++s->seek_pos == sizeof(marker) - 1) {
+                s->wikitext = WT_TEMPLATE;
+            }
         } else {
-            ESP_LOGE(TAG, "HTTP request failed with status code: %d", status_code);
-            err = ESP_FAIL;
+            s->seek_pos = c == '{' ? 1 : 0;
         }
+        return;
+    }
+
+    if (s->pending != '\0') {
+        char pending = s->pending;
+        s->pending = '\0';
+        if (c == pending) {
+            wikitext_pair(s, c);
+            return;
+        }
+        wikitext_single(s, pending);
+    }
+    if (c == '[' || c == ']' || c == '{' || c == '}') {
+        s->pending = c;
     } else {
-        ESP_LOGE(TAG, "HTTP GET request failed: %s", esp_err_to_name(err));
+        wikitext_single(s, c);
     }
+}
 
-    esp_http_client_cleanup(client);
+static void wikitext_feed_utf8(qotd_stream_t* s, uint32_t code) {
+    if (code < 0x80) {
+        wikitext_feed(s, (char)code);
+    } else if (code < 0x800) {
+        wikitext_feed(s, (char)(0xC0 | (code >> 6)));
+        wikitext_feed(s, (char)(0x80 | (code & 0x3F)));
+    } else if (code < 0x10000) {
+        wikitext_feed(s, (char)(0xE0 | (code >> 12)));
+        wikitext_feed(s, (char)(0x80 | ((code >> 6) & 0x3F)));
+        wikitext_feed(s, (char)(0x80 | (code & 0x3F)));
+    } else {
+        wikitext_feed(s, (char)(0xF0 | (code >> 18)));
+        wikitext_feed(s, (char)(0x80 | ((code >> 12) & 0x3F)));
+        wikitext_feed(s, (char)(0x80 | ((code >> 6) & 0x3F)));
+        wikitext_feed(s, (char)(0x80 | (code & 0x3F)));
+    }
+}
 
-    // Fallback quote if API fails
-    if (err != ESP_OK) {
-        snprintf(quote_buffer, buffer_size, "La semplicità è l'ultima sofisticazione.");
+// One character of the JSON response: find "content": "..." and unescape it
+static void json_feed(qotd_stream_t* s, char c) {
+    static const char key[] = "content";
+
+    switch (s->json) {
+        case JSON_SCAN:
+            if (c == '"') {
+                s->json = JSON_STRING;
+                s->key_pos = 0;
+            }
+            break;
+        case JSON_STRING:
+            if (c == '\\') {
+                s->json = JSON_STRING_ESCAPE;
+            } else if (c == '"') {
+                s->json = s->key_pos == sizeof(key) - 1 ? JSON_AFTER_KEY : JSON_SCAN;
+            } else if (s->key_pos < sizeof(key) - 1 && c == key[s->key_pos]) {
+                s->key_pos++;
+            } else {
+                s->key_pos = 0xFF;
+            }
+            break;
+        case JSON_STRING_ESCAPE:
+            s->key_pos = 0xFF;
+            s->json = JSON_STRING;
+            break;
+        case JSON_AFTER_KEY:
+            if (c == ':') {
+                s->json = JSON_AFTER_COLON;
+            } else if (c != ' ' && c != '\n') {
+                s->json = JSON_SCAN;  // "content" was a value, not a key
+                json_feed(s, c);
+            }
+            break;
+        case JSON_AFTER_COLON:
+            if (c == '"') {
+                s->json = JSON_CONTENT;
+            } else if (c != ' ' && c != '\n') {
+                s->json = JSON_SCAN;
+            }
+            break;
+        case JSON_CONTENT:
+            if (c == '\\') {
+                s->json = JSON_CONTENT_ESCAPE;
+            } else if (c == '"') {
+                s->json = JSON_DONE;
+            } else {
+                wikitext_feed(s, c);
+            }
+            break;
+        case JSON_CONTENT_ESCAPE:
+            s->json = JSON_CONTENT;
+            switch (c) {
+                case 'n': wikitext_feed(s, '\n'); break;
+                case 't': wikitext_feed(s, '\t'); break;
+                case 'r': case 'b': case 'f': wikitext_feed(s, ' '); break;
+                case 'u':
+                    s->json = JSON_CONTENT_UNICODE;
+                    s->hex_digits = 0;
+                    s->code = 0;
+                    break;
+                default: wikitext_feed(s, c); break;  // \" \\ \/
+            }
+            break;
+        case JSON_CONTENT_UNICODE: {
+            int digit = (c >= '0' && c <= '9') ? c - '0' :
+                        (c >= 'a' && c <= 'f') ? c - 'a' + 10 :
+                        (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+            if (digit < 0) {
+                s->json = JSON_CONTENT;
+                break;
+            }
+            s->code = (s->code << 4) | (uint32_t)digit;
+            if (++s->hex_digits < 4) {
+                break;
+            }
+            s->json = JSON_CONTENT;
+            if (s->code >= 0xD800 && s->code < 0xDC00) {
+                s->high_surrogate = s->code;  // Low half follows as another \\u
+            } else if (s->code >= 0xDC00 && s->code < 0xE000 && s->high_surrogate != 0) {
+                wikitext_feed_utf8(s, 0x10000 + ((s->high_surrogate - 0xD800) << 10) + (s->code - 0xDC00));
+                s->high_surrogate = 0;
+            } else {
+                wikitext_feed_utf8(s, s->code);
+            }
+            break;
+        }
+        case JSON_DONE:
+            break;
     }
+}
 
-    return err;
+static void qotd_on_data(const char* data, size_t length, void* ctx) {
+    qotd_stream_t* s = (qotd_stream_t*)ctx;
+    for (size_t i = 0; i < length && s->json != JSON_DONE; i++) {
+        json_feed(s, data[i]);
+    }
 }
 
-esp_err_t wikiquote_get_random_quote_with_author(char* quote_buffer, size_t quote_size,
-                                                  char* author_buffer, size_t author_size) {
-    ESP_LOGI(TAG, "Fetching random quote with author from Quotable.io...");
+static void qotd_stream_reset(qotd_stream_t* s, quote_t* quote) {
+    memset(s, 0, sizeof(*s));
+    s->quote = (plain_t){.out = quote->text, .size = sizeof(quote->text)};
+    s->author = (plain_t){.out = quote->author, .size = sizeof(quote->author)};
+    quote->text[0] = '\0';
+    quote->author[0] = '\0';
+}
+
+static uint32_t qotd_rtc_crc(void) {
+    return esp_rom_crc32_le(0, (const uint8_t*)&qotd_rtc.record, sizeof(qotd_rtc.record));
+}
+
+static void qotd_load(void) {
+    if (qotd_loaded) {
+        return;
+    }
+    qotd_loaded = true;
+
+    if (qotd_rtc.record.magic == QOTD_MAGIC && qotd_rtc.crc == qotd_rtc_crc()) {
+        qotd = qotd_rtc.record;
+        qotd_trusted = true;
+        return;
+    }
+
+    size_t size = sizeof(qotd);
+    if (hal_nvs_get_blob(QOTD_NVS_NAMESPACE, QOTD_NVS_KEY, &qotd, &size) != ESP_OK ||
+        size != sizeof(qotd) || qotd.magic != QOTD_MAGIC) {
+        memset(&qotd, 0, sizeof(qotd));
+    }
+}
 
-    const char *url = QUOTABLE_API_URL;
+// RTC always; NVS only when the content changed (at most once a day)
+static void qotd_save(bool content_changed) {
+    qotd.magic = QOTD_MAGIC;
+    qotd_rtc.record = qotd;
+    qotd_rtc.crc = qotd_rtc_crc();
+    qotd_trusted = true;
+
+    if (content_changed) {
+        esp_err_t err = hal_nvs_set_blob(QOTD_NVS_NAMESPACE, QOTD_NVS_KEY, &qotd, sizeof(qotd));
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to save quote of the day: %s", esp_err_to_name(err));
+        }
+    }
+}
+
+// YYYYMMDD of the local date, 0 until SNTP has set the clock
+static uint32_t qotd_today(struct tm* timeinfo) {
+    time_t now = hal_time_now();
+    if (now < MIN_VALID_TIME) {
+        return 0;
+    }
+    localtime_r(&now, timeinfo);
+    return (uint32_t)((timeinfo->tm_year + 1900) * 10000 + (timeinfo->tm_mon + 1) * 100 + timeinfo->tm_mday);
+}
+
+static esp_err_t wikiquote_stored(quote_t* quote) {
+    struct tm timeinfo;
+    qotd_load();
+    if (!qotd_trusted || qotd.date != qotd_today(&timeinfo) || qotd.text[0] == '\0') {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    snprintf(quote->text, sizeof(quote->text), "%s", qotd.text);
+    snprintf(quote->author, sizeof(quote->author), "%s", qotd.author);
+    return ESP_OK;
+}
 
-    esp_http_client_config_t config = {
-        .url = url,
-        .event_handler = http_event_handler,
-        .timeout_ms = 10000,
-        .buffer_size = 2048,
-        .transport_type = HTTP_TRANSPORT_OVER_SSL,
-        .crt_bundle_attach = esp_crt_bundle_attach,
+static esp_err_t wikiquote_build_url(char* url, size_t size) {
+    static const char* const months[] = {
+        "January", "February", "March", "April", "May", "June",
+        "July", "August", "September", "October", "November", "December",
     };
 
-    esp_err_t err = ESP_FAIL;
+    struct tm timeinfo;
+    uint32_t today = qotd_today(&timeinfo);
+    if (today == 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
 
-    for (int attempt = 1; attempt <= MAX_FETCH_RETRIES; attempt++) {
-        ESP_LOGI(TAG, "Attempt %d/%d", attempt, MAX_FETCH_RETRIES);
+    qotd_load();
+    if (qotd_trusted && qotd.date == today) {
+        return ESP_ERR_NOT_FOUND;  // Already fetched today; the page had no usable quote
+    }
 
-        // Reset response buffer for each attempt
-        memset(http_response_buffer, 0, sizeof(http_response_buffer));
-        http_response_len = 0;
+    snprintf(url, size, "%s%s%s_%d,_%d", WIKIQUOTE_API_URL, WIKIQUOTE_QOTD_QUERY,
+             months[timeinfo.tm_mon], timeinfo.tm_mday, timeinfo.tm_year + 1900);
+    return ESP_OK;
+}
 
-        esp_http_client_handle_t client = esp_http_client_init(&config);
-        if (client == NULL) {
-            ESP_LOGE(TAG, "Failed to initialize HTTP client");
-            break;
-        }
+static quote_t streamed;  // Extractor output until the response is accepted
 
-        err = esp_http_client_perform(client);
+static void wikiquote_prepare(hal_http_request_t* request) {
+    struct tm timeinfo;
+    qotd_stream_reset(&stream, &streamed);
+    request->response.on_data = qotd_on_data;
+    request->response.data_ctx = &stream;
 
-        if (err == ESP_OK) {
-            int status_code = esp_http_client_get_status_code(client);
-            ESP_LOGI(TAG, "HTTP GET Status = %d, received = %d", status_code, http_response_len);
+    // Validators only match the page they came from, i.e. today's
+    if (qotd.date == qotd_today(&timeinfo)) {
+        request->if_none_match = qotd.etag;
+        request->if_modified_since = qotd.last_modified;
+    }
+}
 
-            if (status_code == 200 && http_response_len > 0) {
-                // Null-terminate response
-                http_response_buffer[http_response_len] = '\0';
+static esp_err_t wikiquote_parse(const hal_http_response_t* response, quote_t* quote) {
+    struct tm timeinfo;
 
-                // Parse JSON
-                cJSON *root = cJSON_Parse(http_response_buffer);
-                if (root == NULL) {
-                    ESP_LOGE(TAG, "Failed to parse JSON");
-                    esp_http_client_cleanup(client);
-                    err = ESP_FAIL;
-                    break;
-                }
-
-                // Extract both quote and author
-                cJSON *quote_field = cJSON_GetObjectItem(root, "quote");
-                cJSON *author = cJSON_GetObjectItem(root, "author");
-
-                if (quote_field && cJSON_IsString(quote_field) && author && cJSON_IsString(author)) {
-                    size_t quote_len = strlen(quote_field->valuestring);
-
-                    if (quote_len > MAX_QUOTE_LENGTH) {
-                        ESP_LOGW(TAG, "Quote too long (%d chars > %d), retrying...",
-                                 (int)quote_len, MAX_QUOTE_LENGTH);
-                        cJSON_Delete(root);
-                        esp_http_client_cleanup(client);
-                        err = ESP_FAIL;
-                        continue;
-                    }
-
-                    snprintf(quote_buffer, quote_size, "%s", quote_field->valuestring);
-                    snprintf(author_buffer, author_size, "%s", author->valuestring);
-
-                    ESP_LOGI(TAG, "Quote (%d chars): %.100s...", (int)quote_len, quote_buffer);
-                    ESP_LOGI(TAG, "Author: %s", author_buffer);
-
-                    cJSON_Delete(root);
-                    esp_http_client_cleanup(client);
-                    return ESP_OK;
-                } else {
-                    ESP_LOGE(TAG, "Failed to find 'quote' or 'author' field in JSON");
-                }
-
-                cJSON_Delete(root);
-                err = ESP_FAIL;
-            } else {
-                ESP_LOGE(TAG, "HTTP request failed with status code: %d", status_code);
-                err = ESP_FAIL;
-            }
-        } else {
-            ESP_LOGE(TAG, "HTTP GET request failed: %s", esp_err_to_name(err));
+    if (response->status == 304) {
+        if (qotd.text[0] == '\0') {
+            return ESP_ERR_NOT_FOUND;
         }
+        BINLOG_I(TAG, "Quote of the day not modified (0 bytes)");
+        qotd_save(false);
+        snprintf(quote->text, sizeof(quote->text), "%s", qotd.text);
+        snprintf(quote->author, sizeof(quote->author), "%s", qotd.author);
+        return ESP_OK;
+    }
+
+    plain_finish(&stream.quote);
+    plain_finish(&stream.author);
+    if (stream.quote.len == 0 || stream.author.len == 0) {
+        ESP_LOGE(TAG, "Failed to find {{Qotd|quote=...|author=...}} in page");
+        return ESP_FAIL;
+    }
+
+    // Kept for the rest of the day even when too long, so it is not fetched again
+    qotd.date = qotd_today(&timeinfo);
+    snprintf(qotd.etag, sizeof(qotd.etag), "%s", response->etag);
+    snprintf(qotd.last_modified, sizeof(qotd.last_modified), "%s", response->last_modified);
+    if (stream.quote.len <= QUOTE_MAX_LENGTH) {
+        snprintf(qotd.text, sizeof(qotd.text), "%.*s", QUOTE_MAX_LENGTH, streamed.text);
+        snprintf(qotd.author, sizeof(qotd.author), "%.*s", (int)sizeof(qotd.author) - 1, streamed.author);
+    } else {
+        qotd.text[0] = '\0';
+    }
+    qotd_save(true);
 
-        esp_http_client_cleanup(client);
-        break;  // Only retry on quote-too-long; stop on HTTP/parse errors
+    *quote = streamed;
+    BINLOG_I(TAG, "Quote of the day (%d chars): %.100s...", (int)strlen(quote->text), quote->text);
+    BINLOG_I(TAG, "Author: %s", quote->author);
+    return ESP_OK;
+}
+
+const quote_provider_t quote_provider_wikiquote = {
+    .name = "wikiquote_qotd",
+    .build_url = wikiquote_build_url,
+    .prepare = wikiquote_prepare,
+    .parse = wikiquote_parse,
+    .stored = wikiquote_stored,
+    .max_attempts = 1,        // Same quote all day: a retry cannot shorten it
+    .prefetch = false,
+};
+
+// ---------------------------------------------------------------------------
+// Single-source fetch (quote API only), kept for callers that want it alone
+// ---------------------------------------------------------------------------
+
+static esp_err_t fetch_from_api(void) {
+    static const quote_provider_t* const providers[] = {&quote_provider_vercel};
+    const quote_schedule_t schedule = {
+        .mode = QUOTE_SCHEDULE_STAGGER,
+        .deadline_ms = HTTP_TIMEOUT_MS,
+    };
+
+    BINLOG_I(TAG, "API URL: %s", QUOTABLE_API_URL);
+    return quote_provider_run(providers, 1, NULL, 0, &schedule, &result);
+}
+
+esp_err_t wikiquote_get_random_quote(const char* author_name, char* quote_buffer, size_t buffer_size) {
+    BINLOG_I(TAG, "Fetching random quote from Quotable.io...");
+
+    esp_err_t err = fetch_from_api();
+    if (err == ESP_OK) {
+        snprintf(quote_buffer, buffer_size, "%s", result.text);
+        return ESP_OK;
+    }
+
+    // Fallback quote if API fails
+    snprintf(quote_buffer, buffer_size, "La semplicità è l'ultima sofisticazione.");
+    return err;
+}
+
+esp_err_t wikiquote_get_random_quote_with_author(char* quote_buffer, size_t quote_size,
+                                                  char* author_buffer, size_t author_size) {
+    BINLOG_I(TAG, "Fetching random quote with author from Quotable.io...");
+
+    esp_err_t err = fetch_from_api();
+    if (err == ESP_OK) {
+        snprintf(quote_buffer, quote_size, "%s", result.text);
+        snprintf(author_buffer, author_size, "%s", result.author);
+        return ESP_OK;
     }
 
     // Fallback if all attempts fail
     snprintf(quote_buffer, quote_size, "La semplicità è l'ultima sofisticazione.");
     snprintf(author_buffer, author_size, "Leonardo da Vinci");
 
-    return ESP_FAIL;
+    return err;
 }
@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+"""
+Decode binary log dumps (BINLOG lines from binlog_dump()) back into text.
+
+Format strings and tags are recorded on the device as flash addresses;
+they are resolved from the firmware ELF that produced the dump.
+
+Usage:
+    idf.py monitor | tee monitor.log
+    python tools/binlog_decode.py build/t5_epd_hello_world.elf monitor.log
+
+Requires pyelftools (installed in the ESP-IDF Python environment).
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+from elftools.elf.elffile import ELFFile
+
+SLOT_HEADER = struct.Struct("<IIIBBBB")  # fmt, tag, timestamp_ms, level, payload_len, truncated, reserved
+LEVELS = {1: "E", 2: "W", 3: "I", 4: "D", 5: "V"}
+CONVERSION_RE = re.compile(
+    r"%(?P<flags>[-+ #0]*)(?P<width>\*|\d+)?(?:\.(?P<precision>\*|\d*))?"
+    r"(?P<length>hh|h|ll|l|j|z|t|L)?(?P<conv>[diuxXocfFeEgGaAspn%])"
+)
+
+
+class StringTable:
+    """Resolves device addresses to NUL-terminated strings from ELF sections."""
+
+    def __init__(self, elf_path):
+        self.sections = []
+        with open(elf_path, "rb") as f:
+            elf = ELFFile(f)
+            for section in elf.iter_sections():
+                addr = section["sh_addr"]
+                if addr == 0 or section["sh_type"] == "SHT_NOBITS" or section["sh_size"] == 0:
+                    continue
+                self.sections.append((addr, addr + section["sh_size"], section.data()))
+
+    def lookup(self, addr):
+        for start, end, data in self.sections:
+            if start <= addr < end:
+                offset = addr - start
+                terminator = data.find(b"\0", offset)
+                if terminator < 0:
+                    terminator = len(data)
+                return data[offset:terminator].decode("utf-8", errors="replace")
+        return "<unknown 0x%08x>" % addr
+
+
+def unpack_args(fmt, payload):
+    """Mirror of pack_args() in main/binlog.c; returns a Python-format string and args."""
+    pos = 0
+    args = []
+    out = []
+    last = 0
+
+    def take(size, code):
+        nonlocal pos
+        if pos + size > len(payload):
+            raise IndexError
+        value = struct.unpack_from(code, payload, pos)[0]
+        pos += size
+        return value
+
+    for match in CONVERSION_RE.finditer(fmt):
+        out.append(fmt[last:match.start()].replace("%", "%%"))
+        last = match.end()
+        conv = match.group("conv")
+        if conv == "%":
+            out.append("%%")
+            continue
+        try:
+            width = match.group("width") or ""
+            if width == "*":
+                width = str(take(4, "<i"))
+            precision = match.group("precision")
+            if precision == "*":
+                precision = str(take(4, "<i"))
+            spec = "%" + match.group("flags") + width
+            if precision is not None:
+                spec += "." + precision
+            length = match.group("length") or ""
+
+            if conv in "diuxXoc":
+                wide = length in ("ll", "j")
+                signed = conv in "di"
+                code = ("<q" if signed else "<Q") if wide else ("<i" if signed else "<I")
+                value = take(8 if wide else 4, code)
+                if conv == "c":
+                    value = chr(value & 0xFF)
+                out.append(spec + ("s" if conv == "c" else conv))
+                args.append(value)
+            elif conv in "fFeEgGaA":
+                out.append(spec + (conv if conv not in "aA" else "g"))
+                args.append(take(4, "<f"))
+            elif conv == "s":
+                size = take(1, "<B")
+                if pos + size > len(payload):
+                    raise IndexError
+                args.append(payload[pos:pos + size].decode("utf-8", errors="replace"))
+                pos += size
+                out.append(spec + "s")
+            elif conv == "p":
+                out.append("0x%08x")
+                args.append(take(4, "<I"))
+            elif conv == "n":
+                continue
+        except IndexError:
+            # Arguments beyond the packed payload (truncated record)
+            out.append("<?>")
+            last = len(fmt)
+            break
+    out.append(fmt[last:].replace("%", "%%"))
+    return "".join(out), tuple(args)
+
+
+def decode_slot(strings, slot):
+    fmt_addr, tag_addr, timestamp, level, payload_len, truncated, _ = SLOT_HEADER.unpack_from(slot)
+    payload = slot[SLOT_HEADER.size:SLOT_HEADER.size + payload_len]
+    fmt = strings.lookup(fmt_addr)
+    tag = strings.lookup(tag_addr)
+    py_fmt, args = unpack_args(fmt, payload)
+    try:
+        text = py_fmt % args
+    except (TypeError, ValueError) as err:
+        text = "%s  <decode error: %s, args=%r>" % (fmt, err, args)
+    if truncated:
+        text += " [truncated]"
+    return "%s (%d) %s: %s" % (LEVELS.get(level, "?"), timestamp, tag, text)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("elf", help="Firmware ELF the dump was produced by")
+    parser.add_argument("log", nargs="?", help="Captured monitor output (default: stdin)")
+    args = parser.parse_args()
+
+    strings = StringTable(args.elf)
+    source = open(args.log, "r", errors="replace") if args.log else sys.stdin
+
+    for line in source:
+        if "BINLOG-BEGIN" in line:
+            print("---- " + line.split("BINLOG-BEGIN", 1)[1].strip() + " ----")
+            continue
+        match = re.search(r"BINLOG ([0-9a-f]+)", line)
+        if match:
+            print(decode_slot(strings, bytes.fromhex(match.group(1))))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,190 @@
+#!/usr/bin/env python3
+"""
+Binary patches for firmware updates: a device that runs OLD downloads a
+patch instead of NEW and rebuilds NEW in its inactive app slot (ota_delta.c).
+
+Most releases change a few functions; the fonts, the corpus and most of the
+code stay where they were or only move. Like bsdiff, the patch describes NEW
+as runs of OLD with byte differences (zero where nothing changed, a few
+address bytes where code moved) plus the bytes that are new, and deflates
+the result:
+
+    header   "QDP1", OLD size (u32), NEW size (u32), SHA-256 of OLD
+    zlib stream of records:
+             add length (u32), extra length (u32), seek (i32)
+             add bytes:   NEW[i] = OLD[pos + i] + byte (mod 256), pos advances
+             extra bytes: copied as they are
+             pos += seek
+
+The SHA-256 of OLD is the digest the build appends to an ESP-IDF image (the
+hash of everything before it), which the device reads back with
+esp_partition_get_sha256(). It goes in the manifest next to the full image:
+
+    {"version": "1.1.0", "url": "firmware.bin", "size": ..., "sha256": ...,
+     "patch": {"from": "<SHA-256 of OLD>", "url": "patch.bin", "size": ...}}
+
+Usage:
+    python tools/delta_patch.py diff old.bin new.bin patch.bin
+    python tools/delta_patch.py apply old.bin patch.bin new.bin
+
+diff prints the patch size against the full image, raw and gzipped, and the
+manifest entry. Standard library only.
+"""
+
+import argparse
+import gzip
+import hashlib
+import json
+import os
+import struct
+import sys
+import zlib
+
+MAGIC = b"QDP1"
+HEADER = struct.Struct("<4sII32s")
+RECORD = struct.Struct("<IIi")
+
+KEY = 6          # Bytes hashed to find where a stretch of NEW came from
+STEP = 4         # OLD is indexed at every STEP-th offset
+MIN_RUN = 24     # Shorter runs are cheaper as extra bytes
+GIVE_UP = 32     # A run ends once mismatches exceed matches by this much
+
+
+def base_digest(old):
+    """SHA-256 of an image without its appended digest."""
+    return hashlib.sha256(old[:-32]).digest()
+
+
+def extend(old, new, n, o):
+    """Length of the run NEW[n:]/OLD[o:] that matches more than it differs."""
+    limit = min(len(new) - n, len(old) - o)
+    score = best = length = i = 0
+    while i < limit:
+        if i + 64 <= limit and new[n + i:n + i + 64] == old[o + i:o + i + 64]:
+            score += 64
+            i += 64
+        else:
+            score += 1 if new[n + i] == old[o + i] else -1
+            i += 1
+        if score > best:
+            best, length = score, i
+        elif score < best - GIVE_UP:
+            break
+    return length
+
+
+def find_runs(old, new):
+    """(NEW offset, OLD offset, length) of the stretches of NEW taken from OLD."""
+    index = {}
+    for o in range(0, len(old) - KEY + 1, STEP):
+        index.setdefault(old[o:o + KEY], o)
+
+    runs = []
+    n = 0
+    shift = 0     # OLD - NEW offset of the last run: code after a change has not moved
+    while n + KEY <= len(new):
+        key = new[n:n + KEY]
+        o = n + shift
+        if not 0 <= o <= len(old) - KEY or old[o:o + KEY] != key:
+            o = index.get(key)
+            if o is None:
+                n += 1
+                continue
+        start = runs[-1][0] + runs[-1][2] if runs else 0
+        back = 0
+        while n - back > start and o - back > 0 and new[n - back - 1] == old[o - back - 1]:
+            back += 1
+        length = extend(old, new, n - back, o - back)
+        if length < MIN_RUN:
+            n += 1
+            continue
+        n, o = n - back, o - back
+        runs.append((n, o, length))
+        shift = o - n
+        n += length
+    return runs
+
+
+def make_patch(old, new):
+    """Patch that rebuilds NEW from OLD."""
+    runs = find_runs(old, new)
+    stream = bytearray()
+    # Bytes before the first run, then a seek to it
+    first_new, first_old = (runs[0][0], runs[0][1]) if runs else (len(new), 0)
+    stream += RECORD.pack(0, first_new, first_old)
+    stream += new[:first_new]
+    for i, (n, o, length) in enumerate(runs):
+        end = n + length
+        next_new, next_old = (runs[i + 1][0], runs[i + 1][1]) if i + 1 < len(runs) else (len(new), o + length)
+        stream += RECORD.pack(length, next_new - end, next_old - (o + length))
+        stream += bytes(map(lambda a, b: (a - b) & 0xFF, new[n:end], old[o:o + length]))
+        stream += new[end:next_new]
+    header = HEADER.pack(MAGIC, len(old), len(new), base_digest(old))
+    return header + zlib.compress(bytes(stream), 9), len(runs)
+
+
+def apply_patch(old, patch):
+    """NEW from OLD and a patch, as the device rebuilds it."""
+    magic, old_size, new_size, digest = HEADER.unpack_from(patch)
+    if magic != MAGIC or old_size != len(old) or digest != base_digest(old):
+        raise ValueError("patch is for another image")
+    stream = zlib.decompress(patch[HEADER.size:])
+    new = bytearray()
+    pos = at = 0
+    while len(new) < new_size:
+        add, extra, seek = RECORD.unpack_from(stream, at)
+        at += RECORD.size
+        new += bytes(map(lambda a, b: (a + b) & 0xFF, stream[at:at + add], old[pos:pos + add]))
+        at += add
+        pos += add
+        new += stream[at:at + extra]
+        at += extra
+        pos += seek
+    if len(new) != new_size or at != len(stream):
+        raise ValueError("patch does not match its header")
+    return bytes(new)
+
+
+def read(path):
+    with open(path, "rb") as f:
+        return f.read()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Firmware patches for ota_delta.c")
+    sub = parser.add_subparsers(dest="command", required=True)
+    diff = sub.add_parser("diff", help="Make a patch from OLD to NEW")
+    diff.add_argument("old")
+    diff.add_argument("new")
+    diff.add_argument("patch")
+    apply = sub.add_parser("apply", help="Rebuild NEW from OLD and a patch")
+    apply.add_argument("old")
+    apply.add_argument("patch")
+    apply.add_argument("new")
+    args = parser.parse_args()
+
+    if args.command == "apply":
+        new = apply_patch(read(args.old), read(args.patch))
+        with open(args.new, "wb") as f:
+            f.write(new)
+        print(f"{args.new}: {len(new)} bytes, SHA-256 {hashlib.sha256(new).hexdigest()}")
+        return 0
+
+    old, new = read(args.old), read(args.new)
+    patch, runs = make_patch(old, new)
+    if apply_patch(old, patch) != new:
+        print("error: patch does not rebuild the image", file=sys.stderr)
+        return 1
+    with open(args.patch, "wb") as f:
+        f.write(patch)
+    full_gz = len(gzip.compress(new, 9))
+    print(f"Image: {len(new):9} bytes, {full_gz} gzipped")
+    print(f"Patch: {len(patch):9} bytes ({100 * len(patch) / len(new):.1f}% of the image, "
+          f"{100 * len(patch) / full_gz:.1f}% gzipped), {runs} runs from the old image")
+    entry = {"from": base_digest(old).hex(), "url": os.path.basename(args.patch), "size": len(patch)}
+    print(json.dumps({"patch": entry}))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,148 @@
+#!/usr/bin/env python3
+"""
+Generate the provisioning portal's asset table (portal_assets.c) from the
+files in main/portal/.
+
+Every file is served at /<name>, index.html also at /. HTML (with its inline
+<style> and <script>), CSS and JS are minified; every asset is gzipped unless
+that does not make it smaller (e.g. PNG). Each asset gets an ETag from the
+hash of the bytes served, so a browser that already has it gets 304.
+
+Run by main/CMakeLists.txt at build time; standalone:
+    python tools/gen_portal_assets.py --dir main/portal --out portal_assets.c
+
+Prints the size of each asset raw, minified and gzipped. Standard library only.
+"""
+
+import argparse
+import gzip
+import hashlib
+import os
+import re
+import sys
+
+TYPES = {
+    ".html": "text/html; charset=utf-8",
+    ".css": "text/css",
+    ".js": "application/javascript",
+    ".json": "application/json",
+    ".svg": "image/svg+xml",
+    ".ico": "image/x-icon",
+    ".png": "image/png",
+}
+
+
+def minify_css(text):
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    text = re.sub(r"\s+", " ", text)
+    text = re.sub(r"\s*([{}:;,>])\s*", r"\1", text)
+    return text.replace(";}", "}").strip()
+
+
+def minify_js(text):
+    # Conservative: comments and indentation only. Line breaks stay, so
+    # automatic semicolon insertion sees the same code
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+    lines = (line.strip() for line in text.splitlines())
+    return "\n".join(line for line in lines if line and not line.startswith("//"))
+
+
+def minify_html(text):
+    parts = []
+    pos = 0
+    for match in re.finditer(r"(<(style|script)[^>]*>)(.*?)(</\2>)", text, flags=re.S | re.I):
+        parts.append(minify_markup(text[pos:match.start()]))
+        body = minify_css(match.group(3)) if match.group(2).lower() == "style" else minify_js(match.group(3))
+        parts.append(match.group(1) + body + match.group(4))
+        pos = match.end()
+    parts.append(minify_markup(text[pos:]))
+    return "".join(parts)
+
+
+def minify_markup(text):
+    text = re.sub(r"<!--(?!\[).*?-->", "", text, flags=re.S)
+    text = re.sub(r"\s+", " ", text)
+    return re.sub(r">\s+<", "><", text).strip()
+
+
+MINIFIERS = {".html": minify_html, ".css": minify_css, ".js": minify_js}
+
+
+def c_bytes(data, indent="    "):
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append(indent + ", ".join(f"0x{b:02x}" for b in data[i:i + 16]) + ",")
+    return "\n".join(lines)
+
+
+def load_assets(directory):
+    assets = []
+    for name in sorted(os.listdir(directory)):
+        path = os.path.join(directory, name)
+        ext = os.path.splitext(name)[1].lower()
+        if not os.path.isfile(path) or name.startswith("."):
+            continue
+        if ext not in TYPES:
+            sys.exit(f"{path}: unknown asset type (known: {' '.join(TYPES)})")
+        with open(path, "rb") as f:
+            raw = f.read()
+        body = MINIFIERS[ext](raw.decode("utf-8")).encode("utf-8") if ext in MINIFIERS else raw
+        packed = gzip.compress(body, 9, mtime=0)  # mtime 0: same input, same bytes, same ETag
+        gzipped = len(packed) < len(body)
+        data = packed if gzipped else body
+        etag = hashlib.sha256(data).hexdigest()[:16]
+        uris = [f"/{name}"] + (["/"] if name == "index.html" else [])
+        assets.append((name, uris, TYPES[ext], data, gzipped, etag, len(raw), len(body)))
+    return assets
+
+
+def generate(assets):
+    out = [
+        "// Generated by tools/gen_portal_assets.py from main/portal/: do not edit",
+        "",
+        '#include "portal_assets.h"',
+        "",
+    ]
+    for index, (name, _, _, data, _, _, _, _) in enumerate(assets):
+        out += [f"// {name}", f"static const uint8_t asset_{index}[] = {{", c_bytes(data), "};"]
+    out += ["", "const portal_asset_t portal_assets[] = {"]
+    count = 0
+    for index, (_, uris, content_type, _, gzipped, etag, _, _) in enumerate(assets):
+        for uri in uris:
+            out.append(f'    {{"{uri}", "{content_type}", asset_{index}, sizeof(asset_{index}), '
+                       f'"\\"{etag}\\"", {"true" if gzipped else "false"}}},')
+            count += 1
+    out += ["};", f"const size_t portal_asset_count = {count};", ""]
+    return "\n".join(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--dir", required=True, help="main/portal")
+    parser.add_argument("--out", required=True, help="C file to write")
+    args = parser.parse_args()
+
+    assets = load_assets(args.dir)
+    if not any(name == "index.html" for name, *_ in assets):
+        sys.exit(f"{args.dir}: index.html missing")
+    source = generate(assets)
+
+    # Only rewrite on change, so unchanged assets do not trigger a rebuild
+    try:
+        with open(args.out) as f:
+            unchanged = f.read() == source
+    except OSError:
+        unchanged = False
+    if not unchanged:
+        with open(args.out, "w") as f:
+            f.write(source)
+
+    raw_total = sum(asset[6] for asset in assets)
+    total = sum(len(asset[3]) for asset in assets)
+    for name, _, _, data, gzipped, _, raw, minified in assets:
+        print(f"  {name:<16} {raw:6} B raw, {minified:6} minified, {len(data):6} {'gzipped' if gzipped else 'stored'}")
+    print(f"Portal assets: {len(assets)} files, {raw_total} -> {total} bytes of flash")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,169 @@
+#!/usr/bin/env python3
+"""
+Generate the firmware's TLS trust store (trust_store.c) from
+main/certs/trust_store.txt and the PEM files next to it.
+
+Modes (CONFIG_QUOTE_TLS_TRUST_*):
+    bundle  hosts and cipher suites only, roots come from the ESP-IDF bundle
+    ca      pinned root certificates (DER) per host
+    key     pinned root public keys (SubjectPublicKeyInfo DER + SHA-256) per host
+
+Run by main/CMakeLists.txt at build time; standalone:
+    python tools/gen_trust_store.py --config main/certs/trust_store.txt --mode ca --out trust_store.c
+
+Prints the flash used by the generated tables. Standard library only.
+"""
+
+import argparse
+import base64
+import hashlib
+import os
+import re
+import sys
+
+SUITES = {"ecdsa-first": "TRUST_SUITES_ECDSA_FIRST", "ecdsa": "TRUST_SUITES_ECDSA"}
+PEM_RE = re.compile(r"-----BEGIN CERTIFICATE-----(.+?)-----END CERTIFICATE-----", re.S)
+OID_CN = bytes.fromhex("550403")
+
+
+def der_read(data, offset):
+    """Return (tag, content start, content end) of the DER element at offset."""
+    tag = data[offset]
+    length = data[offset + 1]
+    start = offset + 2
+    if length & 0x80:
+        count = length & 0x7F
+        length = int.from_bytes(data[start:start + count], "big")
+        start += count
+    return tag, start, start + length
+
+
+def der_children(data, start, end):
+    """Yield (tag, element start, content start, content end) of a constructed element."""
+    offset = start
+    while offset < end:
+        tag, content_start, content_end = der_read(data, offset)
+        yield tag, offset, content_start, content_end
+        offset = content_end
+
+
+def parse_certificate(der):
+    """Return (common name, SubjectPublicKeyInfo DER) of an X.509 certificate."""
+    _, cert_start, cert_end = der_read(der, 0)
+    _, tbs_start, tbs_end = der_read(der, cert_start)
+    fields = list(der_children(der, tbs_start, tbs_end))
+    if fields[0][0] == 0xA0:  # Explicit version
+        fields = fields[1:]
+    # serialNumber, signature, issuer, validity, subject, subjectPublicKeyInfo
+    _, _, subject_start, subject_end = fields[4]
+    _, spki_offset, _, spki_end = fields[5]
+
+    name = "?"
+    for _, _, set_start, set_end in der_children(der, subject_start, subject_end):
+        for _, _, atv_start, atv_end in der_children(der, set_start, set_end):
+            parts = list(der_children(der, atv_start, atv_end))
+            if der[parts[0][2]:parts[0][3]] == OID_CN:
+                name = der[parts[1][2]:parts[1][3]].decode("utf-8", "replace")
+    return name, der[spki_offset:spki_end]
+
+
+def load_pem(path):
+    with open(path) as f:
+        blocks = PEM_RE.findall(f.read())
+    if len(blocks) != 1:
+        sys.exit(f"{path}: expected exactly one certificate, found {len(blocks)}")
+    return base64.b64decode("".join(blocks[0].split()))
+
+
+def parse_config(path):
+    hosts = []
+    with open(path) as f:
+        for number, line in enumerate(f, 1):
+            line = line.split("#", 1)[0].split()
+            if not line:
+                continue
+            if len(line) < 3 or line[1] not in SUITES:
+                sys.exit(f"{path}:{number}: expected '<host> <{'|'.join(SUITES)}> <pem>...'")
+            hosts.append((line[0], line[1], line[2:]))
+    return hosts
+
+
+def c_bytes(data, indent="    "):
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append(indent + ", ".join(f"0x{b:02x}" for b in data[i:i + 16]) + ",")
+    return "\n".join(lines)
+
+
+def generate(hosts, certs_dir, mode):
+    anchors = {}  # PEM file -> (index, name, der, spki)
+    for _, _, files in hosts:
+        for pem in files:
+            if pem not in anchors:
+                der = load_pem(os.path.join(certs_dir, pem))
+                name, spki = parse_certificate(der)
+                anchors[pem] = (len(anchors), name, der, spki)
+
+    out = [
+        "// Generated by tools/gen_trust_store.py from main/certs/trust_store.txt: do not edit",
+        f"// Mode: {mode}",
+        "",
+        '#include "trust_store.h"',
+        "",
+    ]
+    flash = 0
+    if mode != "bundle":
+        for pem, (index, name, der, spki) in anchors.items():
+            if mode == "ca":
+                out += [f"static const uint8_t anchor_{index}_der[] = {{", c_bytes(der), "};"]
+                flash += len(der)
+            else:
+                out += [f"static const uint8_t anchor_{index}_key[] = {{", c_bytes(spki), "};"]
+                flash += len(spki) + 32
+            out += [f"static const trust_anchor_t anchor_{index} = {{", f'    .name = "{name}",']
+            if mode == "ca":
+                out += [f"    .der = anchor_{index}_der,", f"    .der_len = sizeof(anchor_{index}_der),"]
+            else:
+                digest = hashlib.sha256(spki).digest()
+                out += [f"    .key = anchor_{index}_key,", f"    .key_len = sizeof(anchor_{index}_key),",
+                        "    .key_sha256 = {", c_bytes(digest, "        "), "    },"]
+            out += ["};", ""]
+
+    for h, (host, _, files) in enumerate(hosts):
+        refs = ", ".join(f"&anchor_{anchors[pem][0]}" for pem in files) if mode != "bundle" else "NULL"
+        out.append(f"static const trust_anchor_t* const host_{h}_anchors[] = {{{refs}}};")
+        flash += len(host) + 1 + 4 * len(files) + 12
+    out += ["", "const trust_host_t trust_store_hosts[] = {"]
+    for h, (host, suites, files) in enumerate(hosts):
+        count = len(files) if mode != "bundle" else 0
+        out.append(f'    {{"{host}", host_{h}_anchors, {count}, {SUITES[suites]}}},')
+    out += ["};", f"const size_t trust_store_host_count = {len(hosts)};", ""]
+    return "\n".join(out), anchors, flash
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--config", required=True, help="trust_store.txt")
+    parser.add_argument("--mode", choices=("bundle", "ca", "key"), required=True)
+    parser.add_argument("--out", required=True, help="C file to write")
+    args = parser.parse_args()
+
+    hosts = parse_config(args.config)
+    source, anchors, flash = generate(hosts, os.path.dirname(os.path.abspath(args.config)), args.mode)
+
+    # Only rewrite on change, so an unchanged store does not trigger a rebuild
+    try:
+        with open(args.out) as f:
+            unchanged = f.read() == source
+    except OSError:
+        unchanged = False
+    if not unchanged:
+        with open(args.out, "w") as f:
+            f.write(source)
+
+    names = ", ".join(name for _, name, _, _ in anchors.values())
+    print(f"Trust store ({args.mode}): {len(hosts)} hosts, {len(anchors)} roots ({names}), ~{flash} bytes of flash")
+
+
+if __name__ == "__main__":
+    main()
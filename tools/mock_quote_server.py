@@ -0,0 +1,499 @@
+#!/usr/bin/env python3
+"""
+Local stand-in for the quote API, for the host simulator and fetch benchmark.
+
+Serves the same JSON shape as quotes-api-three.vercel.app:
+    {"quote": "...", "author": "...", "tags": "..."}
+Quotes come in a fixed order so runs are reproducible: the curated list
+first, then numbered test quotes, so nothing repeats unless the "repeat"
+scenario asks for it.
+
+Also answers the MediaWiki API query of the Wikiquote quote-of-the-day
+provider (/w/api.php?...&titles=Wikiquote:Quote_of_the_day/<date>) with a
+{{Qotd|quote=...|author=...}} page picked by the day of the month. Pages
+carry an ETag and Last-Modified; a conditional request (If-None-Match or
+If-Modified-Since) for an unchanged page gets 304 with no body. Without
+utf8=1 in the query, non-ASCII characters are sent as \\uXXXX escapes, as
+the real API does.
+
+Firmware updates: /ota/manifest.json describes the image at
+/ota/firmware.bin, {"version": ..., "url": ..., "size": ..., "sha256": ...}.
+The image is --ota-image (a real build, e.g. build/t5_epd_hello_world.bin)
+or a generated stand-in of --ota-size bytes with the header, app
+descriptor (--ota-version) and appended SHA-256 the firmware checks.
+With --ota-base (the image the device runs, QUOTE_SIM_IMAGE for the
+simulator) the manifest also offers /ota/patch.bin, made against it with
+tools/delta_patch.py; a generated image is then derived from the base like
+a release that changed a few functions.
+
+HTTP listens on --port; HTTPS on --tls-port with a server certificate
+signed by a throwaway test CA (generated with openssl into --cert-dir on
+first start). Point the host build at it with QUOTE_SIM_CA=<cert-dir>/ca.pem.
+
+Behaviour is switched at run time through a control endpoint on either
+listener, so the device-side URL never changes:
+    GET /_scenario?name=chunked&chunk=16&delay_ms=20
+    GET /_scenario?name=error&target=qotd (quote-of-the-day endpoint only)
+    GET /_scenario                      (show the active scenario)
+
+target is "quote" (the default), "qotd", "ota" (manifest and image) or
+"all"; the other endpoints keep answering normally.
+
+Injected waits are announced in an X-Mock-Delay-Ms response header, so the
+host HTTP backend can add them to its modeled (virtual) time.
+
+Scenarios (parameters in brackets):
+    ok              normal response
+    latency         wait before responding [delay_ms=400]
+    chunked         Transfer-Encoding: chunked [chunk=32, delay_ms=10]
+    oversize        quote longer than the firmware's 160-char limit
+    oversize_body   valid JSON larger than the firmware's 4 KB buffer [size=8192]
+    malformed       truncated JSON body
+    missing_fields  valid JSON without "author"
+    error           HTTP error [status=500]
+    flaky           every other request fails with 503
+    slow_reuse      oversize on a connection's first request, so the firmware
+                    asks again; later ones on it (kept-alive) wait [delay_ms=12000]
+    repeat          the previous quote again, every other request
+    corrupt         firmware image and patch with a flipped byte
+    maintenance     manifest asks for a maintenance window [minutes=10]
+
+Usage:
+    python3 tools/mock_quote_server.py [--port 8080] [--tls-port 8443]
+    build-host/quote_sim --fresh --wakes 5
+"""
+
+import argparse
+import hashlib
+import itertools
+import json
+import os
+import random
+import ssl
+import struct
+import subprocess
+import sys
+import threading
+import time
+from datetime import datetime, timezone
+from email.utils import format_datetime
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+from urllib.parse import parse_qs, urlparse
+
+from delta_patch import base_digest, make_patch
+
+QUOTES = [
+    ("La semplicità è l'ultima sofisticazione.", "Leonardo da Vinci", "arte"),
+    ("Fatti non foste a viver come bruti, ma per seguir virtute e canoscenza.",
+     "Dante Alighieri", "conoscenza"),
+    ("Eppur si muove.", "Galileo Galilei", "scienza"),
+    ("Chi va piano va sano e va lontano.", "Proverbio", "saggezza"),
+    ("Il dolce far niente.", "Anonimo", "vita"),
+    ("Nel mezzo del cammin di nostra vita mi ritrovai per una selva oscura, "
+     "ché la diritta via era smarrita.", "Dante Alighieri", "poesia"),
+    ("Ogni cosa che puoi immaginare, la natura l'ha già creata.", "Albert Einstein", "natura"),
+    ("Un libro è un giardino che si porta in tasca.", "Proverbio arabo", "lettura"),
+]
+
+# Quote-of-the-day pages, with the markup the firmware has to strip
+QOTD = [
+    "{{Qotd\n|quote=''The only true wisdom is in knowing you know nothing.''\n"
+    "|author=[[Socrates]]\n}}",
+    "{{Qotd\n|quote=Imagination is more important than [[knowledge]].<br />\n"
+    "|author=[[Albert Einstein|Einstein]]\n}}",
+    "{{Qotd\n|quote=&quot;Simplicity is the ultimate sophistication.&quot;\n"
+    "|author=[[Leonardo da Vinci]] {{small|(attributed)}}\n}}",
+    "{{Qotd\n|quote='''Be yourself'''; everyone else is already taken.\n"
+    "|author=[[Oscar Wilde]]\n}}",
+    "{{Qotd\n|quote=L’amor che move il sole e l’altre stelle.\n"
+    "|author=[[Dante Alighieri]], ''[[Divina Commedia|Paradiso]]''\n}}",
+]
+TARGETS = ("quote", "qotd", "ota", "all")
+JSON_TYPE = "application/json; charset=utf-8"
+
+# Image layout the firmware checks (esp_image_header_t, first segment
+# header, esp_app_desc_t), see ota_update.c
+IMAGE_MAGIC = 0xE9
+APP_DESC_MAGIC = 0xABCD5432
+PROJECT_NAME = "t5_epd_hello_world"
+BASE_VERSION = "1.0.0"   # Host build's FIRMWARE_VERSION
+
+SCENARIOS = {
+    "ok": {},
+    "latency": {"delay_ms": 400},
+    "chunked": {"chunk": 32, "delay_ms": 10},
+    "oversize": {},
+    "oversize_body": {"size": 8192},
+    "malformed": {},
+    "missing_fields": {},
+    "error": {"status": 500},
+    "flaky": {},
+    "slow_reuse": {"delay_ms": 12000},
+    "repeat": {},
+    "corrupt": {},
+    "maintenance": {"minutes": 10},
+}
+
+
+def build_image(version, size, project=PROJECT_NAME):
+    """Stand-in firmware image: valid header and app descriptor, random
+    (incompressible, reproducible) segment data, SHA-256 appended."""
+    header = struct.pack("<BBBBI", IMAGE_MAGIC, 1, 2, 0x2F, 0x40080000) + bytes(15) + b"\x01"
+    desc = struct.pack("<II8x32s32s16s16s32s32s80x", APP_DESC_MAGIC, 0, version.encode(),
+                       project.encode(), b"00:00:00", b"Jan  1 2025", b"v5.1", bytes(32))
+    data_len = size - len(header) - 8 - len(desc) - 32
+    if data_len < 0:
+        raise ValueError(f"image size {size} too small")
+    segment = struct.pack("<II", 0x3F400020, len(desc) + data_len)
+    body = header + segment + desc + random.Random(version).randbytes(data_len)
+    return body + hashlib.sha256(body).digest()
+
+
+def derive_image(base, version):
+    """Next release of a generated image: three functions rewritten, one
+    added (moving everything after it) with the calls into the moved code
+    updated, and the new version in the app descriptor."""
+    rng = random.Random(version)
+    body = bytearray(base[:-32])
+    body[48:80] = version.encode().ljust(32, b"\0")
+    for at in (0.2, 0.55, 0.8):
+        start = int(len(body) * at)
+        body[start:start + 1500] = rng.randbytes(1500)
+    added = int(len(body) * 0.35)
+    body[added:added] = rng.randbytes(2048)
+    for call in range(added + 4096, len(body) - 4, 8192):
+        body[call:call + 4] = rng.randbytes(4)
+    segment_len, = struct.unpack_from("<I", body, 28)
+    struct.pack_into("<I", body, 28, segment_len + 2048)
+    return bytes(body) + hashlib.sha256(body).digest()
+
+
+def image_version(image):
+    """Version string from an image's app descriptor."""
+    magic, = struct.unpack_from("<I", image, 32)
+    if image[0] != IMAGE_MAGIC or magic != APP_DESC_MAGIC:
+        raise ValueError("not an ESP-IDF app image")
+    return image[48:80].split(b"\0", 1)[0].decode()
+
+
+def quote_stream():
+    """Curated quotes, then numbered ones: a pool that never repeats."""
+    yield from QUOTES
+    for n in itertools.count(1):
+        yield (f"Citazione di prova numero {n}.", "Autore di prova", "test")
+
+
+class ScenarioState:
+    def __init__(self, name="ok"):
+        self.lock = threading.Lock()
+        self.rotation = quote_stream()
+        self.last_quote = QUOTES[0]
+        self.requests = 0
+        self.set(name, {})
+
+    def set(self, name, params):
+        if name not in SCENARIOS:
+            raise ValueError(f"unknown scenario '{name}'")
+        target = params.pop("target", "quote")
+        if target not in TARGETS:
+            raise ValueError(f"unknown target '{target}'")
+        with self.lock:
+            self.name = name
+            self.target = target
+            self.params = dict(SCENARIOS[name])
+            for key, value in params.items():
+                if key in self.params:
+                    self.params[key] = int(value)
+            self.requests = 0
+
+    def next_request(self, endpoint):
+        """Scenario for one request; endpoints outside the target get "ok"."""
+        with self.lock:
+            self.requests += 1
+            quote = None
+            if endpoint == "quote":
+                repeat = (self.name == "repeat" and self.target in ("quote", "all")
+                          and self.requests % 2 == 0)
+                quote = self.last_quote if repeat else next(self.rotation)
+                self.last_quote = quote
+            if self.target not in (endpoint, "all"):
+                return "ok", {}, self.requests, quote
+            return self.name, dict(self.params), self.requests, quote
+
+    def describe(self):
+        with self.lock:
+            return {"name": self.name, "target": self.target, "params": self.params,
+                    "requests": self.requests}
+
+
+class QuoteHandler(BaseHTTPRequestHandler):
+    server_version = "MockQuote/1.1"
+    protocol_version = "HTTP/1.1"
+    state = None  # ScenarioState, shared by both listeners
+    quiet = False
+    image = b""   # Firmware served at /ota/firmware.bin
+    patch = b""   # The same from --ota-base, at /ota/patch.bin
+    patch_from = ""
+    served = 0    # Requests on this connection, this one included
+
+    def do_GET(self):
+        self.served += 1
+        try:
+            self.dispatch()
+        except (BrokenPipeError, ConnectionResetError):
+            self.close_connection = True  # Client gave up waiting (deadline)
+
+    def dispatch(self):
+        url = urlparse(self.path)
+        if url.path == "/_scenario":
+            self.control(parse_qs(url.query))
+        elif url.path.startswith("/api/randomquote"):
+            self.quote()
+        elif url.path == "/w/api.php":
+            self.qotd(parse_qs(url.query))
+        elif url.path == "/ota/manifest.json":
+            self.ota_manifest()
+        elif url.path == "/ota/firmware.bin":
+            self.ota_image(self.image)
+        elif url.path == "/ota/patch.bin" and self.patch:
+            self.ota_image(self.patch)
+        else:
+            self.send_body(404, b'{"error":"not found"}')
+
+    def control(self, query):
+        if "name" in query:
+            params = {k: v[0] for k, v in query.items() if k != "name"}
+            try:
+                self.state.set(query["name"][0], params)
+            except ValueError as err:
+                self.send_body(400, json.dumps({"error": str(err)}).encode())
+                return
+        self.send_body(200, json.dumps(self.state.describe()).encode())
+
+    def quote(self):
+        name, params, count, (quote, author, tags) = self.state.next_request("quote")
+        doc = {"quote": quote, "author": author, "tags": tags}
+        if name == "oversize" or (name == "slow_reuse" and self.served == 1):
+            doc["quote"] = (quote + " ") * (1 + 600 // len(quote))
+        elif name == "oversize_body":
+            doc["tags"] = "x" * params["size"]
+        elif name == "missing_fields":
+            del doc["author"]
+        self.respond(name, params, count, doc)
+
+    def qotd(self, query):
+        name, params, count, _ = self.state.next_request("qotd")
+        title = query.get("titles", ["Wikiquote:Quote_of_the_day/January_1,_2025"])[0]
+        try:
+            day = int(title.rsplit("_", 2)[-2].rstrip(","))
+        except (IndexError, ValueError):
+            day = 1
+        content = QOTD[day % len(QOTD)]
+        if name == "oversize":
+            content = content.replace("|quote=", "|quote=" + "Lorem ipsum dolor sit amet. " * 10)
+        elif name == "missing_fields":
+            content = content.split("|author=")[0] + "}}"
+        page = {
+            "ns": 4,
+            "title": title.replace("_", " "),
+            "revisions": [{"slots": {"main": {
+                "contentmodel": "wikitext", "contentformat": "text/x-wiki", "content": content}}}],
+        }
+        doc = {"batchcomplete": True, "query": {"pages": [page]}}
+        if name == "oversize_body":
+            doc["padding"] = "x" * params["size"]
+
+        # Validators change with the content, so scenarios that alter the
+        # page never match an earlier ETag
+        etag = '"%s"' % hashlib.sha1((title + content).encode("utf-8")).hexdigest()[:16]
+        try:
+            date = datetime.strptime(title.rsplit("/", 1)[-1], "%B_%d,_%Y")
+        except ValueError:
+            date = datetime(2025, 1, 1)
+        last_modified = format_datetime(date.replace(tzinfo=timezone.utc), usegmt=True)
+        validators = {"ETag": etag, "Last-Modified": last_modified}
+
+        if_none_match = self.headers.get("If-None-Match")
+        if_modified_since = self.headers.get("If-Modified-Since")
+        if name == "ok" and (if_none_match == etag or
+                             (if_none_match is None and if_modified_since == last_modified)):
+            self.send_body(304, b"", headers=validators)
+            return
+        self.respond(name, params, count, doc, headers=validators,
+                     ensure_ascii="1" not in query.get("utf8", []))
+
+    def ota_manifest(self):
+        name, params, count, _ = self.state.next_request("ota")
+        doc = {"version": image_version(self.image), "url": "/ota/firmware.bin",
+               "size": len(self.image), "sha256": hashlib.sha256(self.image).hexdigest()}
+        if self.patch:
+            doc["patch"] = {"from": self.patch_from, "url": "/ota/patch.bin", "size": len(self.patch)}
+        if name == "maintenance":
+            doc["maintenance"] = params["minutes"]
+        self.respond(name, params, count, doc)
+
+    def ota_image(self, body):
+        name, params, count, _ = self.state.next_request("ota")
+        if name == "corrupt":
+            middle = len(body) // 2
+            body = body[:middle] + bytes([body[middle] ^ 0xFF]) + body[middle + 1:]
+        self.respond(name, params, count, None, body=body, content_type="application/octet-stream")
+
+    def respond(self, name, params, count, doc, headers=None, ensure_ascii=False,
+                body=None, content_type=JSON_TYPE):
+        delay_ms = 0
+        if name == "latency":
+            delay_ms = params["delay_ms"]
+            time.sleep(delay_ms / 1000)
+        elif name == "error":
+            self.send_body(params["status"], b'{"error":"mock failure"}')
+            return
+        elif name == "flaky" and count % 2 == 0:
+            self.send_body(503, b'{"error":"try again"}')
+            return
+        elif name == "slow_reuse" and self.served > 1:
+            delay_ms = params["delay_ms"]
+            time.sleep(delay_ms / 1000)
+
+        if body is None:
+            body = json.dumps(doc, ensure_ascii=ensure_ascii).encode("utf-8")
+        if name == "malformed":
+            body = body[: len(body) // 2]
+
+        if name == "chunked":
+            self.send_chunked(body, params["chunk"], params["delay_ms"], headers, content_type)
+        else:
+            self.send_body(200, body, delay_ms, headers, content_type)
+
+    def send_body(self, status, body, delay_ms=0, headers=None, content_type=JSON_TYPE):
+        self.send_response(status)
+        if delay_ms:
+            self.send_header("X-Mock-Delay-Ms", str(delay_ms))
+        for key, value in (headers or {}).items():
+            self.send_header(key, value)
+        self.send_header("Content-Type", content_type)
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def send_chunked(self, body, chunk, delay_ms, headers=None, content_type=JSON_TYPE):
+        chunks = (len(body) + chunk - 1) // chunk
+        self.send_response(200)
+        self.send_header("X-Mock-Delay-Ms", str(chunks * delay_ms))
+        for key, value in (headers or {}).items():
+            self.send_header(key, value)
+        self.send_header("Content-Type", content_type)
+        self.send_header("Transfer-Encoding", "chunked")
+        self.end_headers()
+        for offset in range(0, len(body), chunk):
+            part = body[offset:offset + chunk]
+            self.wfile.write(b"%x\r\n%s\r\n" % (len(part), part))
+            self.wfile.flush()
+            time.sleep(delay_ms / 1000)
+        self.wfile.write(b"0\r\n\r\n")
+
+    def log_message(self, fmt, *args):
+        if not self.quiet:
+            print("mock: " + fmt % args, flush=True)
+
+
+def ensure_test_ca(cert_dir):
+    """Create a test CA and a localhost/127.0.0.1 server certificate if missing."""
+    ca_key = os.path.join(cert_dir, "ca.key")
+    ca_pem = os.path.join(cert_dir, "ca.pem")
+    key = os.path.join(cert_dir, "server.key")
+    pem = os.path.join(cert_dir, "server.pem")
+    if all(os.path.exists(p) for p in (ca_pem, key, pem)):
+        return ca_pem, key, pem
+
+    os.makedirs(cert_dir, exist_ok=True)
+    ext = os.path.join(cert_dir, "server.ext")
+    with open(ext, "w") as f:
+        f.write("subjectAltName=DNS:localhost,IP:127.0.0.1\n"
+                "extendedKeyUsage=serverAuth\n")
+
+    def openssl(*args):
+        subprocess.run(["openssl", *args], check=True, capture_output=True)
+
+    # ECDSA P-256, the key type the device prefers for fast handshakes
+    openssl("ecparam", "-name", "prime256v1", "-genkey", "-noout", "-out", ca_key)
+    openssl("req", "-x509", "-new", "-key", ca_key, "-days", "3650",
+            "-subj", "/CN=Quote Display Test CA", "-out", ca_pem)
+    openssl("ecparam", "-name", "prime256v1", "-genkey", "-noout", "-out", key)
+    csr = os.path.join(cert_dir, "server.csr")
+    openssl("req", "-new", "-key", key, "-subj", "/CN=localhost", "-out", csr)
+    openssl("x509", "-req", "-in", csr, "-CA", ca_pem, "-CAkey", ca_key,
+            "-CAcreateserial", "-days", "825", "-extfile", ext, "-out", pem)
+    return ca_pem, key, pem
+
+
+def serve(server):
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Mock quote API for the host simulator")
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=8080, help="HTTP port (0 = off)")
+    parser.add_argument("--tls-port", type=int, default=0, help="HTTPS port (0 = off)")
+    parser.add_argument("--cert-dir", default="build-host/mock_certs")
+    parser.add_argument("--scenario", default="ok", choices=sorted(SCENARIOS))
+    parser.add_argument("--quiet", action="store_true", help="Do not log requests")
+    parser.add_argument("--ota-image", help="Firmware image to offer (default: generated)")
+    parser.add_argument("--ota-version", default="1.1.0", help="Version of the generated image")
+    parser.add_argument("--ota-size", type=int, default=1024 * 1024, help="Size of the generated image")
+    parser.add_argument("--ota-base", help="Image the device runs, for a patch (generated if missing)")
+    args = parser.parse_args()
+
+    QuoteHandler.state = ScenarioState(args.scenario)
+    QuoteHandler.quiet = args.quiet
+    base = None
+    if args.ota_base and os.path.exists(args.ota_base):
+        with open(args.ota_base, "rb") as f:
+            base = f.read()
+    elif args.ota_base:
+        base = build_image(BASE_VERSION, args.ota_size)
+        with open(args.ota_base, "wb") as f:
+            f.write(base)
+    if args.ota_image:
+        with open(args.ota_image, "rb") as f:
+            QuoteHandler.image = f.read()
+    elif base:
+        QuoteHandler.image = derive_image(base, args.ota_version)
+    else:
+        QuoteHandler.image = build_image(args.ota_version, args.ota_size)
+    print(f"Firmware {image_version(QuoteHandler.image)} ({len(QuoteHandler.image)} bytes) "
+          f"at /ota/manifest.json", flush=True)
+    if base:
+        QuoteHandler.patch, _ = make_patch(base, QuoteHandler.image)
+        QuoteHandler.patch_from = base_digest(base).hex()
+        print(f"Patch from {image_version(base)} ({args.ota_base}): {len(QuoteHandler.patch)} bytes, "
+              f"{100 * len(QuoteHandler.patch) / len(QuoteHandler.image):.1f}% of the image", flush=True)
+
+    servers = []
+    if args.port:
+        servers.append(ThreadingHTTPServer((args.host, args.port), QuoteHandler))
+        print(f"Mock quote API on http://{args.host}:{args.port}/api/randomquote "
+              f"and /w/api.php", flush=True)
+    if args.tls_port:
+        ca_pem, key, pem = ensure_test_ca(args.cert_dir)
+        tls = ThreadingHTTPServer((args.host, args.tls_port), QuoteHandler)
+        context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+        context.load_cert_chain(pem, key)
+        tls.socket = context.wrap_socket(tls.socket, server_side=True)
+        servers.append(tls)
+        print(f"Mock quote API on https://localhost:{args.tls_port}/api/randomquote "
+              f"(QUOTE_SIM_CA={ca_pem})", flush=True)
+    if not servers:
+        sys.exit("Nothing to serve: both --port and --tls-port are 0")
+
+    for server in servers[1:]:
+        threading.Thread(target=serve, args=(server,), daemon=True).start()
+    serve(servers[0])
+
+
+if __name__ == "__main__":
+    main()